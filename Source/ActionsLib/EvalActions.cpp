@@ -17,6 +17,7 @@
 #include "Config.h"
 #include "SimpleEvaluator.h"
 #include "SimpleOutputWriter.h"
+#include "BeamSearchDecoder.h"
 #include "Criterion.h"
 #include "BestGpu.h"
 #include "ScriptableObjects.h"
@@ -244,7 +245,11 @@ void DoWriteOutput(const ConfigParameters& config)
                            config(L"traceNodeNamesCategory", ConfigParameters::Array(stringargvector())),
                            config(L"traceNodeNamesSparse",   ConfigParameters::Array(stringargvector())));
 
-    SimpleOutputWriter<ElemType> writer(net, 1);
+    // with MPI, 'outputPath' outputs are computed on a separate partition of the data by each worker, which writes them to its own files;
+    // mergeDistributedOutput = true merges binary outputs into one file per node (see SimpleOutputWriter)
+    bool enableDistributedMBReading = config(L"distributedMBReading", GetDistributedMBReadingDefaultValue(config, testDataReader));
+    bool mergeDistributedOutput = config(L"mergeDistributedOutput", false);
+    SimpleOutputWriter<ElemType> writer(net, 1, MPIWrapper::GetInstance(), enableDistributedMBReading, mergeDistributedOutput);
 
     if (config.Exists("writer"))
     {
@@ -266,3 +271,95 @@ void DoWriteOutput(const ConfigParameters& config)
 
 template void DoWriteOutput<float>(const ConfigParameters& config);
 template void DoWriteOutput<double>(const ConfigParameters& config);
+
+// ===========================================================================
+// DoBeamSearch() - implements CNTK "beamSearch" command
+// Decodes one output sequence per input sequence with a BeamSearchDecoder and writes the result as text,
+// one line per input sequence (or, for numHypotheses > 1, one line "score<TAB>tokens" per hypothesis and an empty line after each input).
+// The reader must deliver one sequence per minibatch, which is the case for non-truncated reading with minibatchSize = 1.
+// ===========================================================================
+
+template <typename ElemType>
+void DoBeamSearch(const ConfigParameters& config)
+{
+    ConfigParameters readerConfig(config(L"reader"));
+    readerConfig.Insert("randomize", "None"); // we don't want randomization when output results
+
+    DataReader testDataReader(readerConfig);
+
+    size_t mbSize = config(L"minibatchSize", "1");
+    size_t epochSize = config(L"epochSize", "0");
+    if (epochSize == 0)
+        epochSize = requestDataSize;
+
+    vector<wstring> scoreNodeNames;
+    let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"scoreNodeName", scoreNodeNames);
+    if (scoreNodeNames.size() != 1)
+        InvalidArgument("beamSearch command: Exactly one 'scoreNodeName' must be specified.");
+
+    wstring tokenNodeName = config(L"tokenNodeName");
+    size_t startSymbol = config(L"startSymbol");
+    size_t endSymbol = config(L"endSymbol");
+    size_t beamWidth = config(L"beamWidth", "5");
+    size_t maxLength = config(L"maxLength", "100");
+    double lengthNormalization = config(L"lengthNormalization", "0");
+    size_t numHypotheses = config(L"numHypotheses", "1");
+    wstring outputPath = config(L"outputPath");
+
+    // load a label mapping if requested, otherwise token indices are written
+    vector<string> labelMapping;
+    wstring labelMappingFile = config(L"labelMappingFile", L"");
+    if (!labelMappingFile.empty())
+        File::LoadLabelFile(labelMappingFile, labelMapping);
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+
+    BeamSearchDecoder<ElemType> decoder(net, tokenNodeName, scoreNodeNames[0], startSymbol, endSymbol, beamWidth, maxLength, lengthNormalization);
+    let& sourceNodes = decoder.SourceInputNodes();
+    StreamMinibatchInputs inputMatrices = DataReaderHelpers::RetrieveInputMatrices(sourceNodes);
+
+    testDataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), epochSize);
+    testDataReader.SetNumParallelSequences(1);
+
+    File::MakeIntermediateDirs(outputPath);
+    File outputFile(outputPath, fileOptionsWrite | fileOptionsText);
+    FILE* f = outputFile;
+
+    size_t numSequences = 0;
+    size_t actualMBSize;
+    const size_t numIterationsBeforePrintingProgress = 100;
+    size_t numItersSinceLastPrintOfProgress = 0;
+    while (DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(testDataReader, net, nullptr, false, false, inputMatrices, actualMBSize, nullptr))
+    {
+        auto hypotheses = decoder.Decode(numHypotheses);
+        for (let& hyp : hypotheses)
+        {
+            if (numHypotheses > 1)
+                fprintfOrDie(f, "%f\t", hyp.score);
+            for (size_t i = 0; i < hyp.tokens.size(); i++)
+            {
+                let token = hyp.tokens[i];
+                if (labelMapping.empty())
+                    fprintfOrDie(f, i == 0 ? "%d" : " %d", (int)token);
+                else if (token < labelMapping.size())
+                    fprintfOrDie(f, i == 0 ? "%s" : " %s", labelMapping[token].c_str());
+                else
+                    RuntimeError("beamSearch command: Token %d is not in the label mapping file.", (int)token);
+            }
+            fprintfOrDie(f, "\n");
+        }
+        if (numHypotheses > 1)
+            fprintfOrDie(f, "\n");
+        numSequences++;
+
+        numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
+
+        testDataReader.DataEnd();
+    }
+
+    outputFile.Flush();
+    fprintf(stderr, "Written to %ls\nTotal Sequences Decoded = %lu\n", outputPath.c_str(), (unsigned long)numSequences);
+}
+
+template void DoBeamSearch<float>(const ConfigParameters& config);
+template void DoBeamSearch<double>(const ConfigParameters& config);
@@ -12,6 +12,9 @@
 #include "ScriptableObjects.h"
 #include "BrainScriptEvaluator.h"
 #include "BrainScriptParser.h"
+#include "MPIWrapper.h"
+#include "fileutil.h"
+#include "Globals.h"
 
 function<ComputationNetworkPtr(DEVICEID_TYPE)> GetCreateNetworkFn(const ScriptableObjects::IConfigRecord& config)
 {
@@ -34,6 +37,56 @@ function<ComputationNetworkPtr(DEVICEID_TYPE)> GetCreateNetworkFn(const ConfigPa
     NOT_IMPLEMENTED;
 } // old CNTK config does not support lambdas
 
+// collect the source files a parse tree was read from (the BrainScript source itself, cntk.core.bs and all user includes),
+// and determine whether source outside of the core lib reads files while being evaluated (e.g. initFromFilePath or BS.Network.Load()).
+// Source files are stored in one array, so ordering them by address orders them the way they were read.
+static void CollectNetworkSources(const BS::ExpressionPtr& expr, set<const BS::SourceFile*>& sourceFiles, bool& readsExternalFiles)
+{
+    if (!expr)
+        return;
+    if (expr->location.IsValid())
+    {
+        const BS::SourceFile* sourceFile = &expr->location.GetSourceFile();
+        sourceFiles.insert(sourceFile);
+        static const set<wstring> fileReadingNames = { L"Load", L"Edit", L"ComputationNetworkFromFile", L"ComputationNetworkWithEdits", L"initFromFilePath", L"embeddingPath" };
+        let& path = sourceFile->path;
+        let fileName = path.substr(path.find_last_of(L"/\\") + 1); // (npos + 1 == 0)
+        if (_wcsicmp(fileName.c_str(), L"cntk.core.bs") != 0) // the core lib only references these in definitions that user source must call
+        {
+            if (fileReadingNames.find(expr->id) != fileReadingNames.end())
+                readsExternalFiles = true;
+            for (let& namedArg : expr->namedArgs)
+                if (fileReadingNames.find(namedArg.first) != fileReadingNames.end())
+                    readsExternalFiles = true;
+        }
+    }
+    for (let& arg : expr->args)
+        CollectNetworkSources(arg, sourceFiles, readsExternalFiles);
+    for (let& namedArg : expr->namedArgs)
+        CollectNetworkSources(namedArg.second.second, sourceFiles, readsExternalFiles);
+}
+
+// key of a network in the network cache: 64-bit FNV-1a hash of the content of all source files the network description
+// was parsed from (which includes deviceId and precision), the random-seed setting, and the model-file version the network is stored in
+static wstring GetNetworkCacheKey(const set<const BS::SourceFile*>& sourceFiles)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    auto hashString = [&hash](const wstring& s)
+    {
+        for (wchar_t c : s)
+            hash = (hash ^ (unsigned long long)c) * 1099511628211ull;
+    };
+    for (let* sourceFile : sourceFiles)
+    {
+        hashString(L"\nsourceFile\n");
+        for (let& line : sourceFile->lines)
+            hashString(line + L"\n");
+    }
+    hashString(msra::strfun::wstrprintf(L"\nforceConstantRandomSeed = %d", (int)Globals::ShouldForceConstantRandomSeed()));
+    hashString(msra::strfun::wstrprintf(L"\nmodelVersion = %d", (int)CURRENT_CNTK_MODEL_VERSION));
+    return msra::strfun::wstrprintf(L"%016llx", hash);
+}
+
 template <class ConfigRecordType, typename ElemType>
 bool TryGetNetworkFactory(const ConfigRecordType& config, function<ComputationNetworkPtr(DEVICEID_TYPE)>& createNetworkFn)
 {
@@ -98,16 +151,58 @@ bool TryGetNetworkFactory(const ConfigRecordType& config, function<ComputationNe
             (int)deviceId, traceLevel, ElemTypeName<ElemType>(), sourceOfNetwork.c_str());
         let expr = BS::ParseConfigDictFromString(sourceOfBS, L"BrainScriptNetworkBuilder", move(includePaths));
 
+        // Optionally, the constructed and compiled network is cached as a model file in 'networkCacheDir', keyed by the source above.
+        // A later run with the same source loads that file instead of evaluating the BrainScript, which for large networks
+        // saves most of the startup time. The network is saved right after construction, i.e. with its initial parameters.
+        // The key covers all parsed source files including cntk.core.bs and user includes. Files that are only read while evaluating
+        // (e.g. initFromFilePath or BS.Network.Load()) are not known before evaluation, so such networks are not cached.
+        wstring networkCacheDir = config(L"networkCacheDir", L"");
+        wstring cachePath;
+        if (!networkCacheDir.empty())
+        {
+            set<const BS::SourceFile*> sourceFiles;
+            bool readsExternalFiles = false;
+            CollectNetworkSources(expr, sourceFiles, readsExternalFiles);
+            if (readsExternalFiles)
+                fprintf(stderr, "BuildNetworkFromDescription: Not using the network cache since the network description reads files.\n");
+            else
+                cachePath = networkCacheDir + L"/" + GetNetworkCacheKey(sourceFiles) + L".dnn";
+        }
+
         // the rest is done in a lambda that is only evaluated when a virgin network is needed
         // Note that evaluating the BrainScript *is* instantiating the network, so the evaluate call must be inside the lambda.
-        createNetworkFn = [expr](DEVICEID_TYPE /*deviceId*/)
+        createNetworkFn = [expr, cachePath, deviceId, traceLevel](DEVICEID_TYPE /*deviceId*/)
         {
+            if (!cachePath.empty() && fexists(cachePath))
+            {
+                try
+                {
+                    fprintf(stderr, "BuildNetworkFromDescription: Loading network from cache %ls\n", cachePath.c_str());
+                    auto net = make_shared<ComputationNetwork>(deviceId);
+                    net->SetTraceLevel(traceLevel);
+                    net->Load<ElemType>(cachePath); // this also compiles the network
+                    return net;
+                }
+                catch (const exception& e)
+                {
+                    fprintf(stderr, "BuildNetworkFromDescription: Ignoring network cache %ls, which could not be loaded (%s)\n", cachePath.c_str(), e.what());
+                }
+            }
+
             // evaluate the parse tree, particularly the top-level field 'network'
             // Evaluating it will create the network.
             let object = EvaluateField(expr, L"network");                   // this comes back as a BS::Object
             let network = dynamic_pointer_cast<ComputationNetwork>(object); // cast it
             if (!network)
                 LogicError("BuildNetworkFromDescription: ComputationNetwork not what it was meant to be");
+
+            // only one worker writes the cache
+            if (!cachePath.empty() && (!MPIWrapper::GetInstance() || MPIWrapper::GetInstance()->IsMainNode()))
+            {
+                fprintf(stderr, "BuildNetworkFromDescription: Saving network to cache %ls\n", cachePath.c_str());
+                msra::files::make_intermediate_dirs(cachePath);
+                network->Save(cachePath);
+            }
             return network;
         };
         return true;
@@ -309,6 +309,10 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoWriteOutput<ElemType>(commandParams);
                 }
+                else if (thisAction == "beamSearch")
+                {
+                    DoBeamSearch<ElemType>(commandParams);
+                }
                 else if (thisAction == "devtest")
                 {
                     TestCn<ElemType>(config); // for "devtest" action pass the root config instead
@@ -586,6 +590,7 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
     Globals::SetHyperCompressMemory(config(L"hyperCompressMemory", false));
+    Globals::SetNodeExecutionThreads(config(L"nodeExecutionThreads", (size_t)0));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -730,6 +735,7 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
     Globals::SetHyperCompressMemory(config(L"hyperCompressMemory", false));
+    Globals::SetNodeExecutionThreads(config(L"nodeExecutionThreads", (size_t)0));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -4095,6 +4095,18 @@ namespace CNTK
     ///
     CNTK_API size_t GetMaxNumCPUThreads();
 
+    ///
+    /// Set the process-wide setting for the number of threads used to execute independent operations of a Function concurrently
+    /// (e.g. the branches of an inception block). The CPU threads of each operation are shared among the operations that run at the same time.
+    /// 0 or 1 (the default) executes operations one after another. Only applies to computations on the CPU.
+    ///
+    CNTK_API void SetMaxNumNodeExecutionThreads(size_t numThreads);
+
+    ///
+    /// Returns the current process-wide setting for the number of threads used to execute independent operations concurrently
+    ///
+    CNTK_API size_t GetMaxNumNodeExecutionThreads();
+
     struct DistributedWorkerDescriptor
     {
         size_t m_globalRank;
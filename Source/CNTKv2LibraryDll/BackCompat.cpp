@@ -515,7 +515,22 @@ namespace CNTK
             ComputationNetworkPtr computationNetwork;
             DataType dataType = rootFunction->Outputs()[0].GetDataType();
             DeviceDescriptor device = DeviceDescriptor::CPUDevice();
-            if (compositeFunction->m_computationNetwork == nullptr)
+
+            // A network that has been optimized for inference no longer matches the Function graph; drop it so that it gets rebuilt.
+            if (compositeFunction->m_networkFusedForInference)
+            {
+                device = AsDeviceDescriptor(compositeFunction->m_computationNetwork->GetDeviceId());
+                compositeFunction->m_computationNetwork = nullptr;
+                compositeFunction->m_variableToNodeMap.clear();
+                compositeFunction->m_isVariableRootMap.clear();
+                compositeFunction->m_currentBackpropRoots.clear();
+                compositeFunction->m_currentOutputs.clear();
+                compositeFunction->m_networkMatricesAllocated = false;
+                compositeFunction->m_allNetworkRootsInGlobalEvalOrder.clear();
+                compositeFunction->m_lastRecordedParameterValueTimeStamps.clear();
+                compositeFunction->m_networkFusedForInference = false;
+            }
+            else if (compositeFunction->m_computationNetwork == nullptr)
             {
                 auto parameters = compositeFunction->Parameters();
                 if (!parameters.empty())
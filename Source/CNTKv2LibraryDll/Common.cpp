@@ -529,6 +529,16 @@ namespace CNTK
         return Microsoft::MSR::CNTK::CPUMatrix<float>::GetMaxNumThreads();
     }
 
+    void SetMaxNumNodeExecutionThreads(size_t numThreads)
+    {
+        Microsoft::MSR::CNTK::Globals::SetNodeExecutionThreads(numThreads);
+    }
+
+    size_t GetMaxNumNodeExecutionThreads()
+    {
+        return Microsoft::MSR::CNTK::Globals::GetNodeExecutionThreads();
+    }
+
     static std::atomic<bool> s_defaultUnitGainValue(true);
 
     bool DefaultUnitGainValue() 
@@ -314,26 +314,30 @@ namespace CNTK
 
     void CompositeFunction::UpdateInternalNetworkState()
     {
-        if (!m_computationNetwork)
+        auto updateNetworkState = [this](const std::unordered_map<Variable, ComputationNodeBasePtr>& variableToNodeMap)
         {
-            return;
-        }
-
-        for (const auto& function : m_allPrimitiveFunctions)
-        {
-            auto primitiveFunction = dynamic_cast<const PrimitiveFunction*>(function.get());
-            if (primitiveFunction->IsStateful())
+            for (const auto& function : m_allPrimitiveFunctions)
             {
-                for (const auto& output : function->Outputs())
+                auto primitiveFunction = dynamic_cast<const PrimitiveFunction*>(function.get());
+                if (primitiveFunction->IsStateful())
                 {
-                    auto node = m_variableToNodeMap.at(output);
-                    auto attributes = function->Attributes();
-                    auto seed = attributes[PrimitiveFunction::AttributeNameRngSeed].Value<size_t>();
-                    auto offset = attributes[PrimitiveFunction::AttributeNameRngOffset].Value<size_t>();
-                    node->As<RngUser>()->SetRngState(seed, offset);
+                    for (const auto& output : function->Outputs())
+                    {
+                        auto node = variableToNodeMap.at(output);
+                        auto attributes = function->Attributes();
+                        auto seed = attributes[PrimitiveFunction::AttributeNameRngSeed].Value<size_t>();
+                        auto offset = attributes[PrimitiveFunction::AttributeNameRngOffset].Value<size_t>();
+                        node->As<RngUser>()->SetRngState(seed, offset);
+                    }
                 }
             }
-        }
+        };
+
+        if (m_computationNetwork)
+            updateNetworkState(m_variableToNodeMap);
+
+        for (const auto& network : m_inactiveNetworks)
+            updateNetworkState(network.m_variableToNodeMap);
     }
 
     // Names of the dynamic axes in the CNTK engine for some special sets of dynamic axes values
@@ -388,7 +392,13 @@ namespace CNTK
             NDArrayViewPtr value = variable.IsConstant() ? Constant(variable).Value() : Parameter(variable).Value();
             std::shared_ptr<const Matrix<ElementType>> valueMatrix = variable.IsConstant() ? value->GetMatrix<ElementType>() : value->GetWritableMatrix<ElementType>();
 
-            if (variable.IsParameter() || (valueMatrix->GetDeviceId() == network->GetDeviceId()))
+            // The node of a Parameter refers to the Parameter's storage, so that updates are seen by all networks compiled
+            // for the Function; a copy would go stale, and computing with a reference on another device would move the storage.
+            if (variable.IsParameter() && (valueMatrix->GetDeviceId() != network->GetDeviceId()))
+                InvalidArgument("Parameter%S resides on device %d, but the Function is computed on device %d (-1 denotes the CPU); Parameters cannot be used on a device other than their own.",
+                                ParanthesizedName(variable.Name()).c_str(), (int)valueMatrix->GetDeviceId(), (int)network->GetDeviceId());
+
+            if (valueMatrix->GetDeviceId() == network->GetDeviceId())
                 computationNodePtr->Value() = valueMatrix->AsReference();
             else
             {
@@ -872,23 +882,116 @@ namespace CNTK
         return computationNodePtr;
     }
 
-    template <typename ElementType>
-    ComputationNetworkPtr CompositeFunction::GetComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, const std::unordered_set<Variable>& outputs, bool allocateNetworkMatrices)
+    void CompositeFunction::SwapActiveNetwork(InactiveComputationNetwork& network)
+    {
+        std::swap(m_computationNetwork, network.m_computationNetwork);
+        std::swap(m_variableToNodeMap, network.m_variableToNodeMap);
+        std::swap(m_isVariableRootMap, network.m_isVariableRootMap);
+        std::swap(m_currentBackpropRoots, network.m_currentBackpropRoots);
+        std::swap(m_currentOutputs, network.m_currentOutputs);
+        std::swap(m_networkMatricesAllocated, network.m_networkMatricesAllocated);
+        std::swap(m_allNetworkRootsInGlobalEvalOrder, network.m_allNetworkRootsInGlobalEvalOrder);
+        std::swap(m_lastRecordedParameterValueTimeStamps, network.m_lastRecordedParameterValueTimeStamps);
+        std::swap(m_networkFusedForInference, network.m_networkFusedForInference);
+    }
+
+    /*static*/ bool CompositeFunction::IsCompatibleNetwork(const ComputationNetworkPtr& network,
+                                                           const std::unordered_set<Variable>& networkBackpropRoots,
+                                                           const std::unordered_set<Variable>& networkOutputs,
+                                                           bool networkMatricesAllocated,
+                                                           bool networkFusedForInference,
+                                                           const DeviceDescriptor& device,
+                                                           const std::unordered_set<Variable>& backpropRoots,
+                                                           const std::unordered_set<Variable>& outputs,
+                                                           bool allocateNetworkMatrices)
     {
-        if (m_computationNetwork != nullptr)
+        if (AsDeviceDescriptor(network->GetDeviceId()) != device)
+            return false;
+
+        // Empty backprop roots can be served by any network, but gradients can only be computed for the roots a network was built for
+        if (!backpropRoots.empty() && (networkBackpropRoots != backpropRoots))
+            return false;
+
+        // The memory sharing structure of a network is set up for the outputs requested when its matrices were allocated
+        if (allocateNetworkMatrices && networkMatricesAllocated)
         {
-            // TODO: We should either invalidate and readapt the network if he backpropRoots change compared to what was specified when the network
-            // was last constructed, to just recreate a new network.
-            // For now just disallow changing the backpropRoots after the network is created
-            if (!backpropRoots.empty() && (m_currentBackpropRoots != backpropRoots))
-                LogicError("Changing backprop roots across different Forward calls on a CNTK composite Function is currently unsupported");
-
-            // TODO: Support changing the device across different invocations of the forward method on a Function instance
-            if (AsDeviceDescriptor(m_computationNetwork->GetDeviceId()) != device)
-                LogicError("Changing device across different Forward calls on a CNTK composite Function is currently unsupported");
+            for (const auto& output : outputs)
+            {
+                if (networkOutputs.find(output) == networkOutputs.end())
+                    return false;
+            }
         }
-        else
+
+        // Networks that are not used for computation are built to be saved, which a network optimized for inference cannot be
+        return allocateNetworkMatrices || !networkFusedForInference;
+    }
+
+    bool CompositeFunction::ActivateCompatibleNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, const std::unordered_set<Variable>& outputs, bool allocateNetworkMatrices)
+    {
+        if ((m_computationNetwork != nullptr) &&
+            IsCompatibleNetwork(m_computationNetwork, m_currentBackpropRoots, m_currentOutputs, m_networkMatricesAllocated, m_networkFusedForInference, device, backpropRoots, outputs, allocateNetworkMatrices))
+        {
+            return true;
+        }
+
+        // Most recently used networks first
+        for (auto iter = m_inactiveNetworks.rbegin(); iter != m_inactiveNetworks.rend(); ++iter)
+        {
+            if (IsCompatibleNetwork(iter->m_computationNetwork, iter->m_currentBackpropRoots, iter->m_currentOutputs, iter->m_networkMatricesAllocated, iter->m_networkFusedForInference, device, backpropRoots, outputs, allocateNetworkMatrices))
+            {
+                ActivateInactiveNetwork(std::next(iter).base());
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void CompositeFunction::DeactivateActiveNetwork()
+    {
+        if (m_computationNetwork == nullptr)
+            return;
+
+        m_inactiveNetworks.push_back(InactiveComputationNetwork());
+        SwapActiveNetwork(m_inactiveNetworks.back());
+        if (m_inactiveNetworks.size() > s_maxNumInactiveNetworks)
+            m_inactiveNetworks.erase(m_inactiveNetworks.begin());
+    }
+
+    void CompositeFunction::ActivateInactiveNetwork(std::vector<InactiveComputationNetwork>::iterator inactiveNetwork)
+    {
+        InactiveComputationNetwork network = std::move(*inactiveNetwork);
+        m_inactiveNetworks.erase(inactiveNetwork);
+        DeactivateActiveNetwork();
+        SwapActiveNetwork(network);
+    }
+
+    bool CompositeFunction::ActivateNetwork(const ComputationNetworkPtr& network)
+    {
+        if (network == nullptr)
+            return false;
+
+        if (m_computationNetwork == network)
+            return true;
+
+        auto iter = std::find_if(m_inactiveNetworks.begin(), m_inactiveNetworks.end(), [&network](const InactiveComputationNetwork& inactiveNetwork) {
+            return inactiveNetwork.m_computationNetwork == network;
+        });
+        if (iter == m_inactiveNetworks.end())
+            return false;
+
+        ActivateInactiveNetwork(iter);
+        return true;
+    }
+
+    template <typename ElementType>
+    ComputationNetworkPtr CompositeFunction::GetComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, const std::unordered_set<Variable>& outputs, bool allocateNetworkMatrices)
+    {
+        if (!ActivateCompatibleNetwork(device, backpropRoots, outputs, allocateNetworkMatrices))
         {
+            // None of the networks compiled so far can serve this request; keep the current one around and build a new one
+            DeactivateActiveNetwork();
+
             m_computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
 
             ComputationNetworkBuilder<ElementType> builder(*m_computationNetwork);
@@ -988,6 +1091,31 @@ namespace CNTK
             m_computationNetwork->SetTraceLevel(Internal::GetComputationNetworkTraceLevel());
             m_computationNetwork->CompileNetwork();
 
+            // Without backprop roots this network can only ever be used for inference (backprop roots cannot be added later),
+            // so fold convolution bias/batch-normalization/ReLU epilogues into the convolutions. Networks that are only
+            // built to be saved (no matrices allocated) are left intact.
+            if (backpropRoots.empty() && allocateNetworkMatrices)
+            {
+                auto fusedNodes = m_computationNetwork->FuseConvolutionBiasActivation<ElementType>();
+                if (!fusedNodes.empty())
+                {
+                    // Variables that referred to a removed node now refer to the node computing their value, or are
+                    // dropped if that value no longer exists (they cannot be requested, see the 'output' group above).
+                    for (auto iter = m_variableToNodeMap.begin(); iter != m_variableToNodeMap.end();)
+                    {
+                        auto fusedIter = fusedNodes.find(iter->second);
+                        if (fusedIter == fusedNodes.end())
+                            ++iter;
+                        else if (fusedIter->second)
+                            (iter++)->second = fusedIter->second;
+                        else
+                            iter = m_variableToNodeMap.erase(iter);
+                    }
+                    m_computationNetwork->CompileNetwork();
+                    m_networkFusedForInference = true;
+                }
+            }
+
             // Verify that the shapes of the output Variables that we computed match the corresponding nodes in the ComputationNetwork
             for (auto varNodePair : m_variableToNodeMap)
             {
@@ -1403,7 +1531,7 @@ namespace CNTK
 
         BackPropStatePtr backpropStatePtr;
         if (outputsToRetainBackwardStateFor.size() > 0)
-            backpropStatePtr = MakeSharedObject<CNTKBackPropState>(this->shared_from_this(), computeDevice, GetCurrentBackpropRootsTimeStamps());
+            backpropStatePtr = MakeSharedObject<CNTKBackPropState>(this->shared_from_this(), computeDevice, GetCurrentBackpropRootsTimeStamps(), m_computationNetwork);
 
         return backpropStatePtr;
     }
@@ -1416,6 +1544,11 @@ namespace CNTK
         if (backpropState == nullptr)
             InvalidArgument("Invalid backprop state specified");
 
+        // The Forward call that produced the state may have used a network other than the currently active one
+        if (!ActivateNetwork(backpropState->Network()))
+            LogicError("The specified backprop state cannot be used for backpropagation as the network it was created for is no longer cached by the Function;"
+                       " too many Forward calls with other devices, outputs or backprop roots were made since");
+
         // TODO: Support multiple concurrent backprop states
         std::unordered_map<Variable, uint64_t> currentBackpropRootTimeStamps = GetCurrentBackpropRootsTimeStamps();
         if (backpropState->BackpropRootsForwardTimeStamps() != currentBackpropRootTimeStamps)
@@ -16,8 +16,8 @@ namespace CNTK
     class CNTKBackPropState final : public BackPropState
     {
     public:
-        CNTKBackPropState(const FunctionPtr& function, const DeviceDescriptor& computeDevice, const std::unordered_map<Variable, uint64_t>& backpropRootsForwardTimeStamps)
-            : BackPropState(function, computeDevice), m_backpropRootsForwardTimeStamps(backpropRootsForwardTimeStamps)
+        CNTKBackPropState(const FunctionPtr& function, const DeviceDescriptor& computeDevice, const std::unordered_map<Variable, uint64_t>& backpropRootsForwardTimeStamps, const Microsoft::MSR::CNTK::ComputationNetworkPtr& network)
+            : BackPropState(function, computeDevice), m_backpropRootsForwardTimeStamps(backpropRootsForwardTimeStamps), m_network(network)
         {}
 
         const std::unordered_map<Variable, uint64_t>& BackpropRootsForwardTimeStamps() const
@@ -25,8 +25,17 @@ namespace CNTK
             return m_backpropRootsForwardTimeStamps; 
         }
 
+        // The network that the Forward call which created this state was computed with
+        Microsoft::MSR::CNTK::ComputationNetworkPtr Network() const
+        {
+            return m_network.lock();
+        }
+
     private:
         std::unordered_map<Variable, uint64_t> m_backpropRootsForwardTimeStamps;
+
+        // Not owned, so that a state does not keep a network alive that its Function has already discarded
+        std::weak_ptr<Microsoft::MSR::CNTK::ComputationNetwork> m_network;
     };
     typedef std::shared_ptr<CNTKBackPropState> CNTKBackPropStatePtr;
 
@@ -197,7 +206,7 @@ namespace CNTK
 
         CompositeFunction(const FunctionPtr& rootFunction, std::unordered_set<FunctionPtr>&& allPrimitiveFunctions, const std::wstring& name, const std::wstring& uid = Internal::GenerateUid(L"CompositeFunction"))
             : Function({}, Dictionary(), rootFunction, name, uid),
-            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false)
+            m_allPrimitiveFunctions(std::move(allPrimitiveFunctions)), m_networkMatricesAllocated(false), m_networkFusedForInference(false)
         {}
 
         std::vector<Variable> DetermineInputs() const
@@ -237,6 +246,53 @@ namespace CNTK
         // Copy state info from source function graph into' this' function graph.
         void CopyState(const CompositeFunction& source);
 
+        // The state of a compiled ComputationNetwork that is not the active one. m_computationNetwork and the related members
+        // always describe the active network; networks compiled earlier for other devices, backprop roots or output sets
+        // are parked in m_inactiveNetworks, so that switching back to them (e.g. alternating between training and evaluation)
+        // does not require a recompilation. All networks share the storage of the Parameters, which their nodes refer to.
+        struct InactiveComputationNetwork
+        {
+            Microsoft::MSR::CNTK::ComputationNetworkPtr m_computationNetwork;
+            std::unordered_map<Variable, Microsoft::MSR::CNTK::ComputationNodeBasePtr> m_variableToNodeMap;
+            std::unordered_map<Variable, bool> m_isVariableRootMap;
+            std::unordered_set<Variable> m_currentBackpropRoots;
+            std::unordered_set<Variable> m_currentOutputs;
+            bool m_networkMatricesAllocated = false;
+            std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr> m_allNetworkRootsInGlobalEvalOrder;
+            std::unordered_map<Parameter, size_t> m_lastRecordedParameterValueTimeStamps;
+            bool m_networkFusedForInference = false;
+        };
+
+        // Exchanges the active network (see m_computationNetwork and friends) with the specified inactive one.
+        void SwapActiveNetwork(InactiveComputationNetwork& network);
+
+        // Parks the active network, if any, as the most recently used inactive one. Beyond s_maxNumInactiveNetworks,
+        // the least recently used inactive network is discarded.
+        void DeactivateActiveNetwork();
+
+        // Makes the specified inactive network the active one.
+        void ActivateInactiveNetwork(std::vector<InactiveComputationNetwork>::iterator inactiveNetwork);
+
+        // Makes the specified network the active one. Returns false if it is no longer cached.
+        bool ActivateNetwork(const Microsoft::MSR::CNTK::ComputationNetworkPtr& network);
+
+        // Makes a previously compiled network that can serve the specified request the active one.
+        // Returns false, leaving the active network untouched, if there is no such network.
+        bool ActivateCompatibleNetwork(const DeviceDescriptor& device,
+                                       const std::unordered_set<Variable>& backpropRoots,
+                                       const std::unordered_set<Variable>& outputs,
+                                       bool allocateNetworkMatrices);
+
+        static bool IsCompatibleNetwork(const Microsoft::MSR::CNTK::ComputationNetworkPtr& network,
+                                        const std::unordered_set<Variable>& networkBackpropRoots,
+                                        const std::unordered_set<Variable>& networkOutputs,
+                                        bool networkMatricesAllocated,
+                                        bool networkFusedForInference,
+                                        const DeviceDescriptor& device,
+                                        const std::unordered_set<Variable>& backpropRoots,
+                                        const std::unordered_set<Variable>& outputs,
+                                        bool allocateNetworkMatrices);
+
         template <typename ElementType>
         Microsoft::MSR::CNTK::ComputationNetworkPtr GetComputationNetwork(const DeviceDescriptor& device,
                                                                           const std::unordered_set<Variable>& backpropRoots,
@@ -314,6 +370,17 @@ namespace CNTK
 
         std::unordered_map<Parameter, size_t> m_lastRecordedParameterValueTimeStamps;
 
+        // True if the cached network has been optimized for inference (see ComputationNetwork::FuseConvolutionBiasActivation)
+        // and hence cannot be saved or used to compute gradients.
+        bool m_networkFusedForInference;
+
+        // Networks compiled earlier for other devices, backprop roots or output sets, see InactiveComputationNetwork.
+        // Ordered from the least to the most recently used one.
+        std::vector<InactiveComputationNetwork> m_inactiveNetworks;
+
+        // Each cached network holds its own intermediate matrices, so only this many are kept in addition to the active one
+        static const size_t s_maxNumInactiveNetworks = 4;
+
         // Version history:
         // 1 -- initial version.
         // 2 -- add support for stateful functions (with corresponding nodes inheriting from RngUser).
@@ -16,5 +16,6 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_enableHyperCompressMemory(false);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<size_t> Globals::m_nodeExecutionThreads(0);
 
 }}}
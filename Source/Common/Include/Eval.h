@@ -355,6 +355,39 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPassStreams - Evaluate the next chunk of several independent streams (e.g. concurrent audio streams)
+    // together in one minibatch. Each stream carries its own recurrent state from chunk to chunk. The state is
+    // kept by the caller as an opaque blob, so any number of streams can be served in any order.
+    // All inputs must share the same dynamic axis.
+    // inputs - inputs[n] holds the input buffers of stream n, as for ForwardPass(). Chunks may differ in length.
+    // states - states[n] is the state of stream n after its previous chunk, or empty to start a new sequence.
+    //          On return, it holds the state after this chunk.
+    // outputs - outputs[n] receives the output buffers of stream n. Must be sized to fit the output schema.
+    //
+    virtual void ForwardPassStreams(const std::vector<Values<ElemType>>& inputs, std::vector<std::vector<ElemType>>& states, std::vector<Values<ElemType>>& outputs) = 0;
+
+    //
+    // StartBeamSearch - prepare the model for decoding output token sequences with BeamSearch(). Afterwards,
+    // GetInputSchema() returns the inputs that make up the source sequence.
+    // tokenInputName - input that receives the previously emitted token as a one-hot vector. It must have a
+    //                  dynamic axis of its own. Its history is not delayed again in the model.
+    // scoreOutputName - output on the same axis that holds the log probability (or unnormalized log score) of each token
+    // startSymbol, endSymbol - token indices that begin the decoding and that end a hypothesis
+    // beamWidth - number of partial hypotheses kept in each step
+    // maxLength - maximum number of tokens in a hypothesis
+    // lengthNormalization - hypotheses are ranked by log probability / length^lengthNormalization (0: no normalization)
+    //
+    virtual void StartBeamSearch(const std::wstring& tokenInputName, const std::wstring& scoreOutputName, size_t startSymbol, size_t endSymbol,
+                                 size_t beamWidth, size_t maxLength, double lengthNormalization) = 0;
+
+    //
+    // BeamSearch - decode a single source sequence given as one buffer per input of GetInputSchema().
+    // Returns up to numHypotheses token sequences (without start and end symbol), best first, and their
+    // normalized scores. This method is not reentrant.
+    //
+    virtual void BeamSearch(const Values<ElemType>& inputs, size_t numHypotheses, std::vector<std::vector<size_t>>& hypotheses, std::vector<double>& scores) = 0;
 };
 
 template <typename ElemType>
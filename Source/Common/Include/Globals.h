@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -31,6 +32,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetHyperCompressMemory(bool enable) { m_enableHyperCompressMemory = enable; }
         static bool ShouldEnableHyperCompressMemory() { return m_enableHyperCompressMemory; }
 
+        // Number of threads used to execute independent nodes of a network concurrently (see PARTraversalFlowControlNode); 0 or 1 means sequential execution.
+        static void SetNodeExecutionThreads(size_t numThreads) { m_nodeExecutionThreads = numThreads; }
+        static size_t GetNodeExecutionThreads() { return m_nodeExecutionThreads; }
+
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         // The global flag to enable matrices values in forward and backward prop
@@ -39,5 +44,6 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static std::atomic<bool> m_enableHyperCompressMemory;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        static std::atomic<size_t> m_nodeExecutionThreads;
     };
 }}}
@@ -0,0 +1,288 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MappedFile.h -- portable memory mapping of files (CreateFileMapping() on Windows, mmap() elsewhere)
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class MappedFileAccess
+{
+    read,      // read-only; views may still be mapped copy-on-write
+    readWrite, // the file is created if it does not exist, and views write through to it
+};
+
+// expected access pattern, used for read-ahead
+enum class MappedFileHint
+{
+    normal,
+    sequential, // read-ahead aggressively, e.g. for chunks that are parsed front to back
+    random,     // do not read ahead, e.g. for archives from which single records are picked
+};
+
+// -----------------------------------------------------------------------
+// MappedFile -- a file whose contents can be mapped into memory in views
+//
+// The access hint is passed to the OS when opening the file (Windows) or
+// applied to every view through madvise() (Linux). Views of at least
+// c_hugePageSize bytes are also marked for transparent huge pages where the
+// kernel supports them for file mappings, which reduces TLB misses on large
+// read-only views; this is a hint only and silently ignored otherwise.
+// -----------------------------------------------------------------------
+
+class MappedFile
+{
+public:
+    static const size_t c_hugePageSize = 2 * 1024 * 1024;
+
+    // Opens 'path' for mapping. With readWrite, the file is created if needed and grown to 'size' bytes if it
+    // is smaller (0 = keep the current size).
+    MappedFile(const std::wstring& path, MappedFileAccess access = MappedFileAccess::read, size_t size = 0, MappedFileHint hint = MappedFileHint::normal)
+        : m_path(path), m_access(access), m_hint(hint), m_size(0), m_truncateOnClose(SIZE_MAX)
+    {
+        bool writable = access == MappedFileAccess::readWrite;
+#ifdef _WIN32
+        m_mapping = NULL;
+        DWORD flags = hint == MappedFileHint::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : hint == MappedFileHint::random ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL;
+        m_file = CreateFileW(path.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, NULL,
+                             writable ? OPEN_ALWAYS : OPEN_EXISTING, flags, NULL);
+        if (m_file == INVALID_HANDLE_VALUE)
+            RuntimeError("MappedFile: Cannot open '%ls', error 0x%x.", path.c_str(), (unsigned int) GetLastError());
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize))
+        {
+            CloseHandle(m_file);
+            RuntimeError("MappedFile: Cannot determine the size of '%ls', error 0x%x.", path.c_str(), (unsigned int) GetLastError());
+        }
+        m_size = std::max((size_t) fileSize.QuadPart, writable ? size : 0);
+        // (mapping a larger size than the file grows the file)
+        if (m_size > 0)
+            m_mapping = CreateFileMappingW(m_file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, (DWORD) ((uint64_t) m_size >> 32), (DWORD) ((uint64_t) m_size & 0xFFFFFFFF), NULL);
+        if (m_size > 0 && m_mapping == NULL)
+        {
+            CloseHandle(m_file);
+            RuntimeError("MappedFile: Cannot map '%ls', error 0x%x.", path.c_str(), (unsigned int) GetLastError());
+        }
+#else
+        m_fd = ::open(wtocharpath(path).c_str(), writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0666);
+        if (m_fd < 0)
+            RuntimeError("MappedFile: Cannot open '%ls': %s.", path.c_str(), strerror(errno));
+        struct stat st;
+        if (fstat(m_fd, &st) != 0)
+        {
+            ::close(m_fd);
+            RuntimeError("MappedFile: Cannot determine the size of '%ls': %s.", path.c_str(), strerror(errno));
+        }
+        m_size = (size_t) st.st_size;
+        if (writable && size > m_size)
+        {
+            if (ftruncate(m_fd, (off_t) size) != 0)
+            {
+                ::close(m_fd);
+                RuntimeError("MappedFile: Cannot grow '%ls' to %d bytes: %s.", path.c_str(), (int) size, strerror(errno));
+            }
+            m_size = size;
+        }
+#endif
+    }
+
+    ~MappedFile()
+    {
+        // note: all views must have been unmapped at this point
+#ifdef _WIN32
+        if (m_mapping != NULL)
+            CloseHandle(m_mapping);
+        if (m_truncateOnClose != SIZE_MAX)
+        {
+            LARGE_INTEGER pos;
+            pos.QuadPart = (LONGLONG) m_truncateOnClose;
+            SetFilePointerEx(m_file, pos, NULL, FILE_BEGIN);
+            SetEndOfFile(m_file);
+        }
+        CloseHandle(m_file);
+#else
+        if (m_truncateOnClose != SIZE_MAX && ftruncate(m_fd, (off_t) m_truncateOnClose) != 0)
+            fprintf(stderr, "MappedFile: Cannot truncate '%ls': %s\n", m_path.c_str(), strerror(errno));
+        ::close(m_fd);
+#endif
+    }
+
+    const std::wstring& GetPath() const { return m_path; }
+    size_t GetSize() const { return m_size; }
+    bool IsWritable() const { return m_access == MappedFileAccess::readWrite; }
+
+    // set the final size of a writable file, applied when it is closed
+    void TruncateOnClose(size_t size)
+    {
+        if (!IsWritable())
+            LogicError("MappedFile: Cannot truncate '%ls', which was opened read-only.", m_path.c_str());
+        m_truncateOnClose = size;
+    }
+
+    // view offsets must be a multiple of this
+    static size_t GetViewAlignment()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        return sysInfo.dwAllocationGranularity;
+#else
+        return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    // Maps 'size' bytes at 'offset', which must be a multiple of GetViewAlignment().
+    // With copyOnWrite, the view can be modified without changing the file, also for read-only files.
+    void* MapView(size_t offset, size_t size, bool copyOnWrite = false)
+    {
+        if (offset % GetViewAlignment() != 0)
+            LogicError("MappedFile: View offset %d in '%ls' is not aligned.", (int) offset, m_path.c_str());
+        if (size == 0 || offset + size > m_size)
+            RuntimeError("MappedFile: Cannot map %d bytes at offset %d of '%ls', which has %d bytes.", (int) size, (int) offset, m_path.c_str(), (int) m_size);
+#ifdef _WIN32
+        DWORD access = copyOnWrite ? FILE_MAP_COPY : IsWritable() ? FILE_MAP_WRITE : FILE_MAP_READ;
+        void* view = MapViewOfFile(m_mapping, access, (DWORD) ((uint64_t) offset >> 32), (DWORD) ((uint64_t) offset & 0xFFFFFFFF), size);
+        if (view == NULL)
+            RuntimeError("MappedFile: Cannot map %d bytes at offset %d of '%ls', error 0x%x.", (int) size, (int) offset, m_path.c_str(), (unsigned int) GetLastError());
+#else
+        int protection = copyOnWrite || IsWritable() ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void* view = mmap(NULL, size, protection, copyOnWrite ? MAP_PRIVATE : MAP_SHARED, m_fd, (off_t) offset);
+        if (view == MAP_FAILED)
+            RuntimeError("MappedFile: Cannot map %d bytes at offset %d of '%ls': %s.", (int) size, (int) offset, m_path.c_str(), strerror(errno));
+        Advise(view, size, m_hint);
+#ifdef MADV_HUGEPAGE
+        if (size >= c_hugePageSize && !IsWritable())
+            madvise(view, size, MADV_HUGEPAGE); // (fails harmlessly if not supported for this file system)
+#endif
+#endif
+        return view;
+    }
+
+    void UnmapView(void* view, size_t size)
+    {
+#ifdef _WIN32
+        size;
+        UnmapViewOfFile(view);
+#else
+        munmap(view, size);
+#endif
+    }
+
+    // write modified pages of a view back to the file
+    void FlushView(void* view, size_t size)
+    {
+#ifdef _WIN32
+        FlushViewOfFile(view, size);
+#else
+        msync(view, size, MS_SYNC);
+#endif
+    }
+
+    // change the access hint for a view, e.g. if a reader switches from scanning to random access
+    static void Advise(void* view, size_t size, MappedFileHint hint)
+    {
+#ifdef _WIN32
+        view, size, hint; // (only supported per file on Windows)
+#else
+        int advice = hint == MappedFileHint::sequential ? MADV_SEQUENTIAL : hint == MappedFileHint::random ? MADV_RANDOM : MADV_NORMAL;
+        madvise(view, size, advice);
+#endif
+    }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    void operator=(const MappedFile&) = delete;
+
+    std::wstring m_path;
+    MappedFileAccess m_access;
+    MappedFileHint m_hint;
+    size_t m_size;
+    size_t m_truncateOnClose; // SIZE_MAX = keep size
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+// -----------------------------------------------------------------------
+// MappedView -- a region of a MappedFile that is mapped for the lifetime of this object
+//
+// Unlike MappedFile::MapView(), the offset need not be aligned.
+// -----------------------------------------------------------------------
+
+class MappedView
+{
+public:
+    MappedView(const std::shared_ptr<MappedFile>& file, size_t offset, size_t size, bool copyOnWrite = false)
+        : m_file(file), m_size(size)
+    {
+        size_t alignedOffset = offset - offset % MappedFile::GetViewAlignment();
+        m_viewSize = size + (offset - alignedOffset);
+        m_view = m_file->MapView(alignedOffset, m_viewSize, copyOnWrite);
+        m_data = (char*) m_view + (offset - alignedOffset);
+    }
+
+    // map an entire file read-only
+    explicit MappedView(const std::wstring& path, MappedFileHint hint = MappedFileHint::normal)
+        : MappedView(std::make_shared<MappedFile>(path, MappedFileAccess::read, 0, hint))
+    {
+    }
+
+    ~MappedView()
+    {
+        if (m_view)
+            m_file->UnmapView(m_view, m_viewSize);
+    }
+
+    char* Data() { return m_data; }
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    const std::shared_ptr<MappedFile>& GetFile() const { return m_file; }
+
+private:
+    MappedView(const MappedView&) = delete;
+    void operator=(const MappedView&) = delete;
+
+    // (empty files cannot be mapped)
+    MappedView(const std::shared_ptr<MappedFile>& file)
+        : m_file(file), m_view(nullptr), m_viewSize(0), m_data(nullptr), m_size(file->GetSize())
+    {
+        if (m_size > 0)
+        {
+            m_viewSize = m_size;
+            m_view = m_file->MapView(0, m_size);
+            m_data = (char*) m_view;
+        }
+    }
+
+    std::shared_ptr<MappedFile> m_file;
+    void* m_view;      // start of the mapping, aligned
+    size_t m_viewSize; // size of the mapping
+    char* m_data;      // requested start
+    size_t m_size;     // requested size
+};
+
+}}}
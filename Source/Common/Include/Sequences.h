@@ -900,6 +900,9 @@ inline const Matrix<char>& MBLayout::GetColumnsValidityMask(DEVICEID_TYPE device
 {
     CheckIsValid();
     // lazily compute the validity mask
+    // Nodes that are executed concurrently (see PARTraversalFlowControlNode) may ask for the mask of the same layout.
+    static std::mutex s_columnsValidityMaskMutex;
+    std::lock_guard<std::mutex> lock(s_columnsValidityMaskMutex);
     if (m_columnsValidityMask.IsEmpty())
     {
         assert(HasGaps()); // must only be called if there are gaps
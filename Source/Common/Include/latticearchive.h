@@ -23,6 +23,8 @@
 #include <algorithm> // for find()
 #include "simplesenonehmm.h"
 #include "Matrix.h"
+#include "MappedFile.h" // for mapping V3 lattice archives
+#include <memory>
 
 namespace msra { namespace math {
 
@@ -91,9 +93,11 @@ class lattice
     static_assert(sizeof(nodeinfo) == 2, "unexpected size of nodeeinfo"); // note: int64_t required to allow going across 32-bit boundary
     static_assert(sizeof(edgeinfowithscores) == 16, "unexpected size of edgeinfowithscores");
     static_assert(sizeof(aligninfo) == 4, "unexpected size of aligninfo");
-    std::vector<nodeinfo> nodes;
-    std::vector<edgeinfowithscores> edges;
-    std::vector<aligninfo> align;
+    static_assert(sizeof(header_v1_v2) == 32, "unexpected size of header_v1_v2");
+    // Note: these may refer to a memory-mapped V3 archive instead of owning their data (see frommappedview()).
+    mappablevector<nodeinfo> nodes;
+    mappablevector<edgeinfowithscores> edges;
+    mappablevector<aligninfo> align;
     // V2 lattices  --for a while, we will store both in RAM, until all code is updated
     static int fsgn(float f)
     {
@@ -937,6 +941,39 @@ public:
 #endif
     }
 
+    // V3 ("mappable") format: like V1, edges[] and align[] are stored in their final in-memory form (no uniq'ing),
+    // and every array is padded to a multiple of 8 bytes, so that lattices can be used in place from a memory-mapped archive.
+    // The lattice itself must start at an 8-byte aligned file offset; use fwritepadding() before taking the TOC offset.
+    static const size_t mappableversion = 3;
+    static size_t paddingbytes(size_t bytes)
+    {
+        return (8 - bytes % 8) % 8;
+    }
+    static void fwritepadding(FILE* f, size_t bytes)
+    {
+        static const char zeros[8] = {0};
+        fwriteOrDie(zeros, 1, paddingbytes(bytes), f);
+    }
+    static void freadpadding(FILE* f, size_t bytes)
+    {
+        char buf[8];
+        freadOrDie(buf, 1, paddingbytes(bytes), f);
+    }
+
+    void fwritemappable(FILE* f)
+    {
+        if (edges.size() != info.numedges || nodes.size() != info.numnodes)
+            LogicError("fwritemappable: edges[] and nodes[] must be consistent with the header (call rebuildedges() first)");
+        fwritetag(f, "LAT ", mappableversion);
+        fwriteOrDie(&info, sizeof(info), 1, f);
+        fwritevector(f, "NODE", nodes);
+        fwritepadding(f, nodes.size() * sizeof(nodeinfo));
+        fwritevector(f, "EDGE", edges);
+        fwritevector(f, "ALIG", align);
+        fwritepadding(f, align.size() * sizeof(aligninfo));
+        fputTag(f, "END ");
+    }
+
     // empty constructor, e.g. for use in minibatch source
     lattice()
     {
@@ -957,6 +994,23 @@ public:
         freadOrDie(v, sz, f);
     }
 
+    // check whether unit ids in the file need to be mapped to the user's symmap
+    template <class IDMAP>
+    static bool needsunitmapping(const IDMAP& idmap, size_t spunit)
+    {
+        // This is critical--we have a buggy lattice set that requires no mapping where mapping would fail
+        foreach_index (k, idmap)
+        {
+            if (idmap[k] != (size_t) k
+#if 1
+                && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
+#endif
+                )
+                return true;
+        }
+        return false;
+    }
+
     // read from a stream
     // This can be used on an existing structure and will replace its content. May be useful to avoid memory allocations (resize() will not shrink memory).
     // For efficiency, we will not check the inner consistency of the file here, but rather when we further process it.
@@ -998,22 +1052,8 @@ public:
                 RuntimeError("fread: out of bounds spunitid");
             }
 #endif
-            // This is critical--we have a buggy lattice set that requires no mapping where mapping would fail
-            bool needsmapping = false;
-            foreach_index (k, idmap)
-            {
-                if (idmap[k] != (size_t) k
-#if 1
-                    && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
-#endif
-                    )
-                {
-                    needsmapping = true;
-                    break;
-                }
-            }
             // map align ids to user's symmap  --the lattice gets updated in place here
-            if (needsmapping)
+            if (needsunitmapping(idmap, spunit))
             {
                 if (info.impliedspunitid != SIZE_MAX)
                     info.impliedspunitid = idmap[info.impliedspunitid];
@@ -1059,10 +1099,89 @@ public:
             // reconstruct old lattice format from this   --TODO: remove once we change to new data representation
             rebuildedges(info.impliedspunitid != spunit /*to be able to read somewhat broken V2 lattice archives*/);
         }
+        else if (version == mappableversion) // (normally used in place through frommappedview(), but it can also be read like this)
+        {
+            freadOrDie(&info, sizeof(info), 1, f);
+            freadvector(f, "NODE", nodes, info.numnodes);
+            freadpadding(f, nodes.size() * sizeof(nodeinfo));
+            if (nodes.back().t != info.numframes)
+                RuntimeError("fread: mismatch between info.numframes and last node's time");
+            freadvector(f, "EDGE", edges, info.numedges);
+            freadvector(f, "ALIG", align);
+            freadpadding(f, align.size() * sizeof(aligninfo));
+            fcheckTag(f, "END ");
+            if (needsunitmapping(idmap, spunit))
+            {
+                if (info.impliedspunitid < idmap.size())
+                    info.impliedspunitid = idmap[info.impliedspunitid];
+                foreach_index (k, align)
+                    align[k].updateunit(idmap);
+            }
+            edges2.clear();
+            uniquededgedatatokens.clear();
+        }
         else
             RuntimeError("fread: unsupported lattice format version");
     }
 
+    // use a V3 lattice in place, from a memory-mapped archive
+    // 'p' points to the lattice inside the mapped view, and 'maxbytes' is the number of bytes available from there.
+    // nodes[], edges[] and align[] will refer to the mapped memory directly, so it must outlive this lattice object.
+    // Only if unit ids must be mapped to the user's symmap, align[] is copied (on first modification).
+    template <class IDMAP>
+    void frommappedview(const char* p, size_t maxbytes, const IDMAP& idmap, size_t spunit)
+    {
+        const char* const end = p + maxbytes;
+        if (((uintptr_t) p) % 8 != 0)
+            RuntimeError("frommappedview: lattice is not 8-byte aligned in the archive");
+        auto getbytes = [&](size_t bytes) -> const char*
+        {
+            if ((size_t) (end - p) < bytes)
+                RuntimeError("frommappedview: malformed file, lattice extends beyond the end of the archive");
+            const char* q = p;
+            p += bytes;
+            return q;
+        };
+        auto gettag = [&](const char* tag) -> size_t // same as freadtag(), on memory
+        {
+            const char* q = getbytes(8);
+            if (memcmp(q, tag, 4) != 0)
+                RuntimeError("frommappedview: malformed file, tag %s expected", tag);
+            unsigned int val;
+            memcpy(&val, q + 4, sizeof(val));
+            return val;
+        };
+        if (gettag("LAT ") != mappableversion)
+            RuntimeError("frommappedview: lattice is not in mappable (V3) format");
+        memcpy(&info, getbytes(sizeof(info)), sizeof(info));
+        const size_t numnodes = gettag("NODE");
+        if (numnodes != info.numnodes || numnodes == 0)
+            RuntimeError("frommappedview: malformed file, number of nodes differs from header");
+        nodes.setview((const nodeinfo*) getbytes(numnodes * sizeof(nodeinfo)), numnodes);
+        getbytes(paddingbytes(numnodes * sizeof(nodeinfo)));
+        if (nodes.back().t != info.numframes)
+            RuntimeError("frommappedview: mismatch between info.numframes and last node's time");
+        const size_t numedges = gettag("EDGE");
+        if (numedges != info.numedges)
+            RuntimeError("frommappedview: malformed file, number of edges differs from header");
+        edges.setview((const edgeinfowithscores*) getbytes(numedges * sizeof(edgeinfowithscores)), numedges);
+        const size_t numalign = gettag("ALIG");
+        align.setview((const aligninfo*) getbytes(numalign * sizeof(aligninfo)), numalign);
+        getbytes(paddingbytes(numalign * sizeof(aligninfo)));
+        if (memcmp(getbytes(4), "END ", 4) != 0)
+            RuntimeError("frommappedview: malformed file, tag END expected");
+        // map align ids to user's symmap  --this detaches align[] from the mapped view
+        if (needsunitmapping(idmap, spunit))
+        {
+            if (info.impliedspunitid < idmap.size())
+                info.impliedspunitid = idmap[info.impliedspunitid];
+            foreach_index (k, align)
+                align[k].updateunit(idmap);
+        }
+        edges2.clear();
+        uniquededgedatatokens.clear();
+    }
+
     // parallel versions (defined in parallelforwardbackward.cpp)
     class parallelstate
     {
@@ -1213,6 +1332,23 @@ class archive
     mutable size_t currentarchiveindex;               // which archive is open
     mutable auto_file_ptr f;                          // cached archive file handle of currentarchiveindex
     std::unordered_map<std::wstring, latticeref> toc; // [key] -> (file, offset)  --table of content (.toc file)
+
+    // read-only memory mapping of an entire archive file, for using V3 lattices in place
+    // Lattices are picked from the archive in randomized order, so read-ahead is disabled.
+    mutable std::vector<std::unique_ptr<Microsoft::MSR::CNTK::MappedView>> mappedarchives; // [archiveindex] -> mapping, created on demand for V3 archives
+    const Microsoft::MSR::CNTK::MappedView& getmappedarchive(size_t archiveindex) const
+    {
+        if (mappedarchives.size() <= archiveindex)
+            mappedarchives.resize(archivepaths.size());
+        if (!mappedarchives[archiveindex])
+        {
+            if (verbosity > 0)
+                fprintf(stderr, "getmappedarchive: memory-mapping '%S'\n", archivepaths[archiveindex].c_str());
+            mappedarchives[archiveindex].reset(new Microsoft::MSR::CNTK::MappedView(archivepaths[archiveindex], Microsoft::MSR::CNTK::MappedFileHint::random));
+        }
+        return *mappedarchives[archiveindex];
+    }
+
 public:
     // construct = open the archive
     // archive() : currentarchiveindex (SIZE_MAX) {}
@@ -1346,7 +1482,21 @@ public:
             // seek to start
             fsetpos(f, offset);
             // get it
-            L.fread(f, idmap, spunit);
+            // V3 lattices are not read but used in place, from a memory mapping of the archive file.
+            // Lattices obtained like this must not outlive the archive object.
+            const size_t version = L.freadtag(f, "LAT ");
+            if (version == lattice::mappableversion)
+            {
+                const auto& mapping = getmappedarchive(archiveindex);
+                if (offset >= mapping.Size())
+                    RuntimeError("getlattice: TOC offset beyond end of archive file");
+                L.frommappedview(mapping.Data() + offset, mapping.Size() - offset, idmap, spunit);
+            }
+            else
+            {
+                fsetpos(f, offset);
+                L.fread(f, idmap, spunit);
+            }
             L.setverbosity(verbosity);
 #ifdef HACK_IN_SILENCE // hack to simulate DEL in the lattice
             const size_t silunit = getid(modelsymmap, "sil");
@@ -1378,8 +1528,9 @@ public:
     //  - check consistency (don't write out)
     //  - dump to stdout
     //  - merge two lattices (for merging numer into denom lattices)
+    //  - write the mappable V3 format, which can be used in place without unpacking
     static void convert(const std::wstring& intocpath, const std::wstring& intocpath2, const std::wstring& outpath,
-                        const msra::asr::simplesenonehmm& hset);
+                        const msra::asr::simplesenonehmm& hset, const bool mappable = false);
 };
 };
 };
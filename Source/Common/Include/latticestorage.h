@@ -12,6 +12,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <cstdio>
+#include <vector>
 
 #undef INITIAL_STRANGE // [v-hansu] intialize structs to strange values
 #define PARALLEL_SIL   // [v-hansu] process sil on CUDA, used in other files, please search this
@@ -118,5 +119,139 @@ struct aligninfo // phonetic alignment
         checkoverflow(unit, mappedunit, "aligninfo::unit");
     }
 };
+
+// mappablevector -- std::vector replacement for lattice arrays that can alternatively refer to read-only memory
+// owned by someone else, typically a memory-mapped lattice archive (V3 format), so that lattices can be used in place.
+// Read access goes to whichever storage is active. Any non-const access first copies the referenced data into
+// owned storage ("detach"), so code that modifies lattices (merging, conversion, hacks) keeps working unchanged.
+template <class T>
+class mappablevector
+{
+    std::vector<T> v; // owned storage, used if p == NULL
+    const T* p;       // if not NULL then we refer to this external read-only memory
+    size_t n;         // number of elements at p
+    void detach()
+    {
+        if (p == NULL)
+            return;
+        v.assign(p, p + n);
+        p = NULL;
+        n = 0;
+    }
+
+public:
+    typedef T value_type;
+    typedef typename std::vector<T>::iterator iterator;
+    typedef const T* const_iterator;
+
+    mappablevector()
+        : p(NULL), n(0)
+    {
+    }
+
+    // refer to external memory; caller must guarantee that it outlives this object (or the next modification)
+    void setview(const T* ptr, size_t num)
+    {
+        v.clear();
+        p = ptr;
+        n = num;
+    }
+    bool isview() const
+    {
+        return p != NULL;
+    }
+
+    size_t size() const
+    {
+        return p ? n : v.size();
+    }
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    const T* data() const
+    {
+        return p ? p : v.data();
+    }
+    const T& operator[](size_t i) const
+    {
+        return data()[i];
+    }
+    const T& back() const
+    {
+        return data()[size() - 1];
+    }
+    const_iterator begin() const
+    {
+        return data();
+    }
+    const_iterator end() const
+    {
+        return data() + size();
+    }
+
+    // non-const access detaches from external memory
+    T* data()
+    {
+        detach();
+        return v.data();
+    }
+    T& operator[](size_t i)
+    {
+        detach();
+        return v[i];
+    }
+    T& back()
+    {
+        detach();
+        return v.back();
+    }
+    iterator begin()
+    {
+        detach();
+        return v.begin();
+    }
+    iterator end()
+    {
+        detach();
+        return v.end();
+    }
+    void resize(size_t num)
+    {
+        detach();
+        v.resize(num);
+    }
+    void reserve(size_t num)
+    {
+        detach();
+        v.reserve(num);
+    }
+    void push_back(const T& val)
+    {
+        detach();
+        v.push_back(val);
+    }
+    template <class ITER>
+    void insert(iterator where, ITER first, ITER last)
+    {
+        detach(); // (no-op: 'where' was obtained through non-const end() or begin())
+        v.insert(where, first, last);
+    }
+    void clear()
+    {
+        p = NULL;
+        n = 0;
+        v.clear();
+    }
+    void shrink_to_fit()
+    {
+        v.shrink_to_fit();
+    }
+    void swap(std::vector<T>& other)
+    {
+        detach();
+        v.swap(other);
+    }
+};
 };
 };
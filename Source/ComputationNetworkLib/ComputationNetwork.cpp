@@ -443,6 +443,7 @@ bool ComputationNetwork::IsTypicalCriterionNode(ComputationNodeBasePtr nodePtr)
         nodePtr->OperationName() == OperationNameOf(LogisticNode) ||
         nodePtr->OperationName() == OperationNameOf(CrossEntropyWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(SequenceWithSoftmaxNode) ||
+        nodePtr->OperationName() == OperationNameOf(CTCWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(CrossEntropyNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassBasedCrossEntropyWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassificationErrorNode) ||
@@ -1140,6 +1141,199 @@ void ComputationNetwork::PerformSVDecomposition(const map<wstring, float>& SVDCo
     CompileNetwork();
 }
 
+// ========================================
+// Inference-time fusion of convolution epilogues.
+// A chain
+//     Convolution -> [Plus (per-map bias)] -> [BatchNormalization (spatial)] -> [RectifiedLinear]
+// is computed by the convolution node alone: BN statistics are folded into a copy of the kernel and bias,
+// and bias + ReLU are applied in the same engine call as the convolution. Every node of the chain except the
+// last one must have no other consumer and must not be an output, so that no intermediate value is observable.
+// The last node's consumers and node-group memberships are moved to the convolution node, which takes its name.
+// Must be called on a compiled network that is used for inference only; fused nodes refuse to backprop or be saved.
+// ========================================
+template <class ElemType>
+map<ComputationNodeBasePtr, ComputationNodeBasePtr> ComputationNetwork::FuseConvolutionBiasActivation()
+{
+    map<ComputationNodeBasePtr, ComputationNodeBasePtr> removedNodes;
+
+    auto parents = CreateParentsMap();
+    set<ComputationNodeBasePtr> groupedNodes;
+    for (auto group : GetAllNodeGroups())
+        groupedNodes.insert(group->begin(), group->end());
+
+    // the next node in the chain, if 'node' feeds into nothing else and is not an output
+    auto soleConsumer = [&](const ComputationNodeBasePtr& node) -> ComputationNodeBasePtr
+    {
+        const auto& consumers = parents[node];
+        if (consumers.size() != 1 || groupedNodes.find(node) != groupedNodes.end())
+            return nullptr;
+        const auto& consumer = *consumers.begin();
+        if (consumer->IsPartOfLoop() || consumer->GetMBLayout() != node->GetMBLayout() || consumer->GetSampleLayout() != node->GetSampleLayout())
+            return nullptr;
+        return consumer;
+    };
+    auto isParameter = [](const ComputationNodeBasePtr& node)
+    {
+        return node->OperationName() == OperationNameOf(LearnableParameter) && !node->HasMBLayout();
+    };
+
+    size_t numFused = 0;
+    for (const auto& node : GetNodesWithType(OperationNameOf(ConvolutionNode)))
+    {
+        auto conv = dynamic_pointer_cast<ConvolutionNode<ElemType>>(node);
+        if (!conv || !conv->SupportsFusedEpilogue() || node->IsPartOfLoop())
+            continue;
+
+        const auto& outShape = node->GetSampleLayout();
+        size_t mapAxis = outShape.GetRank() - 1;
+        size_t mapCount = outShape[mapAxis];
+
+        // a bias must broadcast along all axes but the map axis
+        auto isPerMapBias = [&](const ComputationNodeBasePtr& bias)
+        {
+            if (!isParameter(bias))
+                return false;
+            const auto& biasShape = bias->GetSampleLayout();
+            if (biasShape.GetRank() > outShape.GetRank() || biasShape.GetNumElements() != mapCount)
+                return false;
+            for (size_t k = 0; k < biasShape.GetRank(); k++)
+                if (biasShape[k] != (k == mapAxis ? mapCount : 1))
+                    return false;
+            return true;
+        };
+
+        ComputationNodeBasePtr last = conv;
+        vector<ComputationNodeBasePtr> chain;
+
+        shared_ptr<ComputationNode<ElemType>> bias;
+        auto next = soleConsumer(last);
+        if (next && next->OperationName() == OperationNameOf(PlusNode))
+        {
+            auto other = next->Input(0) == last ? next->Input(1) : next->Input(0);
+            if (other != last && isPerMapBias(other))
+            {
+                bias = dynamic_pointer_cast<ComputationNode<ElemType>>(other);
+                chain.push_back(next);
+                last = next;
+                next = soleConsumer(last);
+            }
+        }
+
+        shared_ptr<BatchNormalizationNode<ElemType>> bn;
+        if (next && next->OperationName() == OperationNameOf(BatchNormalizationNode))
+        {
+            auto candidate = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(next);
+            bool ok = candidate && candidate->Spatial() && next->Input(0) == last;
+            for (size_t i = 1; ok && i < next->GetNumInputs(); i++)
+                ok = isParameter(next->Input(i)) && next->Input(i)->GetSampleLayout().GetNumElements() == mapCount;
+            if (ok)
+            {
+                bn = candidate;
+                chain.push_back(next);
+                last = next;
+                next = soleConsumer(last);
+            }
+        }
+
+        bool applyReLU = next && next->OperationName() == OperationNameOf(RectifiedLinearNode);
+        if (applyReLU)
+        {
+            chain.push_back(next);
+            last = next;
+        }
+
+        if (chain.empty())
+            continue;
+
+        // cuDNN clamps epsilon to its minimum; fold with the value actually used
+        double epsilon = 0;
+        if (bn)
+            epsilon = bn->UseCNTKEngine() ? bn->Epsilon() : max(bn->Epsilon(), 1e-5);
+        ComputationNodeBasePtr bnNode = bn;
+        auto param = [&](size_t i) { return bn ? dynamic_pointer_cast<ComputationNode<ElemType>>(bnNode->Input(i)) : nullptr; };
+        conv->SetFusedEpilogue(bias, param(1), param(2), param(3), param(4), epsilon, applyReLU);
+
+        // move consumers and node-group memberships of the last node over to the convolution
+        InvalidateCompiledNetwork();
+        ChangeNodeInputs(last, conv);
+        for (auto groupIter : GetAllNodeGroups())
+        {
+            auto& group = *groupIter;
+            for (auto& groupNode : group)
+                if (groupNode == last)
+                    groupNode = conv;
+        }
+
+        // remove the chain, and the parameters that nothing else refers to any longer
+        set<ComputationNodeBasePtr> parameters;
+        for (const auto& chainNode : chain)
+        {
+            for (const auto& input : chainNode->GetInputs())
+                if (input != conv && find(chain.begin(), chain.end(), input) == chain.end())
+                    parameters.insert(input);
+            chainNode->DetachInputs();
+            RemoveNodeFromNet(chainNode);
+            removedNodes[chainNode] = chainNode == last ? conv : nullptr;
+        }
+        for (const auto& parameter : parameters)
+        {
+            bool used = groupedNodes.find(parameter) != groupedNodes.end();
+            for (const auto& consumer : parents[parameter])
+                used |= find(chain.begin(), chain.end(), consumer) == chain.end();
+            if (!used)
+                RemoveNodeFromNet(parameter);
+        }
+
+        // the convolution now produces what 'last' used to
+        wstring name = last->NodeName();
+        RemoveNodeFromNet(conv);
+        conv->SetNodeName(name);
+        AddNodeToNet(conv);
+
+        // keep the parents map consistent for the following matches
+        parents[conv] = parents[last];
+        numFused++;
+    }
+
+    if (TraceLevel() > 0 && numFused > 0)
+        fprintf(stderr, "FuseConvolutionBiasActivation: fused %d convolution epilogues, removed %d nodes.\n", (int)numFused, (int)removedNodes.size());
+
+    return removedNodes;
+}
+
+// ========================================
+// Int8 inference.
+// Products of a learnable parameter with data are done in int8 on CPU: weights are quantized once per output
+// channel (rows of a Times weight matrix, output maps of a convolution kernel), activations are quantized on each
+// call with a range that is either taken from the data or calibrated on the first calibrationCount calls.
+// Transposed products, sparse inputs and GPU nodes are left unchanged. The setting is not saved with the model.
+// ========================================
+template <class ElemType>
+size_t ComputationNetwork::EnableInt8Inference(size_t calibrationCount)
+{
+    size_t numTimes = 0;
+    size_t numConvolutions = 0;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (auto times = dynamic_pointer_cast<TimesNodeBase<ElemType, false>>(node))
+        {
+            if (times->EnableInt8Inference(calibrationCount))
+                numTimes++;
+        }
+        else if (auto conv = dynamic_pointer_cast<ConvolutionNode<ElemType>>(node))
+        {
+            if (node->Input(0)->OperationName() == OperationNameOf(LearnableParameter) && conv->EnableInt8Inference(calibrationCount))
+                numConvolutions++;
+        }
+    }
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "EnableInt8Inference: using int8 products in %d Times and %d Convolution nodes.\n", (int)numTimes, (int)numConvolutions);
+
+    return numTimes + numConvolutions;
+}
+
 // Helper class to form a logical DBN layer while exporting the network (used by SaveToDbnFile)
 class DbnLayer
 {
@@ -1507,6 +1701,8 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<float>
 template void ComputationNetwork::Read<float>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template map<ComputationNodeBasePtr, ComputationNodeBasePtr> ComputationNetwork::FuseConvolutionBiasActivation<float>();
+template size_t ComputationNetwork::EnableInt8Inference<float>(size_t calibrationCount);
 template /*static*/ void ComputationNetwork::SetDropoutRate<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
@@ -1518,6 +1714,8 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<double
 template void ComputationNetwork::Read<double>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template map<ComputationNodeBasePtr, ComputationNodeBasePtr> ComputationNetwork::FuseConvolutionBiasActivation<double>();
+template size_t ComputationNetwork::EnableInt8Inference<double>(size_t calibrationCount);
 template /*static*/ void ComputationNetwork::SetDropoutRate<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
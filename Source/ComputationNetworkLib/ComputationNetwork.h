@@ -13,6 +13,7 @@
 #include "ComputationNode.h"
 #include "ScriptableObjects.h"
 #include "ComputationEnvironment.h"
+#include "NodeProfiler.h"
 
 #include <map>
 #include <string>
@@ -53,7 +54,8 @@ public:
         m_isCompiled(false),
         m_areMatricesAllocated(false),
         m_pMBLayoutOfNetwork(make_shared<MBLayout>(1, 0, L"*")),
-        m_environment(make_shared<ComputationEnvironment>())
+        m_environment(make_shared<ComputationEnvironment>()),
+        m_nodeProfiler(make_shared<NodeProfiler>())
     {
         //m_pMBLayoutOfNetwork->SetAxisName(L"T");
     }
@@ -187,9 +189,9 @@ private:
     void CollectInputAndLearnableParametersRec(const ComputationNodeBasePtr& node, set<ComputationNodeBasePtr>& visited, list<ComputationNodeBasePtr>& inputs, list<ComputationNodeBasePtr>& learnableParameters);
     void ResetMBLayouts();
     bool IsCompiled() const { return m_isCompiled; }
-    bool AreMatricesAllocated() const { return m_areMatricesAllocated; }
     void VerifyIsCompiled(const char* where) const;
 public:
+    bool AreMatricesAllocated() const { return m_areMatricesAllocated; }
     void AllocateAllMatrices(const std::vector<ComputationNodeBasePtr>& evalRootNodes, const std::vector<ComputationNodeBasePtr>& outValueRootNodes, ComputationNodeBasePtr trainRootNode);
 
     // From the set of nodes extract all nodes which are used as accumulator nodes.
@@ -461,6 +463,9 @@ public:
 
     ComputationEnvironment& Environment() const { return *m_environment; }
 
+    // per-node timing of ForwardProp() and Backprop(), off by default
+    NodeProfiler& GetNodeProfiler() const { return *m_nodeProfiler; }
+
     // -----------------------------------------------------------------------
     // functions to pass on specific SGD options to nodes
     // -----------------------------------------------------------------------
@@ -768,6 +773,18 @@ public:
     template <class ElemType>
     void PerformSVDecomposition(const map<wstring, float>& SVDConfig, size_t AlignedSize);
 
+    // Inference-only rewrite: fold Convolution -> [Plus bias] -> [BatchNormalization] -> [RectifiedLinear] chains into the
+    // convolution node. Returns a map from each removed node to the node that now computes its value, or nullptr
+    // if that value is no longer available. The network must be recompiled afterwards.
+    template <class ElemType>
+    std::map<ComputationNodeBasePtr, ComputationNodeBasePtr> FuseConvolutionBiasActivation();
+
+    // Inference-only: switch the products of parameters with data in Times and Convolution nodes on CPU to int8
+    // (per-channel weight scales, activation ranges calibrated over the first calibrationCount forward calls of each
+    // node, or taken from each call's data if 0). Must be called on a compiled network. Returns the number of nodes switched.
+    template <class ElemType>
+    size_t EnableInt8Inference(size_t calibrationCount);
+
     template <class ElemType>
     void SaveToDbnFile(ComputationNetworkPtr net, const std::wstring& fileName) const;
 
@@ -1063,13 +1080,50 @@ protected:
         ComputationNodeBasePtr m_sourceNode; // one of the nodes of the loop   --TODO: What is the special meaning of this node? It seems to always be a delay node.
         int m_loopId;                        // unique loop id, index in m_allSEQNodes array
         int m_steppingDirection;             // +1 if left to right (t=0..T-1), -1 if rightt to left (t=T-1..0)
+        NodeProfiler* m_profiler;            // profiler of the network that executes the loop, set by PARTraversalFlowControlNode
 
         SEQTraversalFlowControlNode(int loopId, ComputationNodeBasePtr cur)
             : m_loopId(loopId),
-              m_sourceNode(cur)
+              m_sourceNode(cur),
+              m_stepProgramCompiled(false),
+              m_stepProgramIsDouble(false),
+              m_profiler(nullptr)
         {
             SetNodeName(L"Loop_" + m_sourceNode->NodeName());
         }
+
+    private:
+        // The loop body is compiled once into a step program that is replayed for every time step.
+        // Runs of consecutive elementwise nodes (IElementwiseNode) whose inputs share the loop's layout and
+        // dimension are fused into one blocked pass over the step's columns, operating on data pointers that
+        // are resolved once per minibatch. All other nodes are dispatched through ForwardProp(t) as usual,
+        // as are fused runs whose matrices are not dense CPU matrices in the current minibatch.
+        struct FusedElementwiseOp
+        {
+            ComputationNodeBasePtr m_node;
+            ElementWiseOperator m_op;
+            // resolved at the start of each minibatch
+            void* m_output;
+            const void* m_inputs[2];
+        };
+        struct StepInstruction
+        {
+            ComputationNodeBasePtr m_node;              // node to dispatch, or nullptr for a fused run
+            std::vector<FusedElementwiseOp> m_fusedOps; // fused run, in loop order
+            size_t m_numRows;                           // sample dimension shared by all nodes of the fused run
+            bool m_resolved;                            // fused run can be executed on raw data in this minibatch
+        };
+
+        void CompileStepProgram();
+        template <class ElemType> bool TryAddFusedOp(const ComputationNodeBasePtr& node);
+        template <class ElemType> void ResolveStepProgram();
+        template <class ElemType> static void ExecuteFusedOps(const std::vector<FusedElementwiseOp>& fusedOps, size_t offset, size_t numElements);
+
+        std::vector<StepInstruction> m_stepProgram;
+        bool m_stepProgramCompiled;
+        bool m_stepProgramIsDouble;
+
+        NodeProfiler* ActiveProfiler() const { return m_profiler && m_profiler->IsEnabled() ? m_profiler : nullptr; }
     };
 
     // -----------------------------------------------------------------------
@@ -1081,6 +1135,11 @@ protected:
     // on all frames in the node simultaneously.
     //
     // The outermost network level is also represented by this node for execution.
+    //
+    // If enabled through Globals::SetNodeExecutionThreads(), nodes that do not depend
+    // on each other are executed concurrently on a thread pool (CPU only). Besides the
+    // data flow, the schedule respects the order of nodes that accumulate into the same
+    // gradient or that are handed the same matrix by the memory sharing.
     // -----------------------------------------------------------------------
 
     class PARTraversalFlowControlNode : public FlowControlNode
@@ -1120,8 +1179,28 @@ protected:
     public:
         // this special constructor constructs the top-level network node
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
-        PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
+        PARTraversalFlowControlNode(const ComputationNetwork& network, const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+
+    private:
+        // dependencies between the top-level nodes for concurrent execution, indexed like m_nestedNodes
+        struct Schedule
+        {
+            std::vector<size_t> m_numPredecessors;
+            std::vector<std::vector<size_t>> m_successors;
+
+            void AddDependency(size_t from, size_t to);
+        };
+
+        bool ShouldExecuteConcurrently();
+        bool DetermineSchedules();
+        bool ExecuteConcurrently(const Schedule& schedule, const std::function<void(const ComputationNodeBasePtr&)>& execute);
+
+        const ComputationNetwork& m_network;
+        bool m_schedulesDetermined; // (the memory sharing structure is fixed once the network's matrices are allocated)
+        bool m_canExecuteConcurrently;
+        Schedule m_forwardPropSchedule;
+        Schedule m_backpropSchedule;
     };
 
 public:
@@ -1165,6 +1244,7 @@ private:
 
     // environment information that nodes may want to inquire, e.g. to know whether we are training
     ComputationEnvironmentPtr m_environment;
+    std::shared_ptr<NodeProfiler> m_nodeProfiler;
 
     std::map<std::wstring, std::vector<ComputationNodeBasePtr>> m_namedCriterionNodes;
 
@@ -1195,6 +1275,11 @@ private:
     // pool for matrices that can be shared across nodes
     // TODO: does this apply to anything else besides temporary node-internal intermediate results? What, for example?
     MatrixPool m_matrixPool;
+
+    // the matrices handed out by m_matrixPool in AllocateAllMatrices() and the nodes they were handed to, in order;
+    // used to keep nodes that share memory in order when executing nodes concurrently (see PARTraversalFlowControlNode)
+    std::vector<std::pair<const MatrixBase*, const ComputationNodeBase*>> m_forwardPropMatrixRequests;
+    std::vector<std::pair<const MatrixBase*, const ComputationNodeBase*>> m_backpropMatrixRequests;
 };
 typedef ComputationNetwork::ComputationNetworkPtr ComputationNetworkPtr;
 
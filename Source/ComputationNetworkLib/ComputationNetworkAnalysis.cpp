@@ -179,6 +179,27 @@ void ComputationNetwork::FormRecurrentLoops(const ComputationNodeBasePtr& rootNo
                 fprintf(stderr, "\t%ls", (*itr)->NodeName().c_str());
             }
             fprintf(stderr, "\n");
+
+            // Nodes that do not depend on the recurrence (e.g. the W*x input projections of an LSTM) are not strongly
+            // connected to it and thus never become part of the loop; they run once over the full MBLayout before it,
+            // and gradients into them are propagated once after the loop (SEQTraversalFlowControlNode::EndBackprop()).
+            set<wstring> hoistedInputs;
+            for (let& node : iter->m_nestedNodes)
+                for (let& input : node->GetInputs())
+                    if (input->m_loopId != iter->m_loopId && input->HasMBLayout())
+                        hoistedInputs.insert(input->NodeName());
+            if (!hoistedInputs.empty())
+            {
+                fprintf(stderr, "Loop[%d] --> %d per-sequence inputs computed outside the loop:\n", (int)iter->m_loopId, (int)hoistedInputs.size());
+                n = 0;
+                for (let& name : hoistedInputs)
+                {
+                    if (n++ % 3 == 0)
+                        fprintf(stderr, "\n");
+                    fprintf(stderr, "\t%ls", name.c_str());
+                }
+                fprintf(stderr, "\n");
+            }
         }
     }
 
@@ -11,12 +11,18 @@
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
+#include "TensorOps.h"
+#include "WorkStealingThreadPool.h"
+#include "Globals.h"
+#include <omp.h>
 #include <string>
 #include <vector>
 #include <list>
 #include <set>
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 using namespace std;
 
@@ -85,7 +91,7 @@ void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNod
     if (m_nestedNetworks.find(rootNode) != m_nestedNetworks.end())
         fprintf(stderr, "FormNestedNetwork: WARNING: Was called twice for %ls %ls operation\n", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
 
-    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(*this, m_allSEQNodes, GetEvalOrder(rootNode));
 }
 
 ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -105,7 +111,8 @@ ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNod
 
 template<class ElemType> static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient);
 
-ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes /*must be in eval order*/)
+ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(const ComputationNetwork& network, const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes /*must be in eval order*/)
+    : m_network(network), m_schedulesDetermined(false), m_canExecuteConcurrently(false)
 {
     // traverse the network in evaluation order and create a new list that replaces all recurrence by a SEQTraversalFlowControlNode
     set<shared_ptr<IComputationNode>> loopsSeen; // for consistency check only
@@ -116,6 +123,7 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         {
             // instead of the node itself, include the sentinel SEQTraversalFlowControlNode in our list
             m_nestedNodes.push_back(recInfo);
+            recInfo->m_profiler = &network.GetNodeProfiler();
 
             // and verify that we only encountered the loop once (all nodes should have been consecutive)
             if (!loopsSeen.insert(recInfo).second)
@@ -134,7 +142,8 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const FrameRange& fr) /*override*/
 {
-    for (auto& node : m_nestedNodes)
+    NodeProfiler* profiler = m_network.GetNodeProfiler().IsEnabled() ? &m_network.GetNodeProfiler() : nullptr;
+    auto forwardProp = [&fr, profiler](const ComputationNodeBasePtr& node)
     {
 #if 0
         if (dynamic_pointer_cast<LearnableParameter<float>>(node))
@@ -142,6 +151,7 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 #endif
         if (node->IsOutOfDateWrtInputs())
         {
+            NodeProfiler::Scope profile(profiler, node, /*backward=*/false);
             node->BeginForwardProp();
             node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
             node->EndForwardProp();
@@ -152,24 +162,240 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         // Extreme Tracing, part 1/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode())
             DumpNode<float>(node, /*dumpGradient=*/false) || DumpNode<double>(node, false);
-    }
+    };
+
+    if (ShouldExecuteConcurrently() && ExecuteConcurrently(m_forwardPropSchedule, forwardProp))
+        return;
+
+    for (auto& node : m_nestedNodes)
+        forwardProp(node);
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
 {
     childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
-    // process nodes in pre-determined order
-    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+    NodeProfiler* profiler = m_network.GetNodeProfiler().IsEnabled() ? &m_network.GetNodeProfiler() : nullptr;
+    auto backprop = [&fr, profiler](const ComputationNodeBasePtr& node)
     {
-        auto& node = *pnode;
-
-        node->BeginBackprop();
-        node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
-        node->EndBackprop();
+        {
+            NodeProfiler::Scope profile(profiler, node, /*backward=*/true);
+            node->BeginBackprop();
+            node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
+            node->EndBackprop();
+        }
 
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+    };
+
+    if (ShouldExecuteConcurrently() && ExecuteConcurrently(m_backpropSchedule, backprop))
+        return;
+
+    // process nodes in pre-determined order
+    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+        backprop(*pnode);
+}
+
+// -----------------------------------------------------------------------
+// concurrent execution of independent nodes
+//
+// The schedules are dependency graphs over m_nestedNodes (a SEQ loop is a single
+// task). Node j must wait for node i if
+//  - forward:  j consumes the value of i;
+//  - backprop: i consumes the value of j (i.e. writes j's gradient), or i and j both
+//    consume the same node and i comes later in eval order (they accumulate into the
+//    same gradient, which must happen in the order the gradient optimizations expect);
+//  - both: j is handed a matrix from the pool after i held it. The matrix is in use by
+//    its holder and the holder's consumers (which read its value in forward, and
+//    write its gradient in backprop), so the edges connect these groups.
+// Node execution is one task per node on a work-stealing pool shared by all networks;
+// the OpenMP threads of each task are limited to its share of the cores.
+// -----------------------------------------------------------------------
+
+void ComputationNetwork::PARTraversalFlowControlNode::Schedule::AddDependency(size_t from, size_t to)
+{
+    auto& successors = m_successors[from];
+    if (from == to || std::find(successors.begin(), successors.end(), to) != successors.end())
+        return;
+    successors.push_back(to);
+    m_numPredecessors[to]++;
+}
+
+bool ComputationNetwork::PARTraversalFlowControlNode::ShouldExecuteConcurrently()
+{
+    if (Globals::GetNodeExecutionThreads() <= 1 || m_nestedNodes.size() <= 1)
+        return false;
+
+    // The CPU is the only device whose operations can be issued from multiple threads as is.
+    // Hyper memory compression releases input values from EndForwardProp(), which concurrently executing consumers may still need.
+    if (m_network.GetDeviceId() != CPUDEVICE || Globals::ShouldEnableHyperCompressMemory() || !m_network.AreMatricesAllocated())
+        return false;
+
+    if (!m_schedulesDetermined)
+    {
+        m_canExecuteConcurrently = DetermineSchedules();
+        m_schedulesDetermined = true;
     }
+    return m_canExecuteConcurrently;
+}
+
+bool ComputationNetwork::PARTraversalFlowControlNode::DetermineSchedules()
+{
+    const size_t numNodes = m_nestedNodes.size();
+
+    // map every node to its top-level index (the members of a SEQ loop map to the loop)
+    unordered_map<const ComputationNodeBase*, size_t> indexOf;
+    vector<vector<ComputationNodeBasePtr>> members(numNodes);
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        auto seqNode = dynamic_pointer_cast<SEQTraversalFlowControlNode>(m_nestedNodes[i]);
+        if (seqNode)
+            members[i] = seqNode->m_nestedNodes;
+        else
+            members[i].push_back(m_nestedNodes[i]);
+        for (const auto& member : members[i])
+        {
+            // user-defined functions may call back into a language runtime that is not prepared for concurrent calls
+            if (member->OperationName() == L"UserDefinedV2Function")
+                return false;
+            indexOf[member.get()] = i;
+        }
+    }
+
+    // consumers of each top-level node, in eval order
+    vector<vector<size_t>> consumers(numNodes);
+    for (size_t j = 0; j < numNodes; j++)
+    {
+        for (const auto& member : members[j])
+        {
+            for (const auto& input : member->GetInputs())
+            {
+                auto iter = indexOf.find(input.get());
+                if (iter == indexOf.end() || iter->second == j)
+                    continue;
+                auto& inputConsumers = consumers[iter->second];
+                if (std::find(inputConsumers.begin(), inputConsumers.end(), j) == inputConsumers.end())
+                    inputConsumers.push_back(j);
+            }
+        }
+    }
+    for (auto& nodeConsumers : consumers)
+        sort(nodeConsumers.begin(), nodeConsumers.end());
+
+    m_forwardPropSchedule.m_numPredecessors.assign(numNodes, 0);
+    m_forwardPropSchedule.m_successors.assign(numNodes, vector<size_t>());
+    m_backpropSchedule.m_numPredecessors.assign(numNodes, 0);
+    m_backpropSchedule.m_successors.assign(numNodes, vector<size_t>());
+
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        for (size_t k = 0; k < consumers[i].size(); k++)
+        {
+            m_forwardPropSchedule.AddDependency(i, consumers[i][k]);
+            m_backpropSchedule.AddDependency(consumers[i][k], i);
+            if (k > 0)
+                m_backpropSchedule.AddDependency(consumers[i][k], consumers[i][k - 1]);
+        }
+    }
+
+    // memory sharing; returns false if the sharing contradicts the sequential order, which the allocation assumes
+    auto group = [&consumers](size_t i)
+    {
+        vector<size_t> nodes(consumers[i]);
+        nodes.push_back(i);
+        return nodes;
+    };
+    unordered_map<const MatrixBase*, size_t> lastHolder;
+    for (const auto& request : m_network.m_forwardPropMatrixRequests)
+    {
+        auto iter = indexOf.find(request.second);
+        if (iter == indexOf.end())
+            continue;
+        size_t j = iter->second;
+        auto holderIter = lastHolder.find(request.first);
+        if (holderIter != lastHolder.end() && holderIter->second != j)
+        {
+            for (auto i : group(holderIter->second))
+            {
+                if (i > j)
+                    return false;
+                m_forwardPropSchedule.AddDependency(i, j);
+            }
+        }
+        lastHolder[request.first] = j;
+    }
+    // Matrices held since forward prop carry on into backprop; those released during forward prop are free by the
+    // time backprop starts. The latter are recognized by their holder's group coming later in backprop order.
+    unordered_map<const MatrixBase*, bool> heldInBackprop;
+    for (const auto& request : m_network.m_backpropMatrixRequests)
+    {
+        auto iter = indexOf.find(request.second);
+        if (iter == indexOf.end())
+            continue;
+        size_t j = iter->second;
+        auto holderIter = lastHolder.find(request.first);
+        if (holderIter != lastHolder.end() && holderIter->second != j)
+        {
+            bool isBackpropHolder = heldInBackprop[request.first];
+            auto predecessors = group(holderIter->second);
+            auto successors = group(j);
+            bool inOrder = all_of(predecessors.begin(), predecessors.end(), [&successors](size_t i)
+            {
+                return all_of(successors.begin(), successors.end(), [i](size_t k) { return i >= k; });
+            });
+            if (!inOrder && isBackpropHolder)
+                return false;
+            if (inOrder)
+            {
+                for (auto i : predecessors)
+                    for (auto k : successors)
+                        m_backpropSchedule.AddDependency(i, k);
+            }
+        }
+        lastHolder[request.first] = j;
+        heldInBackprop[request.first] = true;
+    }
+
+    return true;
+}
+
+// the thread pool shared by all networks, sized according to Globals::GetNodeExecutionThreads()
+static shared_ptr<WorkStealingThreadPool> GetNodeExecutionThreadPool()
+{
+    static mutex s_mutex;
+    static shared_ptr<WorkStealingThreadPool> s_threadPool;
+
+    lock_guard<mutex> lock(s_mutex);
+    size_t numThreads = Globals::GetNodeExecutionThreads();
+    if (!s_threadPool || s_threadPool->NumWorkers() != numThreads)
+        s_threadPool = make_shared<WorkStealingThreadPool>(numThreads);
+    return s_threadPool;
+}
+
+// returns false if the pool is busy, e.g. when called from a node that is itself being executed concurrently
+bool ComputationNetwork::PARTraversalFlowControlNode::ExecuteConcurrently(const Schedule& schedule, const std::function<void(const ComputationNodeBasePtr&)>& execute)
+{
+    auto threadPool = GetNodeExecutionThreadPool();
+
+    // MBLayouts compute their column masks lazily; do this here for the layouts known upfront
+    for (const auto& node : m_nestedNodes)
+    {
+        const auto& pMBLayout = node->GetMBLayout();
+        if (pMBLayout && pMBLayout->HasGaps())
+            pMBLayout->GetColumnsValidityMask(m_network.GetDeviceId());
+    }
+
+    // each node gets its share of the OpenMP threads, depending on the number of nodes that can run at the same time
+    const int numOmpThreads = omp_get_max_threads();
+    const WorkStealingThreadPool& pool = *threadPool;
+    bool executed = threadPool->TryRun(schedule.m_numPredecessors, schedule.m_successors, [&](size_t i)
+    {
+        size_t numActiveTasks = max<size_t>(1, min(pool.NumWorkers(), pool.NumActiveTasks()));
+        omp_set_num_threads(max(1, numOmpThreads / (int)numActiveTasks));
+        execute(m_nestedNodes[i]);
+    });
+    omp_set_num_threads(numOmpThreads);
+    return executed;
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
 {
@@ -245,15 +471,57 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     // for every time step run through all nodes in this particular loop (treat the loop like a little ComputationNetwork)
     // Note: Currently, this is limited to linear-time loops. But nothing stops the iteration below to, e.g., be a 2D iteration over an image
     // if we implement an according FrameRangeIteration.
+    if (!m_stepProgramCompiled)
+        CompileStepProgram();
+    if (m_stepProgramIsDouble)
+        ResolveStepProgram<double>();
+    else
+        ResolveStepProgram<float>();
+
+    NodeProfiler* profiler = ActiveProfiler();
     FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
+    size_t numParallelSequences = GetMBLayout()->GetNumParallelSequences();
     for (auto t = range.begin(); t != range.end(); t++)
     {
-        for (auto& node : m_nestedNodes)
+        for (auto& instruction : m_stepProgram)
         {
-            node->ForwardProp(t);
-            node->BumpEvalTimeStamp();
+            if (instruction.m_node)
+            {
+                NodeProfiler::Scope profile(profiler, instruction.m_node, /*backward=*/false, /*isLoopStep=*/true);
+                instruction.m_node->ForwardProp(t);
+                instruction.m_node->BumpEvalTimeStamp();
+            }
+            else if (instruction.m_resolved)
+            {
+                // all columns of time step t are consecutive in memory
+                long long startTime = profiler ? profiler->Now() : 0;
+                size_t numElements = instruction.m_numRows * numParallelSequences;
+                if (m_stepProgramIsDouble)
+                    ExecuteFusedOps<double>(instruction.m_fusedOps, t.t() * numElements, numElements);
+                else
+                    ExecuteFusedOps<float>(instruction.m_fusedOps, t.t() * numElements, numElements);
+                for (auto& fusedOp : instruction.m_fusedOps)
+                    fusedOp.m_node->BumpEvalTimeStamp();
+                if (profiler) // a fused run cannot be timed per node; split it evenly
+                {
+                    long long duration = (profiler->Now() - startTime) / (long long) instruction.m_fusedOps.size();
+                    for (auto& fusedOp : instruction.m_fusedOps)
+                        profiler->RecordStep(fusedOp.m_node, /*backward=*/false, duration, 0);
+                }
+            }
+            else
+            {
+                for (auto& fusedOp : instruction.m_fusedOps)
+                {
+                    NodeProfiler::Scope profile(profiler, fusedOp.m_node, /*backward=*/false, /*isLoopStep=*/true);
+                    fusedOp.m_node->ForwardProp(t);
+                    fusedOp.m_node->BumpEvalTimeStamp();
+                }
+            }
         }
     }
+    if (profiler)
+        profiler->RecordLoop(m_nestedNodes, /*backward=*/false);
 
     // Extreme Tracing, part 3/4
     for (auto& node : m_nestedNodes)
@@ -265,6 +533,123 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     }
 }
 
+// number of operands of the elementwise operators that can be fused, or 0 if the operator cannot be fused
+static size_t GetNumFusableOperands(ElementWiseOperator op)
+{
+    switch (op)
+    {
+#define CaseUnaryOp(oper) case op##oper: return 1
+        ForAllUnaryOps(CaseUnaryOp);
+#undef CaseUnaryOp
+#define CaseBinaryOp(oper) case op##oper: return 2
+        ForAllBinaryOps(CaseBinaryOp);
+#undef CaseBinaryOp
+    default: return 0;
+    }
+}
+
+// compile the loop body into m_stepProgram
+// The nodes of the loop and their dimensions do not change after validation, so this is done on first use.
+void ComputationNetwork::SEQTraversalFlowControlNode::CompileStepProgram()
+{
+    m_stepProgram.clear();
+    m_stepProgramIsDouble = dynamic_pointer_cast<ComputationNode<double>>(m_nestedNodes[0]) != nullptr;
+    for (auto& node : m_nestedNodes)
+    {
+        bool fused = m_stepProgramIsDouble ? TryAddFusedOp<double>(node) : TryAddFusedOp<float>(node);
+        if (!fused)
+            m_stepProgram.push_back(StepInstruction{ node, vector<FusedElementwiseOp>(), 0, false });
+    }
+    m_stepProgramCompiled = true;
+}
+
+// append 'node' to the fused run at the end of m_stepProgram (or start a new one) if it is a plain elementwise operation in this loop
+template <class ElemType>
+bool ComputationNetwork::SEQTraversalFlowControlNode::TryAddFusedOp(const ComputationNodeBasePtr& node)
+{
+    if (!node->Is<IElementwiseNode>() || !dynamic_pointer_cast<ComputationNode<ElemType>>(node))
+        return false;
+    ElementWiseOperator op = node->As<IElementwiseNode>()->GetElementwiseOperator();
+    if (GetNumFusableOperands(op) != node->GetNumInputs())
+        return false;
+
+    // no broadcasting: all inputs must be time sequences of this loop's layout, with the same number of elements
+    size_t numRows = node->GetSampleLayout().GetNumElements();
+    for (const auto& input : node->GetInputs())
+    {
+        if (input->GetMBLayout() != node->GetMBLayout() || input->GetSampleLayout().GetNumElements() != numRows || !dynamic_pointer_cast<ComputationNode<ElemType>>(input))
+            return false;
+    }
+
+    if (m_stepProgram.empty() || m_stepProgram.back().m_node || m_stepProgram.back().m_numRows != numRows)
+        m_stepProgram.push_back(StepInstruction{ nullptr, vector<FusedElementwiseOp>(), numRows, false });
+    m_stepProgram.back().m_fusedOps.push_back(FusedElementwiseOp{ node, op, nullptr, { nullptr, nullptr } });
+    return true;
+}
+
+// get the data pointers of all fused runs for this minibatch
+// A run is only executed on raw data if all its matrices are dense CPU matrices covering the full minibatch.
+template <class ElemType>
+void ComputationNetwork::SEQTraversalFlowControlNode::ResolveStepProgram()
+{
+    size_t numCols = GetMBLayout()->GetNumCols();
+    for (auto& instruction : m_stepProgram)
+    {
+        if (instruction.m_node)
+            continue;
+        auto getData = [&](const ComputationNodeBasePtr& node) -> ElemType*
+        {
+            auto& value = static_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+            if (value.GetDeviceId() != CPUDEVICE || value.GetMatrixType() != MatrixType::DENSE || value.GetNumRows() != instruction.m_numRows || value.GetNumCols() != numCols)
+                return nullptr;
+            return value.Data();
+        };
+        instruction.m_resolved = true;
+        for (auto& fusedOp : instruction.m_fusedOps)
+        {
+            fusedOp.m_output = getData(fusedOp.m_node);
+            instruction.m_resolved &= fusedOp.m_output != nullptr;
+            for (size_t i = 0; i < fusedOp.m_node->GetNumInputs(); i++)
+            {
+                fusedOp.m_inputs[i] = getData(fusedOp.m_node->GetInputs()[i]);
+                instruction.m_resolved &= fusedOp.m_inputs[i] != nullptr;
+            }
+        }
+    }
+}
+
+// apply a fused run to 'numElements' consecutive elements starting at 'offset'
+// The elements are processed in blocks that stay in cache across all operations of the run.
+template <class ElemType>
+/*static*/ void ComputationNetwork::SEQTraversalFlowControlNode::ExecuteFusedOps(const vector<FusedElementwiseOp>& fusedOps, size_t offset, size_t numElements)
+{
+    const size_t blockSize = 1024;
+    const size_t minElementsPerThread = 16384; // below this, a parallel region costs more than it saves
+    long numBlocks = (long) ((numElements + blockSize - 1) / blockSize);
+#pragma omp parallel for if (numElements >= 2 * minElementsPerThread)
+    for (long block = 0; block < numBlocks; block++)
+    {
+        size_t begin = offset + block * blockSize;
+        size_t end = offset + min(block * blockSize + blockSize, numElements);
+        for (const auto& fusedOp : fusedOps)
+        {
+            ElemType* c = (ElemType*) fusedOp.m_output;
+            const ElemType* a = (const ElemType*) fusedOp.m_inputs[0];
+            const ElemType* b = (const ElemType*) fusedOp.m_inputs[1];
+            switch (fusedOp.m_op)
+            {
+#define CaseUnaryOp(oper) case op##oper: for (size_t i = begin; i < end; i++) c[i] = Op##oper(a[i]); break
+            ForAllUnaryOps(CaseUnaryOp);
+#undef CaseUnaryOp
+#define CaseBinaryOp(oper) case op##oper: for (size_t i = begin; i < end; i++) c[i] = Op##oper(a[i], b[i]); break
+            ForAllBinaryOps(CaseBinaryOp);
+#undef CaseBinaryOp
+            default: assert(false); // excluded by TryAddFusedOp()
+            }
+        }
+    }
+}
+
 /*virtual*/ void ComputationNetwork::SEQTraversalFlowControlNode::EndForwardProp() /*override*/
 {
     // tell all that loop is done  --e.g. PastValueNode will capture its state for BPTT processing
@@ -284,12 +669,14 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     childrenInThisLoop, childrenInOuterLoop;    // TODO: think through what these mean when coming from PAR mode
     const auto& recurrentNodes = m_nestedNodes; // BUGBUG: -ForForward?? Does this mean we can remove non-ForForward?
     auto pMBLayout = recurrentNodes[0]->GetMBLayout();
+    NodeProfiler* profiler = ActiveProfiler();
     FrameRangeIteration range(pMBLayout, m_steppingDirection);
     for (auto t = range.rbegin(); t != range.rend(); t++) // note: reverse iteration
     {
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
+            NodeProfiler::Scope profile(profiler, node2, /*backward=*/true, /*isLoopStep=*/true);
             node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
@@ -311,11 +698,15 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
 {
     // The following loop handles the case that a node inside the loop back-propagates a gradient into a node outside of the loop.
     // For efficiency, we perform this outside the loop in PAR mode. E.g., in one LSTM speech setup, we measured 12..14% overall speed-up.
+    NodeProfiler* profiler = ActiveProfiler();
     for (auto nodeIter2 = m_nestedNodes.rbegin(); nodeIter2 != m_nestedNodes.rend(); ++nodeIter2)
     {
         auto& node2 = *nodeIter2;
+        NodeProfiler::Scope profile(profiler, node2, /*backward=*/true, /*isLoopStep=*/true);
         node2->Backprop(FrameRange(m_nestedNodes[0]->GetMBLayout()), false /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
     }
+    if (profiler)
+        profiler->RecordLoop(m_nestedNodes, /*backward=*/true);
 
     // tell all nodes we are done for this iteraTion
     for (auto& node2 : m_nestedNodes)
@@ -1088,6 +1479,7 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
             ReleaseMatricesAfterEvalForChildren(nodeIter, parentsMap);
         }
     }
+    m_forwardPropMatrixRequests = m_matrixPool.TakeRequestHistory();
 
     if (trainRootNode != nullptr)
     {
@@ -1127,6 +1519,8 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
+    m_backpropMatrixRequests = m_matrixPool.TakeRequestHistory();
+
     m_areMatricesAllocated = true;
 
     // print the memory sharing structure
@@ -515,26 +515,41 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                                                              bool outputGradient,
                                                              bool onlyShowAbsSumForDense) const
 {
-    // get minibatch matrix -> matData, matRows, matStride
+    // get minibatch matrix -> matData
     const Matrix<ElemType>& outputValues = outputGradient ? Gradient() : Value();
-    let matRows   = outputValues.GetNumRows();
-    let matStride = matRows; // how to get from one column to the next
     unique_ptr<ElemType[]> matDataPtr(outputValues.CopyToArray());
-    ElemType* matData = matDataPtr.get();
-    let sampleLayout = GetSampleLayout(); // this is currently only used for sparse; dense tensors are linearized
+
+    WriteMinibatchWithFormatting(f, matDataPtr.get(), outputValues.GetNumRows(), outputValues.GetNumCols(), GetSampleLayout(), GetMBLayout(), fr,
+                                 onlyUpToRow, onlyUpToT, transpose, isCategoryLabel, isSparse, labelMapping,
+                                 sequenceSeparator, sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator,
+                                 valueFormatString, onlyShowAbsSumForDense);
+}
+
+// same, for a copy of the minibatch in CPU memory, e.g. taken for formatting on a background thread
+// 'matData' is modified in place when 'isCategoryLabel'.
+template <class ElemType>
+/*static*/ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, ElemType* matData, size_t matRows, size_t matCols,
+                                                                         const TensorShape& sampleLayout, MBLayoutPtr pMBLayout, const FrameRange& fr,
+                                                                         size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                                                         const vector<string>& labelMapping, const string& sequenceSeparator, 
+                                                                         const string& sequencePrologue, const string& sequenceEpilogue,
+                                                                         const string& elementSeparator, const string& sampleSeparator,
+                                                                         string valueFormatString,
+                                                                         bool onlyShowAbsSumForDense)
+{
+    let matStride = matRows; // how to get from one column to the next
 
     // process all sequences one by one
-    MBLayoutPtr pMBLayout = GetMBLayout();
     if (!pMBLayout) // no MBLayout: We are printing aggregates (or LearnableParameters?)
     {
         pMBLayout = make_shared<MBLayout>();
-        pMBLayout->Init(1, outputValues.GetNumCols()); // treat this as if we have one single sequence consisting of the columns
-        pMBLayout->AddSequence(0, 0, 0, outputValues.GetNumCols());
+        pMBLayout->Init(1, matCols); // treat this as if we have one single sequence consisting of the columns
+        pMBLayout->AddSequence(0, 0, 0, matCols);
     }
     let& sequences = pMBLayout->GetAllSequences();
     let  width     = pMBLayout->GetNumTimeSteps();
 
-    TensorShape tensorShape = GetSampleLayout();
+    const TensorShape& tensorShape = sampleLayout; // sampleLayout is currently only used for sparse; dense tensors are linearized
     stringstream str;
     let dims = tensorShape.GetDims();
     for (auto dim : dims)
@@ -604,7 +619,7 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
         {
             if (formatChar == 's') // verify label dimension
             {
-                if (outputValues.GetNumRows() != labelMapping.size() &&
+                if (matRows != labelMapping.size() &&
                     sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
                 {
                     static size_t warnings = 0;
@@ -779,7 +794,8 @@ WriteFormattingOptions::WriteFormattingOptions(const ConfigRecordType& config) :
             if      (type == L"real")     ; // default
             else if (type == L"category") isCategoryLabel = true;
             else if (type == L"sparse")   isSparse = true;
-            else                         InvalidArgument("write: type must be 'real', 'category', or 'sparse'");
+            else if (type == L"binary")   isBinary = true;
+            else                         InvalidArgument("write: type must be 'real', 'category', 'sparse', or 'binary'");
             labelMappingFile = (wstring)formatConfig(L"labelMappingFile", L"");
         }
         transpose = formatConfig(L"transpose", transpose);
@@ -836,8 +852,10 @@ template WriteFormattingOptions::WriteFormattingOptions(const ScriptableObjects:
 
 atomic_ullong TimeStamp::s_timeStampCounter = ATOMIC_VAR_INIT(0);
 
-template <> map<size_t, map<size_t, shared_ptr<SingleMatrix>>> ComputationNode<float>::s_constOnes{};
-template <> map<size_t, map<size_t, shared_ptr<DoubleMatrix>>> ComputationNode<double>::s_constOnes{};
+template <> map<tuple<size_t, size_t, DEVICEID_TYPE>, shared_ptr<SingleMatrix>> ComputationNode<float>::s_constOnes{};
+template <> map<tuple<size_t, size_t, DEVICEID_TYPE>, shared_ptr<DoubleMatrix>> ComputationNode<double>::s_constOnes{};
+template <> mutex ComputationNode<float>::s_constOnesMutex{};
+template <> mutex ComputationNode<double>::s_constOnesMutex{};
 
 // -----------------------------------------------------------------------
 // instantiate the core class templates
@@ -24,6 +24,8 @@
 #include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <mutex>
+#include <tuple>
 
 #define DEFAULT_HIDDEN_ACTIVATION 0.1
 
@@ -141,6 +143,8 @@ struct /*interface*/ IStatefulNode
     typedef std::shared_ptr<INodeState> NodeStatePtr;
     virtual NodeStatePtr ExportState() = 0;
     virtual void ImportState(const NodeStatePtr& state) = 0;
+    // permute the state carried over to the next minibatch, such that parallel sequence s continues from sourceSequences[s] (e.g. for beam search)
+    virtual void ReorderParallelSequences(const std::vector<size_t>& sourceSequences) = 0;
 };
 typedef IStatefulNode::NodeStatePtr NodeStatePtr;
 
@@ -1868,7 +1872,7 @@ protected:
     {
         if (matrixPtr == nullptr)
         {
-            matrixPtr = matrixPool.Request<ElemType>(m_deviceId);
+            matrixPtr = matrixPool.Request<ElemType>(m_deviceId, this);
         }
     }
 
@@ -1891,6 +1895,12 @@ public:
                                       const std::string& sequencePrologue, const std::string& sequenceEpilogue, const std::string& elementSeparator,
                                       const std::string& sampleSeparator, std::string valueFormatString,
                                       bool outputGradient = false, bool onlyShowAbsSumForDense = false) const;
+    static void WriteMinibatchWithFormatting(FILE* f, ElemType* matData, size_t matRows, size_t matCols, const TensorShape& sampleLayout, MBLayoutPtr pMBLayout,
+                                             const FrameRange& fr, size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                             const std::vector<std::string>& labelMapping, const std::string& sequenceSeparator,
+                                             const std::string& sequencePrologue, const std::string& sequenceEpilogue, const std::string& elementSeparator,
+                                             const std::string& sampleSeparator, std::string valueFormatString,
+                                             bool onlyShowAbsSumForDense = false);
 
     // simple helper to log the content of a minibatch
     void DebugLogMinibatch(bool outputGradient = false) const
@@ -2031,25 +2041,21 @@ public:
         }
     }
 
-    // NOTE: we should reimplement this to be thread-safe and use a larger than requested initialized memory block
+    // NOTE: we should reimplement this to use a larger than requested initialized memory block
     // we can then just wrap that memory block in a matrix of the correct dimensions since it will be const no one can change it
-    // should only need one memory block per device
-    // Thread-safety could be achieved by changing this to a shared_ptr.
     // When using the TensorView interface, one could instead just use a 1x1 matrix with a view that broadcasts its columns (stride 0).
+    // This is thread-safe, since nodes may be executed concurrently (see PARTraversalFlowControlNode): There is one matrix per device,
+    // which is never moved or modified once created.
     static const Matrix<ElemType>& ConstOnes(const size_t rows, const size_t cols, const DEVICEID_TYPE deviceId)
     {
-        if (s_constOnes.find(rows) == s_constOnes.end() ||
-            s_constOnes[rows].find(cols) == s_constOnes[rows].end()) // not found
+        std::lock_guard<std::mutex> lock(s_constOnesMutex);
+        auto& matrix = s_constOnes[std::make_tuple(rows, cols, deviceId)];
+        if (!matrix) // not found
         {
-            shared_ptr<Matrix<ElemType>> matrix = make_shared<Matrix<ElemType>>(rows, cols, (DEVICEID_TYPE) deviceId);
+            matrix = make_shared<Matrix<ElemType>>(rows, cols, (DEVICEID_TYPE) deviceId);
             matrix->SetValue(1);
-            s_constOnes[rows][cols] = matrix;
         }
-
-        shared_ptr<Matrix<ElemType>> m = s_constOnes[rows][cols];
-        m->TransferFromDeviceToDevice(m->GetDeviceId(), deviceId);
-
-        return *m;
+        return *matrix;
     }
 
     // -----------------------------------------------------------------------
@@ -2060,7 +2066,8 @@ protected:
 
     shared_ptr<Matrix<ElemType>> m_value, m_gradient;
 
-    static std::map<size_t, std::map<size_t, shared_ptr<Matrix<ElemType>>>> s_constOnes;
+    static std::map<std::tuple<size_t, size_t, DEVICEID_TYPE>, shared_ptr<Matrix<ElemType>>> s_constOnes; // [(rows, cols, deviceId)]
+    static std::mutex s_constOnesMutex;
 };
 
 // convenience wrapper for ComputationNode::New()
@@ -2078,6 +2085,7 @@ struct WriteFormattingOptions
     bool isCategoryLabel = false;  // true: find max value in column and output the index instead of the entire vector
     std::wstring labelMappingFile; // optional dictionary for pretty-printing category labels
     bool isSparse = false;
+    bool isBinary = false;         // write the raw values as float32 with a sequence index instead of text (only used by the 'write' command, not saved)
     bool transpose = true;         // true: one line per sample, each sample (column vector) forms one line; false: one column per sample
     // The following strings are interspersed with the data:
     // overall
@@ -2231,6 +2239,14 @@ public:
 
 struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0; };
 
+// =======================================================================
+// IElementwiseNode -- interface implemented by ComputationNodes whose ForwardProp()
+// is a single ElementWiseOperator applied to all inputs (with broadcasting)
+// This allows recurrent loops to fuse runs of such nodes into a single pass per time step.
+// =======================================================================
+
+struct IElementwiseNode { virtual ElementWiseOperator GetElementwiseOperator() const = 0; };
+
 // =======================================================================
 // IFreezable -- nodes that have parameters that can be frozen
 // e.g. if a trained model is to be used as a fixed feature extractor for another
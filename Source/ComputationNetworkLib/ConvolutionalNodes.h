@@ -9,6 +9,7 @@
 #include "Matrix.h"
 #include "ComputationNode.h"
 #include "ConvolutionEngine.h"
+#include "Int8QuantizedOperations.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -288,6 +289,8 @@ public:
 public:
     void Save(File& fstream) const override
     {
+        if (HasFusedEpilogue())
+            LogicError("%ls: Cannot save a convolution that has been optimized for inference (fused bias/batch normalization/activation).", NodeDescription().c_str());
         Base::Save(fstream);
         fstream << m_convolution2D;
         TensorShape(1).Save(fstream); // Write out a dummy tensor, so that model created can be used later after implementing reading this tensor in this model version
@@ -337,6 +340,8 @@ public:
 
     void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
+        if (HasFusedEpilogue())
+            LogicError("%ls: Cannot copy a convolution that has been optimized for inference (fused bias/batch normalization/activation).", NodeDescription().c_str());
         Base::CopyTo(nodeP, newName, flags);
         if (flags & CopyNodeFlags::copyNodeValue)
         {
@@ -350,8 +355,19 @@ public:
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
         const Matrix<ElemType>& input0 = InputRef(0).ValueAsMatrix();
         Matrix<ElemType> sliceInput1Value = InputRef(1).ValueFor(fr);
-        if (!m_transpose)
+        if (HasFusedEpilogue())
+        {
+            UpdateFusedParameters();
+            if (m_int8Multiplier)
+                UpdateInt8Weights();
+            m_convEng->ForwardBiasActivation(sliceInput1Value, m_fusedKernel ? *m_fusedKernel : input0, *m_fusedBias, m_fusedReLU, sliceOutputValue, *m_tempMatrix);
+        }
+        else if (!m_transpose)
+        {
+            if (m_int8Multiplier)
+                UpdateInt8Weights();
             m_convEng->Forward(sliceInput1Value, input0, sliceOutputValue, *m_tempMatrix);
+        }
         else
         {
             // BackwardData adds results to the output so need to zero them out first.
@@ -363,6 +379,8 @@ public:
 
     void BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
+        if (HasFusedEpilogue())
+            LogicError("%ls: Backpropagation through a convolution that has been optimized for inference is not supported.", NodeDescription().c_str());
         auto sliceOutputGrad = GradientFor(fr);
         if (inputIndex == 0) // derivative with respect to the weight matrix
         {
@@ -518,7 +536,130 @@ public:
 
     bool IsConvolution2D() const { return m_convolution2D; }
 
+    // Inference-only fusion (see ComputationNetwork::FuseConvolutionBiasActivation()): the output of this node becomes
+    // ReLU(BN(conv + bias)), where each of bias, batch normalization and ReLU is optional. The batch normalization
+    // statistics are folded into a private copy of the kernel and bias; the parameter nodes themselves are referenced
+    // but are not inputs of this node and are never modified. Folding is redone whenever one of them changes.
+    void SetFusedEpilogue(ComputationNodePtr bias, ComputationNodePtr bnScale, ComputationNodePtr bnBias,
+                          ComputationNodePtr bnMean, ComputationNodePtr bnVariance, double bnEpsilon, bool applyReLU)
+    {
+        if (m_transpose || m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("%ls: Fusion is only supported for non-transposed convolutions in CHW layout.", NodeDescription().c_str());
+        if (!bnScale != !bnBias || !bnScale != !bnMean || !bnScale != !bnVariance)
+            LogicError("%ls: Batch normalization fusion requires scale, bias, mean and variance.", NodeDescription().c_str());
+        m_fusedBiasNode = bias;
+        m_fusedBNScale = bnScale;
+        m_fusedBNBias = bnBias;
+        m_fusedBNMean = bnMean;
+        m_fusedBNVariance = bnVariance;
+        m_fusedBNEpsilon = bnEpsilon;
+        m_fusedReLU = applyReLU;
+        m_hasFusedEpilogue = true;
+        m_fusedKernel.reset();
+        m_fusedBias.reset();
+    }
+
+    bool HasFusedEpilogue() const { return m_hasFusedEpilogue; }
+
+    // fusion requires the output maps to be the outermost output dimension (non-transposed, CHW, full sharing)
+    bool SupportsFusedEpilogue() const
+    {
+        if (m_transpose || m_imageLayout != ImageLayoutKind::CHW || m_convEng == nullptr || m_hasFusedEpilogue)
+            return false;
+        if (std::find(m_sharing.begin(), m_sharing.end(), false) != m_sharing.end())
+            return false;
+        const auto& geometry = *m_convEng->Geometry();
+        const auto& outShape = geometry.OutputShape();
+        return outShape[outShape.GetRank() - 1] == geometry.KernelCount();
+    }
+
+    // Int8 inference (see ComputationNetwork::EnableInt8Inference()): the forward product uses int8 kernel weights with one
+    // scale per output map and int8 inputs whose range is calibrated over the first calibrationCount forward calls.
+    // This needs the GEMM engine, which replaces the current engine if that does not support int8. Returns whether int8 is used.
+    bool EnableInt8Inference(size_t calibrationCount)
+    {
+        if (m_transpose || m_imageLayout != ImageLayoutKind::CHW || m_convEng == nullptr || m_deviceId != CPUDEVICE)
+            return false;
+
+        auto multiplier = make_shared<Int8QuantizedMultiplier<ElemType>>(/*isAConstant=*/true, calibrationCount);
+        if (!m_convEng->SetInt8Multiplier(multiplier))
+        {
+            auto engineKind = (ConvolutionEngineKind)((int)ConvolutionEngineKind::Gemm | (int)ConvolutionEngineKind::Reference);
+            auto engine = ConvolutionEngine<ElemType>::Create(std::const_pointer_cast<ConvolveGeometry>(m_convEng->Geometry()), m_deviceId, m_imageLayout,
+                                                              m_maxTempMemSizeInSamples, m_poolKind, engineKind, NodeName());
+            if (!engine->SetInt8Multiplier(multiplier))
+                return false;
+            m_convEng = std::move(engine);
+        }
+        m_int8Multiplier = multiplier;
+        m_int8TimeStamp = 0;
+        return true;
+    }
+
+    bool IsInt8Inference() const { return m_int8Multiplier != nullptr; }
+
 private:
+    // requantize the kernel on the next forward call if it (or the folded kernel) has changed
+    void UpdateInt8Weights()
+    {
+        uint64_t timeStamp = HasFusedEpilogue() ? m_fusedTimeStamp : InputRef(0).GetEvalTimeStamp();
+        if (timeStamp > m_int8TimeStamp)
+        {
+            m_int8Multiplier->ResetConstants();
+            m_int8TimeStamp = timeStamp;
+        }
+    }
+
+    // recompute folded kernel and bias if the kernel or any of the fused parameters changed since the last fold
+    void UpdateFusedParameters()
+    {
+        uint64_t timeStamp = InputRef(0).GetEvalTimeStamp();
+        for (const auto& node : { m_fusedBiasNode, m_fusedBNScale, m_fusedBNBias, m_fusedBNMean, m_fusedBNVariance })
+        {
+            if (node)
+                timeStamp = max(timeStamp, node->GetEvalTimeStamp());
+        }
+        if (m_fusedBias && timeStamp <= m_fusedTimeStamp)
+            return;
+
+        size_t mapCount = m_convEng->Geometry()->KernelCount();
+        if (!m_fusedBias)
+            m_fusedBias = make_shared<Matrix<ElemType>>(m_deviceId);
+        if (m_fusedBiasNode)
+            m_fusedBias->SetValue(m_fusedBiasNode->Value().Reshaped(mapCount, 1));
+        else
+        {
+            m_fusedBias->Resize(mapCount, 1);
+            m_fusedBias->SetValue(0);
+        }
+
+        if (m_fusedBNScale)
+        {
+            // s = scale / sqrt(var + eps),  W' = W * s,  b' = (b - mean) * s + bnBias   (per output map)
+            Matrix<ElemType> s(m_deviceId);
+            s.SetValue(m_fusedBNVariance->Value().Reshaped(mapCount, 1));
+            s += (ElemType)m_fusedBNEpsilon;
+            s.InplaceSqrt();
+            s.ElementInverse();
+            s.ElementMultiplyWith(m_fusedBNScale->Value().Reshaped(mapCount, 1));
+
+            *m_fusedBias -= m_fusedBNMean->Value().Reshaped(mapCount, 1);
+            m_fusedBias->ElementMultiplyWith(s);
+            *m_fusedBias += m_fusedBNBias->Value().Reshaped(mapCount, 1);
+
+            // kernel memory is [kernelSize x mapCount], i.e. one column per output map
+            const auto& kernel = InputRef(0).ValueAsMatrix();
+            if (!m_fusedKernel)
+                m_fusedKernel = make_shared<Matrix<ElemType>>(m_deviceId);
+            m_fusedKernel->SetValue(kernel.Reshaped(kernel.GetNumElements() / mapCount, mapCount));
+            m_fusedKernel->RowElementMultiplyWith(s.Reshaped(1, mapCount));
+        }
+        else
+            m_fusedKernel.reset(); // use the kernel as is
+
+        m_fusedTimeStamp = timeStamp;
+    }
+
     using TransformerNode::m_transforms;
     using ConvolutionNodeBase<ElemType>::ComputeFilterTransform;
 
@@ -546,6 +687,23 @@ private:
 protected:
     // Flag that indicates whether the node is created using 2D-syntax.
     bool m_convolution2D;
+
+    // fused inference epilogue (not serialized)
+    bool m_hasFusedEpilogue = false;
+    bool m_fusedReLU = false;
+    double m_fusedBNEpsilon = 0;
+    ComputationNodePtr m_fusedBiasNode;
+    ComputationNodePtr m_fusedBNScale;
+    ComputationNodePtr m_fusedBNBias;
+    ComputationNodePtr m_fusedBNMean;
+    ComputationNodePtr m_fusedBNVariance;
+    shared_ptr<Matrix<ElemType>> m_fusedKernel; // folded kernel, or null to use Input(0) directly
+    shared_ptr<Matrix<ElemType>> m_fusedBias;   // folded bias, [mapCount x 1]
+    uint64_t m_fusedTimeStamp = 0;
+
+    // int8 inference (not serialized)
+    shared_ptr<Int8QuantizedMultiplier<ElemType>> m_int8Multiplier;
+    uint64_t m_int8TimeStamp = 0;
 };
 
 // -----------------------------------------------------------------------
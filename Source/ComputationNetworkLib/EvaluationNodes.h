@@ -582,109 +582,113 @@ public:
     static ElemType ComputeEditDistanceError(Matrix<ElemType>& firstSeq, const Matrix<ElemType> & secondSeq, MBLayoutPtr pMBLayout, 
         float subPen, float delPen, float insPen, bool squashInputs, const vector<int>& samplesToIgnore)
     {
-        std::vector<int> firstSeqVec, secondSeqVec;
-
-        // Edit distance between subsequences
-        Matrix<float> grid(CPUDEVICE);
-        
-        // Number of insertions between subsequences
-        Matrix<float> insMatrix(CPUDEVICE);
-        
-        //Number of deletions between subsequences
-        Matrix<float> delMatrix(CPUDEVICE);
-
-        // Number of substitutions between subsequences
-        Matrix<float> subMatrix(CPUDEVICE);
-
-        float del, ins, sub;
-        ElemType wrongSampleNum = 0.0;
-        size_t totalSampleNum = 0, totalframeNum = 0;
-        size_t sequenceStartFrame = 0;
-
+        // the sequences are processed on the CPU, concurrently
+        Matrix<ElemType> firstSeqOnCPU(CPUDEVICE), secondSeqOnCPU(CPUDEVICE);
+        if (firstSeq.GetDeviceId() != CPUDEVICE)
+            firstSeqOnCPU.AssignValuesOf(firstSeq);
+        if (secondSeq.GetDeviceId() != CPUDEVICE)
+            secondSeqOnCPU.AssignValuesOf(secondSeq);
+        const ElemType* firstSeqData = firstSeq.GetDeviceId() == CPUDEVICE ? firstSeq.Data() : firstSeqOnCPU.Data();
+        const ElemType* secondSeqData = secondSeq.GetDeviceId() == CPUDEVICE ? secondSeq.Data() : secondSeqOnCPU.Data();
+
+        std::vector<MBLayout::SequenceInfo> sequences;
         for (const auto& sequence : pMBLayout->GetAllSequences())
         {
-            if (sequence.seqId == GAP_SEQUENCE_ID)
-                continue;
+            if (sequence.seqId != GAP_SEQUENCE_ID && pMBLayout->GetNumSequenceFramesInCurrentMB(sequence) > 0)
+                sequences.push_back(sequence);
+        }
 
-            auto numFrames = pMBLayout->GetNumSequenceFramesInCurrentMB(sequence);
+        // per-sequence results, summed up in a fixed order below so that the result does not depend on the number of threads
+        std::vector<float> wrongSampleNums(sequences.size());
+        std::vector<size_t> sampleNums(sequences.size()), frameNums(sequences.size());
 
-            if (numFrames > 0)
+        #pragma omp parallel for
+        for (long k = 0; k < (long)sequences.size(); k++)
+        {
+            auto columnIndices = pMBLayout->GetColumnIndices(sequences[k]);
+            frameNums[k] = columnIndices.size();
+
+            std::vector<int> firstSeqVec, secondSeqVec;
+            ExtractSampleSequence(firstSeqData, columnIndices, squashInputs, samplesToIgnore, firstSeqVec);
+            ExtractSampleSequence(secondSeqData, columnIndices, squashInputs, samplesToIgnore, secondSeqVec);
+
+            //calculate edit distance
+            size_t firstSize = firstSeqVec.size();
+            sampleNums[k] = firstSize;
+            size_t secondSize = secondSeqVec.size();
+            size_t rows = firstSize + 1;
+
+            // Edit distance between subsequences, and the numbers of insertions, deletions and substitutions it consists of; (i, j) is at [i + j * rows]
+            std::vector<float> grid(rows * (secondSize + 1));
+            std::vector<float> insMatrix(grid.size(), 0.0f);
+            std::vector<float> delMatrix(grid.size(), 0.0f);
+            std::vector<float> subMatrix(grid.size(), 0.0f);
+            float del, ins, sub;
+
+            for (size_t i = 0; i < firstSize + 1; i++)
             {
-                totalframeNum += numFrames;
-
-                auto columnIndices = pMBLayout->GetColumnIndices(sequence);
-
-                ExtractSampleSequence(firstSeq, columnIndices, squashInputs, samplesToIgnore, firstSeqVec);
-                ExtractSampleSequence(secondSeq, columnIndices, squashInputs, samplesToIgnore, secondSeqVec);
-
-                //calculate edit distance
-                size_t firstSize = firstSeqVec.size();
-                totalSampleNum += firstSize;
-                size_t secondSize = secondSeqVec.size();
-                grid.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.Resize(firstSize + 1, secondSize + 1);
-                delMatrix.Resize(firstSize + 1, secondSize + 1);
-                subMatrix.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.SetValue(0.0f);
-                delMatrix.SetValue(0.0f);
-                subMatrix.SetValue(0.0f);
-
-                for (size_t i = 0; i < firstSize + 1; i++)
-                {
-                    grid(i, 0) = (float)(i * delPen);
-                    delMatrix(i, 0) = (float)i;
-                }
+                grid[i] = (float)(i * delPen);
+                delMatrix[i] = (float)i;
+            }
 
-                for (size_t j = 0; j < secondSize + 1; j++)
-                {
-                    grid(0, j) = (float)(j * insPen);
-                    insMatrix(0, j) = (float)j;
-                }
-                for (size_t i = 1; i < firstSize + 1; i++)
+            for (size_t j = 0; j < secondSize + 1; j++)
+            {
+                grid[j * rows] = (float)(j * insPen);
+                insMatrix[j * rows] = (float)j;
+            }
+            for (size_t i = 1; i < firstSize + 1; i++)
+            {
+                for (size_t j = 1; j < secondSize + 1; j++)
                 {
-                    for (size_t j = 1; j < secondSize + 1; j++)
+                    size_t ij = i + j * rows, diag = ij - rows - 1, up = ij - 1, left = ij - rows;
+                    if (firstSeqVec[i - 1] == secondSeqVec[j - 1])
                     {
-                        if (firstSeqVec[i - 1] == secondSeqVec[j - 1])
+                        grid[ij] = grid[diag];
+                        insMatrix[ij] = insMatrix[diag];
+                        delMatrix[ij] = delMatrix[diag];
+                        subMatrix[ij] = subMatrix[diag];
+                    }
+                    else
+                    {
+                        del = grid[up] + delPen; //deletion 
+                        ins = grid[left] + insPen;  //insertion
+                        sub = grid[diag] + subPen; //substitution 
+                        if (sub <= del && sub <= ins)
+                        {
+                            insMatrix[ij] = insMatrix[diag];
+                            delMatrix[ij] = delMatrix[diag];
+                            subMatrix[ij] = subMatrix[diag] + 1.0f;
+                            grid[ij] = sub;
+                        }
+                        else if (del < ins)
                         {
-                            grid(i, j) = grid(i - 1, j - 1);
-                            insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                            delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                            subMatrix(i, j) = subMatrix(i - 1, j - 1);
+                            insMatrix[ij] = insMatrix[up];
+                            subMatrix[ij] = subMatrix[up];
+                            delMatrix[ij] = delMatrix[up] + 1.0f;
+                            grid[ij] = del;
                         }
                         else
                         {
-                            del = grid(i - 1, j) + delPen; //deletion 
-                            ins = grid(i, j - 1) + insPen;  //insertion
-                            sub = grid(i - 1, j - 1) + subPen; //substitution 
-                            if (sub <= del && sub <= ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                                delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                                subMatrix(i, j) = subMatrix(i - 1, j - 1) + 1.0f;
-                                grid(i, j) = sub;
-                            }
-                            else if (del < ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j);
-                                subMatrix(i, j) = subMatrix(i - 1, j);
-                                delMatrix(i, j) = delMatrix(i - 1, j) + 1.0f;
-                                grid(i, j) = del;
-                            }
-                            else
-                            {
-                                delMatrix(i, j) = delMatrix(i, j - 1);
-                                subMatrix(i, j) = subMatrix(i, j - 1);
-                                insMatrix(i, j) = insMatrix(i, j - 1) + 1.0f;
-                                grid(i, j) = ins;
-                            }
+                            delMatrix[ij] = delMatrix[left];
+                            subMatrix[ij] = subMatrix[left];
+                            insMatrix[ij] = insMatrix[left] + 1.0f;
+                            grid[ij] = ins;
                         }
                     }
                 }
-
-                wrongSampleNum += insMatrix(firstSize, secondSize) + delMatrix(firstSize, secondSize) + subMatrix(firstSize, secondSize);
             }
 
-            sequenceStartFrame += numFrames;
+            size_t last = grid.size() - 1;
+            wrongSampleNums[k] = insMatrix[last] + delMatrix[last] + subMatrix[last];
+        }
+
+        ElemType wrongSampleNum = 0.0;
+        size_t totalSampleNum = 0, totalframeNum = 0;
+        for (size_t k = 0; k < sequences.size(); k++)
+        {
+            wrongSampleNum += wrongSampleNums[k];
+            totalSampleNum += sampleNums[k];
+            totalframeNum += frameNums[k];
         }
 
         return (ElemType)(wrongSampleNum * totalframeNum / totalSampleNum);
@@ -699,13 +703,13 @@ private:
     float m_InsPen;
     std::vector<int> m_SamplesToIgnore;
 
-    // Clear out_SampleSeqVec and extract a vector of samples from the matrix into out_SampleSeqVec.
-    static void ExtractSampleSequence(const Matrix<ElemType>& firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<int>& samplesToIgnore, std::vector<int>& out_SampleSeqVec)
+    // Clear out_SampleSeqVec and extract a vector of samples from the row vector firstSeq (in CPU memory) into out_SampleSeqVec.
+    static void ExtractSampleSequence(const ElemType* firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<int>& samplesToIgnore, std::vector<int>& out_SampleSeqVec)
     {
         out_SampleSeqVec.clear();
 
         // Get the first element in the sequence
-        size_t lastId = (int)firstSeq(0, columnIndices[0]);
+        size_t lastId = (int)firstSeq[columnIndices[0]];
         if (std::find(samplesToIgnore.begin(), samplesToIgnore.end(), lastId) == samplesToIgnore.end())
             out_SampleSeqVec.push_back(lastId);
 
@@ -715,7 +719,7 @@ private:
             //squash sequences of identical samples
             for (size_t i = 1; i < columnIndices.size(); i++)
             {
-                size_t refId = (int)firstSeq(0, columnIndices[i]);
+                size_t refId = (int)firstSeq[columnIndices[i]];
                 if (lastId != refId)
                 {
                     lastId = refId;
@@ -728,7 +732,7 @@ private:
         {
             for (size_t i = 1; i < columnIndices.size(); i++)
             {
-                auto refId = (int)firstSeq(0, columnIndices[i]);
+                auto refId = (int)firstSeq[columnIndices[i]];
                 if (std::find(samplesToIgnore.begin(), samplesToIgnore.end(), refId) == samplesToIgnore.end())
                     out_SampleSeqVec.push_back(refId);
             }
@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <set>
 #include "Quantizers.h"
+#include "Int8QuantizedOperations.h"
 #include "InputAndParamNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -29,7 +30,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PlusNode : public BinaryElementWiseNode<ElemType>
+class PlusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Plus"; }
@@ -50,6 +51,8 @@ public:
         result.AssignSumOf(input0, input1);
     }
 
+    virtual ElementWiseOperator /*IElementwiseNode::*/ GetElementwiseOperator() const override { return opSum; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         size_t rank = DetermineElementwiseTensorRank();
@@ -135,7 +138,7 @@ template class LogPlusNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class MinusNode : public BinaryElementWiseNode<ElemType>
+class MinusNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Minus"; }
@@ -156,6 +159,8 @@ public:
         result.AssignDifferenceOf(input0, input1);
     }
 
+    virtual ElementWiseOperator /*IElementwiseNode::*/ GetElementwiseOperator() const override { return opDifference; }
+
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
     {
         size_t rank = DetermineElementwiseTensorRank();
@@ -181,7 +186,7 @@ template class MinusNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ElementTimesNode : public BinaryElementWiseNode<ElemType>
+class ElementTimesNode : public BinaryElementWiseNode<ElemType>, public IElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base;
     UsingBinaryElementwiseNodeBaseMembers;
@@ -207,6 +212,8 @@ public:
         BackpropToImpl(*this, inputIndex, fr, true/*allowBroadcast*/);
     }
 
+    virtual ElementWiseOperator /*IElementwiseNode::*/ GetElementwiseOperator() const override { return opElementwiseProduct; }
+
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
 
     template <typename classType>
@@ -391,6 +398,12 @@ public:
         auto input0 = OneSampleTensorFor(0,  /*gradient=*/false, fr.AllowBroadcast());
         auto input1 = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
         auto output = OneSampleTensorFor(-1, /*gradient=*/false, fr);
+        if (m_pQuantizedMultiplier && InputRef(0).GetEvalTimeStamp() > m_quantizedTimeStamp)
+        {
+            // the left operand has changed since it was quantized
+            m_pQuantizedMultiplier->ResetConstants();
+            m_quantizedTimeStamp = InputRef(0).GetEvalTimeStamp();
+        }
         output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/, 1.0f, this->m_pQuantizedMultiplier);
     }
 
@@ -607,8 +620,22 @@ public:
     size_t OutputRank() const { return m_outputRank; }
     int InferInputRankToMap() const { return m_inferInputRankToMap; }
 
+    // Int8 inference (see ComputationNetwork::EnableInt8Inference()): the product uses int8 weights with one scale per
+    // output row and int8 inputs whose range is calibrated over the first calibrationCount products. Only applies on CPU
+    // to a non-transposed product whose left operand is a parameter; products with sparse data stay as they are.
+    // Returns whether int8 is used.
+    bool EnableInt8Inference(size_t calibrationCount)
+    {
+        if (m_transpose || m_deviceId != CPUDEVICE || m_pQuantizedMultiplier != nullptr || !dynamic_pointer_cast<LearnableParameter<ElemType>>(Input(0)))
+            return false;
+        m_pQuantizedMultiplier = make_shared<Int8QuantizedMultiplier<ElemType>>(/*isAConstant=*/true, calibrationCount);
+        m_quantizedTimeStamp = 0;
+        return true;
+    }
+
 protected: 
     shared_ptr<QuantizedMultiplier<ElemType>> m_pQuantizedMultiplier;
+    uint64_t m_quantizedTimeStamp = 0; // time stamp of the left operand when it was last quantized
 
 private:
     size_t m_outputRank;
@@ -17,6 +17,8 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class ComputationNodeBase;
+
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
 // Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
@@ -51,8 +53,9 @@ public:
 #endif
     }
 
+    // 'owner' is the node the matrix is requested for, see GetRequestHistory()
     template <class ElemType>
-    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId)
+    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId, const ComputationNodeBase* owner = nullptr)
     {
         vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
         shared_ptr<Matrix<ElemType>> matrixPtr;
@@ -69,8 +72,22 @@ public:
         if (!matrixPtr) // this can't really happen
             LogicError("MatrixPool::Request: failed to get a valid matrix.");
 
+        if (owner)
+            m_requestHistory.push_back(make_pair(matrixPtr.get(), owner));
+
         return matrixPtr;
     }
+
+    // The matrices handed out so far and the nodes they were requested for, in order of the requests. Nodes that get
+    // the same matrix must not be executed concurrently; see PARTraversalFlowControlNode for how this is used.
+    // Returns the history since the last call.
+    vector<pair<const MatrixBase*, const ComputationNodeBase*>> TakeRequestHistory()
+    {
+        return std::move(m_requestHistory);
+    }
+
+private:
+    vector<pair<const MatrixBase*, const ComputationNodeBase*>> m_requestHistory;
 };
 
 }}}
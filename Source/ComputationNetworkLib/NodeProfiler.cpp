@@ -0,0 +1,184 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "NodeProfiler.h"
+#include "fileutil.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+NodeProfiler::NodeProfiler()
+    : m_enabled(false), m_origin(chrono::steady_clock::now()), m_numDroppedEvents(0)
+{
+}
+
+void NodeProfiler::Clear()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_events.clear();
+    m_numDroppedEvents = 0;
+    m_totals.clear();
+    m_origin = chrono::steady_clock::now();
+}
+
+long long NodeProfiler::Now() const
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_origin).count();
+}
+
+// caller must hold m_mutex
+int NodeProfiler::ThreadIndex()
+{
+    auto result = m_threadIndices.insert(make_pair(this_thread::get_id(), (int) m_threadIndices.size()));
+    return result.first->second;
+}
+
+// caller must hold m_mutex
+NodeProfiler::NodeTotals& NodeProfiler::Totals(const ComputationNodeBasePtr& node)
+{
+    auto iter = m_totals.find(node.get());
+    if (iter == m_totals.end())
+    {
+        NodeTotals totals = { node->NodeName(), node->OperationName(), { 0, 0 }, { 0, 0 }, 0 };
+        iter = m_totals.insert(make_pair(node.get(), totals)).first;
+    }
+    return iter->second;
+}
+
+void NodeProfiler::Record(const ComputationNodeBasePtr& node, bool backward, long long startTime, long long endTime, unsigned long long bytesAllocated)
+{
+    // a recurrent loop reports its member nodes itself
+    bool isLoop = dynamic_pointer_cast<FlowControlNode>(node) != nullptr;
+    double flops = isLoop ? 0 : backward ? EstimateBackwardFlops(*node) : EstimateForwardFlops(*node);
+
+    lock_guard<mutex> lock(m_mutex);
+    if (m_events.size() < s_maxEvents)
+        m_events.push_back(Event{ node->NodeName(), node->OperationName(), backward, ThreadIndex(), startTime, endTime - startTime, bytesAllocated, flops });
+    else
+        m_numDroppedEvents++;
+
+    if (isLoop)
+        return;
+    auto& totals = Totals(node);
+    totals.m_time[backward] += endTime - startTime;
+    totals.m_flops[backward] += flops;
+    totals.m_bytesAllocated += bytesAllocated;
+}
+
+void NodeProfiler::RecordStep(const ComputationNodeBasePtr& node, bool backward, long long duration, unsigned long long bytesAllocated)
+{
+    lock_guard<mutex> lock(m_mutex);
+    auto& totals = Totals(node);
+    totals.m_time[backward] += duration;
+    totals.m_bytesAllocated += bytesAllocated;
+}
+
+void NodeProfiler::RecordLoop(const vector<ComputationNodeBasePtr>& nodes, bool backward)
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (const auto& node : nodes)
+        Totals(node).m_flops[backward] += backward ? EstimateBackwardFlops(*node) : EstimateForwardFlops(*node);
+}
+
+/*static*/ double NodeProfiler::EstimateForwardFlops(const ComputationNodeBase& node)
+{
+    double outputElements = (double) node.GetSampleMatrixNumRows() * node.GetSampleMatrixNumCols();
+    const wstring operation = node.OperationName();
+    if ((operation == L"Times" || operation == L"TransposeTimes") && node.GetNumInputs() == 2)
+    {
+        // each output element is a dot product over the shared dimension of the two operands
+        size_t outputSampleElements = node.GetSampleLayout().GetNumElements();
+        size_t weightElements = node.Input(0)->GetSampleLayout().GetNumElements();
+        if (outputSampleElements > 0)
+            return 2 * outputElements * ((double) weightElements / outputSampleElements);
+    }
+    else if (operation == L"Convolution" && node.GetNumInputs() >= 2)
+    {
+        // each output element is a dot product over the kernel of its output channel
+        const auto& outputShape = node.GetSampleLayout();
+        size_t numOutputChannels = outputShape.GetRank() > 0 ? outputShape[outputShape.GetRank() - 1] : 1;
+        size_t kernelElements = node.Input(0)->GetSampleLayout().GetNumElements();
+        if (numOutputChannels > 0)
+            return 2 * outputElements * ((double) kernelElements / numOutputChannels);
+    }
+    return outputElements;
+}
+
+/*static*/ double NodeProfiler::EstimateBackwardFlops(const ComputationNodeBase& node)
+{
+    // the gradients of the products w.r.t. both operands cost as much as the forward product each
+    const wstring operation = node.OperationName();
+    bool isProduct = operation == L"Times" || operation == L"TransposeTimes" || operation == L"Convolution";
+    return (isProduct ? 2 : 1) * EstimateForwardFlops(node);
+}
+
+static string JsonEscape(const wstring& s)
+{
+    string result;
+    for (char c : msra::strfun::utf8(s))
+    {
+        if (c == '"' || c == '\\')
+            result.push_back('\\');
+        if ((unsigned char) c >= 0x20)
+            result.push_back(c);
+    }
+    return result;
+}
+
+void NodeProfiler::WriteChromeTrace(const wstring& path) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    msra::files::make_intermediate_dirs(path);
+    FILE* f = fopenOrDie(path, L"wt");
+    fprintfOrDie(f, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < m_events.size(); i++)
+    {
+        const auto& e = m_events[i];
+        fprintfOrDie(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":0,\"tid\":%d,"
+                        "\"args\":{\"op\":\"%s\",\"flops\":%.0f,\"bytesAllocated\":%llu}}%s\n",
+                     JsonEscape(e.m_name).c_str(), e.m_backward ? "backward" : "forward", e.m_startTime, e.m_duration, e.m_threadIndex,
+                     JsonEscape(e.m_operation).c_str(), e.m_flops, e.m_bytesAllocated, i + 1 < m_events.size() ? "," : "");
+    }
+    fprintfOrDie(f, "],\n\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%d}}\n", (int) m_numDroppedEvents);
+    fcloseOrDie(f);
+}
+
+void NodeProfiler::PrintTopNodes(FILE* f, size_t topN) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    vector<const NodeTotals*> nodes;
+    long long totalTime = 0;
+    for (const auto& entry : m_totals)
+    {
+        nodes.push_back(&entry.second);
+        totalTime += entry.second.m_time[0] + entry.second.m_time[1];
+    }
+    sort(nodes.begin(), nodes.end(), [](const NodeTotals* a, const NodeTotals* b)
+    {
+        return a->m_time[0] + a->m_time[1] > b->m_time[0] + b->m_time[1];
+    });
+    if (nodes.size() > topN)
+        nodes.resize(topN);
+
+    fprintf(f, "Node profile: %d nodes, %.3f s total (top %d by forward + backward time)\n", (int) m_totals.size(), totalTime * 1e-6, (int) nodes.size());
+    fprintf(f, "%-40s %-24s %10s %10s %6s %10s %9s %10s\n", "Node", "Operation", "Fwd ms", "Bwd ms", "%", "GFLOP", "GFLOP/s", "Alloc MB");
+    for (const auto* node : nodes)
+    {
+        long long time = node->m_time[0] + node->m_time[1];
+        double flops = node->m_flops[0] + node->m_flops[1];
+        fprintf(f, "%-40ls %-24ls %10.2f %10.2f %6.2f %10.3f %9.2f %10.2f\n",
+                node->m_name.c_str(), node->m_operation.c_str(), node->m_time[0] * 1e-3, node->m_time[1] * 1e-3,
+                totalTime > 0 ? 100.0 * time / totalTime : 0.0, flops * 1e-9, time > 0 ? flops * 1e-3 / time : 0.0,
+                node->m_bytesAllocated / (1024.0 * 1024.0));
+    }
+    if (m_numDroppedEvents > 0)
+        fprintf(f, "Node profile: the timeline is missing the last %d events (limit %d).\n", (int) m_numDroppedEvents, (int) s_maxEvents);
+}
+
+}}}
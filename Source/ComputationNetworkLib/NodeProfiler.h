@@ -0,0 +1,137 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// ===========================================================================
+// NodeProfiler -- per-node timing of forward and backward propagation
+//
+// When enabled, the traversal of a network records for every node and direction the
+// wall-clock time, the executing thread, the bytes of matrix storage allocated meanwhile,
+// and an estimate of the floating-point operations. The results can be exported as a
+// timeline in the Chrome trace format (chrome://tracing) and as a table of the most
+// expensive nodes.
+//
+// Top-level (PAR) nodes appear on the timeline individually. A recurrent loop appears on the
+// timeline as a whole, while the time of its member nodes is accumulated over all time steps
+// and shows in the table only. Fused elementwise runs are split evenly among their nodes.
+//
+// The FLOP estimates are coarse: 2 * M * N * K for Times, TransposeTimes and Convolution,
+// one operation per output element for everything else, and twice the forward cost for
+// the backward propagation of the former.
+// ===========================================================================
+
+class NodeProfiler
+{
+public:
+    NodeProfiler();
+
+    void Enable(bool enable) { m_enabled = enable; }
+    bool IsEnabled() const { return m_enabled; }
+
+    // discard everything recorded so far; the timeline starts over at 0
+    void Clear();
+
+    // microseconds since the last Clear()
+    long long Now() const;
+
+    // execution of a top-level node, or of a recurrent loop as a whole
+    void Record(const ComputationNodeBasePtr& node, bool backward, long long startTime, long long endTime, unsigned long long bytesAllocated);
+    // (part of) the execution of a node inside a recurrent loop; accumulated into the node's totals
+    void RecordStep(const ComputationNodeBasePtr& node, bool backward, long long duration, unsigned long long bytesAllocated);
+    // account for the operations of one pass of a recurrent loop over the minibatch
+    void RecordLoop(const std::vector<ComputationNodeBasePtr>& nodes, bool backward);
+
+    // times one execution of a node from construction to destruction; does nothing if 'profiler' is null
+    class Scope
+    {
+    public:
+        Scope(NodeProfiler* profiler, const ComputationNodeBasePtr& node, bool backward, bool isLoopStep = false)
+            : m_profiler(profiler), m_node(node), m_backward(backward), m_isLoopStep(isLoopStep)
+        {
+            if (m_profiler)
+            {
+                m_startBytes = GetThreadMatrixBytesAllocated();
+                m_startTime = m_profiler->Now();
+            }
+        }
+        ~Scope()
+        {
+            if (!m_profiler)
+                return;
+            long long endTime = m_profiler->Now();
+            unsigned long long bytes = GetThreadMatrixBytesAllocated() - m_startBytes;
+            if (m_isLoopStep)
+                m_profiler->RecordStep(m_node, m_backward, endTime - m_startTime, bytes);
+            else
+                m_profiler->Record(m_node, m_backward, m_startTime, endTime, bytes);
+        }
+
+    private:
+        NodeProfiler* m_profiler;
+        const ComputationNodeBasePtr& m_node;
+        bool m_backward;
+        bool m_isLoopStep;
+        long long m_startTime;
+        unsigned long long m_startBytes;
+    };
+
+    // write the timeline as a Chrome trace (JSON)
+    void WriteChromeTrace(const std::wstring& path) const;
+    // print the 'topN' nodes with the highest forward + backward time
+    void PrintTopNodes(FILE* f, size_t topN) const;
+
+    static double EstimateForwardFlops(const ComputationNodeBase& node);
+    static double EstimateBackwardFlops(const ComputationNodeBase& node);
+
+private:
+    struct Event
+    {
+        std::wstring m_name;
+        std::wstring m_operation;
+        bool m_backward;
+        int m_threadIndex;
+        long long m_startTime;
+        long long m_duration;
+        unsigned long long m_bytesAllocated;
+        double m_flops;
+    };
+    struct NodeTotals
+    {
+        std::wstring m_name;
+        std::wstring m_operation;
+        long long m_time[2];       // [backward]
+        double m_flops[2];
+        unsigned long long m_bytesAllocated;
+    };
+
+    int ThreadIndex(); // small id of the calling thread, for the timeline
+    NodeTotals& Totals(const ComputationNodeBasePtr& node);
+
+    static const size_t s_maxEvents = 1 << 20; // the timeline is capped; the totals are always complete
+
+    bool m_enabled;
+    std::chrono::steady_clock::time_point m_origin;
+    mutable std::mutex m_mutex; // nodes may be executed concurrently, see PARTraversalFlowControlNode
+    std::vector<Event> m_events;
+    size_t m_numDroppedEvents;
+    std::unordered_map<const ComputationNodeBase*, NodeTotals> m_totals;
+    std::map<std::thread::id, int> m_threadIndices;
+};
+
+}}}
@@ -494,10 +494,103 @@ template<class ElemType, int direction>
         LogicError("Unrecognized direction in DelayedValueNodeBase");
 }
 
+// Permute the carried-over activations across parallel sequences: after this, parallel sequence s continues
+// from the state that parallel sequence sourceSequences[s] had at the end of the last minibatch.
+// This is used by beam search, where each step continues the surviving hypotheses in new positions.
+template<class ElemType, int direction>
+/*virtual*/ void DelayedValueNodeBase<ElemType,direction>::/*IStatefulNode::*/ ReorderParallelSequences(const std::vector<size_t>& sourceSequences) /*override*/
+{
+    int dir = direction;
+    if (dir != -1) // state is only carried over left-to-right
+        LogicError("%ls %ls operation: Reordering of the recurrent state is only supported for recurrences into the past.", NodeName().c_str(), OperationName().c_str());
+
+    if (!m_delayedActivationMBLayout || m_delayedValue->IsEmpty())
+        return; // nothing carried over yet
+
+    size_t nT = m_delayedActivationMBLayout->GetNumTimeSteps();
+    size_t nU = m_delayedActivationMBLayout->GetNumParallelSequences();
+    if (sourceSequences.size() != nU)
+        InvalidArgument("%ls %ls operation: Reordering expects %d parallel sequences, but got %d.", NodeName().c_str(), OperationName().c_str(), (int)nU, (int)sourceSequences.size());
+
+    vector<ElemType> indices(nT * nU);
+    for (size_t s = 0; s < nU; s++)
+    {
+        if (sourceSequences[s] >= nU)
+            InvalidArgument("%ls %ls operation: Parallel sequence index %d out of range.", NodeName().c_str(), OperationName().c_str(), (int)sourceSequences[s]);
+        for (size_t t = 0; t < nT; t++)
+            indices[t * nU + s] = (ElemType)(t * nU + sourceSequences[s]);
+    }
+    Matrix<ElemType> indexMap(1, indices.size(), indices.data(), m_deviceId);
+
+    auto reordered = make_shared<Matrix<ElemType>>(m_deviceId);
+    reordered->DoGatherColumnsOf(0, indexMap, *m_delayedValue, 1);
+    m_delayedValue = reordered;
+}
+
+// Per-sequence state, for evaluating independent streams in one minibatch.
+// Unlike ExportState(), which takes the last frame of the minibatch, this takes the last frame of each
+// parallel sequence, since sequences of different length end in different frames.
+// Column s of 'states' receives the activation that parallel sequence s would continue from (zero if it is a gap).
+template<class ElemType, int direction>
+void DelayedValueNodeBase<ElemType, direction>::ExportSequenceStates(Matrix<ElemType>& states) const
+{
+    int dir = direction;
+    if (dir != -1 || m_timeStep != 1)
+        RuntimeError("%ls %ls operation: Per-sequence state is only supported for recurrences into the past with timeStep=1.", NodeName().c_str(), OperationName().c_str());
+    if (!m_delayedActivationMBLayout)
+        LogicError("%ls %ls operation: No state to export before the first minibatch.", NodeName().c_str(), OperationName().c_str());
+
+    size_t nT = m_delayedActivationMBLayout->GetNumTimeSteps();
+    size_t nU = m_delayedActivationMBLayout->GetNumParallelSequences();
+
+    // last frame of the latest sequence in each parallel sequence
+    vector<ElemType> indices(nU, (ElemType)-1);
+    vector<ptrdiff_t> tBegin(nU, SentinelValueIndicatingUnspecifedSequenceBeginIdx);
+    for (const auto& sequenceInfo : m_delayedActivationMBLayout->GetAllSequences())
+    {
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID || sequenceInfo.tBegin < tBegin[sequenceInfo.s])
+            continue;
+        tBegin[sequenceInfo.s] = sequenceInfo.tBegin;
+        size_t tLast = min(sequenceInfo.tEnd, nT) - 1;
+        indices[sequenceInfo.s] = (ElemType)(tLast * nU + sequenceInfo.s);
+    }
+    Matrix<ElemType> indexMap(1, nU, indices.data(), m_deviceId);
+
+    states.Resize(m_delayedValue->GetNumRows(), nU);
+    states.SetValue(0);
+    states.DoGatherColumnsOf(1, indexMap, *m_delayedValue, 1);
+}
+
+// Set the state carried over into the next minibatch, such that parallel sequence s continues from column s of 'states'.
+// Only sequences that begin before the next minibatch (tBegin < 0) use it.
+template<class ElemType, int direction>
+void DelayedValueNodeBase<ElemType, direction>::ImportSequenceStates(const Matrix<ElemType>& states)
+{
+    int dir = direction;
+    if (dir != -1 || m_timeStep != 1)
+        RuntimeError("%ls %ls operation: Per-sequence state is only supported for recurrences into the past with timeStep=1.", NodeName().c_str(), OperationName().c_str());
+
+    // the state looks like a previous minibatch of a single frame, in which all sequences cross the end
+    size_t nU = states.GetNumCols();
+    if (!m_delayedActivationMBLayout)
+        m_delayedActivationMBLayout = make_shared<MBLayout>();
+    m_delayedActivationMBLayout->Init(nU, 1);
+    for (size_t s = 0; s < nU; s++)
+        m_delayedActivationMBLayout->AddSequence(s, s, 0, 2);
+
+    m_delayedValue->SetValue(states);
+}
+
 // instantiate the classes that derive from the above
 template class PastValueNode<float>;
 template class PastValueNode<double>;
 
+// the per-sequence state functions are not virtual, so they are not instantiated with the derived classes
+template void DelayedValueNodeBase<float, -1>::ExportSequenceStates(Matrix<float>& states) const;
+template void DelayedValueNodeBase<double, -1>::ExportSequenceStates(Matrix<double>& states) const;
+template void DelayedValueNodeBase<float, -1>::ImportSequenceStates(const Matrix<float>& states);
+template void DelayedValueNodeBase<double, -1>::ImportSequenceStates(const Matrix<double>& states);
+
 template class FutureValueNode<float>;
 template class FutureValueNode<double>;
 
@@ -73,6 +73,9 @@ public:
     virtual int /*IRecurrentNode::*/ GetRecurrenceSteppingDirection() const override { return -direction; }
     virtual NodeStatePtr /*IStatefulNode::*/ ExportState() override;
     virtual void /*IStatefulNode::*/ ImportState(const NodeStatePtr& pImportedState) override;
+    virtual void /*IStatefulNode::*/ ReorderParallelSequences(const std::vector<size_t>& sourceSequences) override;
+    void ExportSequenceStates(Matrix<ElemType>& states) const;
+    void ImportSequenceStates(const Matrix<ElemType>& states);
     int TimeStep() const { return m_timeStep; }
     ElemType InitialActivationValue() const { return m_initialStateValue; }
 
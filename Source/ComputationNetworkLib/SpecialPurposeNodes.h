@@ -14,6 +14,8 @@
 #include <stdexcept>
 #include <list>
 #include <memory>
+#include <limits>
+#include <algorithm>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -675,6 +677,290 @@ protected:
 template class SequenceWithSoftmaxNode<float>;
 template class SequenceWithSoftmaxNode<double>;
 
+// -----------------------------------------------------------------------
+// CTCWithSoftmaxNode (labels, prediction, blankTokenId=-1)
+// connectionist temporal classification (CTC) training criterion, see "Connectionist Temporal Classification: Labelling Unsegmented
+// Sequence Data with Recurrent Neural Networks", http://machinelearning.wustl.edu/mlpapers/paper_files/icml2006_GravesFGS06.pdf
+//
+// 'labels' is a one-hot label sequence (without blanks) on its own dynamic axis; each label sequence is matched
+// to the sequence of 'prediction' with the same sequence id. 'prediction' holds the unnormalized log probabilities
+// of all labels plus the blank, which is row 'blankTokenId' (-1: the last row).
+// The value is the sum over all sequences of -log P(labels | prediction).
+//
+// The forward-backward recursions run in log space on the CPU (also if the network lives on a GPU), one sequence per thread.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class CTCWithSoftmaxNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<2>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base;
+    UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName()
+    {
+        return L"CTCWithSoftmax";
+    }
+
+public:
+    CTCWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, int blankTokenId = -1)
+        : Base(deviceId, name), m_blankTokenId(blankTokenId)
+    {
+    }
+
+    CTCWithSoftmaxNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : CTCWithSoftmaxNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"blankTokenId"))
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void BackpropToNonLooping(size_t inputIndex) override
+    {
+        if (inputIndex == 0)
+            LogicError("CTCWithSoftmaxNode: Gradients with respect to the labels are not implemented.");
+
+        // predictionGradient += derivative * scalarGradientFromTop
+        FrameRange fr(Input(1)->GetMBLayout());
+        auto gradient = Input(1)->GradientFor(fr);
+        Matrix<ElemType>::Multiply1x1AndWeightedAdd(+1.0f, Gradient() /*1x1*/, *m_derivative, 1.0f, gradient);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    virtual void ForwardPropNonLooping() override
+    {
+        auto pMBLayout = Input(1)->GetMBLayout();
+        auto pLabelMBLayout = Input(0)->GetMBLayout();
+        const size_t numClasses = Input(1)->GetSampleMatrixNumRows();
+        const size_t numCols = Input(1)->Value().GetNumCols();
+        const size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        const size_t blankTokenId = m_blankTokenId < 0 ? numClasses - 1 : (size_t)m_blankTokenId;
+
+        // the recursions run on the CPU
+        m_logSoftmaxOfRight->AssignLogSoftmaxOf(Input(1)->Value() /*prediction*/, true);
+        Matrix<ElemType> logProbsOnCPU(CPUDEVICE);
+        Matrix<ElemType> labelsOnCPU(CPUDEVICE);
+        if (m_logSoftmaxOfRight->GetDeviceId() != CPUDEVICE)
+            logProbsOnCPU.AssignValuesOf(*m_logSoftmaxOfRight);
+        labelsOnCPU.AssignValuesOf(Input(0)->Value());
+        const ElemType* logProbs = m_logSoftmaxOfRight->GetDeviceId() == CPUDEVICE ? m_logSoftmaxOfRight->Data() : logProbsOnCPU.Data();
+
+        // pair each prediction sequence with its label sequence
+        std::vector<MBLayout::SequenceInfo> sequences, labelSequences;
+        for (const auto& sequence : pMBLayout->GetAllSequences())
+        {
+            if (sequence.seqId == GAP_SEQUENCE_ID)
+                continue;
+            if (sequence.tBegin < 0 || sequence.tEnd > pMBLayout->GetNumTimeSteps())
+                InvalidArgument("%ls %ls operation requires complete sequences, but sequence %d is truncated.", NodeName().c_str(), OperationName().c_str(), (int)sequence.seqId);
+            auto labelSequence = std::find_if(pLabelMBLayout->GetAllSequences().begin(), pLabelMBLayout->GetAllSequences().end(),
+                                              [&](const MBLayout::SequenceInfo& s) { return s.seqId == sequence.seqId; });
+            if (labelSequence == pLabelMBLayout->GetAllSequences().end())
+                InvalidArgument("%ls %ls operation: No label sequence for sequence %d.", NodeName().c_str(), OperationName().c_str(), (int)sequence.seqId);
+            sequences.push_back(sequence);
+            labelSequences.push_back(*labelSequence);
+        }
+
+        // label ids = row of the max value of each label column
+        std::vector<std::vector<size_t>> labels(sequences.size());
+        const size_t numLabelRows = labelsOnCPU.GetNumRows();
+        for (size_t i = 0; i < sequences.size(); i++)
+        {
+            for (auto col : pLabelMBLayout->GetColumnIndices(labelSequences[i]))
+            {
+                const ElemType* column = labelsOnCPU.Data() + col * numLabelRows;
+                size_t label = std::max_element(column, column + numLabelRows) - column;
+                if (label == blankTokenId)
+                    InvalidArgument("%ls %ls operation: The label sequence %d contains the blank.", NodeName().c_str(), OperationName().c_str(), (int)sequences[i].seqId);
+                labels[i].push_back(label);
+            }
+        }
+
+        // gap columns receive no gradient
+        std::vector<ElemType> derivative(numClasses * numCols, 0);
+        std::vector<double> logLikelihoods(sequences.size());
+
+        #pragma omp parallel for
+        for (long i = 0; i < (long)sequences.size(); i++)
+        {
+            const auto& sequence = sequences[i];
+            const size_t firstCol = sequence.tBegin * numParallelSequences + sequence.s;
+            logLikelihoods[i] = ForwardBackward(logProbs + firstCol * numClasses, numClasses, sequence.GetNumTimeSteps(), numParallelSequences * numClasses,
+                                                labels[i], blankTokenId, derivative.data() + firstCol * numClasses);
+        }
+
+        double totalLogLikelihood = 0;
+        for (size_t i = 0; i < sequences.size(); i++)
+        {
+            if (logLikelihoods[i] == -std::numeric_limits<double>::infinity())
+                RuntimeError("%ls %ls operation: Sequence %d has too few frames for its %d labels.", NodeName().c_str(), OperationName().c_str(),
+                             (int)sequences[i].seqId, (int)labelSequences[i].GetNumTimeSteps());
+            totalLogLikelihood += logLikelihoods[i];
+        }
+
+        Value().SetValue((ElemType)-totalLogLikelihood);
+        m_derivative->SetValue(numClasses, numCols, m_deviceId, derivative.data());
+#if NANCHECK
+        Value().HasNan("CTCWithSoftmax");
+#endif
+    }
+
+    // CTC forward-backward algorithm for one sequence, in log space.
+    // logProbs   - log posteriors of the frames; frame t is at logProbs + t * stride
+    // labels     - label ids of the sequence, each < numClasses and != blankTokenId
+    // derivative - receives the gradient of -log P(labels) w.r.t. the unnormalized prediction of each frame, in the same layout as logProbs
+    // Returns log P(labels), or -infinity if the sequence has too few frames for its labels.
+    static double ForwardBackward(const ElemType* logProbs, size_t numClasses, size_t numFrames, size_t stride,
+                                  const std::vector<size_t>& labels, size_t blankTokenId, ElemType* derivative)
+    {
+        const double logZero = -std::numeric_limits<double>::infinity();
+
+        // the states are the labels with blanks in between and at both ends: s = 2u+1 is label u, even s are blanks
+        const size_t numStates = 2 * labels.size() + 1;
+        std::vector<size_t> stateLabels(numStates, blankTokenId);
+        std::vector<char> canSkip(numStates, false); // whether the state can be entered from two states back, skipping a blank
+        for (size_t u = 0; u < labels.size(); u++)
+        {
+            stateLabels[2 * u + 1] = labels[u];
+            canSkip[2 * u + 1] = u > 0 && labels[u] != labels[u - 1];
+        }
+        if (numFrames == 0)
+            return logZero;
+
+        // alpha[t * numStates + s] = log probability of all prefixes of length t+1 that end in state s
+        // The states of one frame do not depend on each other, so that the inner loops can be vectorized.
+        std::vector<double> alpha(numFrames * numStates, logZero);
+        alpha[0] = logProbs[blankTokenId];
+        if (numStates > 1)
+            alpha[1] = logProbs[stateLabels[1]];
+        for (size_t t = 1; t < numFrames; t++)
+        {
+            const double* prev = &alpha[(t - 1) * numStates];
+            double* cur = &alpha[t * numStates];
+            const ElemType* frame = logProbs + t * stride;
+            for (size_t s = 0; s < numStates; s++)
+            {
+                double a = prev[s];
+                double b = s >= 1 ? prev[s - 1] : logZero;
+                double c = canSkip[s] ? prev[s - 2] : logZero;
+                cur[s] = LogAdd(a, b, c) + frame[stateLabels[s]];
+            }
+        }
+        const double* last = &alpha[(numFrames - 1) * numStates];
+        const double logLikelihood = LogAdd(last[numStates - 1], numStates > 1 ? last[numStates - 2] : logZero, logZero);
+        if (logLikelihood == logZero)
+            return logZero;
+
+        // beta[s] = log probability of all suffixes after frame t, given state s at frame t
+        std::vector<double> beta(numStates, logZero), nextBeta(numStates);
+        std::vector<double> logOccupancy(numClasses);
+        beta[numStates - 1] = 0;
+        if (numStates > 1)
+            beta[numStates - 2] = 0;
+        for (size_t t = numFrames; t-- > 0;)
+        {
+            if (t < numFrames - 1)
+            {
+                const ElemType* frame = logProbs + (t + 1) * stride;
+                for (size_t s = 0; s < numStates; s++)
+                {
+                    double a = nextBeta[s] + frame[stateLabels[s]];
+                    double b = s + 1 < numStates ? nextBeta[s + 1] + frame[stateLabels[s + 1]] : logZero;
+                    double c = s + 2 < numStates && canSkip[s + 2] ? nextBeta[s + 2] + frame[stateLabels[s + 2]] : logZero;
+                    beta[s] = LogAdd(a, b, c);
+                }
+            }
+
+            // derivative = softmax - posterior probability of each label at frame t
+            std::fill(logOccupancy.begin(), logOccupancy.end(), logZero);
+            const double* alphaT = &alpha[t * numStates];
+            for (size_t s = 0; s < numStates; s++)
+            {
+                auto& occupancy = logOccupancy[stateLabels[s]];
+                occupancy = LogAdd(occupancy, alphaT[s] + beta[s], logZero);
+            }
+            const ElemType* frame = logProbs + t * stride;
+            ElemType* frameDerivative = derivative + t * stride;
+            for (size_t k = 0; k < numClasses; k++)
+                frameDerivative[k] = (ElemType)(exp((double)frame[k]) - exp(logOccupancy[k] - logLikelihood));
+
+            beta.swap(nextBeta);
+        }
+        return logLikelihood;
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        Base::Validate(isFinalValidationPass);
+        m_pMBLayout = nullptr; // no layout
+
+        if (isFinalValidationPass)
+        {
+            if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout())
+                InvalidArgument("%ls %ls operation requires both inputs to be sequences.", NodeName().c_str(), OperationName().c_str());
+            if (Input(0)->GetSampleMatrixNumRows() != Input(1)->GetSampleMatrixNumRows())
+                InvalidArgument("%ls %ls operation requires the labels and the prediction to have the same dimension (one-hot, including the blank).", NodeName().c_str(), OperationName().c_str());
+            if (m_blankTokenId >= (int)Input(1)->GetSampleMatrixNumRows())
+                InvalidArgument("%ls %ls operation: blankTokenId %d is out of range.", NodeName().c_str(), OperationName().c_str(), m_blankTokenId);
+        }
+
+        SetDims(TensorShape(1), false);
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<CTCWithSoftmaxNode<ElemType>>(nodeP);
+            node->m_blankTokenId = m_blankTokenId;
+        }
+    }
+
+    virtual void Save(File& fstream) const override
+    {
+        Base::Save(fstream);
+        fstream << m_blankTokenId;
+    }
+
+    virtual void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        fstream >> m_blankTokenId;
+    }
+
+    // request matrices needed to do node function value evaluation
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_logSoftmaxOfRight, matrixPool);
+        RequestMatrixFromPool(m_derivative, matrixPool);
+    }
+
+    // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
+    virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
+    {
+        Base::ReleaseMatricesAfterBackprop(matrixPool);
+        ReleaseMatrixToPool(m_logSoftmaxOfRight, matrixPool);
+        ReleaseMatrixToPool(m_derivative, matrixPool);
+    }
+
+private:
+    static double LogAdd(double a, double b, double c)
+    {
+        double m = std::max(a, std::max(b, c));
+        if (m == -std::numeric_limits<double>::infinity())
+            return m;
+        return m + log(exp(a - m) + exp(b - m) + exp(c - m));
+    }
+
+    int m_blankTokenId;
+    shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight;
+    shared_ptr<Matrix<ElemType>> m_derivative; // gradient of the value w.r.t. the prediction, computed together with the value
+};
+
+template class CTCWithSoftmaxNode<float>;
+template class CTCWithSoftmaxNode<double>;
+
 // -----------------------------------------------------------------------
 // DummyCriterionNode (objectiveValues, userSuppliedGradient, prediction)
 // TODO: Rename to CustomCriterionNode?
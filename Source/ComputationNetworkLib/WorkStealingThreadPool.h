@@ -0,0 +1,264 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Basics.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// WorkStealingThreadPool -- executes a graph of dependent tasks on a fixed set of threads
+//
+// Each thread has its own queue of ready tasks. Tasks that become ready when a thread completes their last
+// predecessor are pushed to the back of that thread's queue and taken from there by the same thread (so a chain
+// of dependent tasks tends to stay on one core), while idle threads steal from the front of the other queues.
+// The thread calling Run() participates as worker 0, so a pool of N workers starts N - 1 threads.
+// Only one graph can be executed at a time; TryRun() returns false instead of waiting if the pool is busy.
+class WorkStealingThreadPool
+{
+public:
+    WorkStealingThreadPool(size_t numWorkers)
+        : m_shutdown(false), m_generation(0), m_numSleeping(0), m_numRemaining(0), m_numQueued(0), m_numRunning(0), m_failed(false),
+          m_successors(nullptr), m_execute(nullptr)
+    {
+        if (numWorkers == 0)
+            InvalidArgument("WorkStealingThreadPool: At least one worker is needed.");
+
+        for (size_t i = 0; i < numWorkers; i++)
+            m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+        for (size_t i = 1; i < numWorkers; i++)
+            m_threads.push_back(std::thread([this, i]() { WorkerLoop(i); }));
+    }
+
+    ~WorkStealingThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    size_t NumWorkers() const { return m_queues.size(); }
+
+    // number of tasks of the current graph that are ready or executing; used to split the cores among concurrent tasks
+    size_t NumActiveTasks() const { return m_numQueued + m_numRunning; }
+
+    // Executes the tasks 0..N-1 of a graph, where N = numPredecessors.size(). Task i is started once all
+    // numPredecessors[i] tasks that list it in their successors[] have completed. execute(task) is called
+    // concurrently from all workers. If a task throws, the remaining tasks are skipped and the first
+    // exception is rethrown here once all running tasks have finished.
+    void Run(const std::vector<size_t>& numPredecessors, const std::vector<std::vector<size_t>>& successors, const std::function<void(size_t)>& execute)
+    {
+        std::unique_lock<std::mutex> runLock(m_runMutex);
+        RunLocked(numPredecessors, successors, execute);
+    }
+
+    bool TryRun(const std::vector<size_t>& numPredecessors, const std::vector<std::vector<size_t>>& successors, const std::function<void(size_t)>& execute)
+    {
+        std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+        if (!runLock.owns_lock())
+            return false;
+        RunLocked(numPredecessors, successors, execute);
+        return true;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex m_mutex;
+        std::deque<size_t> m_tasks;
+    };
+
+    void RunLocked(const std::vector<size_t>& numPredecessors, const std::vector<std::vector<size_t>>& successors, const std::function<void(size_t)>& execute)
+    {
+        size_t numTasks = numPredecessors.size();
+        if (successors.size() != numTasks)
+            InvalidArgument("WorkStealingThreadPool: Number of predecessor counts and successor lists differ.");
+        if (numTasks == 0)
+            return;
+
+        if (m_numPendingPredecessors.size() < numTasks)
+            m_numPendingPredecessors = std::vector<std::atomic<size_t>>(numTasks);
+        for (size_t i = 0; i < numTasks; i++)
+            m_numPendingPredecessors[i] = numPredecessors[i];
+
+        m_successors = &successors;
+        m_execute = &execute;
+        m_exception = nullptr;
+        m_failed = false;
+        m_numRemaining = numTasks; // before the first task is queued, so that no worker can see a finished graph
+
+        // distribute the tasks that are ready initially over all workers
+        size_t worker = 0;
+        for (size_t i = 0; i < numTasks; i++)
+        {
+            if (numPredecessors[i] == 0)
+            {
+                Push(worker, i);
+                worker = (worker + 1) % NumWorkers();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_generation++;
+        }
+        m_condition.notify_all();
+
+        ExecuteUntilDone(0);
+
+        m_successors = nullptr;
+        m_execute = nullptr;
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+    }
+
+    void WorkerLoop(size_t worker)
+    {
+        size_t seenGeneration = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [&]() { return m_shutdown || m_generation != seenGeneration; });
+                if (m_shutdown)
+                    return;
+                seenGeneration = m_generation;
+            }
+            ExecuteUntilDone(worker);
+        }
+    }
+
+    void ExecuteUntilDone(size_t worker)
+    {
+        while (m_numRemaining > 0)
+        {
+            size_t task;
+            if (TryPop(worker, task))
+            {
+                Execute(worker, task);
+                continue;
+            }
+
+            // nothing to do right now: sleep until a task is queued or the graph is done
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_numSleeping++;
+            m_condition.wait(lock, [this]() { return m_numQueued > 0 || m_numRemaining == 0; });
+            m_numSleeping--;
+        }
+    }
+
+    void Execute(size_t worker, size_t task)
+    {
+        m_numRunning++;
+        if (!m_failed)
+        {
+            try
+            {
+                (*m_execute)(task);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_failed)
+                    m_exception = std::current_exception();
+                m_failed = true;
+            }
+        }
+        m_numRunning--;
+
+        for (auto successor : (*m_successors)[task])
+        {
+            if (--m_numPendingPredecessors[successor] == 0)
+                Push(worker, successor);
+        }
+
+        // this must be the last access to the graph (Run() returns once the count drops to zero)
+        if (--m_numRemaining == 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_condition.notify_all();
+        }
+    }
+
+    void Push(size_t worker, size_t task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queues[worker]->m_mutex);
+            m_queues[worker]->m_tasks.push_back(task);
+        }
+        m_numQueued++;
+
+        // wake up the sleeping workers; taking the lock ensures the wakeup is not lost between their check and their wait
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_numSleeping > 0)
+            m_condition.notify_all();
+    }
+
+    bool TryPop(size_t worker, size_t& task)
+    {
+        // own queue first (most recently readied task), then steal the oldest task from another queue
+        for (size_t i = 0; i < NumWorkers(); i++)
+        {
+            size_t victim = (worker + i) % NumWorkers();
+            auto& queue = *m_queues[victim];
+            std::lock_guard<std::mutex> lock(queue.m_mutex);
+            if (queue.m_tasks.empty())
+                continue;
+            if (victim == worker)
+            {
+                task = queue.m_tasks.back();
+                queue.m_tasks.pop_back();
+            }
+            else
+            {
+                task = queue.m_tasks.front();
+                queue.m_tasks.pop_front();
+            }
+            m_numQueued--;
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues; // [worker]
+    std::vector<std::thread> m_threads;                 // workers 1..N-1
+
+    std::mutex m_runMutex; // serializes Run() calls
+
+    // sleeping and waking up of workers
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_shutdown;
+    size_t m_generation; // incremented for each graph
+    size_t m_numSleeping;
+
+    // state of the graph being executed
+    std::vector<std::atomic<size_t>> m_numPendingPredecessors; // [task] predecessors not yet completed
+    std::atomic<size_t> m_numRemaining;                        // tasks not yet completed
+    std::atomic<size_t> m_numQueued;                           // tasks that are ready but not started
+    std::atomic<size_t> m_numRunning;                          // tasks being executed
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_exception;
+    const std::vector<std::vector<size_t>>* m_successors;
+    const std::function<void(size_t)>* m_execute;
+};
+
+}}}
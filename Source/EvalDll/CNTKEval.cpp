@@ -43,6 +43,7 @@ void CNTKEvalBase<ElemType>::Init(const std::string& config)
 
     Globals::SetShareNodeValueMatrices(m_config(L"shareNodeValueMatrices", true));
     Globals::SetHyperCompressMemory(m_config(L"hyperCompressMemory", false));
+    Globals::SetNodeExecutionThreads(m_config(L"nodeExecutionThreads", (size_t)0));
 }
 
 
@@ -61,6 +62,23 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     {
         LogicError("Unable to construct network from description");
     }
+
+    // This network is only used for inference, so convolution epilogues (bias, batch normalization, ReLU) can be fused.
+    // This is opt-in: Nodes that are fused away are no longer available to GetNodeDimensions() and Evaluate(), and clients
+    // may ask for any node of the network, not just for those listed in outputNodeNames.
+    if (config(L"fuseConvolutionBiasActivation", false))
+    {
+        if (!this->m_net->template FuseConvolutionBiasActivation<ElemType>().empty())
+            this->m_net->CompileNetwork();
+    }
+
+    // Optionally compute dense products and convolutions in int8 on CPU. Activation ranges are calibrated on the first
+    // int8CalibrationCount evaluations (so these should be representative samples), or taken from each call if 0.
+    if (config(L"int8Inference", false))
+    {
+        size_t calibrationCount = config(L"int8CalibrationCount", (size_t)0);
+        this->m_net->template EnableInt8Inference<ElemType>(calibrationCount);
+    }
 }
 
 
@@ -273,6 +291,19 @@ void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstrin
             RuntimeError("Sparse outputs are not supported by this API.");
     }
 
+    // recurrences whose state is carried across chunks, in a fixed order that defines the layout of the state blobs
+    m_recurrentStates.clear();
+    std::set<ComputationNodeBasePtr> visited;
+    for (const auto& output : m_outputNodes)
+    {
+        for (const auto& node : this->m_net->GetEvalOrder(output))
+        {
+            auto pastValue = dynamic_pointer_cast<PastValueNode<ElemType>>(node);
+            if (pastValue && visited.insert(node).second)
+                m_recurrentStates.push_back(pastValue);
+        }
+    }
+
     m_started = true;
 }
 
@@ -308,17 +339,8 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
 
 template<typename ElemType>
 template<template<typename> class ValueContainer>
-void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+void CNTKEvalExtended<ElemType>::SetInputMatrices(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, bool resetRNN)
 {
-    if (!m_started)
-        RuntimeError("ForwardPass() called before StartForwardEvaluation()");
-
-    if (inputs.size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
-        RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs.size());
-
-    if (outputs.size() != m_outputNodes.size())
-        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
-
     size_t i = 0;
     for (auto& inputNode : m_inputNodes)
     {
@@ -374,6 +396,22 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
 
         ++i;
     }
+}
+
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+{
+    if (!m_started)
+        RuntimeError("ForwardPass() called before StartForwardEvaluation()");
+
+    if (inputs.size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
+        RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs.size());
+
+    if (outputs.size() != m_outputNodes.size())
+        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
+
+    SetInputMatrices(inputs, resetRNN);
 
     ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
     this->m_net->ForwardProp(m_outputNodes);
@@ -434,6 +472,225 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassStreams(const std::vector<Values<ElemType>>& inputs, std::vector<std::vector<ElemType>>& states, std::vector<Values<ElemType>>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassStreams() called before StartForwardEvaluation()");
+
+    size_t numStreams = inputs.size();
+    if (states.size() != numStreams || outputs.size() != numStreams)
+        RuntimeError("Expected inputs, states and outputs for the same number of streams, but got %d, %d and %d.", (int)numStreams, (int)states.size(), (int)outputs.size());
+    if (numStreams == 0)
+        return;
+    if (m_inputNodes.empty())
+        RuntimeError("ForwardPassStreams() requires at least one input.");
+
+    auto pMBLayout = m_inputNodes[0]->GetMBLayout();
+    for (const auto& inputNode : m_inputNodes)
+    {
+        if (inputNode->GetMBLayout() != pMBLayout)
+            RuntimeError("ForwardPassStreams() requires all inputs to have the same dynamic axis, but %ls differs.", inputNode->GetName().c_str());
+    }
+
+    // determine the chunk length of each stream
+    std::vector<size_t> lengths(numStreams);
+    size_t numTimeSteps = 0;
+    for (size_t n = 0; n < numStreams; n++)
+    {
+        if (inputs[n].size() != m_inputNodes.size())
+            RuntimeError("Stream %d: Expected %d inputs, but got %d.", (int)n, (int)m_inputNodes.size(), (int)inputs[n].size());
+        if (outputs[n].size() != m_outputNodes.size())
+            RuntimeError("Stream %d: Expected %d outputs, but got %d.", (int)n, (int)m_outputNodes.size(), (int)outputs[n].size());
+
+        for (size_t i = 0; i < m_inputNodes.size(); i++)
+        {
+            const auto& buffer = inputs[n][i];
+            auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(m_inputNodes[i]->ValuePtr());
+            size_t numRows = m_inputNodes[i]->GetSampleLayout().GetNumElements();
+            size_t numCols;
+            if (matrix->GetMatrixType() == MatrixType::SPARSE)
+            {
+                if (buffer.m_colIndices.size() < 2 || buffer.m_colIndices[0] != 0 || buffer.m_colIndices.back() != buffer.m_indices.size())
+                    RuntimeError("Stream %d, input %ls: Invalid sparse column indices.", (int)n, m_inputNodes[i]->GetName().c_str());
+                numCols = buffer.m_colIndices.size() - 1;
+            }
+            else
+            {
+                if (buffer.m_buffer.size() == 0 || buffer.m_buffer.size() % numRows != 0)
+                    RuntimeError("Stream %d, input %ls: Expected input data to be a non-zero multiple of %" PRIu64 ", but it is %" PRIu64 ".",
+                                 (int)n, m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
+                numCols = buffer.m_buffer.size() / numRows;
+            }
+            if (i == 0)
+                lengths[n] = numCols;
+            else if (lengths[n] != numCols)
+                RuntimeError("Stream %d: All inputs must have the same number of samples.", (int)n);
+        }
+        numTimeSteps = std::max(numTimeSteps, lengths[n]);
+    }
+
+    // each stream becomes one parallel sequence; it continues from its state if it has one
+    pMBLayout->Init(numStreams, numTimeSteps);
+    for (size_t n = 0; n < numStreams; n++)
+    {
+        pMBLayout->AddSequence(n, n, states[n].empty() ? 0 : -1, lengths[n]);
+        pMBLayout->AddGap(n, lengths[n], numTimeSteps);
+    }
+
+    // interleave the streams' samples into the input matrices; column t * numStreams + n holds sample t of stream n
+    for (size_t i = 0; i < m_inputNodes.size(); i++)
+    {
+        auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(m_inputNodes[i]->ValuePtr());
+        size_t numRows = m_inputNodes[i]->GetSampleLayout().GetNumElements();
+        size_t numCols = numTimeSteps * numStreams;
+        if (matrix->GetMatrixType() == MatrixType::SPARSE)
+        {
+            std::vector<CPUSPARSE_INDEX_TYPE> colIndices(1, 0), rowIndices;
+            std::vector<ElemType> values;
+            for (size_t t = 0; t < numTimeSteps; t++)
+            {
+                for (size_t n = 0; n < numStreams; n++)
+                {
+                    if (t < lengths[n])
+                    {
+                        const auto& buffer = inputs[n][i];
+                        for (auto k = buffer.m_colIndices[t]; k < buffer.m_colIndices[t + 1]; k++)
+                        {
+                            rowIndices.push_back(buffer.m_indices[k]);
+                            values.push_back(buffer.m_buffer[k]);
+                        }
+                    }
+                    colIndices.push_back((CPUSPARSE_INDEX_TYPE)rowIndices.size());
+                }
+            }
+            matrix->SetMatrixFromCSCFormat(colIndices.data(), rowIndices.data(), values.data(), values.size(), numRows, numCols);
+        }
+        else
+        {
+            std::vector<ElemType> data(numRows * numCols, 0);
+            for (size_t n = 0; n < numStreams; n++)
+            {
+                const auto& buffer = inputs[n][i];
+                for (size_t t = 0; t < lengths[n]; t++)
+                    std::copy(buffer.m_buffer.begin() + t * numRows, buffer.m_buffer.begin() + (t + 1) * numRows, data.begin() + (t * numStreams + n) * numRows);
+            }
+            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), data.data(), matrixFlagNormal);
+        }
+    }
+
+    // scatter the states into the recurrences; a state blob is the concatenation of all their states
+    // (their dimensions are taken from the sample layout, since the values are empty before the first call)
+    auto StateDimension = [](const ComputationNodeBasePtr& node) { return node->GetSampleLayout().GetNumElements(); };
+    size_t stateSize = 0;
+    for (const auto& node : m_recurrentStates)
+        stateSize += StateDimension(node);
+    for (size_t n = 0; n < numStreams; n++)
+    {
+        if (!states[n].empty() && states[n].size() != stateSize)
+            RuntimeError("Stream %d: Expected a state of %d elements, but got %d.", (int)n, (int)stateSize, (int)states[n].size());
+    }
+    size_t offset = 0;
+    for (const auto& node : m_recurrentStates)
+    {
+        size_t dim = StateDimension(node);
+        std::vector<ElemType> data(dim * numStreams, 0);
+        for (size_t n = 0; n < numStreams; n++)
+        {
+            if (!states[n].empty())
+                std::copy(states[n].begin() + offset, states[n].begin() + offset + dim, data.begin() + n * dim);
+        }
+        node->ImportSequenceStates(Matrix<ElemType>(dim, numStreams, data.data(), node->Value().GetDeviceId()));
+        offset += dim;
+    }
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+    this->m_net->ForwardProp(m_outputNodes);
+
+    // gather each stream's outputs
+    for (size_t i = 0; i < m_outputNodes.size(); i++)
+    {
+        auto node = m_outputNodes[i];
+        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        std::vector<ElemType> data(outputMatrix->GetNumElements());
+        ElemType* pData = data.data();
+        size_t size = data.size();
+        outputMatrix->CopyToArray(pData, size);
+
+        size_t dim = outputMatrix->GetNumRows();
+        bool hasTimeAxis = node->GetMBLayout() == pMBLayout;
+        if (!hasTimeAxis && node->HasMBLayout())
+            RuntimeError("Output %ls: ForwardPassStreams() requires the outputs to have the dynamic axis of the inputs.", node->GetName().c_str());
+
+        for (size_t n = 0; n < numStreams; n++)
+        {
+            auto& vec = outputs[n][i].m_buffer;
+            size_t numElements = hasTimeAxis ? dim * lengths[n] : data.size();
+            if (vec.capacity() < numElements)
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            vec.resize(numElements);
+            if (!hasTimeAxis)
+                std::copy(data.begin(), data.end(), vec.begin());
+            else
+            {
+                for (size_t t = 0; t < lengths[n]; t++)
+                    std::copy(data.begin() + (t * numStreams + n) * dim, data.begin() + (t * numStreams + n + 1) * dim, vec.begin() + t * dim);
+            }
+        }
+    }
+
+    // gather the new states
+    for (size_t n = 0; n < numStreams; n++)
+        states[n].resize(stateSize);
+    offset = 0;
+    Matrix<ElemType> nodeStates(CPUDEVICE);
+    for (const auto& node : m_recurrentStates)
+    {
+        size_t dim = StateDimension(node);
+        node->ExportSequenceStates(nodeStates);
+        std::vector<ElemType> data(dim * numStreams);
+        ElemType* pData = data.data();
+        size_t size = data.size();
+        nodeStates.CopyToArray(pData, size);
+        for (size_t n = 0; n < numStreams; n++)
+            std::copy(data.begin() + n * dim, data.begin() + (n + 1) * dim, states[n].begin() + offset);
+        offset += dim;
+    }
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::StartBeamSearch(const std::wstring& tokenInputName, const std::wstring& scoreOutputName, size_t startSymbol, size_t endSymbol,
+                                                 size_t beamWidth, size_t maxLength, double lengthNormalization)
+{
+    m_scopedNetworkOperationMode = make_shared<ScopedNetworkOperationMode>(this->m_net, NetworkOperationMode::inferring);
+    m_decoder = make_shared<BeamSearchDecoder<ElemType>>(this->m_net, tokenInputName, scoreOutputName, startSymbol, endSymbol, beamWidth, maxLength, lengthNormalization);
+    m_outputNodes = this->m_net->OutputNodesByName({ scoreOutputName });
+    m_inputNodes = m_decoder->SourceInputNodes();
+    m_inputMatrices = DataReaderHelpers::RetrieveInputMatrices(m_inputNodes);
+    m_started = false; // the network is set up for decoding, not for ForwardPass()
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::BeamSearch(const Values<ElemType>& inputs, size_t numHypotheses, std::vector<std::vector<size_t>>& hypotheses, std::vector<double>& scores)
+{
+    if (!m_decoder)
+        RuntimeError("BeamSearch() called before StartBeamSearch()");
+
+    if (inputs.size() != m_inputNodes.size())
+        RuntimeError("Expected %d inputs, but got %d.", (int)m_inputNodes.size(), (int)inputs.size());
+
+    SetInputMatrices(inputs, /*resetRNN=*/true);
+
+    auto decoded = m_decoder->Decode(numHypotheses);
+    hypotheses.clear();
+    scores.clear();
+    for (auto& hyp : decoded)
+    {
+        hypotheses.push_back(std::move(hyp.tokens));
+        scores.push_back(hyp.score);
+    }
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
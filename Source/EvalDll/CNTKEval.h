@@ -19,6 +19,7 @@
 #include "EvalWriter.h"
 
 #include "ComputationNetwork.h"
+#include "BeamSearchDecoder.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -107,6 +108,13 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPassStreams(const std::vector<Values<ElemType>>& inputs, std::vector<std::vector<ElemType>>& states, std::vector<Values<ElemType>>& outputs) override;
+
+    virtual void StartBeamSearch(const std::wstring& tokenInputName, const std::wstring& scoreOutputName, size_t startSymbol, size_t endSymbol,
+                                 size_t beamWidth, size_t maxLength, double lengthNormalization) override;
+
+    virtual void BeamSearch(const Values<ElemType>& inputs, size_t numHypotheses, std::vector<std::vector<size_t>>& hypotheses, std::vector<double>& scores) override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -126,6 +134,11 @@ private:
     std::vector<ComputationNodeBasePtr> m_inputNodes;
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
+    std::shared_ptr<BeamSearchDecoder<ElemType>> m_decoder;
+    std::vector<std::shared_ptr<PastValueNode<ElemType>>> m_recurrentStates; // recurrences whose state ForwardPassStreams() carries per stream
+
+    template<template<typename> class ValueContainer>
+    void SetInputMatrices(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, bool resetRNN);
 
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
@@ -0,0 +1,146 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full licence information.
+//
+#pragma once
+#include "BlockMultiplierPlatform.h"
+#include <smmintrin.h>
+#ifdef SUPPORT_AVX2
+#include <immintrin.h>
+#endif
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Handles int8 dot products for the int8 quantized multiplier (see Int8QuantizedMultiplier).
+// The rows of A are signed 8-bit vectors and b is an unsigned 8-bit vector, both padded to a multiple of Alignment
+// (A with zeros). Unsigned bytes of b are multiplied with signed bytes of A and adjacent products are added into 16 bit
+// (pmaddubsw), then pairs of those into 32 bit (pmaddwd with ones). pmaddubsw saturates, so the caller must keep
+// |a| <= MaxA: then 2 * 255 * MaxA fits into 16 bit and results are exact.
+// The caller typically stores signed values as b + 128 and subtracts 128 * sum(a) from the result.
+// Uses AVX2 (256-bit data path) if SUPPORT_AVX2 is defined, SSE4.1 otherwise.
+class BlockHandlerInt8
+{
+public:
+    // Padding of the quantized vectors, in elements.
+    static const int Alignment = 32;
+
+    // Largest absolute value of A for which the 16-bit sums of pmaddubsw do not saturate.
+    static const int MaxA = 63;
+
+    // Computes the dot products of four rows of A (a0..a3) with b, k is a multiple of Alignment.
+    FORCEINLINE static void DotProduct4(const int8_t* a0, const int8_t* a1, const int8_t* a2, const int8_t* a3,
+                                        const uint8_t* b, int k, int32_t* result)
+    {
+#ifdef SUPPORT_AVX2
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256();
+        __m256i acc3 = _mm256_setzero_si256();
+        for (int l = 0; l < k; l += 32)
+        {
+            __m256i b8 = _mm256_loadu_si256((const __m256i*)(b + l));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_maddubs_epi16(b8, _mm256_loadu_si256((const __m256i*)(a0 + l))), ones));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_maddubs_epi16(b8, _mm256_loadu_si256((const __m256i*)(a1 + l))), ones));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_maddubs_epi16(b8, _mm256_loadu_si256((const __m256i*)(a2 + l))), ones));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_maddubs_epi16(b8, _mm256_loadu_si256((const __m256i*)(a3 + l))), ones));
+        }
+        __m128i sum = HorizontalSum4(Fold(acc0), Fold(acc1), Fold(acc2), Fold(acc3));
+#else
+        __m128i acc0 = _mm_setzero_si128();
+        __m128i acc1 = _mm_setzero_si128();
+        __m128i acc2 = _mm_setzero_si128();
+        __m128i acc3 = _mm_setzero_si128();
+        for (int l = 0; l < k; l += 16)
+        {
+            __m128i b8 = _mm_loadu_si128((const __m128i*)(b + l));
+            acc0 = _mm_add_epi32(acc0, MultiplyAdd16(a0 + l, b8));
+            acc1 = _mm_add_epi32(acc1, MultiplyAdd16(a1 + l, b8));
+            acc2 = _mm_add_epi32(acc2, MultiplyAdd16(a2 + l, b8));
+            acc3 = _mm_add_epi32(acc3, MultiplyAdd16(a3 + l, b8));
+        }
+        __m128i sum = HorizontalSum4(acc0, acc1, acc2, acc3);
+#endif
+        _mm_storeu_si128((__m128i*)result, sum);
+    }
+
+    // Computes the dot product of a single row of A with b, k is a multiple of Alignment.
+    FORCEINLINE static int32_t DotProduct(const int8_t* a, const uint8_t* b, int k)
+    {
+        __m128i acc = _mm_setzero_si128();
+        for (int l = 0; l < k; l += 16)
+            acc = _mm_add_epi32(acc, MultiplyAdd16(a + l, _mm_loadu_si128((const __m128i*)(b + l))));
+        acc = _mm_hadd_epi32(acc, acc);
+        acc = _mm_hadd_epi32(acc, acc);
+        return _mm_cvtsi128_si32(acc);
+    }
+
+    // Returns the largest absolute value of x[0..n-1].
+    static float AbsMax(const float* x, size_t n)
+    {
+        const __m128i absMask = _mm_set1_epi32(0x7fffffff);
+        __m128 max4 = _mm_setzero_ps();
+        size_t n4 = n - n % 4;
+        for (size_t i = 0; i < n4; i += 4)
+            max4 = _mm_max_ps(max4, _mm_and_ps(_mm_loadu_ps(x + i), _mm_castsi128_ps(absMask)));
+        max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+        max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+        float absMax = _mm_cvtss_f32(max4);
+        for (size_t i = n4; i < n; i++)
+            absMax = std::max(absMax, fabsf(x[i]));
+        return absMax;
+    }
+
+    // Quantizes x[0..k-1] to unsigned bytes round(x * factor) + offset, where round(x * factor) is clipped to
+    // [-rangeMax, rangeMax] and rounds halfway cases to even.
+    static void QuantizeUnsigned(const float* x, int k, float factor, int rangeMax, int offset, uint8_t* q)
+    {
+        const __m128 factor4 = _mm_set1_ps(factor);
+        const __m128 max4 = _mm_set1_ps((float)rangeMax);
+        const __m128 min4 = _mm_set1_ps((float)-rangeMax);
+        const __m128i offset4 = _mm_set1_epi32(offset);
+        int k16 = k - k % 16;
+        for (int l = 0; l < k16; l += 16)
+        {
+            __m128i q0 = QuantizeUnsigned4(x + l, factor4, min4, max4, offset4);
+            __m128i q1 = QuantizeUnsigned4(x + l + 4, factor4, min4, max4, offset4);
+            __m128i q2 = QuantizeUnsigned4(x + l + 8, factor4, min4, max4, offset4);
+            __m128i q3 = QuantizeUnsigned4(x + l + 12, factor4, min4, max4, offset4);
+            _mm_storeu_si128((__m128i*)(q + l), _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3)));
+        }
+        for (int l = k16; l < k; l++)
+            q[l] = (uint8_t)(_mm_cvtss_si32(_mm_min_ss(_mm_max_ss(_mm_set_ss(x[l] * factor), min4), max4)) + offset);
+    }
+
+private:
+    FORCEINLINE static __m128i QuantizeUnsigned4(const float* x, __m128 factor4, __m128 min4, __m128 max4, __m128i offset4)
+    {
+        __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(x), factor4), min4), max4);
+        return _mm_add_epi32(_mm_cvtps_epi32(scaled), offset4);
+    }
+
+    // 16 products of a[0..15] with the unsigned bytes b8, summed into four 32-bit lanes
+    FORCEINLINE static __m128i MultiplyAdd16(const int8_t* a, __m128i b8)
+    {
+        __m128i pairs = _mm_maddubs_epi16(b8, _mm_loadu_si128((const __m128i*)a));
+        return _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    }
+
+    // returns { sum(x0), sum(x1), sum(x2), sum(x3) }
+    FORCEINLINE static __m128i HorizontalSum4(__m128i x0, __m128i x1, __m128i x2, __m128i x3)
+    {
+        return _mm_hadd_epi32(_mm_hadd_epi32(x0, x1), _mm_hadd_epi32(x2, x3));
+    }
+
+#ifdef SUPPORT_AVX2
+    FORCEINLINE static __m128i Fold(__m256i x)
+    {
+        return _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    }
+#endif
+};
+
+}}}
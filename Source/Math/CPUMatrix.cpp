@@ -121,6 +121,7 @@ template <class ElemType>
 static ElemType* NewArray(size_t n)
 {
     ElemType* p = new ElemType[n]();
+    CountThreadMatrixAllocation(n * sizeof(ElemType));
 #if 0 // _DEBUG
         ElemType nan = Matrix<ElemType>::MakeNan(__LINE__);
         for (size_t i = 0; i < n; i++)
@@ -16,6 +16,7 @@
 #include "CPUSparseMatrix.h"
 #include <random>
 #include <chrono>
+#include <algorithm>
 #include <iostream>
 #ifdef LEAKDETECT
 #include <vld.h>
@@ -687,6 +688,7 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
             auto* pArray      = new ElemType[numNZElemToReserve]();
             auto* unCompIndex = new CPUSPARSE_INDEX_TYPE[numNZElemToReserve]();
             auto* compIndex   = new CPUSPARSE_INDEX_TYPE[newCompIndexSize]();
+            CountThreadMatrixAllocation(numNZElemToReserve * (sizeof(ElemType) + sizeof(CPUSPARSE_INDEX_TYPE)) + newCompIndexSize * sizeof(CPUSPARSE_INDEX_TYPE));
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Allocate: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -716,6 +718,7 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
         {
             ElemType* blockVal = new ElemType[numNZElemToReserve];
             size_t* blockIds = new size_t[newCompIndexSize];
+            CountThreadMatrixAllocation(numNZElemToReserve * sizeof(ElemType) + newCompIndexSize * sizeof(size_t));
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Resize: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -985,7 +988,15 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
         if (rhs.GetFormat() != matrixFormatSparseCSC)
             NOT_IMPLEMENTED;
 
-        // allocate enough memory
+        // c = lhs * rhs^T has a non-zero column for each distinct row index of rhs, e.g. for each word id in the gradient
+        // of an embedding. It is stored in block-column format with one block per such column, accumulating into the blocks
+        // c already has. Block ids are kept sorted: ColumnSlice() relies on that, and updates then walk the parameter
+        // matrix in memory order.
+        const CPUSPARSE_INDEX_TYPE* rhsRows = rhs.MajorIndexLocation();                   // row indices of the current view
+        const ElemType* rhsValues = rhs.Buffer() + *rhs.SecondaryIndexLocation();         // values of the current view
+        const CPUSPARSE_INDEX_TYPE* rhsColStarts = rhs.SecondaryIndexLocation();
+        const size_t rhsNzOffset = rhsColStarts[0];
+
         c.SetFormat(matrixFormatSparseBlockCol);
         size_t blockSizePrev = c.GetBlockSize();
 
@@ -994,46 +1005,58 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             c.RequireSizeAndAllocate(m, n, 0, true); // allocate for blockIds
         }
 
-        map<size_t, size_t> col2BlockId;
-        for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
-        {
-            col2BlockId[c.GetBlockIds()[blockId]] = blockId;
-        }
+        // sorted unique ids, merged with the ones of c
+        vector<size_t> ids(rhsRows, rhsRows + rhs.NzCount());
+        ids.insert(ids.end(), c.GetBlockIds(), c.GetBlockIds() + blockSizePrev);
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        size_t blockSizeCurr = ids.size();
 
-        size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
+        // Dense remap table from column of c to its block. Only entries of ids are ever read, so the table is not
+        // initialized, and only the pages that are touched get committed even for a large vocabulary.
+        unique_ptr<size_t[]> col2BlockId(new size_t[n]);
+        for (size_t blockId = 0; blockId < blockSizeCurr; blockId++)
+            col2BlockId[ids[blockId]] = blockId;
+
+        if (blockSizePrev == 0)
         {
-            size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
-            if (col2BlockId.find(resultCol) == col2BlockId.end())
-            {
-                col2BlockId[resultCol] = blockSizeCurr;
-                c.GetBlockIds()[blockSizeCurr] = resultCol;
-                blockSizeCurr ++;
-            }
+            c.RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, false);
+            memset(c.Buffer(), 0, sizeof(ElemType) * m * blockSizeCurr);
         }
-
-        if (blockSizeCurr > blockSizePrev)
+        else if (blockSizeCurr != blockSizePrev || !equal(ids.begin(), ids.end(), c.GetBlockIds()))
         {
-            c.RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, true);
-            c.SetBlockSize(blockSizeCurr);
-            memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
+            // move the existing blocks to their new positions
+            vector<size_t> prevIds(c.GetBlockIds(), c.GetBlockIds() + blockSizePrev);
+            vector<ElemType> prevValues(c.Buffer(), c.Buffer() + m * blockSizePrev);
+            c.RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, false);
+            memset(c.Buffer(), 0, sizeof(ElemType) * m * blockSizeCurr);
+            for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
+                memcpy(c.Buffer() + col2BlockId[prevIds[blockId]] * m, prevValues.data() + blockId * m, sizeof(ElemType) * m);
         }
-
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
+        copy(ids.begin(), ids.end(), c.GetBlockIds());
+        c.SetBlockSize(blockSizeCurr);
+
+        // Accumulate alpha * rhs(id, j) * lhs(:, j) into the block of each id. Each task owns a range of rows of c, so that
+        // tasks never write to the same location and the whole product is a single parallel loop.
+        const ElemType* lhsData = lhs.Data();
+        ElemType* results = c.Buffer();
+        const size_t rhsNumCols = rhs.GetNumCols();
+        const size_t rowsPerTask = max((size_t)16, (m + omp_get_max_threads() - 1) / omp_get_max_threads());
+        const long numTasks = (long)((m + rowsPerTask - 1) / rowsPerTask);
+#pragma omp parallel for
+        for (long task = 0; task < numTasks; task++)
         {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
-
-            for (size_t p = start; p < end; p++)
+            size_t rowStart = task * rowsPerTask;
+            size_t rowEnd = min(m, rowStart + rowsPerTask);
+            for (size_t rhsCol = 0; rhsCol < rhsNumCols; rhsCol++)
             {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
-
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
+                const ElemType* lhsCol = lhsData + rhsCol * m;
+                for (size_t p = rhsColStarts[rhsCol] - rhsNzOffset; p < rhsColStarts[rhsCol + 1] - rhsNzOffset; p++)
                 {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
+                    ElemType* block = results + col2BlockId[rhsRows[p]] * m;
+                    ElemType scale = alpha * rhsValues[p];
+                    for (size_t row = rowStart; row < rowEnd; row++)
+                        block[row] += scale * lhsCol[row];
                 }
             }
         }
@@ -1079,21 +1102,29 @@ void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSpars
             }
         }
     }
-    else if (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
+    else if (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol)
+    {
+        // block ids are unique, so blocks can be added in parallel, each to a contiguous column of rhs
+        const size_t len = lhs.GetNumRows();
+#pragma omp parallel for
+        for (long j = 0; j < (long)lhs.GetBlockSize(); j++)
+        {
+            size_t col = lhs.GetBlockIds()[j] - lhs.GetBlockIdShift();
+            const ElemType* values = lhs.Buffer() + j * len;
+            ElemType* dense = &rhs(0, col);
+            for (size_t row = 0; row < len; row++)
+                dense[row] += alpha * values[row];
+        }
+    }
+    else if (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
     {
+        size_t len = lhs.GetNumCols();
         for (size_t j = 0; j < lhs.GetBlockSize(); j++)
         {
-            size_t i = lhs.GetBlockIds()[j] - lhs.GetBlockIdShift();
-            size_t len = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? lhs.GetNumRows() : lhs.GetNumCols();
+            size_t row = lhs.GetBlockIds()[j] - lhs.GetBlockIdShift();
             size_t start = j * len;
             for (size_t p = start; p < start + len; p++)
-            {
-                ElemType val = lhs.Buffer()[p];
-
-                size_t r = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? (p - start) : i;
-                size_t c = (lhs.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? i : (p - start);
-                rhs(r, c) += alpha * val;
-            }
+                rhs(row, p - start) += alpha * lhs.Buffer()[p];
         }
     }
     else
@@ -1202,20 +1233,34 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
     }
     // BUGBUG: dimension/ownbuffer check?
 
-    if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
+    if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol)
+    {
+        // one block per distinct column (see MultiplyAndAdd()), so blocks are updated in parallel on contiguous columns
+        const size_t len = GetNumRows();
+#pragma omp parallel for
+        for (long j = 0; j < (long)GetBlockSize(); j++)
+        {
+            size_t col = GetBlockIds()[j] - GetBlockIdShift();
+            ElemType* values = Buffer() + j * len;
+            ElemType* smoothed = &c(0, col);
+            for (size_t row = 0; row < len; row++)
+            {
+                smoothed[row] = unitGainFactor * values[row] + momentum * smoothed[row];
+                values[row] = smoothed[row];
+            }
+        }
+    }
+    else if (GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
     {
-        const auto isSparseBlockCol = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
+        size_t len = GetNumCols();
         for (size_t j = 0; j < GetBlockSize(); j++)
         {
-            size_t i = GetBlockIds()[j] - GetBlockIdShift();
-            size_t len = (isSparseBlockCol) ? GetNumRows() : GetNumCols();
+            size_t row = GetBlockIds()[j] - GetBlockIdShift();
             size_t start = j * len;
             for (size_t p = start; p < start + len; p++)
             {
-                ElemType val = Buffer()[p];
-                size_t row = (isSparseBlockCol) ? (p - start) : i;
-                size_t col = (isSparseBlockCol) ? i : (p - start);
-                c(row, col) = unitGainFactor * val + momentum * c(row, col);
+                size_t col = p - start;
+                c(row, col) = unitGainFactor * Buffer()[p] + momentum * c(row, col);
                 Buffer()[p] = c(row, col);
             }
         }
@@ -1265,19 +1310,37 @@ ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool n
             }
         }
     }
-    else if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
+    else if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol)
     {
-        size_t len = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? GetNumRows() : GetNumCols();
+        // blocks are distinct columns, see NormalGrad()
+        const size_t len = GetNumRows();
+#pragma omp parallel for reduction(+ : aveMultiplier)
+        for (long j = 0; j < (long)GetBlockSize(); j++)
+        {
+            size_t col = GetBlockIds()[j] - GetBlockIdShift();
+            ElemType* values = Buffer() + j * len;
+            ElemType* smoothed = &c(0, col);
+            for (size_t row = 0; row < len; row++)
+            {
+                smoothed[row] += values[row] * values[row];
+                ElemType a = sqrt(floor + smoothed[row]);
+                values[row] /= a;
+
+                if (needAveMultiplier)
+                    aveMultiplier += 1 / a;
+            }
+        }
+    }
+    else if (GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
+    {
+        size_t len = GetNumCols();
         size_t p = 0;
         for (long j = 0; j < GetBlockSize(); j++)
         {
-            size_t colOrRow = GetBlockIds()[j] - GetBlockIdShift();
-            for (long i = 0; i < len; i++, p++)
+            size_t row = GetBlockIds()[j] - GetBlockIdShift();
+            for (long col = 0; col < len; col++, p++)
             {
                 ElemType val = Buffer()[p];
-
-                size_t row = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? i : colOrRow;
-                size_t col = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol) ? colOrRow : i;
                 c(row, col) += val * val;
                 ElemType a = sqrt(floor + c(row, col));
                 Buffer()[p] /= a;
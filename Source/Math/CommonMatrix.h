@@ -48,6 +48,11 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 MATH_API void SetMathLibTraceLevel(int traceLevel);
 MATH_API int GetMathLibTraceLevel();
 
+// Bytes of matrix storage (CPU and GPU) allocated by the calling thread since it started. The difference between
+// two calls attributes allocations to the code in between, e.g. to a node in the per-node profiler.
+MATH_API void CountThreadMatrixAllocation(size_t bytes);
+MATH_API unsigned long long GetThreadMatrixBytesAllocated();
+
 class MATH_API TracingGPUMemoryAllocator
 {
 private:
@@ -108,6 +113,8 @@ enum ElementWiseOperator
     opElementwiseProductWithLogSumDerivative,
     opCopyIfEqual,
     opElementwiseProductWithExpOfDiff, /* a * exp(b - c) */
+    // binary (appended here so that the values of the above stay unchanged)
+    opLinearRectifierOfSum, /* fused bias + ReLU: max(a + b, 0) */
     // Note: not all that's implemented in CNTK ComputationNodes has an opcode yet.
 };
 
@@ -162,6 +169,7 @@ enum ElementWiseOperator
     Macro(ElementwiseProductWithReciprocalDerivative);                \
     Macro(ElementwiseProductWithSqrtDerivative);                      \
     Macro(SqrOfDifference);                                           \
+    Macro(LinearRectifierOfSum);                                      \
     //Macro(Index);
 
 #define ForAllTernaryOps(Macro)                         \
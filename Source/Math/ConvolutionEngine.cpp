@@ -6,6 +6,8 @@
 #include "stdafx.h"
 #include "ConvolutionEngine.h"
 #include "CuDnnFactories.h"
+#include "Int8QuantizedOperations.h"
+#include <emmintrin.h>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -29,6 +31,56 @@ void ConvolutionEngine<ElemType>::Forward(const Mat& in, const Mat& kernel, Mat&
     ForwardCore(in, kernel, out, workspace);
 }
 
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ForwardBiasActivation(const Mat& in, const Mat& kernel, const Mat& bias, bool applyReLU, Mat& out, Mat& workspace)
+{
+    const auto& g = *m_geometry;
+    assert(g.InputShape().GetNumElements() == in.GetNumRows());
+    assert(g.OutputShape().GetNumElements() == out.GetNumRows());
+    assert(in.GetNumCols() == out.GetNumCols());
+    assert(g.KernelShape().GetNumElements() * g.KernelCount() == kernel.GetNumElements());
+
+    if (m_imageLayout != ImageLayoutKind::CHW)
+        InvalidArgument("ForwardBiasActivation: only CHW layout is supported.");
+    const auto& outShape = g.OutputShape();
+    if (!bias.IsEmpty() && (bias.GetNumElements() != g.KernelCount() || outShape[outShape.GetRank() - 1] != g.KernelCount()))
+        InvalidArgument("ForwardBiasActivation: bias must have one element per output map and maps must be the outermost output dimension.");
+
+    EnsureCompatible();
+    EnsureConvolutionInitialized();
+    ForwardBiasActivationCore(in, kernel, bias, applyReLU, out, workspace);
+}
+
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ForwardBiasActivationCore(const Mat& in, const Mat& kernel, const Mat& bias, bool applyReLU, Mat& out, Mat& workspace)
+{
+    ForwardCore(in, kernel, out, workspace);
+    if (bias.IsEmpty() && !applyReLU)
+        return;
+
+    // Output is [mapSize x mapCount x batchSize] (CHW), bias is broadcast along the map dimension.
+    // Either way this is one sweep over the output rather than one per operation.
+    if (bias.IsEmpty())
+    {
+        SmallVector<size_t> opDims{ out.GetNumElements() };
+        SmallVector<ptrdiff_t> strides{ 1 };
+        out.TensorOp(0, out, 1, ElementWiseOperator::opLinearRectifier, ElementWiseOperator::opSum,
+                     std::array<size_t, 2>{ 0, 0 }, opDims, std::array<SmallVector<ptrdiff_t>, 2>{ strides, strides },
+                     SmallVector<size_t>(), std::array<SmallVector<ptrdiff_t>, 2>());
+    }
+    else
+    {
+        size_t mapCount = m_geometry->KernelCount();
+        size_t mapSize = out.GetNumRows() / mapCount;
+        SmallVector<size_t> opDims{ mapSize, mapCount, out.GetNumCols() };
+        SmallVector<ptrdiff_t> outStrides{ 1, (ptrdiff_t)mapSize, (ptrdiff_t)out.GetNumRows() };
+        SmallVector<ptrdiff_t> biasStrides{ 0, 1, 0 };
+        out.TensorOp(0, out, bias, 1, applyReLU ? ElementWiseOperator::opLinearRectifierOfSum : ElementWiseOperator::opSum, ElementWiseOperator::opSum,
+                     std::array<size_t, 3>{ 0, 0, 0 }, opDims, std::array<SmallVector<ptrdiff_t>, 3>{ outStrides, biasStrides, outStrides },
+                     SmallVector<size_t>(), std::array<SmallVector<ptrdiff_t>, 3>());
+    }
+}
+
 template <class ElemType>
 void ConvolutionEngine<ElemType>::BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace)
 {
@@ -127,6 +179,211 @@ void ConvolutionEngine<ElemType>::MaxUnpooling(const Mat& out, const Mat& poolIn
     MaxUnpoolingCore(out, poolIn, in);
 }
 
+//------------------------------------------------------------------
+// Specialized CPU forward pooling over the two leftmost (spatial) dimensions.
+// Each [W x H] plane (one per channel and sample) is pooled independently, one output row
+// at a time: output columns whose windows lie fully inside the input are computed four at
+// a time with SSE (float, strides 1 and 2) or by loops with unrolled windows for common
+// shapes; border columns are processed one by one with clipped windows. Results match the generic lookup-table
+// pooling: max pooling ignores padding, average pooling divides by the number of actual
+// (non-padded) elements.
+//------------------------------------------------------------------
+template <class ElemType>
+class CpuPooling2D
+{
+public:
+    static bool IsSupported(const ConvolveGeometry& geometry, PoolKind poolKind)
+    {
+        if (poolKind != PoolKind::Max && poolKind != PoolKind::Average)
+            return false;
+        const auto& inT = geometry.InputShape();
+        const auto& kernT = geometry.KernelShape();
+        const auto& outT = geometry.OutputShape();
+        if (inT.GetRank() < 2 || kernT.GetRank() != inT.GetRank())
+            return false;
+        // All dimensions except the first two must be passed through unchanged (e.g. channels).
+        for (size_t i = 2; i < inT.GetRank(); i++)
+        {
+            if (kernT[i] != 1 || geometry.GetStride(i) != 1 || outT[i] != inT[i] || geometry.GetMapCount(i) != 1)
+                return false;
+        }
+        return geometry.GetMapCount(0) == 1 && geometry.GetMapCount(1) == 1;
+    }
+
+    static void Forward(const ConvolveGeometry& geometry, PoolKind poolKind, const ElemType* in, size_t batchSize, ElemType* out)
+    {
+        Params p;
+        const auto& inT = geometry.InputShape();
+        const auto& outT = geometry.OutputShape();
+        p.inW = (int)inT[0];
+        p.inH = (int)inT[1];
+        p.outW = (int)outT[0];
+        p.outH = (int)outT[1];
+        p.kW = (int)geometry.KernelShape()[0];
+        p.kH = (int)geometry.KernelShape()[1];
+        p.sW = (int)geometry.GetStride(0);
+        p.sH = (int)geometry.GetStride(1);
+        p.padW = geometry.GetLowerPad(0);
+        p.padH = geometry.GetLowerPad(1);
+        size_t planes = inT.GetNumElements() / (inT[0] * inT[1]) * batchSize;
+
+        PlaneFunc poolPlane = poolKind == PoolKind::Max ? GetPlaneFunc<true>(p) : GetPlaneFunc<false>(p);
+#pragma omp parallel for
+        for (long i = 0; i < (long)planes; i++)
+            poolPlane(p, in + i * p.inW * p.inH, out + i * p.outW * p.outH);
+    }
+
+private:
+    struct Params
+    {
+        int inW, inH;
+        int outW, outH;
+        int kW, kH;   // Window size.
+        int sW, sH;   // Stride.
+        int padW, padH; // Lower padding: window of output (0, 0) starts at input (-padW, -padH).
+    };
+
+    typedef void (*PlaneFunc)(const Params& p, const ElemType* src, ElemType* dst);
+
+    // Common window/stride shapes get their own instantiations so that the loops over the window are fully unrolled.
+    template <bool isMax>
+    static PlaneFunc GetPlaneFunc(const Params& p)
+    {
+        if (p.kW == 2 && p.kH == 2 && p.sW == 2 && p.sH == 2)
+            return &PoolPlane<isMax, 2, 2, 2, 2>;
+        if (p.kW == 3 && p.kH == 3 && p.sW == 2 && p.sH == 2)
+            return &PoolPlane<isMax, 3, 3, 2, 2>;
+        if (p.kW == 3 && p.kH == 3 && p.sW == 1 && p.sH == 1)
+            return &PoolPlane<isMax, 3, 3, 1, 1>;
+        return &PoolPlane<isMax, 0, 0, 0, 0>;
+    }
+
+    // Computes interior output columns four at a time with SSE for float and strides 1 and 2.
+    // Returns the first column in [oxLo, oxHi) that still has to be computed.
+    template <bool isMax>
+    static int PoolRowSimd(const float* srcRow, int inW, int padW, int rows, int kW, int sW, int oxLo, int oxHi, float scale, float* dstRow)
+    {
+        int ox = oxLo;
+        if (sW == 1)
+        {
+            for (; ox + 4 <= oxHi; ox += 4)
+            {
+                __m128 res = isMax ? _mm_set1_ps(-std::numeric_limits<float>::infinity()) : _mm_setzero_ps();
+                for (int y = 0; y < rows; y++)
+                {
+                    const float* win = srcRow + y * inW + ox;
+                    for (int kx = 0; kx < kW; kx++)
+                        res = isMax ? _mm_max_ps(_mm_loadu_ps(win + kx), res) : _mm_add_ps(res, _mm_loadu_ps(win + kx));
+                }
+                _mm_storeu_ps(dstRow + ox, isMax ? res : _mm_mul_ps(res, _mm_set1_ps(scale)));
+            }
+        }
+        else if (sW == 2)
+        {
+            // Loads 8 consecutive elements and keeps the even ones, so the last load must not go past the row end.
+            for (; ox + 4 <= oxHi && 2 * ox - padW + kW + 6 < inW; ox += 4)
+            {
+                __m128 res = isMax ? _mm_set1_ps(-std::numeric_limits<float>::infinity()) : _mm_setzero_ps();
+                for (int y = 0; y < rows; y++)
+                {
+                    const float* win = srcRow + y * inW + 2 * ox;
+                    for (int kx = 0; kx < kW; kx++)
+                    {
+                        __m128 v = _mm_shuffle_ps(_mm_loadu_ps(win + kx), _mm_loadu_ps(win + kx + 4), _MM_SHUFFLE(2, 0, 2, 0));
+                        res = isMax ? _mm_max_ps(v, res) : _mm_add_ps(res, v);
+                    }
+                }
+                _mm_storeu_ps(dstRow + ox, isMax ? res : _mm_mul_ps(res, _mm_set1_ps(scale)));
+            }
+        }
+        return ox;
+    }
+
+    template <bool isMax, class T>
+    static int PoolRowSimd(const T* /*srcRow*/, int /*inW*/, int /*padW*/, int /*rows*/, int /*kW*/, int /*sW*/, int oxLo, int /*oxHi*/, T /*scale*/, T* /*dstRow*/)
+    {
+        return oxLo;
+    }
+
+    // Pools one [inW x inH] plane into [outW x outH]. KW, KH, SW and SH are compile-time window size and
+    // stride, 0 means that the value from Params is used.
+    template <bool isMax, int KW, int KH, int SW, int SH>
+    static void PoolPlane(const Params& p, const ElemType* src, ElemType* dst)
+    {
+        const int kW = KW != 0 ? KW : p.kW;
+        const int kH = KH != 0 ? KH : p.kH;
+        const int sW = SW != 0 ? SW : p.sW;
+        const int sH = SH != 0 ? SH : p.sH;
+        const ElemType init = isMax ? -std::numeric_limits<ElemType>::infinity() : 0;
+
+        // Output columns [oxLo, oxHi) have windows that do not cross the left or right border.
+        int oxLo = p.padW <= 0 ? 0 : min((p.padW + sW - 1) / sW, p.outW);
+        int oxHi = p.inW + p.padW - kW < 0 ? 0 : min((p.inW + p.padW - kW) / sW + 1, p.outW);
+        if (oxHi < oxLo)
+            oxHi = oxLo;
+
+        for (int oy = 0; oy < p.outH; oy++)
+        {
+            int y0 = oy * sH - p.padH;
+            int yBeg = max(y0, 0);
+            int yEnd = min(y0 + kH, p.inH);
+            ElemType* dstRow = dst + oy * p.outW;
+
+            auto poolBorder = [&](int ox)
+            {
+                int x0 = ox * sW - p.padW;
+                int xBeg = max(x0, 0);
+                int xEnd = min(x0 + kW, p.inW);
+                ElemType res = init;
+                for (int y = yBeg; y < yEnd; y++)
+                {
+                    for (int x = xBeg; x < xEnd; x++)
+                        res = isMax ? std::max(res, src[y * p.inW + x]) : res + src[y * p.inW + x];
+                }
+                dstRow[ox] = isMax ? res : res / ((yEnd - yBeg) * (xEnd - xBeg));
+            };
+            for (int ox = 0; ox < oxLo; ox++)
+                poolBorder(ox);
+            for (int ox = oxHi; ox < p.outW; ox++)
+                poolBorder(ox);
+
+            const ElemType* srcRow = src + yBeg * p.inW - p.padW;
+            const int rows = yEnd - yBeg;
+            const ElemType scale = (ElemType)1 / (rows * kW);
+            const int oxSimd = PoolRowSimd<isMax>(srcRow, p.inW, p.padW, rows, kW, sW, oxLo, oxHi, scale, dstRow);
+            if (rows == kH)
+            {
+                // Window fully inside vertically: the window loops have compile-time bounds for specialized shapes.
+                for (int ox = oxSimd; ox < oxHi; ox++)
+                {
+                    const ElemType* win = srcRow + ox * sW;
+                    ElemType res = init;
+                    for (int y = 0; y < kH; y++)
+                    {
+                        for (int kx = 0; kx < kW; kx++)
+                            res = isMax ? std::max(res, win[y * p.inW + kx]) : res + win[y * p.inW + kx];
+                    }
+                    dstRow[ox] = isMax ? res : res * scale;
+                }
+            }
+            else
+            {
+                for (int ox = oxSimd; ox < oxHi; ox++)
+                {
+                    const ElemType* win = srcRow + ox * sW;
+                    ElemType res = init;
+                    for (int y = 0; y < rows; y++)
+                    {
+                        for (int kx = 0; kx < kW; kx++)
+                            res = isMax ? std::max(res, win[y * p.inW + kx]) : res + win[y * p.inW + kx];
+                    }
+                    dstRow[ox] = isMax ? res : res * scale;
+                }
+            }
+        }
+    }
+};
+
 //------------------------------------------------------------------
 // Reference convolution engine implementation.
 // This engine supports arbitrary convolution geometry but does not provide efficient implementation.
@@ -203,6 +460,12 @@ protected:
 
     void ForwardPoolingCore(const Mat& in, Mat& out) override
     {
+        if (!IsGpu(m_deviceId) && in.GetMatrixType() == MatrixType::DENSE && CpuPooling2D<ElemType>::IsSupported(*m_geometry, m_poolKind))
+        {
+            CpuPooling2D<ElemType>::Forward(*m_geometry, m_poolKind, in.Data(), in.GetNumCols(), out.Data());
+            return;
+        }
+
         if (m_poolKind == PoolKind::Max)
         {
             in.MaxPoolingForward(m_mpRowCol, *m_mpRowIndices, *m_indices, out);
@@ -565,6 +828,12 @@ public:
     {
     }
 
+    bool SetInt8Multiplier(std::shared_ptr<Int8QuantizedMultiplier<ElemType>> multiplier) override
+    {
+        m_int8Multiplier = multiplier;
+        return true;
+    }
+
 protected:
     using typename Base::IntMatPtr;
 
@@ -648,7 +917,7 @@ protected:
             {
                 auto outSlice = out.ColumnSlice(start, 1);
                 outSlice.Reshape(mapOutSize, mapCount);
-                Mat::Multiply(unrolledInput, true, kern, false, outSlice);
+                MultiplyUnrolled(unrolledInput, kern, outSlice);
             }
             else
             {
@@ -659,13 +928,30 @@ protected:
                     outTempSlice = outTempSlice.ColumnSlice(0, curBatchSize * mapCount);
                     outTempSlice.Reshape(mapOutSize * curBatchSize, mapCount);
                 }
-                Mat::Multiply(unrolledInput, true, kern, false, outTempSlice);
+                MultiplyUnrolled(unrolledInput, kern, outTempSlice);
                 outTempSlice.Reshape(curBatchSize, mapOutSize * mapCount);
                 auto outSlice = out.ColumnSlice(start, curBatchSize);
                 outSlice.AssignTransposeOf(outTempSlice);
             }
         }
     }
+
+    // Step 2 of the forward method: [XYC x NW'H']^T * [XYC x K] -> [NW'H' x K].
+    // The int8 product is computed as [XYC x K]^T * [XYC x NW'H'] so that weights are quantized per output map (row),
+    // and is written transposed, directly in the [NW'H' x K] layout.
+    void MultiplyUnrolled(const Mat& unrolledInput, const Mat& kern, Mat& out)
+    {
+        if (m_int8Multiplier == nullptr)
+        {
+            Mat::Multiply(unrolledInput, true, kern, false, out);
+            return;
+        }
+        int k = (int)kern.GetNumRows();
+        int mapCount = (int)kern.GetNumCols();
+        int unrolledCount = (int)unrolledInput.GetNumCols();
+        m_int8Multiplier->Multiply(mapCount, unrolledCount, k, kern.Data(), /*isATransposed=*/true, unrolledInput.Data(),
+                                   out.Data(), /*rowStride=*/unrolledCount, /*colStride=*/1);
+    }
     
     // The backward data method works by representing this operation as a "reverse" convolution
     // in case kernel's last dimension is equal to input dimension. Gradients matrix (grad) becomes
@@ -846,6 +1132,285 @@ public:
         return deviceId < 0 &&
                find(begin(geometry->Sharing()), end(geometry->Sharing()), false) == end(geometry->Sharing());
     }
+
+protected:
+    // if set, forward product is done in int8
+    std::shared_ptr<Int8QuantizedMultiplier<ElemType>> m_int8Multiplier;
+};
+
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// Implements forward convolution for 2D 3x3 kernels with stride 1 and full sharing on CPU
+// using minimal filtering algorithms F(2x2,3x3) and F(4x4,3x3)
+// (Fast Algorithms for Convolutional Neural Networks; Lavin, Gray).
+// The input is split into overlapping tiles of alpha x alpha (alpha = m + 2) elements which are
+// transformed, as are the kernels. For each of the alpha^2 tile positions, the products of
+// transformed kernels and inputs summed over input channels form an independent GEMM:
+//    [K x C] * [C x NT] -> [K x NT], where NT is the number of tiles in the minibatch.
+// The products are then transformed back into m x m output tiles. Unlike unrolling, this
+// does not inflate the input 9x and needs 2.25x (m = 2) or 4x (m = 4) fewer multiplications.
+// Backward passes and pooling are done by the GEMM/reference engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class WinogradConvolutionEngine : public GemmConvolutionEngine<ElemType>
+{
+public:
+    using Base = GemmConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)
+    {
+    }
+
+    // Winograd transforms do not preserve int8 ranges; use the GEMM engine for int8 inference.
+    bool SetInt8Multiplier(std::shared_ptr<Int8QuantizedMultiplier<ElemType>> /*multiplier*/) override
+    {
+        return false;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_maxTempMemSizeInSamples;
+
+    // Transform matrices (row-major) for F(m x m, 3 x 3).
+    struct Transform
+    {
+        size_t m;
+        const double* BT; // [alpha x alpha] input transform
+        const double* G;  // [alpha x 3] kernel transform
+        const double* AT; // [m x alpha] output transform
+    };
+
+    static const Transform& GetTransform(size_t outW, size_t outH)
+    {
+        static const double BT2[] =
+        {
+            1,  0, -1,  0,
+            0,  1,  1,  0,
+            0, -1,  1,  0,
+            0,  1,  0, -1
+        };
+        static const double G2[] =
+        {
+            1,    0,   0,
+            0.5,  0.5, 0.5,
+            0.5, -0.5, 0.5,
+            0,    0,   1
+        };
+        static const double AT2[] =
+        {
+            1, 1,  1,  0,
+            0, 1, -1, -1
+        };
+        static const double BT4[] =
+        {
+            4,  0, -5,  0, 1, 0,
+            0, -4, -4,  1, 1, 0,
+            0,  4, -4, -1, 1, 0,
+            0, -2, -1,  2, 1, 0,
+            0,  2, -1, -2, 1, 0,
+            0,  4,  0, -5, 0, 1
+        };
+        static const double G4[] =
+        {
+            1.0 / 4,        0,         0,
+           -1.0 / 6,  -1.0 / 6,  -1.0 / 6,
+           -1.0 / 6,   1.0 / 6,  -1.0 / 6,
+            1.0 / 24,  1.0 / 12,  1.0 / 6,
+            1.0 / 24, -1.0 / 12,  1.0 / 6,
+            0,         0,         1
+        };
+        static const double AT4[] =
+        {
+            1, 1,  1, 1,  1, 0,
+            0, 1, -1, 2, -2, 0,
+            0, 1,  1, 4,  4, 0,
+            0, 1, -1, 8, -8, 1
+        };
+        static const Transform f2x2 = { 2, BT2, G2, AT2 };
+        static const Transform f4x4 = { 4, BT4, G4, AT4 };
+        // Larger tiles save more multiplications but waste more on partially covered border tiles.
+        return outW >= 8 && outH >= 8 ? f4x4 : f2x2;
+    }
+
+    // res[r1 x r1] = T * d * T^T, where T is [r1 x r0] and d is [r0 x r0], all row-major.
+    static void Transform2D(const double* T, size_t r1, size_t r0, const ElemType* d, ElemType* res)
+    {
+        // Accumulate in double: F(4x4,3x3) coefficients are large enough to noticeably hurt float precision.
+        double tmp[6 * 6];
+        for (size_t i = 0; i < r1; i++)
+        {
+            for (size_t j = 0; j < r0; j++)
+            {
+                double sum = 0;
+                for (size_t k = 0; k < r0; k++)
+                    sum += T[i * r0 + k] * d[k * r0 + j];
+                tmp[i * r0 + j] = sum;
+            }
+        }
+        for (size_t i = 0; i < r1; i++)
+        {
+            for (size_t j = 0; j < r1; j++)
+            {
+                double sum = 0;
+                for (size_t k = 0; k < r0; k++)
+                    sum += tmp[i * r0 + k] * T[j * r0 + k];
+                res[i * r1 + j] = (ElemType)sum;
+            }
+        }
+    }
+
+    // Notation follows the GEMM engine: input is [WHC x N], output is [W'H'K x N] and kernel weights
+    // are stored as [XYC x K] (X = Y = 3, Z = C).
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        if (in.GetMatrixType() != MatrixType::DENSE)
+        {
+            Base::ForwardCore(in, kernel, out, workspace);
+            return;
+        }
+
+        const auto& inT = m_geometry->InputShape();
+        const auto& outT = m_geometry->OutputShape();
+        const size_t inW = inT[0];
+        const size_t inH = inT[1];
+        const size_t mapInCount = inT[2];
+        const size_t outW = outT[0];
+        const size_t outH = outT[1];
+        const size_t mapOutCount = outT[2];
+        // Input coordinates of the first kernel tap for output (0, 0); negative if padded.
+        const int offW = -m_geometry->GetLowerPad(0);
+        const int offH = -m_geometry->GetLowerPad(1);
+
+        const auto& tr = GetTransform(outW, outH);
+        const size_t m = tr.m;
+        const size_t alpha = m + 2;
+        const size_t alpha2 = alpha * alpha;
+        const size_t tilesW = (outW + m - 1) / m;
+        const size_t tilesH = (outH + m - 1) / m;
+        const size_t tileCount = tilesW * tilesH;
+
+        size_t batchSize = in.GetNumCols();
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t maxTiles = tileCount * subBatchSize;
+
+        // Reserve space for:
+        // 1. Transformed kernels: alpha^2 matrices of [K x C].
+        // 2. Transformed input tiles: alpha^2 matrices of [C x NT].
+        // 3. Products: alpha^2 matrices of [K x NT].
+        size_t kernSize = mapOutCount * mapInCount;
+        size_t maxInSize = mapInCount * maxTiles;
+        size_t maxOutSize = mapOutCount * maxTiles;
+        workspace.Resize(1, alpha2 * (kernSize + maxInSize + maxOutSize));
+
+        // 1. Transform kernels: U = G * g * G^T.
+        ElemType* pu = workspace.Data();
+        const ElemType* pkern = kernel.Data();
+#pragma omp parallel for
+        for (long kc = 0; kc < (long)kernSize; kc++)
+        {
+            size_t k = kc / mapInCount;
+            size_t c = kc % mapInCount;
+            ElemType u[6 * 6];
+            Transform2D(tr.G, alpha, 3, pkern + k * 9 * mapInCount + c * 9, u);
+            for (size_t xi = 0; xi < alpha2; xi++)
+                pu[xi * kernSize + c * mapOutCount + k] = u[xi];
+        }
+
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t curTiles = tileCount * curBatchSize;
+            size_t inSize = mapInCount * curTiles;
+            size_t outSize = mapOutCount * curTiles;
+            ElemType* pv = pu + alpha2 * kernSize;
+            ElemType* pm = pv + alpha2 * inSize;
+
+            // 2. Transform input tiles: V = B^T * d * B.
+            auto inputSlice = in.ColumnSlice(start, curBatchSize);
+            const ElemType* pin = inputSlice.Data();
+#pragma omp parallel for
+            for (long pc = 0; pc < (long)inSize; pc++)
+            {
+                size_t p = pc / mapInCount;
+                size_t c = pc % mapInCount;
+                size_t n = p / tileCount;
+                size_t ty = (p % tileCount) / tilesW;
+                size_t tx = (p % tileCount) % tilesW;
+                const ElemType* pmap = pin + n * inT.GetNumElements() + c * inW * inH;
+                int x0 = (int)(tx * m) + offW;
+                int y0 = (int)(ty * m) + offH;
+                ElemType d[6 * 6];
+                for (size_t y = 0; y < alpha; y++)
+                {
+                    int iy = y0 + (int)y;
+                    for (size_t x = 0; x < alpha; x++)
+                    {
+                        int ix = x0 + (int)x;
+                        bool inside = 0 <= ix && ix < (int)inW && 0 <= iy && iy < (int)inH;
+                        d[y * alpha + x] = inside ? pmap[iy * inW + ix] : 0;
+                    }
+                }
+                ElemType v[6 * 6];
+                Transform2D(tr.BT, alpha, alpha, d, v);
+                for (size_t xi = 0; xi < alpha2; xi++)
+                    pv[xi * inSize + p * mapInCount + c] = v[xi];
+            }
+
+            // 3. Multiply: M = U * V for each tile position.
+            for (size_t xi = 0; xi < alpha2; xi++)
+            {
+                auto u = workspace.ColumnSlice(xi * kernSize, kernSize);
+                u.Reshape(mapOutCount, mapInCount);
+                auto v = workspace.ColumnSlice(alpha2 * kernSize + xi * inSize, inSize);
+                v.Reshape(mapInCount, curTiles);
+                auto prod = workspace.ColumnSlice(alpha2 * (kernSize + inSize) + xi * outSize, outSize);
+                prod.Reshape(mapOutCount, curTiles);
+                Mat::Multiply(u, false, v, false, prod);
+            }
+
+            // 4. Transform products back into output tiles: Y = A^T * M * A.
+            auto outSlice = out.ColumnSlice(start, curBatchSize);
+            ElemType* pout = outSlice.Data();
+#pragma omp parallel for
+            for (long pk = 0; pk < (long)outSize; pk++)
+            {
+                size_t p = pk / mapOutCount;
+                size_t k = pk % mapOutCount;
+                size_t n = p / tileCount;
+                size_t ty = (p % tileCount) / tilesW;
+                size_t tx = (p % tileCount) % tilesW;
+                ElemType mt[6 * 6];
+                for (size_t xi = 0; xi < alpha2; xi++)
+                    mt[xi] = pm[xi * outSize + p * mapOutCount + k];
+                ElemType y[4 * 4];
+                Transform2D(tr.AT, m, alpha, mt, y);
+                ElemType* pmap = pout + n * outT.GetNumElements() + k * outW * outH;
+                for (size_t j = 0; j < m && ty * m + j < outH; j++)
+                {
+                    for (size_t i = 0; i < m && tx * m + i < outW; i++)
+                        pmap[(ty * m + j) * outW + tx * m + i] = y[j * m + i];
+                }
+            }
+        }
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry)
+    {
+        if (!Base::IsSupported(deviceId, geometry))
+            return false;
+        const auto& inT = geometry->InputShape();
+        const auto& kernT = geometry->KernelShape();
+        const auto& outT = geometry->OutputShape();
+        return inT.GetRank() == 3 &&
+               kernT[0] == 3 && kernT[1] == 3 && kernT[2] == inT[2] &&
+               geometry->GetStride(0) == 1 && geometry->GetStride(1) == 1 &&
+               geometry->GetMapCount(0) == 1 && geometry->GetMapCount(1) == 1 &&
+               outT[2] == geometry->GetMapCount(2);
+    }
 };
 
 template <class ElemType>
@@ -883,6 +1448,14 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
         return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, forceDeterministicAlgorithms);
     }
 
+    if (isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing Winograd convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
     if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
     {
         if (GetMathLibTraceLevel() > 0)
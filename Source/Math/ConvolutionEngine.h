@@ -12,6 +12,9 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+template <class ElemType>
+class Int8QuantizedMultiplier;
+
 //-------------------------------------------------------------
 // Convolution and pooling engine interface.
 //-------------------------------------------------------------
@@ -22,8 +25,9 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Winograd  = 1 << 4, // Winograd minimal filtering on CPU. Works only for 2D 3x3 convos with stride 1 and full sharing, uses GEMM engine for backprop.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    All       = Reference | CuDnn | Legacy | Gemm | Winograd
 };
 
 enum class PoolKind
@@ -47,6 +51,10 @@ public:
 
     void Forward(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace);
 
+    // Forward convolution followed by adding a per-map bias (one value per output map, may be empty) and an optional ReLU.
+    // Used for inference-time fusion of convolution/bias/activation chains. Requires CHW layout.
+    void ForwardBiasActivation(const Mat& in, const Mat& kernel, const Mat& bias, bool applyReLU, Mat& out, Mat& workspace);
+
     void BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace);
 
     void BackwardKernel(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace);
@@ -74,6 +82,10 @@ public:
 
     virtual bool ImplementsGradientOverwriteOptimization() const { return false; }
 
+    // Makes forward convolution use an int8 quantized product (inference only), or the regular one again if multiplier is null.
+    // Returns false if the engine does not support it; currently only the GEMM engine on CPU does.
+    virtual bool SetInt8Multiplier(std::shared_ptr<Int8QuantizedMultiplier<ElemType>> /*multiplier*/) { return false; }
+
 protected:
     ConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
         : m_geometry(geometry), m_deviceId(deviceId), m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples), m_poolKind(poolKind)
@@ -87,6 +99,9 @@ protected:
 
     virtual void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) = 0;
 
+    // Default runs ForwardCore and then applies bias and activation in a single elementwise pass over the output.
+    virtual void ForwardBiasActivationCore(const Mat& in, const Mat& kernel, const Mat& bias, bool applyReLU, Mat& out, Mat& workspace);
+
     virtual void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) = 0;
 
     virtual void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) = 0;
@@ -222,6 +222,7 @@ AllocatedElemType* TracingGPUMemoryAllocator::AllocateNoTrace(int deviceId, size
 
     PrepareDevice(deviceId);
     CUDA_CALL(cudaMalloc((void**) &deviceBufferPtr, sizeof(AllocatedElemType) * numElements));
+    CountThreadMatrixAllocation(sizeof(AllocatedElemType) * numElements);
 
     return deviceBufferPtr;
 }
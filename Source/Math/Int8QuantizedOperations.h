@@ -0,0 +1,203 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+#include "QuantizedOperations.h"
+#include "BlockHandlerInt8.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Int8 quantized product for inference, C = A * B, where A is typically a weight matrix and B holds activations.
+// - A is quantized symmetrically with one scale per row, i.e. per output unit or output feature map, so that rows
+//   with a small range do not lose their precision to rows with a large one. Values are limited to
+//   +-BlockHandlerInt8::MaxA (7 bit), which keeps the 16-bit intermediate sums of the kernel from saturating.
+// - B is quantized symmetrically to +-127 with a single scale and stored unsigned, offset by 128. The offset is
+//   compensated by subtracting 128 times the sum of the quantized row of A from each dot product.
+//   By default the range of B is taken from the data on each call. With calibrationCount > 0 the first
+//   calibrationCount calls still use their own data range, but also record the largest one seen; from then on this
+//   calibrated range is used as is and larger values are clipped.
+// Quantized rows of A and columns of B are padded to BlockHandlerInt8::Alignment elements (A with zeros), so that the
+// dot products run without tail handling.
+template <class ElemType>
+class Int8QuantizedMultiplier : public QuantizedMultiplier<ElemType>
+{
+    typedef QuantizedMultiplier<ElemType> Base;
+    using Base::m_isAConstant;
+    using Base::m_firstPass;
+
+    static const int RangeMaxA = BlockHandlerInt8::MaxA;
+    static const int RangeMaxB = 127;
+    static const int OffsetB = 128;
+
+    // quantized A, row by row, the scale of each row, and OffsetB times the sum of each quantized row
+    vector<int8_t> m_matA;
+    vector<ElemType> m_scaleA;
+    vector<int32_t> m_offsetA;
+
+    // quantized B offset by OffsetB, column by column, and its scale
+    vector<uint8_t> m_matB;
+    ElemType m_scaleB;
+
+    // activation range calibration, see above
+    size_t m_calibrationCount;
+    size_t m_calibratedCount;
+    ElemType m_rangeB;
+
+public:
+    Int8QuantizedMultiplier(bool isAConstant, size_t calibrationCount = 0)
+        : Base(isAConstant, false), m_scaleB(0), m_calibrationCount(calibrationCount), m_calibratedCount(0), m_rangeB(0)
+    {
+    }
+
+    // A[m,k]*B[k,n] = C[m,n]
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C) override
+    {
+        Multiply(m, n, k, A, /*isATransposed=*/false, B, C, /*rowStride=*/1, /*colStride=*/m);
+    }
+
+    // A[m,k]*B[k,n] = C[m,n] with a general layout of A and C: if isATransposed, A is passed as the column-major
+    // matrix A^T[k,m] (i.e. each row of A is contiguous); element C[i,j] is written to C[i * rowStride + j * colStride].
+    void Multiply(int m, int n, int k, const ElemType* A, bool isATransposed, const ElemType* B, ElemType* C, size_t rowStride, size_t colStride)
+    {
+        int kPadded = PaddedSize(k);
+        if (!m_isAConstant || m_firstPass || m_scaleA.size() != (size_t)m || m_matA.size() != (size_t)m * kPadded)
+            QuantizeA(m, k, kPadded, A, isATransposed);
+        QuantizeB(n, k, kPadded, B);
+        m_firstPass = false;
+
+        const int8_t* matA = m_matA.data();
+        const uint8_t* matB = m_matB.data();
+        const ElemType* scaleA = m_scaleA.data();
+        const int32_t* offsetA = m_offsetA.data();
+        const ElemType scaleB = m_scaleB;
+        // Each thread takes blocks of four rows of A, which stay in the L1 cache while they are multiplied with all
+        // columns of B. Going over the columns in the outer loop instead would stream all of A from memory per column,
+        // and would not parallelize the single-column products of evaluation.
+        long numBlocks = (m + 3) / 4;
+#pragma omp parallel for
+        for (long block = 0; block < numBlocks; block++)
+        {
+            int i = (int)block * 4;
+            const int8_t* a = matA + (size_t)i * kPadded;
+            int32_t dots[4];
+            for (int j = 0; j < n; j++)
+            {
+                const uint8_t* b = matB + (size_t)j * kPadded;
+                ElemType* c = C + j * colStride;
+                if (i + 4 <= m)
+                {
+                    BlockHandlerInt8::DotProduct4(a, a + kPadded, a + 2 * kPadded, a + 3 * kPadded, b, kPadded, dots);
+                    for (int r = 0; r < 4; r++)
+                        c[(i + r) * rowStride] = (ElemType)(dots[r] - offsetA[i + r]) * scaleA[i + r] * scaleB;
+                }
+                else
+                {
+                    for (int r = i; r < m; r++)
+                        c[r * rowStride] = (ElemType)(BlockHandlerInt8::DotProduct(matA + (size_t)r * kPadded, b, kPadded) - offsetA[r]) * scaleA[r] * scaleB;
+                }
+            }
+        }
+    }
+
+    bool IsCalibrated() const { return m_calibrationCount > 0 && m_calibratedCount >= m_calibrationCount; }
+
+    // range of B used once calibration is complete
+    ElemType CalibratedRange() const { return m_rangeB; }
+
+private:
+    static int PaddedSize(int k)
+    {
+        return (k + BlockHandlerInt8::Alignment - 1) / BlockHandlerInt8::Alignment * BlockHandlerInt8::Alignment;
+    }
+
+    static int QuantizeValue(ElemType value, ElemType factor, int rangeMax)
+    {
+        ElemType q = round(value * factor);
+        return (int)std::max((ElemType)-rangeMax, std::min((ElemType)rangeMax, q));
+    }
+
+    // B is quantized on every call, so for float this is done with SIMD
+    static float AbsMax(const float* x, size_t n)
+    {
+        return BlockHandlerInt8::AbsMax(x, n);
+    }
+    static double AbsMax(const double* x, size_t n)
+    {
+        double absMax = 0;
+        for (size_t i = 0; i < n; i++)
+            absMax = std::max(absMax, fabs(x[i]));
+        return absMax;
+    }
+
+    static void QuantizeColumnB(const float* b, int k, float factor, uint8_t* col)
+    {
+        BlockHandlerInt8::QuantizeUnsigned(b, k, factor, RangeMaxB, OffsetB, col);
+    }
+    static void QuantizeColumnB(const double* b, int k, double factor, uint8_t* col)
+    {
+        for (int l = 0; l < k; l++)
+            col[l] = (uint8_t)(QuantizeValue(b[l], factor, RangeMaxB) + OffsetB);
+    }
+
+    void QuantizeA(int m, int k, int kPadded, const ElemType* A, bool isATransposed)
+    {
+        m_matA.assign((size_t)m * kPadded, 0);
+        m_scaleA.resize(m);
+        m_offsetA.resize(m);
+        size_t stride = isATransposed ? 1 : m;
+#pragma omp parallel for
+        for (long i = 0; i < m; i++)
+        {
+            const ElemType* a = isATransposed ? A + (size_t)i * k : A + i;
+            ElemType absMax = 0;
+            for (int l = 0; l < k; l++)
+                absMax = std::max(absMax, (ElemType)fabs(a[l * stride]));
+
+            m_scaleA[i] = absMax / RangeMaxA;
+            ElemType factor = absMax > 0 ? RangeMaxA / absMax : 0;
+            int8_t* row = m_matA.data() + (size_t)i * kPadded;
+            int32_t sum = 0;
+            for (int l = 0; l < k; l++)
+            {
+                row[l] = (int8_t)QuantizeValue(a[l * stride], factor, RangeMaxA);
+                sum += row[l];
+            }
+            m_offsetA[i] = sum * OffsetB;
+        }
+    }
+
+    void QuantizeB(int n, int k, int kPadded, const ElemType* B)
+    {
+        ElemType range;
+        if (IsCalibrated())
+            range = m_rangeB;
+        else
+        {
+            range = AbsMax(B, (size_t)n * k);
+            if (m_calibrationCount > 0)
+            {
+                m_rangeB = std::max(m_rangeB, range);
+                m_calibratedCount++;
+            }
+        }
+
+        m_scaleB = range / RangeMaxB;
+        ElemType factor = range > 0 ? RangeMaxB / range : 0;
+        m_matB.resize((size_t)n * kPadded);
+#pragma omp parallel for
+        for (long j = 0; j < n; j++)
+        {
+            const ElemType* b = B + (size_t)j * k;
+            uint8_t* col = m_matB.data() + (size_t)j * kPadded;
+            QuantizeColumnB(b, k, factor, col);
+            for (int l = k; l < kPadded; l++)
+                col[l] = OffsetB;
+        }
+    }
+};
+
+}}}
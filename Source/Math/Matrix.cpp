@@ -156,6 +156,18 @@ int GetMathLibTraceLevel()
     return m_mathLibTraceLevel.load();
 }
 
+static THREAD_LOCAL unsigned long long s_threadMatrixBytesAllocated = 0;
+
+void CountThreadMatrixAllocation(size_t bytes)
+{
+    s_threadMatrixBytesAllocated += bytes;
+}
+
+unsigned long long GetThreadMatrixBytesAllocated()
+{
+    return s_threadMatrixBytesAllocated;
+}
+
 MatrixBase::~MatrixBase() { }
 
 #pragma region BufferManagement
@@ -21,6 +21,7 @@ class QuantizedMultiplier
     // Placeholders for quantized matrices A and B
     vector<short> m_pMatA, m_pMatB;
 
+protected:
     // Whether matrices A and B are constant (i.e. weights)
     // If the matrix is constant, the size of the underlying container for quatized values will be preserved for
     // the lifespan of the object
@@ -29,6 +30,12 @@ class QuantizedMultiplier
 
     bool m_firstPass;
 
+    // for derived multipliers that do their own quantization
+    QuantizedMultiplier(bool isAConstant, bool isBConstant) :
+        m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
+    {
+    }
+
 public: 
     QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, bool isAConstant, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB, bool isBConstant) :
         m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
@@ -41,8 +48,10 @@ public:
     {
     };
 
+    virtual ~QuantizedMultiplier() {}
+
     // A[m,k]*B[k,n] = C[m,n]
-    void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
     {
         // Quantize
         if (!m_isAConstant || m_firstPass)
@@ -84,6 +93,9 @@ public:
 
     void SetIsAConstant(bool v) { m_isAConstant = v; }
     void SetIsBConstant(bool v) { m_isBConstant = v; }
+
+    // Makes the next call quantize constant matrices again, e.g. after the weights have been modified.
+    void ResetConstants() { m_firstPass = true; }
 };
 
 }}}
\ No newline at end of file
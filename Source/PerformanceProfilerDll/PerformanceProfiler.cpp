@@ -4,7 +4,7 @@
 //
 // Real-time thread-safe profiler that generates a summary report and a detail profile log.
 // The profiler is highly performant and lightweight. Profiling a single event introduces an overhead
-// of approximately 100 ns.
+// of approximately 100 ns. Recording a custom event takes no lock.
 //
 
 #ifndef _CRT_SECURE_NO_WARNINGS
@@ -17,8 +17,14 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -67,8 +73,22 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "", profilerEvtSeparator, false },                            // profilerSepSpace2
 
     { "Prefetch Minibatch", profilerEvtTime, false },               // profilerEvtPrefetchMinibatch
+    { "_Get Sequences", profilerEvtTime, false },                   // profilerEvtReaderGetSequences
+    { "__Load Chunk", profilerEvtTime, false },                     // profilerEvtReaderLoadChunk
+    { "__Transform Sequences", profilerEvtTime, false },            // profilerEvtReaderTransform
+    { "_Pack Minibatch", profilerEvtTime, false },                  // profilerEvtReaderPack
+    { "_Copy To Matrices", profilerEvtTime, false },                // profilerEvtReaderCopyToMatrices
+    { "Minibatch Throughput", profilerEvtThroughput, false },       // profilerEvtReaderThroughput
 };
 
+//
+// Latency histogram of time events: durations below c_histogramSubBuckets ticks have a bucket each,
+// above that each power of two is split into c_histogramSubBuckets buckets.
+//
+static const int c_histogramSubBucketBits = 3;
+static const int c_histogramSubBuckets = 1 << c_histogramSubBucketBits;
+static const int c_histogramBuckets = (64 - c_histogramSubBucketBits + 1) * c_histogramSubBuckets;
+
 
 struct FixedEventRecord
 {
@@ -78,17 +98,40 @@ struct FixedEventRecord
     long long       min;          // time (ns) or throughput (kB/s)
     long long       max;          // time (ns) or throughput (kB/s)
     long long       totalBytes;   // used only for throughput events
+    unsigned int    histogram[c_histogramBuckets]; // used only for time events
 };
 
 //
-// The custom event record is a variable size datastructure in memory:
-// NULL terminated description string, followed by CustomEventRecord struct
+// Custom events (which include the occurrences of fixed time events) are recorded as fixed size
+// binary records. Descriptions are interned: fixed events use their event id, custom descriptions
+// get ids from profilerEvtMax on.
 //
 struct CustomEventRecord
 {
     long long       beginClock;
     long long       endClock;
     unsigned int    threadId;
+    unsigned int    descriptionId;
+};
+
+//
+// Every recording thread owns a ring buffer of custom event records. The owner appends without
+// locking (single producer), and the flusher thread moves the records to the event log on disk
+// (single consumer). If a ring is full, the event is dropped and counted. When a thread exits,
+// its ring is handed on to the next thread that starts recording.
+//
+static const unsigned long long c_ringBufferRecords = 1 << 14; // per thread; must be a power of 2
+static const int c_flushIntervalMs = 100;
+
+struct EventRingBuffer
+{
+    std::atomic<unsigned long long> head;    // next record to write; written by the owner only
+    char                            padding[64 - sizeof(std::atomic<unsigned long long>)]; // keep head and tail in separate cache lines
+    std::atomic<unsigned long long> tail;    // next record to flush; written by the flusher only
+    std::atomic<unsigned long long> dropped; // events dropped because the ring was full
+    CustomEventRecord               records[c_ringBufferRecords];
+
+    EventRingBuffer() : head(0), tail(0), dropped(0) {}
 };
 
 
@@ -97,16 +140,32 @@ struct CustomEventRecord
 //
 struct ProfilerState
 {
-    bool                    enabled;                     // Profiler enabled (active)
+    std::atomic<bool>       enabled;                     // Profiler enabled (active)
     bool                    syncGpu;                     // Sync GPU per each profiling event
     bool                    cudaSyncEnabled;             // Runtime state of CUDA kernel sync
     std::wstring            profilerDir;                 // Directory where reports/logs are saved
     std::wstring            logSuffix;                   // Suffix to append to report/log file names
     FixedEventRecord        fixedEvents[profilerEvtMax]; // Profiling data for each fixed event
-    bool                    customEventBufferFull;       // Is custom event buffer full?
-    unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
-    unsigned long long      customEventOffset;           // Offset to current place in buffer
-    unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
+
+    // custom events
+    unsigned long long      customEventBufferBytes;      // Maximum number of bytes of custom event records to log
+    unsigned long long      customEventBytesLogged;      // Bytes of custom event records logged so far (flusher only)
+    unsigned long long      customEventsOverLimit;       // Events not logged because of customEventBufferBytes (flusher only)
+    std::wstring            eventLogFileName;            // Binary log of the custom event records, converted to the detail file at the end
+    FILE*                   eventLogFile;
+
+    std::mutex                                   ringMutex;   // rings, freeRings
+    std::vector<std::unique_ptr<EventRingBuffer>> rings;
+    std::vector<EventRingBuffer*>                freeRings;  // rings of threads that have exited
+
+    std::mutex                                   descriptionMutex; // descriptions, descriptionIds
+    std::deque<std::string>                      descriptions;     // custom description of id (profilerEvtMax + index); never modified once added
+    std::unordered_map<std::string, unsigned int> descriptionIds;
+
+    std::thread                                  flusher;
+    std::mutex                                   flusherMutex;
+    std::condition_variable                      flusherWakeUp;
+    bool                                         flusherStop;
 };
 
 
@@ -116,14 +175,21 @@ static unique_ptr<ProfilerState> g_profilerState;
 // Mutex controlling access to g_profilerState
 static std::mutex g_mutex;
 
+// Incremented by every ProfilerInit(), to invalidate the per-thread state of a previous instance
+static std::atomic<unsigned int> g_profilerGeneration(0);
+
 // Forward declarations
 unsigned int GetThreadId();
+void ProfilerFlushEvents();
+void ProfilerFlusherThread();
 
 void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo);
 void FormatTimeStr(char* str, size_t strLen, double value);
 void FormatThroughputStr(char* str, size_t strLen, double value);
 void FormatBytesStr(char* str, size_t strLen, long long bytes);
 void ProfilerGenerateDetailFile(const std::wstring& fileName);
+int HistogramBucket(long long ticks);
+double HistogramBucketLowerBound(int bucket);
 
 
 double TicksToSeconds(long long ticks)
@@ -142,7 +208,7 @@ double TicksSqToSecondsSq(double ticksSq)
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
-// customEventBufferBytes: Size of the custom event buffer.
+// customEventBufferBytes: Maximum number of bytes of custom event records to log.
 // logSuffix: Suffix string to append to log file names.
 // syncGpu: Wait for GPU to complete processing for each profiling event with syncGpu flag set.
 //
@@ -158,10 +224,9 @@ void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsig
     g_profilerState->profilerDir = profilerDir;
     g_profilerState->logSuffix = logSuffix;
 
-    g_profilerState->customEventBufferFull = false;
     g_profilerState->customEventBufferBytes = customEventBufferBytes;
-    g_profilerState->customEventOffset = 0ull;
-    g_profilerState->customEventBuffer.reset(new char[customEventBufferBytes]);
+    g_profilerState->customEventBytesLogged = 0ull;
+    g_profilerState->customEventsOverLimit = 0ull;
 
     g_profilerState->syncGpu = syncGpu;
     g_profilerState->enabled = false;
@@ -170,6 +235,17 @@ void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsig
     {
         RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", g_profilerState->profilerDir.c_str());
     }
+
+    g_profilerState->eventLogFileName = g_profilerState->profilerDir + L"/events_" + g_profilerState->logSuffix + L".bin";
+    g_profilerState->eventLogFile = _wfopen(g_profilerState->eventLogFileName.c_str(), L"w+b");
+    if (g_profilerState->eventLogFile == NULL)
+    {
+        RuntimeError("Error: ProfilerInit: Cannot create file <%ls>.\n", g_profilerState->eventLogFileName.c_str());
+    }
+
+    g_profilerGeneration++;
+    g_profilerState->flusherStop = false;
+    g_profilerState->flusher = std::thread(ProfilerFlusherThread);
 }
 
 //
@@ -207,38 +283,108 @@ void ProfilerTimeRecordFixedEvent(const int eventId, const long long beginClock,
     g_profilerState->fixedEvents[eventId].max = std::max(delta, g_profilerState->fixedEvents[eventId].max);
     g_profilerState->fixedEvents[eventId].sum += delta;
     g_profilerState->fixedEvents[eventId].sumsq += (double)delta * (double)delta;
+    g_profilerState->fixedEvents[eventId].histogram[HistogramBucket(delta)]++;
     g_profilerState->fixedEvents[eventId].cnt++;
 }
 
-void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock)
+//
+// Per-thread recording state. Its destructor returns the ring to the profiler when the thread exits.
+// (This needs thread_local rather than THREAD_LOCAL, which does not support destructors on Windows.)
+//
+struct ThreadEventState
 {
-    std::lock_guard<std::mutex> lock(g_mutex);
+    // recently used custom descriptions, by address; the content is compared as well, since the caller may reuse the memory
+    struct DescriptionCacheEntry
+    {
+        const char*     description;
+        const char*     interned;
+        unsigned int    id;
+    };
+    static const size_t c_descriptionCacheSize = 64;
 
-    if (!g_profilerState->enabled)
-        return;
+    unsigned int            generation;
+    EventRingBuffer*        ring;
+    unsigned int            threadId;
+    DescriptionCacheEntry   descriptionCache[c_descriptionCacheSize];
 
-    auto eventDescriptionBytes = strlen(eventDescription) + 1;
-    auto requiredBufferBytes = eventDescriptionBytes + sizeof(CustomEventRecord);
-    if ((g_profilerState->customEventOffset + requiredBufferBytes) > g_profilerState->customEventBufferBytes)
+    ThreadEventState() : generation(0), ring(nullptr), threadId(0) {}
+
+    ~ThreadEventState()
     {
-        if (!g_profilerState->customEventBufferFull)
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (ring && g_profilerState != nullptr && generation == g_profilerGeneration)
         {
-            fprintf(stderr, "Warning: Performance Profiler: Buffer is full, no more events will be recorded.\n");
-            g_profilerState->customEventBufferFull = true;
+            std::lock_guard<std::mutex> ringLock(g_profilerState->ringMutex);
+            g_profilerState->freeRings.push_back(ring);
         }
-        return;
     }
 
-    strcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, eventDescription);
-    g_profilerState->customEventOffset += eventDescriptionBytes;
+    // (re-)initialize for the current profiler instance
+    void Attach()
+    {
+        std::lock_guard<std::mutex> ringLock(g_profilerState->ringMutex);
+        if (!g_profilerState->freeRings.empty())
+        {
+            ring = g_profilerState->freeRings.back();
+            g_profilerState->freeRings.pop_back();
+        }
+        else
+        {
+            g_profilerState->rings.push_back(std::unique_ptr<EventRingBuffer>(new EventRingBuffer()));
+            ring = g_profilerState->rings.back().get();
+        }
+        threadId = GetThreadId();
+        memset(descriptionCache, 0, sizeof(descriptionCache));
+        generation = g_profilerGeneration;
+    }
+};
+
+static thread_local ThreadEventState t_eventState;
 
-    CustomEventRecord eventRecord;
+unsigned int ProfilerInternDescription(ThreadEventState& state, const char* eventDescription)
+{
+    auto& entry = state.descriptionCache[(reinterpret_cast<size_t>(eventDescription) >> 3) % ThreadEventState::c_descriptionCacheSize];
+    if (entry.description == eventDescription && strcmp(entry.interned, eventDescription) == 0)
+        return entry.id;
+
+    std::lock_guard<std::mutex> lock(g_profilerState->descriptionMutex);
+    auto result = g_profilerState->descriptionIds.insert(std::make_pair(std::string(eventDescription), (unsigned int)(profilerEvtMax + g_profilerState->descriptions.size())));
+    if (result.second)
+        g_profilerState->descriptions.push_back(eventDescription);
+    entry.description = eventDescription;
+    entry.interned = g_profilerState->descriptions[result.first->second - profilerEvtMax].c_str();
+    entry.id = result.first->second;
+    return entry.id;
+}
+
+void ProfilerTimeRecordToBuffer(const int eventId, const char* eventDescription, const long long beginClock, const long long endClock)
+{
+    if (!g_profilerState->enabled)
+        return;
+
+    ThreadEventState& state = t_eventState;
+    if (state.generation != g_profilerGeneration || state.ring == nullptr)
+        state.Attach();
+
+    EventRingBuffer& ring = *state.ring;
+    unsigned long long head = ring.head.load(std::memory_order_relaxed);
+    unsigned long long used = head - ring.tail.load(std::memory_order_acquire);
+    if (used >= c_ringBufferRecords)
+    {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    CustomEventRecord& eventRecord = ring.records[head & (c_ringBufferRecords - 1)];
     eventRecord.beginClock = beginClock;
     eventRecord.endClock = endClock;
-    eventRecord.threadId = GetThreadId();
+    eventRecord.threadId = state.threadId;
+    eventRecord.descriptionId = eventDescription ? ProfilerInternDescription(state, eventDescription) : (unsigned int)eventId;
+    ring.head.store(head + 1, std::memory_order_release);
 
-    memcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, &eventRecord, sizeof(CustomEventRecord));
-    g_profilerState->customEventOffset += sizeof(CustomEventRecord);
+    // don't wait for the next flush interval if the ring is filling up
+    if (used + 1 == c_ringBufferRecords / 2)
+        g_profilerState->flusherWakeUp.notify_one();
 }
 
 
@@ -264,7 +410,7 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventI
 
     long long endClock = Clock::GetTimeStamp();
     ProfilerTimeRecordFixedEvent(eventId, stateId, endClock);
-    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock);
+    ProfilerTimeRecordToBuffer(eventId, nullptr, stateId, endClock);
 }
 
 
@@ -274,7 +420,7 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const char* even
     if (g_profilerState == nullptr)
         return;
 
-    ProfilerTimeRecordToBuffer(eventDescription, stateId, Clock::GetTimeStamp());
+    ProfilerTimeRecordToBuffer(0, eventDescription, stateId, Clock::GetTimeStamp());
 }
 
 
@@ -342,6 +488,63 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 }
 
 
+//
+// Get the statistics of a fixed time event recorded so far.
+// Returns false if the profiler is not initialized or the event was not recorded.
+//
+bool PERF_PROFILER_API ProfilerGetEventStats(const int eventId, ProfilerEventStats& stats)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    const FixedEventRecord& record = g_profilerState->fixedEvents[eventId];
+    if (c_fixedEvtDesc[eventId].eventType == profilerEvtSeparator || record.cnt == 0)
+        return false;
+
+    stats = ProfilerEventStats();
+    stats.count = record.cnt;
+
+    if (c_fixedEvtDesc[eventId].eventType == profilerEvtThroughput)
+    {
+        // Throughput is recorded in kB/s
+        stats.total = (double)record.totalBytes;
+        stats.mean = 1000.0 * record.sum / record.cnt;
+        double variance = 1000.0 * 1000.0 * record.sumsq / record.cnt - stats.mean * stats.mean;
+        stats.stdDev = sqrt(std::max(variance, 0.0));
+        stats.min = 1000.0 * record.min;
+        stats.max = 1000.0 * record.max;
+        return true;
+    }
+
+    stats.total = TicksToSeconds(record.sum);
+    stats.mean = stats.total / record.cnt;
+    double variance = TicksSqToSecondsSq(record.sumsq) / record.cnt - stats.mean * stats.mean;
+    stats.stdDev = sqrt(std::max(variance, 0.0));
+    stats.min = TicksToSeconds(record.min);
+    stats.max = TicksToSeconds(record.max);
+
+    // Walk the histogram up to the bucket that contains each percentile, and take the center of that bucket.
+    double percentiles[] = { 0.5, 0.9, 0.99 };
+    double* results[] = { &stats.p50, &stats.p90, &stats.p99 };
+    for (int i = 0; i < _countof(percentiles); i++)
+    {
+        long long rank = std::max((long long)ceil(percentiles[i] * record.cnt), 1ll);
+        long long cumulative = 0;
+        int bucket = 0;
+        while (bucket < c_histogramBuckets - 1 && (cumulative += record.histogram[bucket]) < rank)
+            bucket++;
+        double center = (HistogramBucketLowerBound(bucket) + HistogramBucketLowerBound(bucket + 1)) / 2;
+        center = std::min(std::max(center, (double)record.min), (double)record.max);
+        *results[i] = TicksToSeconds((long long)center);
+    }
+
+    return true;
+}
+
+
 //
 // Generate reports and release all resources.
 //
@@ -351,6 +554,14 @@ void PERF_PROFILER_API ProfilerClose()
     if (g_profilerState == nullptr)
         return;
 
+    // Stop the flusher, which writes out all events recorded so far
+    {
+        std::lock_guard<std::mutex> lock(g_profilerState->flusherMutex);
+        g_profilerState->flusherStop = true;
+    }
+    g_profilerState->flusherWakeUp.notify_one();
+    g_profilerState->flusher.join();
+
     // Get current time as yyyy-mm-dd_hh-mm-ss
     time_t currentTime;
     time(&currentTime);
@@ -366,10 +577,68 @@ void PERF_PROFILER_API ProfilerClose()
     fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_detail_" + g_profilerState->logSuffix + L".csv";
     ProfilerGenerateDetailFile(fileName);
 
+    fclose(g_profilerState->eventLogFile);
+    _wunlink(g_profilerState->eventLogFileName.c_str());
+
+    std::lock_guard<std::mutex> lock(g_mutex); // (a thread exiting now must not return its ring to the state being destroyed)
     g_profilerState.reset();
 }
 
 
+//
+// Move the records of all rings to the event log. Called on the flusher thread only.
+//
+void ProfilerFlushEvents()
+{
+    std::vector<EventRingBuffer*> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_profilerState->ringMutex);
+        for (auto& ring : g_profilerState->rings)
+            rings.push_back(ring.get());
+    }
+
+    for (auto ring : rings)
+    {
+        unsigned long long tail = ring->tail.load(std::memory_order_relaxed);
+        unsigned long long head = ring->head.load(std::memory_order_acquire);
+        while (tail != head)
+        {
+            // up to the end of the ring or of the recorded events, whichever comes first
+            unsigned long long begin = tail & (c_ringBufferRecords - 1);
+            unsigned long long count = std::min(head - tail, c_ringBufferRecords - begin);
+
+            unsigned long long budget = (g_profilerState->customEventBufferBytes - g_profilerState->customEventBytesLogged) / sizeof(CustomEventRecord);
+            unsigned long long logged = std::min(count, budget);
+            if (logged < count && g_profilerState->customEventsOverLimit == 0)
+                fprintf(stderr, "Warning: Performance Profiler: Buffer is full, no more events will be recorded.\n");
+            if (logged > 0)
+                fwriteOrDie(&ring->records[begin], sizeof(CustomEventRecord), (size_t)logged, g_profilerState->eventLogFile);
+            g_profilerState->customEventBytesLogged += logged * sizeof(CustomEventRecord);
+            g_profilerState->customEventsOverLimit += count - logged;
+
+            tail += count;
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+}
+
+void ProfilerFlusherThread()
+{
+    std::unique_lock<std::mutex> lock(g_profilerState->flusherMutex);
+    for (;;)
+    {
+        bool stop = g_profilerState->flusherStop;
+        lock.unlock();
+        ProfilerFlushEvents();
+        if (stop)
+            return;
+        lock.lock();
+        if (!g_profilerState->flusherStop)
+            g_profilerState->flusherWakeUp.wait_for(lock, std::chrono::milliseconds(c_flushIntervalMs));
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Utility functions.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -387,6 +656,32 @@ unsigned int GetThreadId()
 }
 
 
+//
+// Map a duration to its histogram bucket, and back.
+//
+int HistogramBucket(long long ticks)
+{
+    if (ticks < c_histogramSubBuckets)
+        return (int)std::max(ticks, 0ll);
+
+    int msb = 0;
+    for (unsigned long long v = (unsigned long long)ticks >> 1; v != 0; v >>= 1)
+        msb++;
+    int shift = msb - c_histogramSubBucketBits;
+    return (shift + 1) * c_histogramSubBuckets + (int)((ticks >> shift) & (c_histogramSubBuckets - 1));
+}
+
+double HistogramBucketLowerBound(int bucket)
+{
+    if (bucket < c_histogramSubBuckets)
+        return bucket;
+
+    // (as double, since the upper buckets exceed the range of long long)
+    int shift = bucket / c_histogramSubBuckets - 1;
+    return ldexp((double)(c_histogramSubBuckets + bucket % c_histogramSubBuckets), shift);
+}
+
+
 //
 // Generate summary report.
 //
@@ -484,6 +779,15 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
         if (printLine) fprintfOrDie(f, "\n");
     }
 
+    unsigned long long dropped = 0;
+    for (const auto& ring : g_profilerState->rings)
+        dropped += ring->dropped;
+    if (dropped > 0 || g_profilerState->customEventsOverLimit > 0)
+    {
+        fprintfOrDie(f, "\nEvents missing from the detail file: %llu (thread buffer full), %llu (buffer size limit)\n",
+            dropped, g_profilerState->customEventsOverLimit);
+    }
+
     fclose(f);
 }
 
@@ -536,19 +840,25 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
 
     fprintfOrDie(f, "EventDescription,ThreadId,BeginTimeStamp(ms),EndTimeStamp(ms)\n");
 
-    char* eventPtr = g_profilerState->customEventBuffer.get();
-
-    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+    // The log is in flush order, i.e. grouped by thread; the detail file is in order of begin time
+    std::vector<CustomEventRecord> records((size_t)(g_profilerState->customEventBytesLogged / sizeof(CustomEventRecord)));
+    rewind(g_profilerState->eventLogFile);
+    if (!records.empty())
+        freadOrDie(records.data(), sizeof(CustomEventRecord), records.size(), g_profilerState->eventLogFile);
+    std::stable_sort(records.begin(), records.end(), [](const CustomEventRecord& a, const CustomEventRecord& b)
     {
-        char* descriptionStr = eventPtr;
-        eventPtr += strlen(descriptionStr) + 1;
+        return a.beginClock < b.beginClock;
+    });
 
-        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
-        eventPtr += sizeof(CustomEventRecord);
+    for (const auto& eventRecord : records)
+    {
+        const char* descriptionStr = eventRecord.descriptionId < profilerEvtMax
+            ? c_fixedEvtDesc[eventRecord.descriptionId].eventDescription
+            : g_profilerState->descriptions[eventRecord.descriptionId - profilerEvtMax].c_str();
 
-        fprintfOrDie(f, "\"%s\",%u,%.8f,%.8f\n", descriptionStr, eventRecord->threadId, 
-            1000.0 * TicksToSeconds(eventRecord->beginClock),
-            1000.0 * TicksToSeconds(eventRecord->endClock));
+        fprintfOrDie(f, "\"%s\",%u,%.8f,%.8f\n", descriptionStr, eventRecord.threadId,
+            1000.0 * TicksToSeconds(eventRecord.beginClock),
+            1000.0 * TicksToSeconds(eventRecord.endClock));
     }
 
     fclose(f);
@@ -9,9 +9,11 @@
 // Profiler Usage
 //
 // To initialize and tear down the profiler, call ProfilerInit() and ProfilerClose(). The scoped
-// object, ProfilerContext can also be used for managing the lifetime of the profiler. The profiler
-// works by accumulating events in a pre-allocated buffer, up until the buffer is full. At the
-// time when the profiler is torn down, a summary report and a detailed log file is written to disk.
+// object, ProfilerContext can also be used for managing the lifetime of the profiler. Every thread
+// records its events into its own lock-free ring buffer, from which a background thread moves
+// them to a binary log in the profiler directory, up until the configured number of bytes has been
+// logged. Events that find their thread's ring buffer full are dropped and counted. At the time
+// when the profiler is torn down, a summary report and a detailed log file is written to disk.
 //
 // When profiling code, two types of events can be used - fixed or custom. A fixed event is
 // predefined in the ProfilerEvents enum and by the FixedEventDesc struct. A custom event is
@@ -26,6 +28,9 @@
 // and ProfilerThroughputBegin() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// Aggregate statistics of fixed events, including latency percentiles, can be queried at any
+// time with ProfilerGetEventStats(), e.g. by tools that report them directly.
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -73,6 +78,12 @@ enum ProfilerEvents
 
     // Data reader events
     profilerEvtPrefetchMinibatch,           // Prefetching the next minibatch in a background thread
+    profilerEvtReaderGetSequences,          // Getting the sequences of a minibatch from the randomizer (incl. transforms)
+    profilerEvtReaderLoadChunk,             // Loading a chunk from the deserializer (possibly on a prefetch thread)
+    profilerEvtReaderTransform,             // Applying transforms to the sequences of a minibatch
+    profilerEvtReaderPack,                  // Packing sequences into minibatch buffers
+    profilerEvtReaderCopyToMatrices,        // Copying the packed minibatch into the input matrices
+    profilerEvtReaderThroughput,            // Bytes of minibatch data prefetched per second
 
     profilerEvtMax
 };
@@ -81,7 +92,7 @@ enum ProfilerEvents
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
-// customEventBufferBytes: Bytes to allocate for the custom event buffer.
+// customEventBufferBytes: Maximum number of bytes of custom event records to log (24 bytes per event).
 // logSuffix: Suffix string to append to log files.
 // syncGpu: Wait for GPU to complete processing for each profiling event.
 //
@@ -122,6 +133,31 @@ long long PERF_PROFILER_API ProfilerThroughputBegin();
 void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int eventId, const long long bytes);
 
 
+//
+// Aggregate statistics of a fixed event: times in seconds, or rates in bytes per second for
+// throughput events. The percentiles are only computed for time events; they are estimated
+// from a logarithmic histogram, to within about 6%.
+//
+struct ProfilerEventStats
+{
+    int     count;
+    double  mean;
+    double  stdDev;
+    double  min;
+    double  max;
+    double  total;      // seconds, or bytes for throughput events
+    double  p50;
+    double  p90;
+    double  p99;
+};
+
+//
+// Get the statistics of a fixed event recorded so far.
+// Returns false if the profiler is not initialized or the event was not recorded.
+//
+bool PERF_PROFILER_API ProfilerGetEventStats(const int eventId, ProfilerEventStats& stats);
+
+
 //
 // Generate reports and release all resources.
 //
@@ -10,73 +10,23 @@
 #include "BinaryReader.h"
 #include <limits.h>
 #include <stdint.h>
-
-#define CLOSEHANDLE_ERROR 0
+#include <float.h>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-// HIGH and LOW DWORD functions
-DWORD HIDWORD(size_t size)
-{
-    return size >> 32;
-}
-DWORD LODWORD(size_t size)
-{
-    return size & 0xFFFFFFFF;
-}
-
 // BinaryFile Constructor
 // fileName - file to read or create (if it doesn't exist)
 // options - file options, (fileOptionsReadWrite and fileOptionsRead are accepted)
-// size - size of the file to map, will expand/contract existing files to given size. zero means keep current size
+// size - size of the file to map, will expand existing files to given size when writing. zero means keep current size
 BinaryFile::BinaryFile(std::wstring fileName, FileOptions options, size_t size)
 {
-
-    SYSTEM_INFO sysInfo;
-    GetSystemInfo(&sysInfo);
-    m_viewAlignment = sysInfo.dwAllocationGranularity;
-    /* If file created, continue to map file. */
-
+    m_viewAlignment = MappedFile::GetViewAlignment();
     m_writeFile = options == fileOptionsReadWrite;
     m_name = fileName;
     m_maxViewSize = 0x10000000; // 256MB initial max size
-    m_hndFile = CreateFile(fileName.c_str(), m_writeFile ? (GENERIC_WRITE | GENERIC_READ) : GENERIC_READ,
-                           FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (m_hndFile == INVALID_HANDLE_VALUE)
-    {
-        char message[256];
-        sprintf_s(message, "Unable to Open/Create file %ls, error %x", fileName.c_str(), GetLastError());
-        RuntimeError(message);
-    }
-
-    // code to detect type of file (network/local)
-    // std::wstring path;
-    // auto found = fileName.find_last_of(L"\\/");
-    // if (found == npos)
-    //    path = fileName + L"\\";
-    // else
-    //    path = fileName.substr(0, found);
-    // auto driveType = GetDriveType(path.c_str());
-
-    // get the actual size of the file
-    if (size == 0)
-    {
-        GetFileSizeEx(m_hndFile, (PLARGE_INTEGER) &size);
-    }
-    m_filePositionMax = size;
-
-    m_hndMapped =
-        CreateFileMapping(m_hndFile, NULL,
-                          m_writeFile ? PAGE_READWRITE : PAGE_READONLY,
-                          HIDWORD(size), LODWORD(size),
-                          NULL);
-    if (m_hndMapped == NULL)
-    {
-        char message[256];
-        sprintf_s(message, "Unable to map file %ls, error 0x%x", fileName.c_str(), GetLastError());
-        RuntimeError(message);
-    }
-    m_mappedSize = size;
+    m_file.reset(new MappedFile(fileName, m_writeFile ? MappedFileAccess::readWrite : MappedFileAccess::read, size));
+    m_mappedSize = m_file->GetSize();
+    m_filePositionMax = m_mappedSize;
 
     // if writing the file, the inital size of the file is zero
     if (m_writeFile)
@@ -93,23 +43,11 @@ BinaryFile::~BinaryFile()
         // the view
         iter = ReleaseView(iter, true);
     }
-    int rc = CloseHandle(m_hndMapped);
-    if ((rc == CLOSEHANDLE_ERROR) && !std::uncaught_exception())
-    {
-        RuntimeError("BinaryFile: Failed to close handle, %d", ::GetLastError());
-    }
 
     // if we are writing the file, truncate to actual size
     if (m_writeFile)
-    {
-        SetFilePointerEx(m_hndFile, *(LARGE_INTEGER*) &m_filePositionMax, NULL, FILE_BEGIN);
-        SetEndOfFile(m_hndFile);
-    }
-    rc = CloseHandle(m_hndFile);
-    if ((rc == CLOSEHANDLE_ERROR) && !std::uncaught_exception())
-    {
-        RuntimeError("BinaryFile: Failed to close handle, %d", ::GetLastError());
-    }
+        m_file->TruncateOnClose(m_filePositionMax);
+    m_file.reset();
 }
 
 void BinaryFile::SetFilePositionMax(size_t filePositionMax)
@@ -117,9 +55,7 @@ void BinaryFile::SetFilePositionMax(size_t filePositionMax)
     m_filePositionMax = filePositionMax;
     if (m_filePositionMax > m_mappedSize)
     {
-        char message[128];
-        sprintf_s(message, "Setting max position larger than mapped file size: %ld > %ld", (long)m_filePositionMax, (long)m_mappedSize);
-        RuntimeError(message);
+        RuntimeError("Setting max position larger than mapped file size: %ld > %ld", (long)m_filePositionMax, (long)m_mappedSize);
     }
 }
 
@@ -202,9 +138,8 @@ vector<ViewPosition>::iterator BinaryFile::ReleaseView(vector<ViewPosition>::ite
     else
     {
         if (m_writeFile)
-            FlushViewOfFile(iter->view, iter->size);
-        bool ret = UnmapViewOfFile(iter->view) != FALSE;
-        ret;
+            m_file->FlushView(iter->view, iter->size);
+        m_file->UnmapView(iter->view, iter->size);
         iter = m_views.erase(iter);
     }
     return iter;
@@ -216,17 +151,7 @@ vector<ViewPosition>::iterator BinaryFile::ReleaseView(vector<ViewPosition>::ite
 // returns - pointer to the view
 void* BinaryFile::GetView(size_t filePosition, size_t size)
 {
-    void* pBuf = MapViewOfFile(m_hndMapped,                                  // handle to map object
-                               m_writeFile ? FILE_MAP_WRITE : FILE_MAP_READ, // get correct permissions
-                               HIDWORD(filePosition),
-                               LODWORD(filePosition),
-                               size);
-    if (pBuf == NULL)
-    {
-        char message[128];
-        sprintf_s(message, "Unable to map file %ls @ %lld, error %x", m_name.c_str(), filePosition, GetLastError());
-        RuntimeError(message);
-    }
+    void* pBuf = m_file->MapView(filePosition, size);
     m_views.push_back(ViewPosition(pBuf, filePosition, size));
 
     // update file position max if neccesary
@@ -350,7 +275,7 @@ size_t BinaryFile::RoundUp(size_t filePosition)
 SectionFile::SectionFile(std::wstring fileName, FileOptions options, size_t size)
     : BinaryFile(fileName, options, size)
 {
-    m_fileSection = new Section(this, 0, NULL, mappingFile, sectionHeaderMin);
+    m_fileSection = new Section(this, 0, 0, mappingFile, sectionHeaderMin);
     if (m_writeFile)
     {
         m_fileSection->InitHeader(sectionTypeFile, string("Binary Data File"), sectionDataNone, 0);
@@ -359,9 +284,7 @@ SectionFile::SectionFile(std::wstring fileName, FileOptions options, size_t size
     // check for a file header
     if (!m_fileSection->ValidateHeader(m_writeFile))
     {
-        char message[128];
-        sprintf_s(message, "Invalid File format for binary file %ls", fileName.c_str());
-        RuntimeError(message);
+        RuntimeError("Invalid File format for binary file %ls", fileName.c_str());
     }
 }
 
@@ -399,7 +322,7 @@ void Section::InitHeader(SectionType type, std::string description, SectionData
     m_sectionHeader->flags = flagNone;                                                  // bit flags, dependent on sectionType
     m_sectionHeader->elementsCount = 0;                                                 // number of total elements stored
     memset(m_sectionHeader->nameDescription, 0, descriptionSize);                       // clear out the string buffer to all zeros first
-    strcpy_s(m_sectionHeader->nameDescription, description.c_str());                    // name and description of section contents in this format (name: description) (string, with extra bytes zeroed out, at least one null terminator required)
+    strcpy_s(m_sectionHeader->nameDescription, descriptionSize, description.c_str());   // name and description of section contents in this format (name: description) (string, with extra bytes zeroed out, at least one null terminator required)
     m_sectionHeader->size = sectionHeaderMin;                                           // size of this section (including header)
     m_sectionHeader->sizeAll = sectionHeaderMin;                                        // size of this section (including header and all sub-sections)
     m_sectionHeader->sectionFilePosition[0] = 0;                                        // sub-section file offsets (if needed), assumed to be in File Position order
@@ -507,9 +430,7 @@ Section* Section::ReadSection(size_t index, MappingType mapping, size_t sizeElem
     // make sure the header is valid
     if (!section->ValidateHeader())
     {
-        char message[256];
-        sprintf_s(message, "Invalid header in file %ls, in header %ls\n", m_file->GetName().c_str(), section->GetName().c_str());
-        RuntimeError(message);
+        RuntimeError("Invalid header in file %ls, in header %ls\n", m_file->GetName().c_str(), section->GetName().c_str());
     }
 
     // setup the element mapping and pointers as needed
@@ -546,9 +467,7 @@ char* Section::EnsureElements(size_t element, size_t bytesRequested)
     size_t elementsRequested = bytesRequested / GetElementSize();
     if (element + elementsRequested > GetElementCount())
     {
-        char message[256];
-        sprintf_s(message, "Element out of range, error accesing element %lld, size=%lld\n", element, bytesRequested);
-        RuntimeError(message);
+        RuntimeError("Element out of range, error accesing element %lld, size=%lld\n", element, bytesRequested);
     }
 
     // make sure we have the buffer in the range to handle the request
@@ -569,9 +488,7 @@ char* Section::GetElementBuffer(size_t element, size_t windowSize)
     // check element range
     if (!m_file->Writing() && element >= GetElementCount())
     {
-        char message[256];
-        sprintf_s(message, "Element out of range, error accesing element %lld, max element=%lld\n", element, GetElementCount());
-        RuntimeError(message);
+        RuntimeError("Element out of range, error accesing element %lld, max element=%lld\n", element, GetElementCount());
     }
 
     // section is mapped as a whole, so no separate mapping for element buffer
@@ -1079,9 +996,7 @@ void SectionString::SetLabelMapping(const std::map<SectionString::LabelIdType, S
         auto iter = labelMapping.find(i);
         if (iter == labelMapping.end())
         {
-            char message[256];
-            sprintf_s(message, "Mapping table doesn't contain an entry for label Id#%d\n", i);
-            RuntimeError(message);
+            RuntimeError("Mapping table doesn't contain an entry for label Id#%d\n", i);
         }
 
         // add to reverse mapping table
@@ -1091,9 +1006,7 @@ void SectionString::SetLabelMapping(const std::map<SectionString::LabelIdType, S
         errno_t err = strcpy_s(curStr, size, str.c_str());
         if (err)
         {
-            char message[256];
-            sprintf_s(message, "Not enough room in mapping buffer, %lld bytes insufficient for string %d - %s\n", originalSize, i, str.c_str());
-            RuntimeError(message);
+            RuntimeError("Not enough room in mapping buffer, %lld bytes insufficient for string %d - %s\n", originalSize, i, str.c_str());
         }
         size_t len = str.length() + 1; // don't forget the null
         size -= len;
@@ -1113,9 +1026,7 @@ void* SectionString::GetElement(size_t index) const
     char* str = (char*) m_elementBuffer;
     if (index >= GetElementCount())
     {
-        char message[256];
-        sprintf_s(message, "GetElement: invalid index, %lld requested when there are only %lld elements\n", index, GetElementCount());
-        RuntimeError(message);
+        RuntimeError("GetElement: invalid index, %lld requested when there are only %lld elements\n", index, GetElementCount());
     }
 
     // now skip all the strings before the one that we want
@@ -1139,9 +1050,7 @@ char* SectionString::EnsureElements(size_t element, size_t bytesRequested)
     assert(GetMappingType() != mappingElementWindow); // not supported for string tables currently
     if (element >= GetElementCount())
     {
-        char message[256];
-        sprintf_s(message, "Element out of range, error accesing element %lld, size=%lld\n", element, bytesRequested);
-        RuntimeError(message);
+        RuntimeError("Element out of range, error accesing element %lld, size=%lld\n", element, bytesRequested);
     }
 
     // make sure we have the buffer in the range to handle the request
@@ -1230,7 +1139,7 @@ void SectionStats::InitCompute(const ConfigArray& compute)
     {
         std::string name = compute[i];
         auto stat = GetElement<NumericStatistics>(i);
-        strcpy_s(stat->statistic, name.c_str());
+        strcpy_s(stat->statistic, _countof(stat->statistic), name.c_str());
         stat->value = 0.0;
     }
 
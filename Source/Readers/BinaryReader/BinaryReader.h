@@ -8,9 +8,11 @@
 #include "DataReader.h"
 #include "DataWriter.h"
 #include "Config.h"
+#include "MappedFile.h"
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -130,8 +132,7 @@ struct ViewPosition
 class BinaryFile
 {
 protected:
-    HANDLE m_hndFile;         // handle to the file
-    HANDLE m_hndMapped;       // handle to the mapped file object
+    std::unique_ptr<MappedFile> m_file; // the mapped file
     size_t m_mappedSize;      // size of mapped file (zero for size of file being read)
     size_t m_maxViewSize;     // maximum size we want a single view to contain
     size_t m_viewAlignment;   // address alignment required by views
@@ -686,7 +687,4 @@ public:
 
 // utility function to round an integer up to a multiple of size
 size_t RoundUp(size_t value, size_t size);
-// HIGH and LOW DWORD functions
-DWORD HIDWORD(size_t size);
-DWORD LODWORD(size_t size);
 } } }
@@ -150,6 +150,9 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
     // Note it's possible in distributed reading mode to only want to read
     // a subset of the offsets table.
     ReadOffsetsTable(m_file);
+
+    // The chunks themselves are mapped rather than read. Chunks are parsed front to back, so ask for read-ahead.
+    m_mappedFile = make_shared<MappedFile>(m_filename, MappedFileAccess::read, 0, MappedFileHint::sequential);
 }
 
 ChunkDescriptions BinaryChunkDeserializer::GetChunkDescriptions()
@@ -210,30 +213,23 @@ void BinaryChunkDeserializer::GetSequencesForChunk(ChunkIdType chunkId, std::vec
     }
 }
 
-unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
+shared_ptr<MappedView> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 {
-    // Seek to the start of the chunk
-    CNTKBinaryFileHelper::seekOrDie(m_file, m_dataStart + m_offsetsTable->GetOffset(chunkId), SEEK_SET);
-
     // Determine how big the chunk is.
     size_t chunkSize = m_offsetsTable->GetChunkSize(chunkId);
-    
-    // Create buffer
-    unique_ptr<byte[]> buffer(new byte[chunkSize]);
-
-    // Read the chunk from disk
-    CNTKBinaryFileHelper::readOrDie(buffer.get(), sizeof(byte), chunkSize, m_file);
 
-    return buffer;
+    // Map the chunk instead of reading it. The view is copy-on-write, since the sparse deserializer
+    // fixes up the row indices in place; only the pages it touches are copied.
+    return make_shared<MappedView>(m_mappedFile, m_dataStart + m_offsetsTable->GetOffset(chunkId), chunkSize, /*copyOnWrite=*/true);
 }
 
 
 ChunkPtr BinaryChunkDeserializer::GetChunk(ChunkIdType chunkId)
 {
-    // Read the chunk into memory
-    unique_ptr<byte[]> chunkBuffer = ReadChunk(chunkId);
+    // Map the chunk into memory
+    shared_ptr<MappedView> chunkBuffer = ReadChunk(chunkId);
 
-    return make_shared<BinaryDataChunk>(chunkId, m_offsetsTable->GetStartIndex(chunkId), m_offsetsTable->GetNumSequences(chunkId), std::move(chunkBuffer), m_deserializers);
+    return make_shared<BinaryDataChunk>(chunkId, m_offsetsTable->GetStartIndex(chunkId), m_offsetsTable->GetNumSequences(chunkId), chunkBuffer, m_deserializers);
 }
 
 void BinaryChunkDeserializer::SetTraceLevel(unsigned int traceLevel)
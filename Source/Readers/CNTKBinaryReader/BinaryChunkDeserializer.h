@@ -10,6 +10,7 @@
 #include "CorpusDescriptor.h"
 #include "BinaryDataChunk.h"
 #include "BinaryDataDeserializer.h"
+#include "MappedFile.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -85,8 +86,8 @@ private:
     void ReadOffsetsTable(FILE* infile, size_t startOffset, size_t numChunks);
     void ReadOffsetsTable(FILE* infile);
 
-    // Reads a chunk from disk into buffer
-    unique_ptr<byte[]> ReadChunk(ChunkIdType chunkId);
+    // Maps a chunk from disk into memory
+    shared_ptr<MappedView> ReadChunk(ChunkIdType chunkId);
 
     BinaryChunkDeserializer(const wstring& filename);
 
@@ -94,7 +95,8 @@ private:
 
 private:
     const wstring m_filename;
-    FILE* m_file;
+    FILE* m_file;                        // used for reading the header
+    shared_ptr<MappedFile> m_mappedFile; // used for accessing the chunks
 
     int64_t m_offsetStart;
     int64_t m_dataStart;
@@ -10,13 +10,14 @@
 #include "CorpusDescriptor.h"
 #include "BinaryChunkDeserializer.h"
 #include "BinaryDataDeserializer.h"
+#include "MappedFile.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 class BinaryDataChunk : public Chunk, public std::enable_shared_from_this<Chunk>
 {
 public:
-    explicit BinaryDataChunk(ChunkIdType chunkId, size_t startSequence, size_t numSequences, unique_ptr<byte[]> buffer, std::vector<BinaryDataDeserializerPtr> deserializer)
-        : m_chunkId(chunkId), m_startSequence(startSequence), m_numSequences(numSequences), m_buffer(std::move(buffer)), m_deserializers(deserializer)
+    explicit BinaryDataChunk(ChunkIdType chunkId, size_t startSequence, size_t numSequences, const shared_ptr<MappedView>& buffer, std::vector<BinaryDataDeserializerPtr> deserializer)
+        : m_chunkId(chunkId), m_startSequence(startSequence), m_numSequences(numSequences), m_buffer(buffer), m_deserializers(deserializer)
     {
     }
 
@@ -51,7 +52,7 @@ protected:
         size_t bytesProcessed = 0;
         // Now call all of the deserializers on the chunk, in order
         for (size_t c = 0; c < m_deserializers.size(); c++)
-            bytesProcessed += m_deserializers[c]->GetSequenceDataForChunk(m_numSequences, 0, (byte*)m_buffer.get() + bytesProcessed, m_data[c]);
+            bytesProcessed += m_deserializers[c]->GetSequenceDataForChunk(m_numSequences, 0, (byte*)m_buffer->Data() + bytesProcessed, m_data[c]);
     }
 
     // chunk id (copied from the descriptor)
@@ -63,8 +64,8 @@ protected:
     // so we must tell the chunk where it starts.
     size_t m_numSequences;
 
-    // This is the actual chunk read from disk. We will call back to the deserializer for it to be deserialized
-    unique_ptr<byte[]> m_buffer;
+    // This is the actual chunk, mapped from disk. We will call back to the deserializer for it to be deserialized
+    shared_ptr<MappedView> m_buffer;
 
     // This is the deserializer who knows how to interpret the m_data chunk that we read in
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
@@ -99,6 +99,25 @@ void HTKMLFReader<ElemType>::InitFromConfig(const ConfigRecordType& readerConfig
     }
 }
 
+// Convert a lattice archive into the mappable (V3) format, which is used in place from a memory-mapped file instead of being unpacked
+// into memory lattice by lattice. The converted archive is written next to the original one (<stem>.mappable, .toc, .symlist) and
+// reused as long as it is not older than the original TOC. The .symlist file is written last, so it marks a completed conversion.
+// Note: Conversion is not guarded against concurrent workers; with MPI, run it once beforehand (e.g. in a single-worker run).
+static wstring GetMappableLatticeToc(const wstring& tocpath, const msra::asr::simplesenonehmm& hset)
+{
+    wstring stem = tocpath;
+    if (stem.size() > 4 && EqualCI(stem.substr(stem.size() - 4), L".toc"))
+        stem.resize(stem.size() - 4);
+    stem += L".mappable";
+
+    if (!msra::files::fuptodate(stem + L".symlist", tocpath))
+    {
+        fprintf(stderr, "GetMappableLatticeToc: converting lattice archive '%ls' to the mappable format\n", tocpath.c_str());
+        msra::lattices::archive::convert(tocpath, L"", stem, hset, true /*mappable*/);
+    }
+    return stem + L".toc";
+}
+
 // Load all input and output data.
 // Note that the terms features imply be real-valued quantities and
 // labels imply categorical quantities, irrespective of whether they
@@ -277,6 +296,7 @@ void HTKMLFReader<ElemType>::PrepareForTrainingOrTesting(const ConfigRecordType&
 
     // get lattice toc file names
     std::pair<std::vector<wstring>, std::vector<wstring>> latticetocs;
+    bool convertLatticesToMappable = false;
     foreach_index (i, latticeNames) // only support one set of lattice now
     {
         const ConfigRecordType& thisLattice = readerConfig(latticeNames[i]);
@@ -292,6 +312,7 @@ void HTKMLFReader<ElemType>::PrepareForTrainingOrTesting(const ConfigRecordType&
             latticetocs.first.insert(latticetocs.first.end(), paths.begin(), paths.end());
         }
         RootPathInLatticeTocs = (wstring) thisLattice(L"prefixPathInToc", L"");
+        convertLatticesToMappable = thisLattice(L"convertToMappable", false);
     }
 
     // get HMM related file names
@@ -310,6 +331,18 @@ void HTKMLFReader<ElemType>::PrepareForTrainingOrTesting(const ConfigRecordType&
     if (cdphonetyingpaths.size() > 0 && statelistpaths.size() > 0 && transPspaths.size() > 0)
         m_hset.loadfromfile(cdphonetyingpaths[0], statelistpaths[0], transPspaths[0]);
 
+    // optionally use the lattices from archives in the mappable format, converting them on first use
+    if (convertLatticesToMappable)
+    {
+        if (!RootPathInLatticeTocs.empty())
+            InvalidArgument("convertToMappable cannot be used together with prefixPathInToc.");
+        if (m_hset.getsymmap().empty())
+            InvalidArgument("convertToMappable requires the HMM definition (phoneFile) to map the lattice units.");
+        for (auto* tocs : { &latticetocs.first, &latticetocs.second })
+            for (auto& tocpath : *tocs)
+                tocpath = GetMappableLatticeToc(tocpath, m_hset);
+    }
+
     if (iFeat != scriptpaths.size() || iLabel != mlfpathsmulti.size())
         RuntimeError("# of inputs files vs. # of inputs or # of output files vs # of outputs inconsistent");
 
@@ -22,6 +22,7 @@
 #include "simplesenonehmm.h"
 #include <array>
 #include "minibatchsourcehelpers.h"
+#include "MappedFile.h"
 
 namespace msra { namespace asr {
 
@@ -346,6 +347,11 @@ class htkfeatreader : protected htkfeatio
     size_t numframes;                    // number of samples for current logical file
     size_t energyElements;               // how many energy elements to add if addEnergy is true
 
+    // Uncompressed archives are memory-mapped, and frames are copied straight out of the mapping instead of going
+    // through the FILE* buffer. The file handle is still used for the header, and as a fallback if mapping fails.
+    std::unique_ptr<Microsoft::MSR::CNTK::MappedView> mappedarchive; // mapping of the physical file, or null
+    const char* mappedframe;                                         // next frame to read from mappedarchive
+
 public:
     // parser for complex a=b[s,e] syntax
     struct parsedpath
@@ -595,15 +601,33 @@ private:
         this->b.swap(b2);
         this->vecbytesize = H.sampsize;
         this->hascrcc = hascrcc2;
+
+        // archives are read in sequence, usually many utterances from the same file, so map the whole file
+        mappedarchive.reset();
+        mappedframe = nullptr;
+        if (ppath.isarchive && !isidxformat && !compressed)
+        {
+            try
+            {
+                mappedarchive.reset(new Microsoft::MSR::CNTK::MappedView(physicalpath, Microsoft::MSR::CNTK::MappedFileHint::sequential));
+            }
+            catch (const std::exception& e) // (e.g. address space exhausted on 32-bit builds)
+            {
+                fprintf(stderr, "openphysical: cannot memory-map '%ls', reading it instead: %s\n", physicalpath.c_str(), e.what());
+            }
+        }
     }
     void close() // force close the open file --use this in case of read failure
     {
+        mappedarchive.reset();
+        mappedframe = nullptr;
         f = NULL; // assigning a new FILE* to f will close the old FILE* if any
         physicalpath.clear();
     }
 
 public:
     htkfeatreader()
+        : mappedframe(nullptr)
     {
         addEnergy = false;
         energyElements = 0;
@@ -633,9 +657,15 @@ public:
                 RuntimeError("open: end frame exceeds archive's total number of frames %d in '%ls'", (int)physicalframes, ((wstring)ppath).c_str());
 
             int64_t dataoffset = physicaldatastart + ppath.s * vecbytesize;
-            fsetpos(f, dataoffset); // we assume fsetpos(), which is our own, is smart to not flush the read buffer
             curframe = 0;
             numframes = ppath.e + 1 - ppath.s;
+            if (mappedarchive && dataoffset + numframes * vecbytesize <= mappedarchive->Size())
+                mappedframe = mappedarchive->Data() + dataoffset;
+            else
+            {
+                mappedframe = nullptr;
+                fsetpos(f, dataoffset); // we assume fsetpos(), which is our own, is smart to not flush the read buffer
+            }
         }
         else // reading a full file
         {
@@ -674,7 +704,15 @@ public:
     {
         if (curframe >= numframes)
             RuntimeError("htkfeatreader:attempted to read beyond end");
-        if (!compressed && !isidxformat) // not compressed--the easy one
+        if (mappedframe) // mapped archive--copy from the mapping
+        {
+            v.resize(featdim);
+            memcpy(v.data(), mappedframe, featdim * sizeof(float));
+            mappedframe += vecbytesize;
+            if (needbyteswapping)
+                msra::util::byteswap(v);
+        }
+        else if (!compressed && !isidxformat) // not compressed--the easy one
         {
             freadOrDie(v, featdim, f);
             if (needbyteswapping)
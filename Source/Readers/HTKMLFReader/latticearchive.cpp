@@ -3,8 +3,6 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 
-#pragma once
-
 #include "stdafx.h"
 #include "Basics.h"
 #include "fileutil.h"
@@ -47,7 +45,7 @@ static void writeunitmap(const wstring &symlistpath, const UNITMAP &unitmap)
             units[unitid] = label;
     }
 
-    auto_file_ptr flist = fopenOrDie(symlistpath, L"wb");
+    auto_file_ptr flist(fopenOrDie(symlistpath, L"wb"));
     // write (physical) units
     foreach_index (k, units)
     {
@@ -104,8 +102,8 @@ static size_t tryfind(const MAPTYPE &map, const KEYTYPE &key, VALTYPE deflt)
     std::set<std::wstring> seenkeys; // (keep track of seen keys; throw error for duplicate keys)
     msra::files::make_intermediate_dirs(outpath);
 
-    auto_file_ptr f = fopenOrDie(outpath, L"wb");
-    auto_file_ptr ftoc = fopenOrDie(tocpath, L"wb");
+    auto_file_ptr f(fopenOrDie(outpath, L"wb"));
+    auto_file_ptr ftoc(fopenOrDie(tocpath, L"wb"));
     size_t brokeninputfiles = 0;
     foreach_index (i, infiles)
     {
@@ -405,7 +403,7 @@ void lattice::dedup()
 //  - empty ("") -> don't output, just check the format
 //  - dash ("-") -> dump lattice to stdout instead
 /*static*/ void archive::convert(const std::wstring &intocpath, const std::wstring &intocpath2, const std::wstring &outpath,
-                                 const msra::asr::simplesenonehmm &hset)
+                                 const msra::asr::simplesenonehmm &hset, const bool mappable)
 {
     const auto &modelsymmap = hset.getsymmap();
 
@@ -431,8 +429,8 @@ void lattice::dedup()
     std::vector<char> textbuffer;
     auto toclines = msra::files::fgetfilelines(intocpath, textbuffer);
 
-    auto_file_ptr f = NULL;
-    auto_file_ptr ftoc = NULL;
+    auto_file_ptr f;
+    auto_file_ptr ftoc;
 
     // process all files
     if (outpath != L"" && outpath != L"-") // test for special syntaxes that bypass to actually create an output archive
@@ -491,8 +489,16 @@ void lattice::dedup()
         if (f && ftoc)
         {
             // write to archive
+            if (mappable) // V3: expand to final in-memory form, and 8-byte align the lattice in the file
+            {
+                L.rebuildedges(false);
+                lattice::fwritepadding(f, (size_t) fgetpos(f));
+            }
             uint64_t offset = fgetpos(f);
-            L.fwrite(f);
+            if (mappable)
+                L.fwritemappable(f);
+            else
+                L.fwrite(f);
             fflushOrDie(f);
 
             // write reference to TOC file   --note: TOC file is a headerless UTF8 file; so don't use fprintf %ls format (default code page)
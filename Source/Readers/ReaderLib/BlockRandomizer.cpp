@@ -13,6 +13,7 @@
 
 #include "DataReader.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -364,7 +365,9 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_prefetch.wait();
             }
 
+            auto profLoadChunk = ProfilerTimeBegin();
             m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
+            ProfilerTimeEnd(profLoadChunk, profilerEvtReaderLoadChunk);
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -412,7 +415,11 @@ void BlockRandomizer::Prefetch(ChunkIdType chunkId)
         }
 
         m_prefetchedChunk = chunkId;
-        m_prefetch = std::async(m_launchType, [this, chunkId]() { return m_deserializer->GetChunk(chunkId); });
+        m_prefetch = std::async(m_launchType, [this, chunkId]()
+        {
+            PROFILE_SCOPE(profilerEvtReaderLoadChunk);
+            return m_deserializer->GetChunk(chunkId);
+        });
 
         if (m_verbosity >= Debug)
             fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u\n", chunkId);
@@ -9,6 +9,7 @@
 #include "NoRandomizer.h"
 #include "DataReader.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -190,7 +191,9 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
             }
             else
             {
+                auto profLoadChunk = ProfilerTimeBegin();
                 chunks[s.m_chunkId] = m_deserializer->GetChunk(s.m_chunkId);
+                ProfilerTimeEnd(profLoadChunk, profilerEvtReaderLoadChunk);
             }
         }
     }
@@ -350,6 +350,7 @@ template <class ElemType>
 typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
+    auto profThroughput = ProfilerThroughputBegin();
 
     // Resetting layouts.
     for (auto& mx : m_prefetchBuffers)
@@ -368,6 +369,8 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
     if (m_dataTransferers[currentDataTransferIndex])
         m_dataTransferers[currentDataTransferIndex]->WaitForSyncPointOnAssignStreamAsync();
 
+    auto profCopy = ProfilerTimeBegin();
+    long long bytes = 0;
     for (auto& mx : m_prefetchBuffers)
     {
         size_t streamId = m_nameToStreamId[mx.first];
@@ -375,9 +378,12 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
         mx.second.m_mbLayout = stream->m_layout;
 
         size_t sampleSize = m_streams[streamId]->m_sampleLayout->GetNumElements();
-        FillMatrixFromStream(m_streams[streamId]->m_storageType, mx.second.m_matrix.get(), sampleSize, stream, m_dataTransferers[currentDataTransferIndex].get());
+        bytes += FillMatrixFromStream(m_streams[streamId]->m_storageType, mx.second.m_matrix.get(), sampleSize, stream, m_dataTransferers[currentDataTransferIndex].get());
     }
 
+    ProfilerTimeEnd(profCopy, profilerEvtReaderCopyToMatrices);
+    ProfilerThroughputEnd(profThroughput, profilerEvtReaderThroughput, bytes);
+
     // Let's record that we started the copy, so that the main thread can wait afterwards.
     if (m_dataTransferers[currentDataTransferIndex])
         m_dataTransferers[currentDataTransferIndex]->RecordCPUToGPUCopy();
@@ -387,7 +393,7 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
 
 
 template <class ElemType>
-/*static*/ void ReaderShim<ElemType>::FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
+/*static*/ size_t ReaderShim<ElemType>::FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
 {
     size_t numCols = stream->m_layout->GetNumCols();
 
@@ -395,6 +401,7 @@ template <class ElemType>
     {
         auto data = reinterpret_cast<const ElemType*>(stream->m_data);
         matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), const_cast<ElemType*>(data), matrixFlagNormal, transferer);
+        return numRows * numCols * sizeof(ElemType);
     }
     else if (type == StorageType::sparse_csc)
     {
@@ -406,6 +413,7 @@ template <class ElemType>
         IndexType* rows = reinterpret_cast<IndexType*>(values + nnzCount);
         IndexType* columns = reinterpret_cast<IndexType*>(rows + nnzCount);
         matrix->SetMatrixFromCSCFormat(columns, rows, values, nnzCount, numRows, numCols, transferer);
+        return nnzCount * (sizeof(ElemType) + sizeof(IndexType)) + (numCols + 1) * sizeof(IndexType);
     }
     else
         RuntimeError("Storage type %d is not supported.", (int)type);
@@ -156,7 +156,8 @@ private:
     // The value is updated only from the main thread (in StartEpoch/GetMinibatch)
     size_t m_currentSamplePosition;
 
-    static void FillMatrixFromStream(
+    // Returns the number of bytes copied.
+    static size_t FillMatrixFromStream(
         StorageType type,
         Matrix<ElemType>* matrix,
         size_t numRows,
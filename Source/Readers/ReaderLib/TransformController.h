@@ -10,6 +10,7 @@
 #include "Transformer.h"
 #include "SequenceEnumerator.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -82,6 +83,7 @@ public:
             return sequences;
         }
 
+        PROFILE_SCOPE(profilerEvtReaderTransform);
         ExceptionCapture capture;
 #pragma omp parallel for schedule(dynamic)
         for (int j = 0; j < sequences.m_data.front().size(); ++j)
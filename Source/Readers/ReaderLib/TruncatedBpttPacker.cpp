@@ -9,6 +9,7 @@
 #include <cmath>
 #include "TruncatedBpttPacker.h"
 #include "ReaderUtil.h"
+#include "PerformanceProfiler.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -190,19 +191,24 @@ Minibatch TruncatedBPTTPacker::ReadMinibatch()
     Minibatch result;
 
     // Iterating over the streams/slots and packing them into the minibatch.
-    for (size_t streamIndex = 0; streamIndex < m_outputStreamDescriptions.size(); ++streamIndex)
+    // (The slots have been filled above, so only the packing itself is profiled here.)
     {
-        m_currentLayouts[streamIndex]->Init(m_numParallelSequences, m_config.m_truncationSize);
-        size_t sequenceId = 0;
-        for (size_t slotIndex = 0; slotIndex < m_numParallelSequences; ++slotIndex)
+        PROFILE_SCOPE(profilerEvtReaderPack);
+
+        for (size_t streamIndex = 0; streamIndex < m_outputStreamDescriptions.size(); ++streamIndex)
         {
-            result.m_endOfSweep |= PackSlot(streamIndex, slotIndex, sequenceId);
-        }
+            m_currentLayouts[streamIndex]->Init(m_numParallelSequences, m_config.m_truncationSize);
+            size_t sequenceId = 0;
+            for (size_t slotIndex = 0; slotIndex < m_numParallelSequences; ++slotIndex)
+            {
+                result.m_endOfSweep |= PackSlot(streamIndex, slotIndex, sequenceId);
+            }
 
-        StreamMinibatchPtr m = make_shared<StreamMinibatch>();
-        m->m_data = m_streamBuffers[m_currentBufferIndex][streamIndex].m_data.get();
-        m->m_layout = m_currentLayouts[streamIndex];
-        result.m_data.push_back(m);
+            StreamMinibatchPtr m = make_shared<StreamMinibatch>();
+            m->m_data = m_streamBuffers[m_currentBufferIndex][streamIndex].m_data.get();
+            m->m_layout = m_currentLayouts[streamIndex];
+            result.m_data.push_back(m);
+        }
     }
 
     m_currentBufferIndex = (m_currentBufferIndex + 1) % m_numberOfBuffers;
@@ -328,7 +334,9 @@ void TruncatedBPTTPacker::ReadSequencesToSlot(size_t slotIndex)
         // We need a single sequence, potentially we can request (m_truncationSize - slot.AvailableNumberOfSamples())
         // to be more efficient. In reality the truncation size usually is less the sequence size.
         // Bptt always operates on a local timeline, so we do not limit the global minibatch count.
+        auto profGetSequences = ProfilerTimeBegin();
         const auto& sequences = m_sequenceEnumerator->GetNextSequences(SIZE_MAX, 1);
+        ProfilerTimeEnd(profGetSequences, profilerEvtReaderGetSequences);
 
         // assert that number of input streams == number of output streams -- 
         // this does not have to be the case in general, but the current
@@ -0,0 +1,408 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Basics.h"
+#include "ComputationNetwork.h"
+#include "ComputationNode.h"
+#include "RecurrentNodes.h"
+#include "ReshapingNodes.h"
+#include "Sequences.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// BeamSearchDecoder -- decodes output token sequences from a network one token at a time, keeping the best
+// beamWidth partial hypotheses in each step.
+//
+// The network is expected to have
+//  - a token input (dense or sparse one-hot) on its own dynamic axis, which receives the previously emitted
+//    token at each step (the start symbol in the first step). That is, the decoder history is consumed by the
+//    network as is, not delayed once more by a PastValue (such a model can be edited into this form by
+//    replacing the delayed label input with a new input), and
+//  - a score output on the same axis with one score per output token. These are log probabilities or
+//    unnormalized log scores; they are normalized by a log-softmax on the host.
+// All other inputs of the score output make up the source sequence, of which there must be exactly one
+// when Decode() is called. The decoder sees one step of the token sequence at a time, so the source must reach
+// it through values without dynamic axis (e.g. SumElements() of the encoder output). Operations over whole
+// sequences on the token axis, such as Where() and thus BroadcastSequenceAs(), are not supported.
+//
+// All hypotheses are evaluated together as the parallel sequences of a single-frame minibatch. The source
+// sequence is replicated into the same number of parallel sequences. Each step continues the recurrences of
+// the decoder from the previous step (PastValue carry-over, as in truncated BPTT) after their state has been
+// reordered to follow the surviving hypotheses. Nodes that do not depend on the token input (e.g. the encoder)
+// are evaluated once per source sequence.
+// Pruning is done on the host with a heap. A hypothesis that emits the end symbol is complete and reduces the
+// beam width by one. Complete hypotheses are ranked by log probability / length^lengthNormalization.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class BeamSearchDecoder
+{
+public:
+    struct Hypothesis
+    {
+        std::vector<size_t> tokens; // excluding start and end symbol
+        double logProbability;
+        double score;               // log probability, normalized by the length
+    };
+
+    BeamSearchDecoder(ComputationNetworkPtr net, const std::wstring& tokenInputName, const std::wstring& scoreOutputName,
+                      size_t startSymbol, size_t endSymbol, size_t beamWidth, size_t maxLength, double lengthNormalization)
+        : m_net(net), m_startSymbol(startSymbol), m_endSymbol(endSymbol), m_beamWidth(beamWidth), m_maxLength(maxLength), m_lengthNormalization(lengthNormalization)
+    {
+        if (beamWidth == 0)
+            InvalidArgument("BeamSearchDecoder: Beam width must be at least 1.");
+        if (maxLength == 0)
+            InvalidArgument("BeamSearchDecoder: Maximum output length must be at least 1.");
+
+        m_scoreOutput = m_net->OutputNodesByName({ scoreOutputName }).front();
+        m_tokenInput = m_net->GetNodeFromName(tokenInputName);
+
+        auto inputNodes = m_net->InputNodesForOutputs({ scoreOutputName });
+        if (std::find(inputNodes.begin(), inputNodes.end(), m_tokenInput) == inputNodes.end())
+            InvalidArgument("BeamSearchDecoder: '%ls' is not an input of the score output '%ls'.", tokenInputName.c_str(), scoreOutputName.c_str());
+        if (!m_tokenInput->HasMBLayout() || m_scoreOutput->GetMBLayout() != m_tokenInput->GetMBLayout())
+            InvalidArgument("BeamSearchDecoder: The token input '%ls' and the score output '%ls' must have the same dynamic axis.", tokenInputName.c_str(), scoreOutputName.c_str());
+        if (endSymbol >= m_scoreOutput->GetSampleLayout().GetNumElements())
+            InvalidArgument("BeamSearchDecoder: End symbol %d exceeds the dimension of the score output.", (int)endSymbol);
+        if (std::max(startSymbol, endSymbol) >= m_tokenInput->GetSampleLayout().GetNumElements())
+            InvalidArgument("BeamSearchDecoder: Start or end symbol exceeds the dimension of the token input.");
+
+        for (auto& node : inputNodes)
+        {
+            if (node == m_tokenInput)
+                continue;
+            if (node->GetMBLayout() == m_tokenInput->GetMBLayout())
+                InvalidArgument("BeamSearchDecoder: The source input '%ls' must not share the dynamic axis of the token input.", node->NodeName().c_str());
+            m_sourceInputs.push_back(node);
+        }
+
+        // Values that do not depend on the token input are computed in the first step only, so they must outlive it.
+        // If the matrices have been allocated already, their memory may be shared, so they are recomputed in each step instead.
+        m_reevaluateSource = m_net->AreMatricesAllocated();
+        if (!m_reevaluateSource)
+            MarkSourceOnlyNodesNonSharable();
+
+        m_net->AllocateAllMatrices({}, { m_scoreOutput }, nullptr);
+        m_net->StartEvaluateMinibatchLoop(m_scoreOutput);
+
+        // the recurrences of the decoder, whose state is reordered after each step; whole-sequence operations are rejected
+        for (auto& node : m_net->GetEvalOrder(m_scoreOutput))
+        {
+            if (node->OperationName() == OperationNameOf(WhereNode) && node->Input(0)->GetMBLayout() == m_tokenInput->GetMBLayout())
+                InvalidArgument("BeamSearchDecoder: %ls %ls operation: Operations over whole sequences are not supported on the token axis.", node->NodeName().c_str(), node->OperationName().c_str());
+            if (node->GetMBLayout() != m_tokenInput->GetMBLayout() || !node->Is<IStatefulNode>())
+                continue;
+            auto pastValue = dynamic_pointer_cast<PastValueNode<ElemType>>(node);
+            if (!pastValue)
+                InvalidArgument("BeamSearchDecoder: %ls %ls operation: Only PastValue recurrences are supported in the decoder.", node->NodeName().c_str(), node->OperationName().c_str());
+            if (pastValue->TimeStep() != 1)
+                InvalidArgument("BeamSearchDecoder: %ls %ls operation: Only a time step of 1 is supported in the decoder.", node->NodeName().c_str(), node->OperationName().c_str());
+            m_decoderStates.push_back(pastValue);
+        }
+    }
+
+    // inputs to be filled with the source sequence before calling Decode()
+    const std::vector<ComputationNodeBasePtr>& SourceInputNodes() const { return m_sourceInputs; }
+
+    // Decodes the source sequence held by the source inputs. Returns up to numHypotheses hypotheses, best first.
+    std::vector<Hypothesis> Decode(size_t numHypotheses)
+    {
+        let K = m_beamWidth;
+
+        ReplicateSourceSequence();
+        ComputationNetwork::BumpEvalTimeStamp(m_sourceInputs);
+
+        std::vector<Hypothesis> beam(1, Hypothesis{ {}, 0, 0 }); // partial hypotheses, parallel sequence s holds beam[s]
+        std::vector<Hypothesis> complete;
+        std::vector<Candidate> candidates;
+        std::vector<size_t> sourceSequences;
+        for (size_t t = 0; t < m_maxLength && !beam.empty(); t++)
+        {
+            SetTokenInput(beam, t);
+            ComputationNetwork::BumpEvalTimeStamp({ m_tokenInput });
+            if (m_reevaluateSource && t > 0)
+                ComputationNetwork::BumpEvalTimeStamp(m_sourceInputs);
+            m_net->ForwardProp(m_scoreOutput);
+            GetLogProbabilities(beam.size());
+
+            SelectBestCandidates(beam, K - complete.size(), candidates);
+
+            std::vector<Hypothesis> nextBeam;
+            sourceSequences.clear();
+            for (const auto& candidate : candidates)
+            {
+                Hypothesis hyp{ beam[candidate.hyp].tokens, candidate.logProbability, 0 };
+                if (candidate.token == m_endSymbol)
+                {
+                    hyp.score = NormalizedScore(hyp.logProbability, hyp.tokens.size() + 1);
+                    complete.push_back(std::move(hyp));
+                }
+                else
+                {
+                    hyp.tokens.push_back(candidate.token);
+                    nextBeam.push_back(std::move(hyp));
+                    sourceSequences.push_back(candidate.hyp);
+                }
+            }
+            beam.swap(nextBeam);
+
+            // continue each recurrence from the hypothesis that was extended; unused parallel sequences repeat the first one
+            if (!beam.empty())
+            {
+                sourceSequences.resize(K, sourceSequences.front());
+                for (auto& state : m_decoderStates)
+                    state->ReorderParallelSequences(sourceSequences);
+            }
+        }
+
+        // hypotheses that reached the maximum length without end symbol
+        for (auto& hyp : beam)
+        {
+            hyp.score = NormalizedScore(hyp.logProbability, hyp.tokens.size());
+            complete.push_back(std::move(hyp));
+        }
+
+        std::stable_sort(complete.begin(), complete.end(), [](const Hypothesis& a, const Hypothesis& b) { return a.score > b.score; });
+        if (complete.size() > numHypotheses)
+            complete.resize(numHypotheses);
+        return complete;
+    }
+
+private:
+    struct Candidate
+    {
+        double logProbability;
+        size_t hyp;
+        size_t token;
+        bool operator>(const Candidate& other) const { return logProbability > other.logProbability; }
+    };
+
+    double NormalizedScore(double logProbability, size_t length) const
+    {
+        if (m_lengthNormalization == 0 || length == 0)
+            return logProbability;
+        return logProbability / pow((double)length, m_lengthNormalization);
+    }
+
+    // mark all nodes below the score output that do not depend on the token input as non-sharable
+    void MarkSourceOnlyNodesNonSharable()
+    {
+        const auto& evalOrder = m_net->GetEvalOrder(m_scoreOutput);
+        std::set<ComputationNodeBasePtr> dependsOnToken{ m_tokenInput };
+        // iterate to a fixed point, since inputs of recurrent nodes may come later in the eval order
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (auto& node : evalOrder)
+            {
+                if (dependsOnToken.find(node) != dependsOnToken.end())
+                    continue;
+                for (auto& input : node->GetInputs())
+                {
+                    if (dependsOnToken.find(input) != dependsOnToken.end())
+                    {
+                        dependsOnToken.insert(node);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        for (auto& node : evalOrder)
+        {
+            if (!node->IsLeaf() && dependsOnToken.find(node) == dependsOnToken.end())
+                node->MarkValueNonSharable();
+        }
+    }
+
+    // replicate the single source sequence into beamWidth parallel sequences
+    void ReplicateSourceSequence()
+    {
+        let K = m_beamWidth;
+
+        // determine the column mapping for each layout first, since layouts may be shared between inputs
+        std::map<MBLayoutPtr, std::vector<ElemType>> columnMaps; // [layout][replicated column] -> column in the reader's minibatch
+        for (auto& node : m_sourceInputs)
+        {
+            let& layout = node->GetMBLayout();
+            if (!layout || columnMaps.find(layout) != columnMaps.end())
+                continue; // inputs without dynamic axis are used as is
+
+            const MBLayout::SequenceInfo* sequence = nullptr;
+            size_t numSequences = 0;
+            for (let& seq : layout->GetAllSequences())
+            {
+                if (seq.seqId == GAP_SEQUENCE_ID)
+                    continue;
+                sequence = &seq;
+                numSequences++;
+            }
+            if (numSequences != 1)
+                RuntimeError("BeamSearchDecoder: Expected exactly one source sequence for input '%ls', but got %d.", node->NodeName().c_str(), (int)numSequences);
+            if (sequence->tBegin != 0 || sequence->tEnd > layout->GetNumTimeSteps())
+                RuntimeError("BeamSearchDecoder: The source sequence for input '%ls' must be contained in the minibatch completely.", node->NodeName().c_str());
+
+            let T = sequence->tEnd;
+            let S = layout->GetNumParallelSequences();
+            auto& columnMap = columnMaps[layout];
+            columnMap.resize(T * K);
+            for (size_t t = 0; t < T; t++)
+                for (size_t s = 0; s < K; s++)
+                    columnMap[t * K + s] = (ElemType)(t * S + sequence->s);
+        }
+
+        for (auto& node : m_sourceInputs)
+        {
+            let& layout = node->GetMBLayout();
+            if (!layout)
+                continue;
+            auto& columnMap = columnMaps[layout];
+            auto& value = node->As<ComputationNode<ElemType>>()->Value();
+            Matrix<ElemType> indexMap(1, columnMap.size(), columnMap.data(), value.GetDeviceId());
+            Matrix<ElemType> replicated(value.GetNumRows(), 0, value.GetDeviceId(), value.GetMatrixType(), value.GetFormat());
+            replicated.DoGatherColumnsOf(0, indexMap, value, 1);
+            value.SetValue(replicated);
+        }
+
+        for (auto& iter : columnMaps)
+        {
+            let T = iter.second.size() / K;
+            iter.first->Init(K, T);
+            for (size_t s = 0; s < K; s++)
+                iter.first->AddSequence(s, s, 0, T);
+        }
+
+        for (auto& node : m_sourceInputs)
+        {
+            if (node->HasMBLayout())
+                node->NotifyFunctionValuesMBSizeModified();
+        }
+    }
+
+    // feed the last token of each hypothesis as a one-hot vector, as time step t of each parallel sequence
+    void SetTokenInput(const std::vector<Hypothesis>& beam, size_t t)
+    {
+        let K = m_beamWidth;
+
+        let& layout = m_tokenInput->GetMBLayout();
+        layout->Init(K, 1);
+        for (size_t s = 0; s < K; s++)
+            layout->AddSequence(s, s, -(ptrdiff_t)t, m_maxLength - t); // begins t steps before this minibatch, so that the recurrences carry over
+
+        // unused parallel sequences repeat the first hypothesis
+        std::vector<size_t> tokens(K);
+        for (size_t s = 0; s < K; s++)
+        {
+            let& hyp = beam[s < beam.size() ? s : 0];
+            tokens[s] = hyp.tokens.empty() ? m_startSymbol : hyp.tokens.back();
+        }
+
+        auto& value = m_tokenInput->As<ComputationNode<ElemType>>()->Value();
+        let numRows = m_tokenInput->GetSampleLayout().GetNumElements();
+        if (value.GetMatrixType() == MatrixType::SPARSE)
+        {
+            std::vector<CPUSPARSE_INDEX_TYPE> colIndices(K + 1), rowIndices(K);
+            std::vector<ElemType> ones(K, 1);
+            for (size_t s = 0; s < K; s++)
+            {
+                colIndices[s] = (CPUSPARSE_INDEX_TYPE)s;
+                rowIndices[s] = (CPUSPARSE_INDEX_TYPE)tokens[s];
+            }
+            colIndices[K] = (CPUSPARSE_INDEX_TYPE)K;
+            value.SetMatrixFromCSCFormat(colIndices.data(), rowIndices.data(), ones.data(), K, numRows, K);
+        }
+        else
+        {
+            m_tokenBuffer.assign(numRows * K, 0);
+            for (size_t s = 0; s < K; s++)
+                m_tokenBuffer[s * numRows + tokens[s]] = 1;
+            value.SetValue(numRows, K, value.GetDeviceId(), m_tokenBuffer.data(), matrixFlagNormal);
+        }
+        m_tokenInput->NotifyFunctionValuesMBSizeModified();
+    }
+
+    // copy the scores of the first numHypotheses parallel sequences to the host and normalize them to log probabilities
+    void GetLogProbabilities(size_t numHypotheses)
+    {
+        const auto& scores = m_scoreOutput->As<ComputationNode<ElemType>>()->Value();
+        let V = scores.GetNumRows();
+        if (scores.GetNumCols() != m_beamWidth)
+            LogicError("BeamSearchDecoder: Expected %d columns in the score output, but got %d.", (int)m_beamWidth, (int)scores.GetNumCols());
+
+        m_logProbabilities.resize(V * m_beamWidth);
+        ElemType* data = m_logProbabilities.data();
+        size_t size = m_logProbabilities.size();
+        scores.CopyToArray(data, size);
+
+#pragma omp parallel for
+        for (long h = 0; h < (long)numHypotheses; h++)
+        {
+            ElemType* column = data + h * V;
+            ElemType maxScore = *std::max_element(column, column + V);
+            double sum = 0;
+            for (size_t v = 0; v < V; v++)
+                sum += exp((double)(column[v] - maxScore));
+            ElemType logSum = maxScore + (ElemType)log(sum);
+            for (size_t v = 0; v < V; v++)
+                column[v] -= logSum;
+        }
+    }
+
+    // select the width best extensions over all hypotheses and tokens, best first
+    void SelectBestCandidates(const std::vector<Hypothesis>& beam, size_t width, std::vector<Candidate>& candidates) const
+    {
+        let V = m_logProbabilities.size() / m_beamWidth;
+
+        // min-heap of the best candidates found so far
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap;
+        for (size_t h = 0; h < beam.size(); h++)
+        {
+            const ElemType* column = m_logProbabilities.data() + h * V;
+            for (size_t v = 0; v < V; v++)
+            {
+                Candidate candidate{ beam[h].logProbability + column[v], h, v };
+                if (heap.size() < width)
+                    heap.push(candidate);
+                else if (candidate > heap.top())
+                {
+                    heap.pop();
+                    heap.push(candidate);
+                }
+            }
+        }
+
+        candidates.resize(heap.size());
+        for (size_t i = candidates.size(); i-- > 0; heap.pop())
+            candidates[i] = heap.top();
+    }
+
+    ComputationNetworkPtr m_net;
+    ComputationNodeBasePtr m_tokenInput;
+    ComputationNodeBasePtr m_scoreOutput;
+    std::vector<ComputationNodeBasePtr> m_sourceInputs;
+    std::vector<shared_ptr<IStatefulNode>> m_decoderStates;
+    bool m_reevaluateSource; // nodes that only depend on the source are not kept across steps
+
+    size_t m_startSymbol;
+    size_t m_endSymbol;
+    size_t m_beamWidth;
+    size_t m_maxLength;
+    double m_lengthNormalization;
+
+    std::vector<ElemType> m_tokenBuffer;      // host buffer for dense token input
+    std::vector<ElemType> m_logProbabilities; // [v + h * V] log probabilities of the current step
+};
+
+}}}
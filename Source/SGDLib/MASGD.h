@@ -17,6 +17,8 @@
 #include <stdexcept>
 #include <chrono> 
 #include <random>
+#include <map>
+#include <cmath>
 
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -39,12 +41,15 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         size_t m_localSamplesProcessedSinceLastReport; 
         double m_accumulatedSecondsOnSyncPointInOneEpoch;
         size_t m_syncPointHitCounterInOneEpoch;
+        double m_secondsOverlappedSinceLastReport;
+        double m_secondsWaitedSinceLastReport;
         Timer  m_Timer; 
 
     public:
         MASGDPerfStats(size_t myRank, size_t numWorkers):
             m_numWorkers(numWorkers), m_myRank(myRank), m_numSyncPerformedInCurrentEpoch(0), m_reportFrequency(1), 
-            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0)
+            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0),
+            m_secondsOverlappedSinceLastReport(0), m_secondsWaitedSinceLastReport(0)
         {
             m_Timer.Start();
         }
@@ -100,6 +105,14 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
 
+        // asynchronous model aggregation: time spent computing while an aggregation was in flight,
+        // and time spent waiting for it to complete afterwards
+        void OnAsyncMAOverlap(double secondsOverlapped, double secondsWaited)
+        {
+            m_secondsOverlappedSinceLastReport += secondsOverlapped;
+            m_secondsWaitedSinceLastReport += secondsWaited;
+        }
+
         void ReportMAPerfStats( size_t totalSamplesProcessedSinceLastReport, 
                                 size_t localSamplesProcessedSinceLastReport, 
                                 float secondOnCommunication)
@@ -115,6 +128,15 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                             "\t\t(model aggregation stats) %d-th sync: totalThroughput = %.2fk samplesPerSecond , throughputPerWorker = %.2fk samplesPerSecond\n";
             fprintf(stderr, prefix.c_str(), (int)m_numSyncPerformedInCurrentEpoch, secondsSinceLastReport, secondOnCommunication, (int)totalSamplesProcessedSinceLastReport, (int)m_numWorkers, (int)localSamplesProcessedSinceLastReport,
                                             (int)m_numSyncPerformedInCurrentEpoch, totalThroughput, throughputPerWorker); 
+            if (m_secondsOverlappedSinceLastReport > 0)
+            {
+                double secondsInFlight = m_secondsOverlappedSinceLastReport + m_secondsWaitedSinceLastReport;
+                fprintf(stderr, "\t\t(model aggregation stats) %d-th sync: %.2f seconds of computation overlapped with aggregation, %.2f seconds waited for it (%.1f%% hidden)\n",
+                        (int)m_numSyncPerformedInCurrentEpoch, m_secondsOverlappedSinceLastReport, m_secondsWaitedSinceLastReport,
+                        100.0 * m_secondsOverlappedSinceLastReport / secondsInFlight);
+                m_secondsOverlappedSinceLastReport = 0;
+                m_secondsWaitedSinceLastReport = 0;
+            }
         }
     };
     // base class for MA-SGD algorithm family 
@@ -328,6 +350,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     class BasicModelAveragingSGD : public IMASGD<ElemType>
     {
         typedef IMASGD<ElemType> Base; 
+    protected:
         using Base::m_pMPI;
         using Base::DownCast;
 
@@ -404,4 +427,370 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         }
     };
 
+    // Model averaging with communication overlapped with computation.
+    // At a sync point, a snapshot of the model is averaged across workers in the background (non-blocking allreduce)
+    // while training continues on the local model. At the next sync point the result is merged in as a correction,
+    //     model = model + (average of snapshots - own snapshot),
+    // which keeps the local progress made in the meantime, and the next averaging is started.
+    // Instead of the blocking status handshake, the number of workers that reached the end of their data is summed up
+    // in the same allreduce: once this is non-zero, no further averaging is started in this epoch, and all workers do
+    // a final, blocking model averaging at the end of the epoch.
+    template<typename ElemType>
+    class AsyncModelAveragingSGD : public BasicModelAveragingSGD<ElemType>
+    {
+        typedef BasicModelAveragingSGD<ElemType> Base;
+        typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+        using Base::m_pMPI;
+        using Base::m_perfReporter;
+        using Base::m_numSyncPerformed;
+        using Base::DownCast;
+
+    public:
+        AsyncModelAveragingSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID)
+            : Base(pMPI, reportFreq, devID), m_pending(false), m_stopped(false), m_samplesInFlight(0)
+        {
+            fprintf(stderr, "Model averaging is performed asynchronously, overlapped with computation\n");
+        }
+
+        void OnEpochStart(const std::list<ComputationNodeBasePtr>& learnableNodes) override
+        {
+            Base::OnEpochStart(learnableNodes);
+            assert(!m_pending);
+            m_stopped = false;
+        }
+
+        bool OnArrivingAtSyncPoint(
+            const std::list<ComputationNodeBasePtr>& learnableNodes,
+            std::list<Matrix<ElemType>>& /*smoothedGradient*/,
+            size_t samplesSinceLastSync) override
+        {
+            if (m_pending)
+                CompleteAveraging(learnableNodes);
+            if (m_stopped)
+                return false; // some worker has reached the end of its data, wait for the final averaging
+
+            StartAveraging(learnableNodes, samplesSinceLastSync, /*atEnd=*/false);
+            return true;
+        }
+
+        void OnEpochEnd(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                        std::list<Matrix<ElemType>>& smoothedGradient,
+                        size_t samplesSinceLastSync) override
+        {
+            // Let the others know that we are done by joining the next averaging with a zero weight.
+            // They take part in it at their next sync point, or at the end of their data.
+            if (m_pending)
+                CompleteAveraging(learnableNodes);
+            if (!m_stopped)
+            {
+                StartAveraging(learnableNodes, 0, /*atEnd=*/true);
+                CompleteAveraging(learnableNodes);
+            }
+            assert(m_stopped);
+
+            // final averaging, so that all workers end the epoch with the same model
+            size_t totalSamplesProcessed = 0;
+            float secondsOnCommunication = 0.0f;
+            m_numSyncPerformed++;
+            this->ModelAggregationProcessing(samplesSinceLastSync, learnableNodes, smoothedGradient, totalSamplesProcessed, secondsOnCommunication);
+            m_perfReporter.OnMAPerformed(samplesSinceLastSync, totalSamplesProcessed, secondsOnCommunication);
+
+            m_pMPI->WaitAll();
+            m_perfReporter.OnEpochEnd();
+        }
+
+    private:
+        // take a snapshot of the model and start averaging it, weighted by the number of samples it has seen
+        void StartAveraging(const std::list<ComputationNodeBasePtr>& learnableNodes, size_t samples, bool atEnd)
+        {
+            ElemType weight = (ElemType)samples;
+            size_t offset = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+                auto pNode = DownCast(pBaseNode);
+                const Matrix<ElemType>& value = pNode->Value();
+                auto& snapshot = m_snapshots[pNode->NodeName()];
+                if (!snapshot)
+                    snapshot = make_shared<Matrix<ElemType>>(value.DeepClone());
+                else
+                    snapshot->SetValue(value);
+
+                size_t numElements = value.GetNumElements();
+                if (m_buffer.size() < offset + numElements)
+                    m_buffer.resize(offset + numElements);
+                ElemType* data = m_buffer.data() + offset;
+                value.CopyToArray(data, numElements);
+                for (size_t i = 0; i < numElements; i++)
+                    data[i] *= weight;
+                offset += numElements;
+            }
+            // followed by the total weight and the number of workers at the end of their data
+            m_buffer.resize(offset + 2);
+            m_buffer[offset] = weight;
+            m_buffer[offset + 1] = atEnd ? (ElemType)1 : (ElemType)0;
+
+            m_pMPI->AllReduceAsync(m_buffer.data(), m_buffer.size(), &m_request);
+            m_pending = true;
+            m_samplesInFlight = samples;
+            m_numSyncPerformed++;
+            m_overlapTimer.Restart();
+        }
+
+        // wait for the averaging in flight and merge its result into the model
+        void CompleteAveraging(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            assert(m_pending);
+            m_overlapTimer.Stop();
+            Timer waitTimer;
+            waitTimer.Start();
+            m_pMPI->Wait(&m_request);
+            waitTimer.Stop();
+            m_pending = false;
+
+            size_t numElements = m_buffer.size() - 2;
+            ElemType totalWeight = m_buffer[numElements];
+            if (m_buffer[numElements + 1] > 0)
+                m_stopped = true;
+
+            if (totalWeight > 0)
+            {
+                size_t offset = 0;
+                for (auto& pBaseNode : learnableNodes)
+                {
+                    if (!pBaseNode->IsParameterUpdateRequired())
+                        continue;
+                    auto pNode = DownCast(pBaseNode);
+                    Matrix<ElemType>& value = pNode->Value();
+                    Matrix<ElemType> correction(value.GetDeviceId());
+                    correction.SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), m_buffer.data() + offset);
+                    offset += value.GetNumElements();
+
+                    Matrix<ElemType>::ScaleAndAdd(-1, *m_snapshots.at(pNode->NodeName()), 1 / totalWeight, correction);
+                    value += correction;
+                }
+                assert(offset == numElements);
+            }
+
+            m_perfReporter.OnAsyncMAOverlap(m_overlapTimer.ElapsedSeconds(), waitTimer.ElapsedSeconds());
+            m_perfReporter.OnMAPerformed(m_samplesInFlight, (size_t)totalWeight, (float)waitTimer.ElapsedSeconds());
+        }
+
+        bool m_pending;                 // an averaging is in flight
+        bool m_stopped;                 // some worker has reached the end of its data, no further averaging in this epoch
+        MPI_Request m_request;
+        std::vector<ElemType> m_buffer; // weighted snapshot, in place of the average once the allreduce has completed
+        std::map<std::wstring, shared_ptr<Matrix<ElemType>>> m_snapshots;
+        size_t m_samplesInFlight;
+        Timer m_overlapTimer;
+    };
+
+    // Implementation of block-wise model update and filtering (BMUF, "block momentum"), see
+    //   K. Chen and Q. Huo: Scalable training of deep learning machines by incremental block training
+    //   with intra-block parallel optimization and blockwise model-update filtering, ICASSP 2016.
+    // Workers train independently on blocks of data. At each sync point the average of the model deltas since
+    // the last sync (the block gradient) is filtered with a block-level momentum:
+    //     smoothedBlockGradient = blockMomentum * smoothedBlockGradient + blockLearningRate * (-averageDelta)
+    //     globalModel           = globalModel - smoothedBlockGradient
+    // and the workers continue from the global model, or, with Nesterov momentum, from where the global model is
+    // heading (globalModel - blockMomentum * smoothedBlockGradient).
+    // The model deltas are allreduced asynchronously, so that the update of one parameter overlaps with the
+    // communication of the following ones.
+    template<typename ElemType>
+    class BasicBlockMomentumSGD : public IMASGD<ElemType>
+    {
+        typedef IMASGD<ElemType> Base;
+        using Base::m_pMPI;
+        using Base::m_deviceId;
+        using Base::DownCast;
+
+    public:
+        BasicBlockMomentumSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID,
+                              bool useNesterovMomentum, bool resetSGDMomentum, double blockLearningRate,
+                              double blockMomentumAsTimeConstant, size_t syncPeriod)
+            : Base(pMPI, reportFreq, devID),
+              m_useNesterovMomentum(useNesterovMomentum),
+              m_resetSGDMomentum(resetSGDMomentum),
+              m_blockLearningRate(blockLearningRate),
+              m_blockMomentumAsTimeConstant(blockMomentumAsTimeConstant)
+        {
+            fprintf(stderr, "Parallel training (%d workers) using BlockMomentumSGD with block momentum = %6.4f, block learning rate = %6.4f%s%s\n",
+                    (int)m_pMPI->NumNodesInUse(), TimeConstant2Momentum(m_blockMomentumAsTimeConstant, syncPeriod), m_blockLearningRate,
+                    m_useNesterovMomentum ? ", using Nesterov-style block momentum" : "",
+                    m_resetSGDMomentum ? ", resetting SGD momentum after sync" : "");
+        }
+
+        void OnEpochStart(const std::list<ComputationNodeBasePtr>& learnableNodes) override
+        {
+            Base::OnEpochStart(learnableNodes);
+            // the global model starts out as the current model (all workers start from the same model),
+            // unless it was restored from a checkpoint
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+                auto pNode = DownCast(pBaseNode);
+                if (m_prevParameters.find(pNode->NodeName()) == m_prevParameters.end())
+                {
+                    auto prevParameter = make_shared<Matrix<ElemType>>(pNode->Value().DeepClone());
+                    auto smoothedBlockGradient = make_shared<Matrix<ElemType>>(pNode->Value().GetNumRows(), pNode->Value().GetNumCols(), pNode->Value().GetDeviceId());
+                    smoothedBlockGradient->SetValue(0);
+                    m_prevParameters[pNode->NodeName()] = prevParameter;
+                    m_smoothedBlockGradients[pNode->NodeName()] = smoothedBlockGradient;
+                }
+            }
+        }
+
+        void ModelAggregationProcessing(
+            size_t samplesSinceLastSync,                                       /* in */
+            const std::list<ComputationNodeBasePtr>&  learnableNodes,          /* in/out */
+            std::list<Matrix<ElemType>>&              smoothedGradient,        /* in/out */
+            size_t&                                   totalSamplesProcessed,   /* out */
+            float&                                    secondsOnCommunication   /* out */) override
+        {
+            //----------------------------------------
+            // 1. determine the block momentum from the number of samples in this block
+            //----------------------------------------
+            int nTotalSamples = (int)samplesSinceLastSync;
+            Timer commTimer;
+            secondsOnCommunication = 0.0f;
+            commTimer.Start();
+            m_pMPI->AllReduce(&nTotalSamples, 1);
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+            if (nTotalSamples <= 0)
+            {
+                // nothing was learned in this block (or the count overflowed): keep the models as they are
+                totalSamplesProcessed = samplesSinceLastSync * m_pMPI->NumNodesInUse();
+                if (nTotalSamples == 0)
+                    return;
+            }
+            else
+                totalSamplesProcessed = nTotalSamples;
+
+            ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstant, totalSamplesProcessed);
+            ElemType numWorkers = (ElemType)m_pMPI->NumNodesInUse();
+
+            //----------------------------------------
+            // 2. start the allreduce of the model deltas for all parameters
+            //----------------------------------------
+            std::vector<ComputationNodePtr> nodes;
+            std::vector<Matrix<ElemType>> deltas;
+            std::vector<unique_ptr<ElemType[]>> buffers;
+            std::vector<MPI_Request> requests;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType> delta(pNode->Value().DeepClone());
+                delta -= *m_prevParameters.at(pNode->NodeName());
+                nodes.push_back(pNode);
+                buffers.push_back(unique_ptr<ElemType[]>(delta.CopyToArray()));
+                deltas.push_back(std::move(delta));
+            }
+            requests.resize(nodes.size());
+            commTimer.Restart();
+            for (size_t i = 0; i < nodes.size(); i++)
+                m_pMPI->AllReduceAsync(buffers[i].get(), deltas[i].GetNumElements(), &requests[i]);
+
+            //----------------------------------------
+            // 3. update the global model and the local models as the sums arrive
+            //----------------------------------------
+            for (size_t i = 0; i < nodes.size(); i++)
+            {
+                m_pMPI->Wait(&requests[i]);
+                Matrix<ElemType>& delta = deltas[i];
+                delta.SetValue(delta.GetNumRows(), delta.GetNumCols(), delta.GetDeviceId(), buffers[i].get());
+
+                Matrix<ElemType>& prevParameter = *m_prevParameters.at(nodes[i]->NodeName());
+                Matrix<ElemType>& smoothedBlockGradient = *m_smoothedBlockGradients.at(nodes[i]->NodeName());
+                // the block gradient is the negated average delta
+                Matrix<ElemType>::ScaleAndAdd(-(ElemType)m_blockLearningRate / numWorkers, delta, blockMomentum, smoothedBlockGradient);
+                prevParameter -= smoothedBlockGradient;
+
+                Matrix<ElemType>& currentParameter = nodes[i]->Value();
+                currentParameter.SetValue(prevParameter);
+                if (m_useNesterovMomentum)
+                    Matrix<ElemType>::ScaleAndAdd(-blockMomentum, smoothedBlockGradient, currentParameter);
+            }
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+            if (m_resetSGDMomentum)
+            {
+                for (auto& sg : smoothedGradient)
+                    sg.SetValue(0);
+            }
+        }
+
+        void SaveToCheckPoint(File& fstream) override
+        {
+            if (!m_pMPI->IsMainNode())
+                return;
+
+            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BBlockMomentumSGD");
+            fstream << (size_t)m_prevParameters.size();
+            for (auto& iter : m_prevParameters)
+            {
+                fstream << iter.first;
+                fstream << *iter.second;
+                fstream << *m_smoothedBlockGradients.at(iter.first);
+            }
+            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EBlockMomentumSGD");
+        }
+
+        void LoadFromCheckPoint(File& fstream) override
+        {
+            if (!fstream.TryGetMarker(FileMarker::fileMarkerBeginSection, L"BBlockMomentumSGD"))
+                return; // checkpoint written without block momentum: start over from the current model
+
+            size_t numParameters;
+            fstream >> numParameters;
+            m_prevParameters.clear();
+            m_smoothedBlockGradients.clear();
+            for (size_t i = 0; i < numParameters; i++)
+            {
+                std::wstring name;
+                fstream >> name;
+                auto prevParameter = make_shared<Matrix<ElemType>>(m_deviceId);
+                auto smoothedBlockGradient = make_shared<Matrix<ElemType>>(m_deviceId);
+                fstream >> *prevParameter;
+                fstream >> *smoothedBlockGradient;
+                m_prevParameters[name] = prevParameter;
+                m_smoothedBlockGradients[name] = smoothedBlockGradient;
+            }
+            fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EBlockMomentumSGD");
+        }
+
+        // block momentum per sync of syncPeriod samples <-> time constant in samples
+        static double TimeConstant2Momentum(double timeConstant, size_t syncPeriod)
+        {
+            if (timeConstant == 0)
+                return 0;
+            return exp(-((double)syncPeriod) / timeConstant);
+        }
+
+        static double Momentum2TimeConstant(double blockMomentum, size_t syncPeriod)
+        {
+            if (blockMomentum < 0 || blockMomentum >= 1)
+                InvalidArgument("Unexpected block momentum (%.2f). Block momentum should be in the range of [0,1)", blockMomentum);
+            return -((double)syncPeriod) / log(blockMomentum);
+        }
+
+    private:
+        typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+
+        bool   m_useNesterovMomentum;
+        bool   m_resetSGDMomentum;
+        double m_blockLearningRate;
+        double m_blockMomentumAsTimeConstant;
+
+        // global model at the last sync and the filtered block gradients, per parameter node
+        std::map<std::wstring, shared_ptr<Matrix<ElemType>>> m_prevParameters;
+        std::map<std::wstring, shared_ptr<Matrix<ElemType>>> m_smoothedBlockGradients;
+    };
+
 } } }
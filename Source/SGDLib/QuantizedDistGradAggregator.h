@@ -0,0 +1,262 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "MatrixQuantizerImpl.h"
+#include "TimerUtility.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Data-parallel gradient aggregation with gradients quantized to 1, 2, 4 or 8 bits (see ColumnQuantizer).
+// The quantization error of each node is kept in a residual and added to the gradient of the next minibatch
+// (error feedback), so that no gradient information is lost over time.
+// Aggregation is an all-reduce made of two exchanges of quantized data:
+//  - reduce-scatter: the columns of each gradient matrix are divided into one stripe per node; every node quantizes
+//    its gradient and sends each stripe to the node that owns it, which unquantizes and sums up what it receives;
+//  - all-gather: every node quantizes its aggregated stripe again (with a second residual) and all nodes gather
+//    the quantized stripes of all others, which they unquantize into the gradient matrix.
+// Only CPU gradients are supported.
+template <class ElemType>
+class QuantizedDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+
+public:
+    QuantizedDistGradAggregator(const MPIWrapperPtr& mpi, int numGradientBits, bool zeroThresholdFor1Bit, int traceLevel, int syncStatsTrace)
+        : IDistGradAggregator<ElemType>(mpi), m_numGradientBits(numGradientBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_traceLevel(traceLevel), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_initialized(false)
+    {
+        if (numGradientBits != 1 && numGradientBits != 2 && numGradientBits != 4 && numGradientBits != 8)
+            InvalidArgument("QuantizedDistGradAggregator: gradientBits must be 1, 2, 4 or 8 (or the full precision), got %d.", numGradientBits);
+    }
+
+    // Aggregate the gradient matrices across all nodes
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
+    {
+        ResetState(gradients, resetState);
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        size_t numGradMatrices = gradients.size();
+        size_t numProc = NumProc();
+        size_t myRank = MyRank();
+
+        // If the current node did not process any samples, the gradients should be zero'd
+        if (headerCPU->numSamples == 0)
+        {
+            for (size_t i = 0; i < numGradMatrices; ++i)
+                gradients[i]->SetValue(0);
+        }
+
+        // Headers are small, so every node gathers all of them and aggregates locally
+        size_t headerSize = headerCPU->Size();
+        m_gatheredHeaders.resize(headerSize * numProc);
+        MPI_Request headerRequest;
+        MPI_Iallgather(headerCPU, (int) headerSize, MPI_CHAR, m_gatheredHeaders.data(), (int) headerSize, MPI_CHAR, m_mpi->Communicator(), &headerRequest) || MpiFail("MPI_Iallgather");
+
+        // Reduce-scatter: receive the stripes owned by this node from all other nodes, quantize the local gradients
+        // and send each stripe to its owner. We use the index of the gradient matrix as the tag.
+        std::vector<MPI_Request> recvRequests;
+        std::vector<MPI_Request> sendRequests;
+        std::vector<size_t> numRecvRequests(numGradMatrices, 0);
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            for (size_t k = 0; k < numProc; ++k)
+            {
+                if (k != myRank && m_stripeBytes[i][myRank] > 0)
+                {
+                    recvRequests.push_back(MPI_Request());
+                    MPI_Irecv(m_recvStripes[i][k]->Buffer(), m_stripeBytes[i][myRank], MPI_CHAR, (int) k, (int) i, m_mpi->Communicator(), &recvRequests.back()) || MpiFail("MPI_Irecv");
+                    numRecvRequests[i]++;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            m_quantizer->QuantizeAsync(*gradients[i], *m_residuals[i], *m_quantizedGradients[i], *m_residuals[i], m_zeroThresholdFor1Bit);
+            m_quantizer->WaitQuantizeAsyncDone();
+
+            for (size_t k = 0; k < numProc; ++k)
+            {
+                if (k != myRank && m_stripeBytes[i][k] > 0)
+                {
+                    sendRequests.push_back(MPI_Request());
+                    MPI_Isend(m_quantizedGradients[i]->Buffer() + m_stripeOffsets[i][k], m_stripeBytes[i][k], MPI_CHAR, (int) k, (int) i, m_mpi->Communicator(), &sendRequests.back()) || MpiFail("MPI_Isend");
+                }
+            }
+        }
+
+        // Aggregate the own stripe of each gradient as its parts arrive, quantize the result into this node's slot
+        // of the all-gather buffer and start the all-gather
+        std::vector<MPI_Request> allGatherRequests(numGradMatrices);
+        size_t firstRecvRequest = 0;
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            if (numRecvRequests[i] > 0)
+                MPI_Waitall((int) numRecvRequests[i], &recvRequests[firstRecvRequest], MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            firstRecvRequest += numRecvRequests[i];
+
+            size_t stripeNumCols = m_stripeResiduals[i]->GetNumCols();
+            if (stripeNumCols > 0)
+            {
+                size_t stripeStartCol = StripeStartColumn(gradients[i]->GetNumCols(), myRank);
+                Matrix<ElemType> stripe = gradients[i]->ColumnSlice(stripeStartCol, stripeNumCols);
+
+                // The own part is taken after quantization too, to be consistent with the residual
+                QuantizedMatrix<ElemType> ownStripe = m_quantizedGradients[i]->ColumnSlice(stripeStartCol, stripeNumCols);
+                m_quantizer->UnquantizeAsync(ownStripe, stripe, false);
+                for (size_t k = 0; k < numProc; ++k)
+                {
+                    if (k != myRank)
+                        m_quantizer->UnquantizeAsync(*m_recvStripes[i][k], stripe, true);
+                }
+                m_quantizer->WaitUnquantizeAsyncDone();
+
+                QuantizedMatrix<ElemType> aggregatedStripe = m_aggregatedGradients[i]->ColumnSlice(stripeStartCol, stripeNumCols);
+                m_quantizer->QuantizeAsync(stripe, *m_stripeResiduals[i], aggregatedStripe, *m_stripeResiduals[i], m_zeroThresholdFor1Bit);
+                m_quantizer->WaitQuantizeAsyncDone();
+            }
+
+            MPI_Iallgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, m_aggregatedGradients[i]->Buffer(), m_stripeBytes[i].data(), m_stripeOffsets[i].data(), MPI_CHAR,
+                            m_mpi->Communicator(), &allGatherRequests[i]) || MpiFail("MPI_Iallgatherv");
+        }
+
+        MPI_Wait(&headerRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        for (size_t k = 0; k < numProc; ++k)
+        {
+            if (k != myRank)
+                headerCPU->Aggregate((DistGradHeader*) &m_gatheredHeaders[k * headerSize], true);
+        }
+
+        // Unquantize the aggregated gradients as they arrive
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            MPI_Wait(&allGatherRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            m_quantizer->UnquantizeAsync(*m_aggregatedGradients[i], *gradients[i], false);
+        }
+        m_quantizer->WaitUnquantizeAsyncDone();
+
+        if (!sendRequests.empty())
+            MPI_Waitall((int) sendRequests.size(), sendRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
+            fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+        }
+
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    // first column of the stripe owned by node 'rank'
+    size_t StripeStartColumn(size_t numCols, size_t rank)
+    {
+        return numCols * rank / NumProc();
+    }
+
+    void ResetState(const std::vector<Matrix<ElemType>*>& gradients, bool resetState)
+    {
+        // When called the first time let's setup the quantization buffers and residuals
+        if (!m_initialized)
+        {
+            m_initialized = true;
+            if (gradients[0]->GetDeviceId() != CPUDEVICE)
+                RuntimeError("Quantized gradient aggregation is currently only supported for gradients on the CPU.");
+
+            m_quantizer.reset(MatrixQuantizerImpl<ElemType>::Create(CPUDEVICE, false /*useAsync*/));
+
+            size_t numProc = NumProc();
+            size_t myRank = MyRank();
+            m_stripeBytes.resize(gradients.size());
+            m_stripeOffsets.resize(gradients.size());
+            m_recvStripes.resize(gradients.size());
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+                if (gradients[i]->GetMatrixType() != DENSE)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+                size_t numRows = gradients[i]->GetNumRows();
+                size_t numCols = gradients[i]->GetNumCols();
+                size_t quantizedColSize = QuantizedColumn<ElemType>::QuantizedColumnSize(m_numGradientBits, numRows);
+                for (size_t k = 0; k < numProc; k++)
+                {
+                    size_t startCol = StripeStartColumn(numCols, k);
+                    size_t endCol = StripeStartColumn(numCols, k + 1);
+                    if (quantizedColSize * endCol > INT_MAX)
+                        RuntimeError("Quantized gradient aggregation: gradient matrix %d x %d is too large.", (int) numRows, (int) numCols);
+
+                    m_stripeOffsets[i].push_back((int) (quantizedColSize * startCol));
+                    m_stripeBytes[i].push_back((int) (quantizedColSize * (endCol - startCol)));
+                }
+
+                m_residuals.push_back(std::make_unique<Matrix<ElemType>>(numRows, numCols, CPUDEVICE));
+                m_residuals.back()->SetValue(0);
+                m_quantizedGradients.push_back(std::make_unique<QuantizedMatrix<ElemType>>(numRows, numCols, m_numGradientBits, CPUDEVICE));
+                m_aggregatedGradients.push_back(std::make_unique<QuantizedMatrix<ElemType>>(numRows, numCols, m_numGradientBits, CPUDEVICE));
+
+                size_t stripeNumCols = StripeStartColumn(numCols, myRank + 1) - StripeStartColumn(numCols, myRank);
+                m_stripeResiduals.push_back(std::make_unique<Matrix<ElemType>>(numRows, stripeNumCols, CPUDEVICE));
+                m_stripeResiduals.back()->SetValue(0);
+                for (size_t k = 0; k < numProc; k++)
+                    m_recvStripes[i].push_back(k == myRank ? nullptr : std::make_unique<QuantizedMatrix<ElemType>>(numRows, stripeNumCols, m_numGradientBits, CPUDEVICE));
+            }
+
+            if (m_traceLevel > 0)
+                fprintf(stderr, "QuantizedDistGradAggregator: %d-bit aggregation of %d gradient matrices across %d nodes.\n", m_numGradientBits, (int) gradients.size(), (int) numProc);
+        }
+        else if (resetState)
+        {
+            // Discard the accumulated quantization error
+            for (size_t i = 0; i < m_residuals.size(); i++)
+            {
+                m_residuals[i]->SetValue(0);
+                m_stripeResiduals[i]->SetValue(0);
+            }
+        }
+    }
+
+private:
+    int m_numGradientBits;
+    bool m_zeroThresholdFor1Bit;
+
+    std::unique_ptr<MatrixQuantizerImpl<ElemType>> m_quantizer;
+
+    // quantization error of the local gradients and of the aggregated stripe owned by this node
+    std::vector<std::unique_ptr<Matrix<ElemType>>> m_residuals;
+    std::vector<std::unique_ptr<Matrix<ElemType>>> m_stripeResiduals;
+
+    // quantized local gradients, i.e. the source of the reduce-scatter
+    std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>> m_quantizedGradients;
+
+    // quantized parts of the own stripe received from the other nodes, indexed by gradient and source node
+    std::vector<std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>>> m_recvStripes;
+
+    // quantized aggregated gradients, i.e. the target of the all-gather
+    std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>> m_aggregatedGradients;
+
+    // size and offset in bytes of the quantized stripes of all nodes, per gradient
+    std::vector<std::vector<int>> m_stripeBytes;
+    std::vector<std::vector<int>> m_stripeOffsets;
+
+    std::vector<char> m_gatheredHeaders;
+
+    int m_traceLevel;
+    int m_syncStatsTrace;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+
+    bool m_initialized;
+};
+} } }
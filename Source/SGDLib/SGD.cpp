@@ -32,6 +32,7 @@
 
 #include "SimpleDistGradAggregator.h"
 #include "V2SimpleDistGradAggregator.h"
+#include "QuantizedDistGradAggregator.h"
 #include "ProgressTracing.h"
 #include "PerformanceProfiler.h"
 
@@ -424,6 +425,14 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         m_pASGDHelper->InitModel(learnableNodes);
     }
 
+    if (!m_metricsFile.empty() && !m_metricsWriter)
+    {
+        wstring metricsFile = m_metricsFile;
+        if (m_mpi != nullptr && m_mpi->NumNodesInUse() > 1)
+            metricsFile += msra::strfun::wstrprintf(L".rank%d", (int) m_mpi->CurrentNodeRank());
+        m_metricsWriter = make_shared<TrainingMetricsWriter>(metricsFile, m_metricsIntervalSeconds, net->GetDeviceId());
+    }
+
     // --- MAIN EPOCH LOOP
     for (int i = startEpoch; i < (int) m_maxEpochs; i++) // TODO: why is this an int, and not a size_t?
     {
@@ -558,6 +567,14 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                       i + 1, learnRatePerSample, MomentumPerMB(momentumPerSample, actualMinibatchSize), momentumAsTimeConstant);
         }
 
+        if (m_nodeProfileTopN > 0)
+        {
+            net->GetNodeProfiler().Clear();
+            net->GetNodeProfiler().Enable(true);
+        }
+        if (m_metricsWriter)
+            m_metricsWriter->StartEpoch(i);
+
         EpochCriterion epochCriterion; // criterion values are returned in this
         std::vector<EpochCriterion> epochEvalErrors(evaluationNodes.size());
         TrainOneEpoch(net,
@@ -576,6 +593,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                       learnableNodes, smoothedGradients, smoothedCounts,
                       epochCriterion, epochEvalErrors);
         totalTrainingSamplesSeen += epochCriterion.second; // aggregate #training samples, for logging purposes only
+        if (m_metricsWriter)
+            m_metricsWriter->EndEpoch();
 
         timer.Stop();
         double epochTime = timer.ElapsedSeconds();
@@ -592,6 +611,18 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         for (size_t j = 0; j < epochEvalErrors.size(); j++)
             epochEvalErrors[j].LogCriterion(evaluationNodes[j]->NodeName());
         fprintf(stderr, "totalSamplesSeen = %d; learningRatePerSample = %.8g; epochTime=%.6gs\n", (int)totalTrainingSamplesSeen, learnRatePerSample, epochTime);
+
+        // per-node profile of this epoch's training (not of the validation below)
+        if (m_nodeProfileTopN > 0)
+        {
+            net->GetNodeProfiler().Enable(false);
+            net->GetNodeProfiler().PrintTopNodes(stderr, m_nodeProfileTopN);
+            wstring tracePath = msra::strfun::wstrprintf(L"%ls.nodeProfile.%d", m_modelPath.c_str(), i + 1);
+            if (m_mpi != nullptr)
+                tracePath += msra::strfun::wstrprintf(L".rank%d", (int) m_mpi->CurrentNodeRank());
+            net->GetNodeProfiler().WriteChromeTrace(tracePath + L".json");
+            LOGPRINTF(stderr, "Node profile timeline written to %ls.json\n", tracePath.c_str());
+        }
 #if 0
         // TODO: This was only printed if >1 eval criterion. Why? Needed?
         LOGPRINTF(stderr, "Finished Epoch[%2d of %d]:     Criterion Node [%ls] Per Sample = %.8g\n",
@@ -1049,6 +1080,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         }
 
         ProfilerTimeEnd(profGetMinibatch, profilerEvtMainGetMinibatch);
+        if (m_metricsWriter)
+            m_metricsWriter->EndStage(TrainingMetricsWriter::stageReaderWait, profGetMinibatch);
         auto profForwardBackward = ProfilerTimeBegin();
 
         nSamplesSinceLastModelSync += actualMBSize;
@@ -1136,6 +1169,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         }
 
         ProfilerTimeEnd(profForwardBackward, profilerEvtMainFB);
+        if (m_metricsWriter)
+            m_metricsWriter->EndStage(TrainingMetricsWriter::stageForwardBackward, profForwardBackward);
         auto profGradientAgg = ProfilerTimeBegin();
 
         // for momentum/clipping/regularization/etc., as well as for progress and statistics, we should only count frames that are not gaps
@@ -1227,6 +1262,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         }
 
         ProfilerTimeEnd(profGradientAgg, profilerEvtMainGradient);
+        if (m_metricsWriter)
+            m_metricsWriter->EndStage(TrainingMetricsWriter::stageGradientAggregation, profGradientAgg);
         auto profWeights = ProfilerTimeBegin();
 
         // update model parameters
@@ -1311,6 +1348,8 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
 
         ProfilerTimeEnd(profWeights, profilerEvtMainWeights);
+        if (m_metricsWriter)
+            m_metricsWriter->EndStage(TrainingMetricsWriter::stageWeightUpdate, profWeights);
         auto profPost = ProfilerTimeBegin();
 
         timer.Stop();
@@ -1439,6 +1478,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
         ProfilerTimeEnd(profPost, profilerEvtMainPost);
         ProfilerTimeEnd(profMinibatch, profilerEvtMainMinibatch);
+        if (m_metricsWriter)
+        {
+            m_metricsWriter->EndStage(TrainingMetricsWriter::stageOther, profPost);
+            m_metricsWriter->EndMinibatch(profMinibatch, aggregateNumSamplesWithLabel);
+        }
     }
 
     // --- END MAIN MINIBATCH LOOP
@@ -2090,7 +2134,9 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
         else
             m_distGradAgg = std::make_shared<AllReduceDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, m_bufferedAsyncGradientAggregation, traceLevel, m_syncStatsTrace);
 #else
-        RuntimeError("Gradient quantization is unsupported in CNTK binaries built without quantized gradient aggregation support!");
+        if (m_bufferedAsyncGradientAggregation)
+            fprintf(stderr, "WARNING: useBufferedAsyncGradientAggregation is not supported with quantized gradient aggregation, gradients are aggregated synchronously.\n");
+        m_distGradAgg = std::make_shared<QuantizedDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, traceLevel, m_syncStatsTrace);
 #endif // !CNTK_PARALLEL_TRAINING_SUPPORT
     }
     else
@@ -2115,12 +2161,18 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
     }
     if (GetParallelizationMethod() == ParallelizationMethod::modelAveragingSGD)
     {
-        m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        if (m_asyncModelAveraging)
+            m_pMASGDHelper = make_shared<AsyncModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        else
+            m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
     }
     else if (GetParallelizationMethod() == ParallelizationMethod::blockMomentumSGD)
     {
 #ifndef CNTK_PARALLEL_TRAINING_SUPPORT
-        RuntimeError("Block Momentum is not supported in the main CNTK repo. You need to enable 1bit submodule.");
+        m_pMASGDHelper = make_shared<BasicBlockMomentumSGD<ElemType>>(m_mpi, traceLevel, devID,
+                                                                      m_useNesterovBlockMomentum, m_resetSGDMomentum,
+                                                                      m_blockLearningRate, m_blockMomentumAsTimeConstant,
+                                                                      m_modelAggregationBlockSize);
 #else
         if (Globals::UseV2Aggregator())
         {
@@ -2736,6 +2788,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numMBsToShowResult = configSGD(L"numMBsToShowResult", (size_t)10);
     m_firstMBsToShowResult = configSGD(L"firstMBsToShowResult", (size_t)0);
     m_numMBsToCUDAProfile = configSGD(L"numMBsToCUDAProfile", (size_t)0);
+    m_nodeProfileTopN = configSGD(L"nodeProfileTopN", (size_t)0);
+    m_metricsFile = (const wstring&) configSGD(L"metricsFile", L"");
+    m_metricsIntervalSeconds = configSGD(L"metricsIntervalSeconds", 10.0);
 
     m_gradientClippingWithTruncation = configSGD(L"gradientClippingWithTruncation", true);
     m_clippingThresholdPerSample = configSGD(L"clippingThresholdPerSample", numeric_limits<double>::infinity());
@@ -2896,6 +2951,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
+    m_asyncModelAveraging = false;
 
     if (configSGD.Exists(L"ParallelTrain"))
     {
@@ -2964,12 +3020,10 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                 fprintf(stderr, "WARNING: option syncPeroid in ModelAveragingSGD is going to be deprecated. Please use blockSizePerWorker instead in the future.\n");
             }
 #endif
+            m_asyncModelAveraging = configMASGD(L"asyncModelAveraging", false);
         }
         if (configParallelTrain.Exists(L"BlockMomentumSGD"))
         {
-#ifndef CNTK_PARALLEL_TRAINING_SUPPORT
-            InvalidArgument("BlockMomentumSGD is not enabled in this version.\n");
-#else
             const ConfigRecordType& configBMSGD(configParallelTrain(L"BlockMomentumSGD", ConfigRecordType::Record()));
             if (configBMSGD.Exists(L"blockSize") && configBMSGD.Exists(L"blockSizePerWorker"))
                 InvalidArgument("It is only allowed to set blockSizePerWorker or blockSize, not both of them");
@@ -3008,15 +3062,14 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             else if (configBMSGD.Exists(L"blockMomentumPerSync"))
             {
                 double blockMomentum = configBMSGD(L"blockMomentumPerSync");
-                m_blockMomentumAsTimeConstant = BlockMomentumSGD<double>::Momentum2TimeConstant(blockMomentum, m_modelAggregationBlockSize);
+                m_blockMomentumAsTimeConstant = BasicBlockMomentumSGD<double>::Momentum2TimeConstant(blockMomentum, m_modelAggregationBlockSize);
             }
 #endif 
             else /*if (!configBMSGD.Exists(L"blockMomentumPerSync") && !configBMSGD.Exists(L"blockMomentumAsTimeConstant"))*/
             {
                 double blockMomentum = 1.0 - 1.0 / (double)numMPIWorkers;   // this is a default value which ensures each block update contributes equally
-                m_blockMomentumAsTimeConstant = BlockMomentumSGD<double>::Momentum2TimeConstant(blockMomentum, m_modelAggregationBlockSize);
+                m_blockMomentumAsTimeConstant = BasicBlockMomentumSGD<double>::Momentum2TimeConstant(blockMomentum, m_modelAggregationBlockSize);
             }
-#endif 
         }
 
         if (configParallelTrain.Exists(L"DataParallelASGD"))
@@ -3060,10 +3113,9 @@ SGDParams::SGDParams(const ScriptableObjects::IConfigRecordPtr configp)
 
 void SGDParams::InitializeAndCheckBlockMomentumSGDParameters()
 {
-#ifdef CNTK_PARALLEL_TRAINING_SUPPORT 
     // final argument checking in case of user specifying a bad parameter
     size_t numMPIWorker = MPIWrapper::GetInstance()->NumNodesInUse();
-    double blockMomentum = BlockMomentumSGD<double>::TimeConstant2Momentum(m_blockMomentumAsTimeConstant, m_modelAggregationBlockSize);
+    double blockMomentum = BasicBlockMomentumSGD<double>::TimeConstant2Momentum(m_blockMomentumAsTimeConstant, m_modelAggregationBlockSize);
     if ((1 - blockMomentum)*m_blockLearningRate*numMPIWorker >= 2.0)
     {
         fprintf(stderr, "WARNING: (1-blockMomentumPerSync)*blockLearningRate is larger than 2*numWorkers; it is possible to overshoot.");
@@ -3072,11 +3124,6 @@ void SGDParams::InitializeAndCheckBlockMomentumSGDParameters()
     {
         fprintf(stderr, "WARNING: blockMomentum equals to zero. \n");
     }
-#else
-    // don't need do anything here 
-    m_blockMomentumAsTimeConstant = 0.0;
-    m_blockLearningRate = 1.0;
-#endif 
 }
 
 // register SGD<> with the ScriptableObject system
@@ -18,6 +18,7 @@
 #include <chrono>
 #include <random>
 #include "Profiler.h"
+#include "TrainingMetrics.h"
 #include "MASGD.h"
 #include "ASGDHelper.h"
 using namespace std; // ugh! TODO: get rid of this from .h files!!!
@@ -241,6 +242,9 @@ protected:
     size_t m_numMBsToShowResult = 0;
     size_t m_firstMBsToShowResult = 0;
     int m_numMBsToCUDAProfile;
+    size_t m_nodeProfileTopN; // > 0: time every node and report the top N nodes plus a Chrome trace per epoch
+    std::wstring m_metricsFile; // if not empty, training metrics are appended to this file (see TrainingMetricsWriter)
+    double m_metricsIntervalSeconds;
 
     bool m_doGradientCheck;
     double m_gradientCheckSigDigit;
@@ -276,6 +280,7 @@ protected:
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
+    bool   m_asyncModelAveraging;
     bool   m_resetSGDMomentum; 
     bool   m_useNesterovBlockMomentum;
     double m_blockLearningRate; 
@@ -573,6 +578,8 @@ private:
     void MarkDropoutNodesEvalTimeStampAsOutdated(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode);
     std::shared_ptr<ASGDHelper<ElemType>> m_pASGDHelper;
 
+    std::shared_ptr<TrainingMetricsWriter> m_metricsWriter; // (null unless m_metricsFile is given)
+
     bool UsingGradientAggregation(size_t epochNumber) const
     {
         return ((GetParallelizationMethod() == ParallelizationMethod::dataParallelSGD) && (epochNumber >= m_parallelizationStartEpochNum));
@@ -15,9 +15,12 @@
 #include <string>
 #include <stdexcept>
 #include <fstream>
+#include <sstream>
 #include <cstdio>
+#include <future>
 #include "ProgressTracing.h"
 #include "ComputationNetworkBuilder.h"
+#include "MPIWrapper.h"
 
 using namespace std;
 
@@ -30,8 +33,11 @@ class SimpleOutputWriter
     typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
 
 public:
-    SimpleOutputWriter(ComputationNetworkPtr net, int verbosity = 0)
-        : m_net(net), m_verbosity(verbosity)
+    // With 'mpi' and 'enableDistributedMBReading', WriteOutput() to an outputPath reads a separate partition of the data on each worker.
+    // Each worker writes its outputs to its own files (suffix .rank<r>). With 'mergeDistributedOutput', binary outputs are then merged
+    // into one file per node by the main worker, in the order in which the reader has dealt out the sequences (see MergeBinaryShards()).
+    SimpleOutputWriter(ComputationNetworkPtr net, int verbosity = 0, const MPIWrapperPtr& mpi = nullptr, bool enableDistributedMBReading = false, bool mergeDistributedOutput = false)
+        : m_net(net), m_verbosity(verbosity), m_mpi(mpi), m_enableDistributedMBReading(enableDistributedMBReading), m_mergeDistributedOutput(mergeDistributedOutput)
     {
     }
 
@@ -115,19 +121,84 @@ public:
         dataWriter.SaveData(0, outputMatrices, 1, 1, 0);
     }
 
-    void WriteMinibatch(FILE* f, ComputationNodePtr node, 
-        const WriteFormattingOptions & formattingOptions, char formatChar, std::string valueFormatString, std::vector<std::string>& labelMapping,
-        size_t numMBsRun, bool gradient)
+    // copy of a node's minibatch in CPU memory, so that it can be written while the next minibatch is computed
+    struct MinibatchSnapshot
+    {
+        ComputationNodePtr node;
+        std::shared_ptr<ElemType> data; // (array)
+        size_t numRows;
+        size_t numCols;
+        TensorShape sampleLayout;
+        MBLayoutPtr pMBLayout;          // (a copy, as the network's is reused by the next minibatch)
+    };
+
+    static MinibatchSnapshot TakeSnapshot(ComputationNodePtr node, bool gradient)
     {
-        const auto sequenceSeparator = formattingOptions.Processed(node->NodeName(), formattingOptions.sequenceSeparator, numMBsRun);
-        const auto sequencePrologue =  formattingOptions.Processed(node->NodeName(), formattingOptions.sequencePrologue,  numMBsRun);
-        const auto sequenceEpilogue =  formattingOptions.Processed(node->NodeName(), formattingOptions.sequenceEpilogue,  numMBsRun);
-        const auto elementSeparator =  formattingOptions.Processed(node->NodeName(), formattingOptions.elementSeparator,  numMBsRun);
-        const auto sampleSeparator =   formattingOptions.Processed(node->NodeName(), formattingOptions.sampleSeparator,   numMBsRun);
+        const Matrix<ElemType>& matrix = gradient ? node->Gradient() : node->Value();
+        MinibatchSnapshot snapshot;
+        snapshot.node = node;
+        snapshot.data = std::shared_ptr<ElemType>(matrix.CopyToArray(), [](ElemType* p) { delete[] p; });
+        snapshot.numRows = matrix.GetNumRows();
+        snapshot.numCols = matrix.GetNumCols();
+        snapshot.sampleLayout = static_pointer_cast<ComputationNodeBase>(node)->GetSampleLayout();
+        if (node->HasMBLayout())
+        {
+            snapshot.pMBLayout = make_shared<MBLayout>();
+            snapshot.pMBLayout->CopyFrom(node->GetMBLayout());
+        }
+        return snapshot;
+    }
 
-        node->WriteMinibatchWithFormatting(f, FrameRange(), SIZE_MAX, SIZE_MAX, formattingOptions.transpose, formattingOptions.isCategoryLabel, formattingOptions.isSparse, labelMapping,
+    void WriteMinibatch(FILE* f, const MinibatchSnapshot& snapshot, 
+        const WriteFormattingOptions & formattingOptions, char formatChar, std::string valueFormatString, std::vector<std::string>& labelMapping,
+        size_t numMBsRun)
+    {
+        const auto& nodeName = snapshot.node->NodeName();
+        const auto sequenceSeparator = formattingOptions.Processed(nodeName, formattingOptions.sequenceSeparator, numMBsRun);
+        const auto sequencePrologue =  formattingOptions.Processed(nodeName, formattingOptions.sequencePrologue,  numMBsRun);
+        const auto sequenceEpilogue =  formattingOptions.Processed(nodeName, formattingOptions.sequenceEpilogue,  numMBsRun);
+        const auto elementSeparator =  formattingOptions.Processed(nodeName, formattingOptions.elementSeparator,  numMBsRun);
+        const auto sampleSeparator =   formattingOptions.Processed(nodeName, formattingOptions.sampleSeparator,   numMBsRun);
+
+        ComputationNode<ElemType>::WriteMinibatchWithFormatting(f, snapshot.data.get(), snapshot.numRows, snapshot.numCols, snapshot.sampleLayout, snapshot.pMBLayout,
+            FrameRange(), SIZE_MAX, SIZE_MAX, formattingOptions.transpose, formattingOptions.isCategoryLabel, formattingOptions.isSparse, labelMapping,
             sequenceSeparator, sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator,
-            valueFormatString, gradient);
+            valueFormatString);
+    }
+
+    // binary format: the data file holds the samples of all sequences back to back, as float32 column vectors;
+    // the index file is text, with a header line "float32 <sample dims>" and one line "<seqId> <first sample> <number of samples>" per sequence
+    void WriteMinibatchBinary(FILE* dataFile, FILE* indexFile, const MinibatchSnapshot& snapshot, size_t& numSamplesWritten)
+    {
+        MBLayoutPtr pMBLayout = snapshot.pMBLayout;
+        if (!pMBLayout) // no MBLayout: treat the columns as a single sequence
+        {
+            pMBLayout = make_shared<MBLayout>();
+            pMBLayout->Init(1, snapshot.numCols);
+            pMBLayout->AddSequence(0, 0, 0, snapshot.numCols);
+        }
+
+        const size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        const ptrdiff_t width = (ptrdiff_t)pMBLayout->GetNumTimeSteps();
+        std::vector<float> sample(snapshot.numRows);
+        for (const auto& seqInfo : pMBLayout->GetAllSequences())
+        {
+            if (seqInfo.seqId == GAP_SEQUENCE_ID)
+                continue;
+            const ptrdiff_t tBegin = max(seqInfo.tBegin, (ptrdiff_t)0);
+            const ptrdiff_t tEnd = min((ptrdiff_t)seqInfo.tEnd, width);
+            if (tBegin >= tEnd)
+                continue;
+
+            fprintfOrDie(indexFile, "%lu %lu %lu\n", (unsigned long)seqInfo.seqId, (unsigned long)numSamplesWritten, (unsigned long)(tEnd - tBegin));
+            for (ptrdiff_t t = tBegin; t < tEnd; t++)
+            {
+                const ElemType* column = snapshot.data.get() + (t * numParallelSequences + seqInfo.s) * snapshot.numRows;
+                std::copy(column, column + snapshot.numRows, sample.begin());
+                fwriteOrDie(sample.data(), sizeof(float), sample.size(), dataFile);
+            }
+            numSamplesWritten += tEnd - tBegin;
+        }
     }
 
     void InsertNode(std::vector<ComputationNodeBasePtr>& allNodes, ComputationNodeBasePtr parent, ComputationNodeBasePtr newNode)
@@ -199,29 +270,61 @@ public:
         if ((formattingOptions.isCategoryLabel || formattingOptions.isSparse) && !formattingOptions.labelMappingFile.empty())
             File::LoadLabelFile(formattingOptions.labelMappingFile, labelMapping);
 
+        if (formattingOptions.isBinary && outputPath == L"-")
+            InvalidArgument("write: Binary output cannot be written to stdout.");
+
+        const bool useDistributedMBReading = m_mpi && m_enableDistributedMBReading && m_mpi->NumNodesInUse() > 1 && dataReader.SupportsDistributedMBRead();
+        if (useDistributedMBReading && outputPath == L"-")
+            InvalidArgument("write: Output of distributed reading cannot be written to stdout.");
+        const bool mergeOutput = useDistributedMBReading && m_mergeDistributedOutput;
+        if (mergeOutput && !formattingOptions.isBinary)
+            InvalidArgument("write: mergeDistributedOutput requires binary output. Text outputs of distributed reading are kept as one file per worker.");
+        if (mergeOutput && dataReader.IsLegacyReader())
+            InvalidArgument("write: mergeDistributedOutput is not supported with legacy readers, which do not deal out the sequences to the workers one by one.");
+
         // open output files
         File::MakeIntermediateDirs(outputPath);
         std::map<ComputationNodeBasePtr, shared_ptr<File>> outputStreams; // TODO: why does unique_ptr not work here? Complains about non-existent default_delete()
+        std::map<ComputationNodeBasePtr, shared_ptr<File>> indexStreams;  // for binary output
+        std::map<ComputationNodeBasePtr, size_t> numSamplesWritten;       // for binary output
         for (auto & onode : allOutputNodes)
         {
             std::wstring nodeOutputPath = outputPath;
             if (nodeOutputPath != L"-")
                 nodeOutputPath += L"." + onode->NodeName();
-            auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsText);
-            outputStreams[onode] = f;
+            if (useDistributedMBReading)
+                nodeOutputPath = ShardPath(nodeOutputPath, m_mpi->CurrentNodeRank());
+            if (formattingOptions.isBinary)
+            {
+                outputStreams[onode] = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsBinary);
+                indexStreams[onode] = make_shared<File>(nodeOutputPath + L".idx", fileOptionsWrite | fileOptionsText);
+                FILE* indexFile = *indexStreams[onode];
+                fprintfOrDie(indexFile, "float32");
+                for (auto dim : onode->GetSampleLayout().GetDims())
+                    fprintfOrDie(indexFile, " %lu", (unsigned long)dim);
+                fprintfOrDie(indexFile, "\n");
+            }
+            else
+                outputStreams[onode] = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsText);
         }
 
         // evaluate with minibatches
-        dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        if (useDistributedMBReading)
+            dataReader.StartDistributedMinibatchLoop(mbSize, 0, m_mpi->CurrentNodeRank(), m_mpi->NumNodesInUse(), inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        else
+            dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
 
         m_net->StartEvaluateMinibatchLoop(outputNodes);
 
         size_t totalEpochSamples = 0;
 
-        for (auto & onode : outputNodes)
+        if (!formattingOptions.isBinary)
         {
-            FILE* f = *outputStreams[onode];
-            fprintfOrDie(f, "%s", formattingOptions.prologue.c_str());
+            for (auto & onode : outputNodes)
+            {
+                FILE* f = *outputStreams[onode];
+                fprintfOrDie(f, "%s", formattingOptions.prologue.c_str());
+            }
         }
 
         size_t actualMBSize;
@@ -230,18 +333,50 @@ public:
         char formatChar = !formattingOptions.isCategoryLabel ? 'f' : !formattingOptions.labelMappingFile.empty() ? 's' : 'u';
         std::string valueFormatString = "%" + formattingOptions.precisionFormat + formatChar; // format string used in fprintf() for formatting the values
 
-        for (size_t numMBsRun = 0; DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, false, false, inputMatrices, actualMBSize, nullptr); numMBsRun++)
+        // Writing is done on a background thread from copies of the outputs, while the main thread computes the next minibatch.
+        // At most one minibatch is pending, which keeps the output in order and bounds the memory used for the copies.
+        std::future<void> pendingWrite;
+        auto writeSnapshots = [&](const std::vector<MinibatchSnapshot>& snapshots, size_t numMBsRun)
         {
+            for (const auto& snapshot : snapshots)
+            {
+                FILE* file = *outputStreams[snapshot.node];
+                if (formattingOptions.isBinary)
+                    WriteMinibatchBinary(file, *indexStreams[snapshot.node], snapshot, numSamplesWritten[snapshot.node]);
+                else
+                    WriteMinibatch(file, snapshot, formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun);
+            }
+            if (outputPath == L"-") // if we mush all nodes together on stdout, add some visual separator
+                fprintf(stdout, "\n");
+        };
+
+        for (size_t numMBsRun = 0;; numMBsRun++)
+        {
+            bool wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, useDistributedMBReading, useDistributedMBReading, inputMatrices, actualMBSize, m_mpi);
+            if (useDistributedMBReading)
+            {
+                // with distributed reading, a worker may receive no data for a minibatch while the others still do,
+                // so we only stop once none of the workers has read anything
+                size_t numWorkersWithData = wasDataRead ? 1 : 0;
+                m_mpi->AllReduce(&numWorkersWithData, 1);
+                if (numWorkersWithData == 0)
+                    break;
+            }
+            else if (!wasDataRead)
+                break;
+            if (!wasDataRead || actualMBSize == 0)
+                continue;
+
             ComputationNetwork::BumpEvalTimeStamp(inputNodes);
             m_net->ForwardProp(outputNodes);
 
+            std::vector<MinibatchSnapshot> snapshots;
             for (auto & onode : outputNodes)
             {
                 // compute the node value
                 // Note: Intermediate values are memoized, so in case of multiple output nodes, we only compute what has not been computed already.
 
-                FILE* file = *outputStreams[onode];
-                WriteMinibatch(file, dynamic_pointer_cast<ComputationNode<ElemType>>(onode), formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ false);
+                snapshots.push_back(TakeSnapshot(dynamic_pointer_cast<ComputationNode<ElemType>>(onode), /* gradient */ false));
 
                 if (nodeUnitTest)
                     m_net->Backprop(onode);
@@ -251,22 +386,24 @@ public:
             {
                 for (auto & node : gradientNodes)
                 {
-                    FILE* file = *outputStreams[node];
                     if (!node->GradientPtr())
                     {
                         fprintf(stderr, "Warning: Gradient of node '%s' is empty. Not used in backward pass?", msra::strfun::utf8(node->NodeName().c_str()).c_str());
                     }
                     else
                     {
-                        WriteMinibatch(file, node, formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ true);
+                        snapshots.push_back(TakeSnapshot(node, /* gradient */ true));
                     }
                 }
             }
+
+            if (pendingWrite.valid())
+                pendingWrite.get(); // (rethrows errors from writing)
+            pendingWrite = std::async(std::launch::async, [&writeSnapshots, snapshots, numMBsRun]() { writeSnapshots(snapshots, numMBsRun); });
+
             totalEpochSamples += actualMBSize;
 
             fprintf(stderr, "Minibatch[%lu]: ActualMBSize = %lu\n", (unsigned long)numMBsRun, (unsigned long)actualMBSize);
-            if (outputPath == L"-") // if we mush all nodes together on stdout, add some visual separator
-                fprintf(stdout, "\n");
 
             numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
 
@@ -275,10 +412,16 @@ public:
             dataReader.DataEnd();
         } // end loop over minibatches
 
-        for (auto & stream : outputStreams)
+        if (pendingWrite.valid())
+            pendingWrite.get();
+
+        if (!formattingOptions.isBinary)
         {
-            FILE* f = *stream.second;
-            fprintfOrDie(f, "%s", formattingOptions.epilogue.c_str());
+            for (auto & stream : outputStreams)
+            {
+                FILE* f = *stream.second;
+                fprintfOrDie(f, "%s", formattingOptions.epilogue.c_str());
+            }
         }
 
         fprintf(stderr, "Written to %ls*\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), (unsigned long)totalEpochSamples);
@@ -286,11 +429,117 @@ public:
         // flush all files (where we can catch errors) so that we can then destruct the handle cleanly without error
         for (auto & iter : outputStreams)
             iter.second->Flush();
+        for (auto & iter : indexStreams)
+            iter.second->Flush();
+
+        if (mergeOutput)
+        {
+            // close the shards, wait for all workers to have written theirs, and let the main worker merge them
+            outputStreams.clear();
+            indexStreams.clear();
+            m_mpi->WaitAll();
+            if (m_mpi->IsMainNode())
+            {
+                for (auto & onode : allOutputNodes)
+                {
+                    std::wstring nodeOutputPath = outputPath + L"." + onode->NodeName();
+                    std::vector<std::wstring> shardPaths;
+                    for (size_t rank = 0; rank < m_mpi->NumNodesInUse(); rank++)
+                        shardPaths.push_back(ShardPath(nodeOutputPath, rank));
+                    MergeBinaryShards(nodeOutputPath, shardPaths);
+                    for (const auto& shardPath : shardPaths)
+                    {
+                        unlinkOrDie(shardPath);
+                        unlinkOrDie(shardPath + L".idx");
+                    }
+                }
+                fprintf(stderr, "Merged the outputs of %d workers into %ls*\n", (int)m_mpi->NumNodesInUse(), outputPath.c_str());
+            }
+            m_mpi->WaitAll();
+        }
+    }
+
+    // merge the binary outputs of several workers (data file and .idx file each, see WriteMinibatchBinary()) into one
+    // Readers without randomization deal out the sequences to the workers one by one (sequence i goes to worker i % #workers),
+    // so taking the sequences from the shards in turn restores the order of the data, and the result is identical to what a
+    // single worker would have written, except for the seqIds in the index, which number the sequences within a minibatch.
+    static void MergeBinaryShards(const std::wstring& path, const std::vector<std::wstring>& shardPaths)
+    {
+        struct Sequence
+        {
+            unsigned long seqId, firstSample, numSamples;
+        };
+        std::vector<std::vector<Sequence>> shardSequences(shardPaths.size());
+        std::string header;
+        size_t sampleSize = sizeof(float); // in bytes
+        for (size_t shard = 0; shard < shardPaths.size(); shard++)
+        {
+            std::wstring indexPath = shardPaths[shard] + L".idx";
+            FILE* shardIndexFile = fopenOrDie(indexPath, L"rt");
+            char line[1024];
+            if (!fgets(line, sizeof(line), shardIndexFile))
+                RuntimeError("write: Missing header in index file %ls.", indexPath.c_str());
+            if (shard == 0)
+            {
+                header = line;
+                std::istringstream dims(header.substr(header.find(' ') + 1));
+                for (size_t dim; dims >> dim;)
+                    sampleSize *= dim;
+            }
+            else if (header != line)
+                RuntimeError("write: Index file %ls has a different header than %ls.idx.", indexPath.c_str(), shardPaths[0].c_str());
+            Sequence sequence;
+            while (fgets(line, sizeof(line), shardIndexFile))
+            {
+                if (sscanf(line, "%lu %lu %lu", &sequence.seqId, &sequence.firstSample, &sequence.numSamples) != 3)
+                    RuntimeError("write: Malformed line in index file %ls: %s", indexPath.c_str(), line);
+                shardSequences[shard].push_back(sequence);
+            }
+            fcloseOrDie(shardIndexFile);
+        }
+
+        FILE* f = fopenOrDie(path, L"wb");
+        FILE* indexFile = fopenOrDie(path + L".idx", L"wt");
+        fprintfOrDie(indexFile, "%s", header.c_str());
+        std::vector<FILE*> shardFiles;
+        for (const auto& shardPath : shardPaths)
+            shardFiles.push_back(fopenOrDie(shardPath, L"rb"));
+        std::vector<char> buffer;
+        size_t numSamples = 0;
+        for (size_t i = 0, numLeft = shardPaths.size(); numLeft > 0; i++) // i = index of the sequence within its shard
+        {
+            numLeft = 0;
+            for (size_t shard = 0; shard < shardPaths.size(); shard++)
+            {
+                if (i >= shardSequences[shard].size())
+                    continue;
+                numLeft++;
+                const auto& sequence = shardSequences[shard][i];
+                buffer.resize(sequence.numSamples * sampleSize);
+                fsetpos(shardFiles[shard], sequence.firstSample * sampleSize);
+                freadOrDie(buffer.data(), 1, buffer.size(), shardFiles[shard]);
+                fwriteOrDie(buffer.data(), 1, buffer.size(), f);
+                fprintfOrDie(indexFile, "%lu %lu %lu\n", sequence.seqId, (unsigned long)numSamples, sequence.numSamples);
+                numSamples += sequence.numSamples;
+            }
+        }
+        for (auto shardFile : shardFiles)
+            fcloseOrDie(shardFile);
+        fcloseOrDie(indexFile);
+        fcloseOrDie(f);
     }
 
 private:
+    static std::wstring ShardPath(const std::wstring& path, size_t rank)
+    {
+        return msra::strfun::wstrprintf(L"%ls.rank%d", path.c_str(), (int)rank);
+    }
+
     ComputationNetworkPtr m_net;
     int m_verbosity;
+    MPIWrapperPtr m_mpi;
+    bool m_enableDistributedMBReading;
+    bool m_mergeDistributedOutput;
     void operator=(const SimpleOutputWriter&); // (not assignable)
 };
 
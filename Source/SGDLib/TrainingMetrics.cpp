@@ -0,0 +1,153 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "TrainingMetrics.h"
+#include "TimerUtility.h"
+#include "fileutil.h"
+#include "BestGpu.h" // for CPUONLY flag only
+#include <algorithm>
+#include <time.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#endif
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// working set of this process and its peak, in MB
+static void GetProcessMemoryMB(size_t& current, size_t& peak)
+{
+    current = peak = 0;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        current = counters.WorkingSetSize >> 20;
+        peak = counters.PeakWorkingSetSize >> 20;
+    }
+#else
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f)
+        return;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long long kB;
+        if (sscanf(line, "VmRSS: %llu kB", &kB) == 1)
+            current = (size_t)(kB >> 10);
+        else if (sscanf(line, "VmHWM: %llu kB", &kB) == 1)
+            peak = (size_t)(kB >> 10);
+    }
+    fclose(f);
+#endif
+}
+
+TrainingMetricsWriter::TrainingMetricsWriter(const wstring& path, double intervalSeconds, DEVICEID_TYPE deviceId)
+    : m_intervalSeconds(intervalSeconds), m_deviceId(deviceId), m_ticksPerSecond((double)Clock::GetTicksPerSecond()), m_epochNumber(0), m_inEpoch(false),
+      m_cpuMemoryMB(0), m_cpuPeakMemoryMB(0), m_gpuMemoryMB(0), m_gpuPeakMemoryMB(0)
+{
+    ResetInterval(Clock::GetTimeStamp());
+    msra::files::make_intermediate_dirs(path);
+    m_file = fopenOrDie(path, L"a");
+}
+
+TrainingMetricsWriter::~TrainingMetricsWriter()
+{
+    EndEpoch();
+    fclose(m_file);
+}
+
+void TrainingMetricsWriter::StartEpoch(int epochNumber)
+{
+    m_epochNumber = epochNumber;
+    m_inEpoch = true;
+    ResetInterval(Clock::GetTimeStamp());
+}
+
+void TrainingMetricsWriter::EndEpoch()
+{
+    if (m_inEpoch && !m_minibatchSeconds.empty())
+        WriteLine(Clock::GetTimeStamp());
+    m_inEpoch = false;
+}
+
+void TrainingMetricsWriter::EndStage(Stage stage, long long beginClock)
+{
+    if (m_inEpoch)
+        m_stageSeconds[stage] += (Clock::GetTimeStamp() - beginClock) / m_ticksPerSecond;
+}
+
+void TrainingMetricsWriter::EndMinibatch(long long beginClock, size_t numSamples)
+{
+    if (!m_inEpoch)
+        return;
+
+    long long now = Clock::GetTimeStamp();
+    m_minibatchSeconds.push_back((now - beginClock) / m_ticksPerSecond);
+    m_numSamples += numSamples;
+    SampleMemory();
+
+    if ((now - m_intervalBeginClock) / m_ticksPerSecond >= m_intervalSeconds)
+        WriteLine(now);
+}
+
+void TrainingMetricsWriter::SampleMemory()
+{
+#ifndef CPUONLY
+    if (m_deviceId >= 0)
+    {
+        auto freeAndTotal = TracingGPUMemoryAllocator::GetFreeAndTotalMemoryInMBs(m_deviceId);
+        m_gpuMemoryMB = freeAndTotal.second - freeAndTotal.first;
+        m_gpuPeakMemoryMB = max(m_gpuPeakMemoryMB, m_gpuMemoryMB);
+    }
+#endif
+}
+
+void TrainingMetricsWriter::WriteLine(long long now)
+{
+    double seconds = (now - m_intervalBeginClock) / m_ticksPerSecond;
+
+    // latency percentiles by rank
+    auto percentile = [this](double p)
+    {
+        size_t rank = min((size_t)(p * m_minibatchSeconds.size()), m_minibatchSeconds.size() - 1);
+        nth_element(m_minibatchSeconds.begin(), m_minibatchSeconds.begin() + rank, m_minibatchSeconds.end());
+        return 1000 * m_minibatchSeconds[rank];
+    };
+    double p50 = percentile(0.5), p90 = percentile(0.9), p99 = percentile(0.99);
+    double maxLatency = 1000 * *max_element(m_minibatchSeconds.begin(), m_minibatchSeconds.end());
+
+    GetProcessMemoryMB(m_cpuMemoryMB, m_cpuPeakMemoryMB);
+
+    fprintfOrDie(m_file, "{\"timestamp\":%lld,\"epoch\":%d,\"minibatches\":%d,\"samples\":%llu,\"seconds\":%.3f,\"samplesPerSecond\":%.1f,",
+                 (long long)time(NULL), m_epochNumber + 1, (int)m_minibatchSeconds.size(), (unsigned long long)m_numSamples, seconds,
+                 seconds > 0 ? m_numSamples / seconds : 0.0);
+    fprintfOrDie(m_file, "\"minibatchLatencyMs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},", p50, p90, p99, maxLatency);
+    fprintfOrDie(m_file, "\"stageSeconds\":{\"readerWait\":%.3f,\"forwardBackward\":%.3f,\"gradientAggregation\":%.3f,\"weightUpdate\":%.3f,\"other\":%.3f},",
+                 m_stageSeconds[stageReaderWait], m_stageSeconds[stageForwardBackward], m_stageSeconds[stageGradientAggregation],
+                 m_stageSeconds[stageWeightUpdate], m_stageSeconds[stageOther]);
+    fprintfOrDie(m_file, "\"memoryMB\":{\"cpu\":{\"current\":%d,\"peak\":%d}", (int)m_cpuMemoryMB, (int)m_cpuPeakMemoryMB);
+    if (m_deviceId >= 0)
+        fprintfOrDie(m_file, ",\"gpu%d\":{\"current\":%d,\"peak\":%d}", (int)m_deviceId, (int)m_gpuMemoryMB, (int)m_gpuPeakMemoryMB);
+    fprintfOrDie(m_file, "}}\n");
+    fflushOrDie(m_file);
+
+    ResetInterval(now);
+}
+
+void TrainingMetricsWriter::ResetInterval(long long now)
+{
+    m_intervalBeginClock = now;
+    m_numSamples = 0;
+    m_minibatchSeconds.clear();
+    fill(m_stageSeconds, m_stageSeconds + numStages, 0.0);
+}
+
+}}}
@@ -0,0 +1,76 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// TrainingMetrics.h -- periodic machine-readable training metrics
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "CommonMatrix.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// TrainingMetricsWriter -- appends a line of JSON to a file every few seconds of training
+//
+// Each line covers the minibatches completed since the previous line:
+//   {"timestamp":1792317050,"epoch":3,"minibatches":120,"samples":30720,"seconds":10.02,"samplesPerSecond":3066.5,
+//    "minibatchLatencyMs":{"p50":80.1,"p90":90.2,"p99":120.3,"max":130.0},
+//    "stageSeconds":{"readerWait":1.2,"forwardBackward":7.0,"gradientAggregation":0.5,"weightUpdate":1.0,"other":0.3},
+//    "memoryMB":{"cpu":{"current":1234,"peak":2345},"gpu0":{"current":3456,"peak":4567}}}
+// The file is flushed after every line, so that it can be followed while training runs.
+// CPU memory is the working set of the process; GPU memory is what is in use on the device
+// (by any process), with the peak taken over the minibatches seen by this writer.
+// -----------------------------------------------------------------------
+
+class TrainingMetricsWriter
+{
+public:
+    enum Stage
+    {
+        stageReaderWait,
+        stageForwardBackward,
+        stageGradientAggregation,
+        stageWeightUpdate,
+        stageOther,
+        numStages
+    };
+
+    TrainingMetricsWriter(const std::wstring& path, double intervalSeconds, DEVICEID_TYPE deviceId);
+    ~TrainingMetricsWriter();
+
+    // minibatches are only counted between StartEpoch() and EndEpoch(); the latter writes out the last partial interval
+    void StartEpoch(int epochNumber);
+    void EndEpoch();
+    // 'beginClock' is a Clock::GetTimeStamp() value (e.g. from ProfilerTimeBegin()); the stage or minibatch ends now
+    void EndStage(Stage stage, long long beginClock);
+    void EndMinibatch(long long beginClock, size_t numSamples);
+
+private:
+    void WriteLine(long long now);
+    void ResetInterval(long long now);
+    void SampleMemory();
+
+    FILE* m_file;
+    double m_intervalSeconds;
+    DEVICEID_TYPE m_deviceId;
+    double m_ticksPerSecond;
+    int m_epochNumber;
+    bool m_inEpoch;
+
+    // since the last line
+    long long m_intervalBeginClock;
+    size_t m_numSamples;
+    std::vector<double> m_minibatchSeconds;
+    double m_stageSeconds[numStages];
+
+    size_t m_cpuMemoryMB, m_cpuPeakMemoryMB;
+    size_t m_gpuMemoryMB, m_gpuPeakMemoryMB;
+};
+
+}}}
@@ -74,8 +74,8 @@ void expdiffj(std::vector<double>& Eframescorrectbuf, double& logEframescorrectt
 }
 // this must be identical to an actual CUDA kernel (except for the input data types: vectorref -> std::vector)
 void edgealignmentj(const std::vector<lrhmmdef>& hmms, const std::vector<lr3transP>& transPs, const size_t spalignunitid, const size_t silalignunitid,
-                    const std::vector<msra::lattices::nodeinfo>& nodes, const std::vector<msra::lattices::edgeinfowithscores>& edges,
-                    const std::vector<msra::lattices::aligninfo>& aligns,
+                    const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes, const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges,
+                    const msra::lattices::mappablevector<msra::lattices::aligninfo>& aligns,
                     const msra::math::ssematrixbase& logLLs, const std::vector<unsigned int>& alignoffsets,
                     std::vector<unsigned short>& backptrstorage, const std::vector<size_t>& backptroffsets,
                     std::vector<unsigned short>& alignresult, std::vector<float>& edgeacscores)
@@ -94,8 +94,8 @@ void edgealignmentj(const std::vector<lrhmmdef>& hmms, const std::vector<lr3tran
 
 void forwardlatticej(const size_t batchsize, const size_t startindex, const std::vector<float>& edgeacscores,
                      const size_t spalignunitid, const size_t silalignunitid,
-                     const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
-                     const std::vector<msra::lattices::aligninfo>& aligns,
+                     const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
+                     const msra::lattices::mappablevector<msra::lattices::aligninfo>& aligns,
                      const std::vector<unsigned short>& alignments, const std::vector<unsigned int>& alignmentoffsets,
                      std::vector<double>& logalphas, float lmf, float wp, float amf, const float boostingfactor,
                      const std::vector<unsigned short>& uids, const std::vector<unsigned short>& senone2classmap, const bool returnEframescorrect,
@@ -112,9 +112,9 @@ void forwardlatticej(const size_t batchsize, const size_t startindex, const std:
 
 void backwardlatticej(const size_t batchsize, const size_t startindex, const std::vector<float>& edgeacscores,
                       const size_t spalignunitid, const size_t silalignunitid,
-                      const std::vector<msra::lattices::edgeinfowithscores>& edges,
-                      const std::vector<msra::lattices::nodeinfo>& nodes,
-                      const std::vector<msra::lattices::aligninfo>& aligns, const double totalfwscore,
+                      const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges,
+                      const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
+                      const msra::lattices::mappablevector<msra::lattices::aligninfo>& aligns, const double totalfwscore,
                       std::vector<double>& logpps, std::vector<double>& logalphas, std::vector<double>& logbetas,
                       float lmf, float wp, float amf, const float boostingfactor, const bool returnEframescorrect, std::vector<double>& logframescorrectedge,
                       std::vector<double>& logaccalphas, std::vector<double>& Eframescorrectbuf, std::vector<double>& logaccbetas)
@@ -132,7 +132,7 @@ void backwardlatticej(const size_t batchsize, const size_t startindex, const std
 }
 
 void sMBRerrorsignalj(const std::vector<unsigned short>& alignstateids, const std::vector<unsigned int>& alignoffsets,
-                      const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
+                      const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
                       const std::vector<double>& logpps, const float amf, const std::vector<double>& logEframescorrect,
                       const double logEframescorrecttotal, msra::math::ssematrixbase& errorsignal, msra::math::ssematrixbase& errorsignalneg)
 {
@@ -146,7 +146,7 @@ void sMBRerrorsignalj(const std::vector<unsigned short>& alignstateids, const st
 }
 
 void stateposteriorsj(const std::vector<unsigned short>& alignstateids, const std::vector<unsigned int>& alignoffsets,
-                      const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
+                      const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
                       const std::vector<double>& logqs, msra::math::ssematrixbase& logacc)
 {
     const size_t shufflemode = 3;
@@ -194,8 +194,8 @@ void weightedcomponentexpproducts(const msra::math::ssematrixbase& loggammas, co
 // this function behaves as its CUDA counterpart, except that it takes CPU-side std::vectors for everything
 // this must be identical to CUDA kernel-launch function in -ops class (except for the input data types: vectorref -> std::vector)
 static void emulateedgealignment(const std::vector<lrhmmdef>& hmms, const std::vector<lr3transP>& transPs, const size_t spalignunitid, const size_t silalignunitid,
-                                 const std::vector<msra::lattices::nodeinfo>& nodes, const std::vector<msra::lattices::edgeinfowithscores>& edges,
-                                 const std::vector<msra::lattices::aligninfo>& aligns,
+                                 const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes, const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges,
+                                 const msra::lattices::mappablevector<msra::lattices::aligninfo>& aligns,
                                  const msra::math::ssematrixbase& logLLs, const std::vector<unsigned int>& alignoffsets,
                                  std::vector<unsigned short>& backptrstorage, const std::vector<size_t>& backptroffsets,
                                  std::vector<unsigned short>& alignresult, std::vector<float>& edgeacscores)
@@ -215,8 +215,8 @@ static double emulateforwardbackwardlattice(const size_t* batchsizeforward, cons
                                             const size_t numlaunchforward, const size_t numlaunchbackward,
                                             const size_t spalignunitid, const size_t silalignunitid,
                                             const std::vector<float>& edgeacscores,
-                                            const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
-                                            const std::vector<msra::lattices::aligninfo>& aligns,
+                                            const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
+                                            const msra::lattices::mappablevector<msra::lattices::aligninfo>& aligns,
                                             const std::vector<unsigned short>& alignments, const std::vector<unsigned int>& alignoffsets,
                                             std::vector<double>& logpps, std::vector<double>& logalphas, std::vector<double>& logbetas,
                                             const float lmf, const float wp, const float amf, const float boostingfactor, const bool returnEframescorrect,
@@ -299,7 +299,7 @@ static double emulateforwardbackwardlattice(const size_t* batchsizeforward, cons
 // this function behaves as its CUDA conterparts, except that it takes CPU-side std::vectors for everything
 // this must be identical to CUDA kernel-launch function in -ops class (except for the input data types: vectorref -> std::vector)
 static void emulatesMBRerrorsignal(const std::vector<unsigned short>& alignstateids, const std::vector<unsigned int>& alignoffsets,
-                                   const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
+                                   const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
                                    const std::vector<double>& logpps, const float amf,
                                    const std::vector<double>& logEframescorrect, const double logEframescorrecttotal,
                                    msra::math::ssematrixbase& errorsignal, msra::math::ssematrixbase& errorsignalneg)
@@ -325,7 +325,7 @@ static void emulatesMBRerrorsignal(const std::vector<unsigned short>& alignstate
 // this function behaves as its CUDA conterparts, except that it takes CPU-side std::vectors for everything
 // this must be identical to CUDA kernel-launch function in -ops class (except for the input data types: vectorref -> std::vector)
 static void emulatemmierrorsignal(const std::vector<unsigned short>& alignstateids, const std::vector<unsigned int>& alignoffsets,
-                                  const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
+                                  const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
                                   const std::vector<double>& logpps, msra::math::ssematrixbase& errorsignal)
 {
     const size_t numedges = edges.size();
@@ -345,7 +345,7 @@ static void emulatemmierrorsignal(const std::vector<unsigned short>& alignstatei
 // this function behaves as its CUDA conterparts, except that it takes CPU-side std::vectors for everything
 // this must be identical to CUDA kernel-launch function in -ops class (except for the input data types: vectorref -> std::vector)
 /*static*/ void emulatestateposteriors(const std::vector<unsigned short>& alignstateids, const std::vector<unsigned int>& alignoffsets,
-                                       const std::vector<msra::lattices::edgeinfowithscores>& edges, const std::vector<msra::lattices::nodeinfo>& nodes,
+                                       const msra::lattices::mappablevector<msra::lattices::edgeinfowithscores>& edges, const msra::lattices::mappablevector<msra::lattices::nodeinfo>& nodes,
                                        const std::vector<double>& logqs, msra::math::ssematrixbase& logacc)
 {
     foreach_coord (i, j, logacc)
@@ -415,5 +415,315 @@ BOOST_AUTO_TEST_CASE(EvalRNNTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalStreamsTest)
+{
+    // running sum over time, so that the output shows whether the state was carried over
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder = [ \n"
+        "i1 = Input(2) \n"
+        "o1 = Plus(i1, PastValue(2, o1, timeStep = 1, defaultHiddenActivity = 0)) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float>* eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    std::vector<Values<float>> inputs(2, Values<float>(1));
+    std::vector<Values<float>> outputs; // moved in, since copies would not keep the reserved capacity
+    for (size_t n = 0; n < 2; n++)
+        outputs.push_back(outputLayouts.CreateBuffers<float>({ 2 }));
+    std::vector<std::vector<float>> states(2);
+
+    // first chunk: two frames for stream 0, one frame for stream 1
+    inputs[0][0].m_buffer = { 1, 2, 3, 4 };
+    inputs[1][0].m_buffer = { 10, 10 };
+    eval->ForwardPassStreams(inputs, states, outputs);
+
+    std::vector<float> expected0{ 1, 2, 4, 6 }, expected1{ 10, 10 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected0.begin(), expected0.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[1][0].m_buffer.begin(), outputs[1][0].m_buffer.end(), expected1.begin(), expected1.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(states[0].begin(), states[0].end(), expected0.begin() + 2, expected0.end());
+
+    // second chunk: stream 0 continues, stream 1 starts over
+    inputs[0][0].m_buffer = { 1, 1 };
+    inputs[1][0].m_buffer = { 5, 5, 1, 2 };
+    states[1].clear();
+    eval->ForwardPassStreams(inputs, states, outputs);
+
+    expected0 = { 5, 7 };
+    expected1 = { 5, 5, 6, 7 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[0][0].m_buffer.begin(), outputs[0][0].m_buffer.end(), expected0.begin(), expected0.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputs[1][0].m_buffer.begin(), outputs[1][0].m_buffer.end(), expected1.begin(), expected1.end());
+
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalGatedRecurrenceTest)
+{
+    // gated recurrence whose elementwise nodes are all executed as one fused run per time step
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder = [ \n"
+        "i1 = Input(2) \n"
+        "d = PastValue(2, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = ElementTimes(Sigmoid(Plus(i1, d)), Tanh(Minus(i1, d))) \n"
+        "FeatureNodes = (i1) \n"
+        "outputNodes = (o1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float>* eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f, 1.0f, -2.0f };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 4 });
+
+    eval->ForwardPass(inputBuffer, outputBuffer);
+
+    std::vector<double> state(2, 0);
+    BOOST_REQUIRE_EQUAL(outputBuffer[0].m_buffer.size(), inputBuffer[0].m_buffer.size());
+    for (size_t i = 0; i < inputBuffer[0].m_buffer.size(); i++)
+    {
+        double x = inputBuffer[0].m_buffer[i];
+        double& h = state[i % 2];
+        h = 1 / (1 + exp(-(x + h))) * tanh(x - h);
+        BOOST_CHECK_CLOSE(outputBuffer[0].m_buffer[i], h, 1e-3);
+    }
+
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBeamSearchTest)
+{
+    // Token model with P(next | current) given by the columns C0..C3, as negative log probabilities.
+    // Tokens: 0 = <s>, 1 = a, 2 = b, 3 = </s>. P(a|<s>) = 0.6, P(b|<s>) = 0.4, P(</s>|a) = 0.5, P(</s>|b) = 0.9.
+    // Greedy decoding yields 'a' (0.30), while a beam of two finds 'b' (0.36).
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder = [ \n"
+        "t = Input(4) \n"
+        "C0 = RowStack(Constant(1000), Constant(0.510826), Constant(0.916291), Constant(1000)) \n"
+        "C1 = RowStack(Constant(1000), Constant(1.386294), Constant(1.386294), Constant(0.693147)) \n"
+        "C2 = RowStack(Constant(1000), Constant(2.995732), Constant(2.995732), Constant(0.105361)) \n"
+        "C3 = RowStack(Constant(1000), Constant(1.386294), Constant(1.386294), Constant(1.386294)) \n"
+        "s01 = Plus(ElementTimes(C0, RowSlice(0, 1, t)), ElementTimes(C1, RowSlice(1, 1, t))) \n"
+        "s23 = Plus(ElementTimes(C2, RowSlice(2, 1, t)), ElementTimes(C3, RowSlice(3, 1, t))) \n"
+        "z = Negate(Plus(s01, s23)) \n"
+        "FeatureNodes = (t) \n"
+        "outputNodes = (z) \n"
+        "] \n";
+
+    IEvaluateModelExtended<float>* eval;
+    GetEvalExtendedF(&eval);
+    eval->CreateNetwork(modelDefinition);
+
+    eval->StartBeamSearch(L"t", L"z", /*startSymbol=*/0, /*endSymbol=*/3, /*beamWidth=*/2, /*maxLength=*/5, /*lengthNormalization=*/0);
+
+    Values<float> inputBuffer(0); // no source sequence
+    std::vector<std::vector<size_t>> hypotheses;
+    std::vector<double> scores;
+    eval->BeamSearch(inputBuffer, 2, hypotheses, scores);
+
+    BOOST_REQUIRE_EQUAL(hypotheses.size(), 2);
+    BOOST_REQUIRE_EQUAL(scores.size(), 2);
+    std::vector<size_t> expectedBest{ 2 }, expectedSecond{ 1 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(hypotheses[0].begin(), hypotheses[0].end(), expectedBest.begin(), expectedBest.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(hypotheses[1].begin(), hypotheses[1].end(), expectedSecond.begin(), expectedSecond.end());
+    BOOST_CHECK_CLOSE(scores[0], log(0.36), 0.01);
+    BOOST_CHECK_CLOSE(scores[1], log(0.30), 0.01);
+
+    // decoding again yields the same result
+    eval->BeamSearch(inputBuffer, 1, hypotheses, scores);
+    BOOST_REQUIRE_EQUAL(hypotheses.size(), 1);
+    BOOST_CHECK_EQUAL_COLLECTIONS(hypotheses[0].begin(), hypotheses[0].end(), expectedBest.begin(), expectedBest.end());
+
+    eval->Destroy();
+}
+
+// Decoder with a recurrence over the tokens, conditioned on a source sequence on its own dynamic axis.
+// Tokens: 0 = <s>, 1 = a, 2 = b, 3 = </s>. The encoder computes the running sums of the (scalar) source frames, and the
+// encoded source c is their mean. The scores of the next token depend on the current token t, the previous token h
+// (through a PastValue) and c: W t + U h + v c.
+static const std::string recurrentDecoderModel =
+    "deviceId = -1 \n"
+    "precision = \"float\" \n"
+    "traceLevel = 1 \n"
+    "BrainScriptNetworkBuilder = [ \n"
+    "    sourceAxis = DynamicAxis() \n"
+    "    s = Input(1, dynamicAxis = sourceAxis) \n"
+    "    t = Input(4) \n"
+    "    enc = s + PastValue(1, enc, defaultHiddenActivation = 0) \n"
+    "    c = ElementDivide(SumElements(enc), SumElements(BS.Constants.OnesLike(s))) \n"
+    "    h = PastValue(4, t, defaultHiddenActivation = 0) \n"
+    "    W = ParameterTensor((4:4), init = 'fromLiteral', learningRateMultiplier = 0, initFromLiteral = '-9 -9 -9 -9 \n 0.7 -1.4 -0.7 0 \n 1.3 -1.5 -0.1 0.1 \n -1.4 1.5 -1.4 0.9') \n"
+    "    U = ParameterTensor((4:4), init = 'fromLiteral', learningRateMultiplier = 0, initFromLiteral = '0 0 0 0 \n -0.6 1.1 -0.5 0.2 \n -1.3 -1 -1.4 0.1 \n -1.2 -0.4 1 0.3') \n"
+    "    v = ParameterTensor((4:1), init = 'fromLiteral', learningRateMultiplier = 0, initFromLiteral = '0 \n -0.1 \n 0.8 \n -0.9') \n"
+    "    z = Times(W, t) + Times(U, h) + Times(v, c) \n"
+    "    featureNodes = (s : t) \n"
+    "    outputNodes = (z) \n"
+    "] \n";
+
+// Reference for the decoder: evaluates the whole token sequence with ForwardPass(), without any state carried over
+struct RecurrentDecoderReference
+{
+    static const size_t numTokens = 4, startSymbol = 0, endSymbol = 3;
+
+    IEvaluateModelExtended<float>* eval;
+    VariableSchema inputLayouts, outputLayouts;
+
+    RecurrentDecoderReference()
+    {
+        eval = SetupNetworkAndGetLayouts(recurrentDecoderModel, inputLayouts, outputLayouts);
+    }
+    ~RecurrentDecoderReference() { eval->Destroy(); }
+
+    // log probabilities of the token following the given ones
+    std::vector<double> NextLogProbabilities(const std::vector<float>& source, const std::vector<size_t>& tokens)
+    {
+        Values<float> inputs = inputLayouts.CreateBuffers<float>({ 1, 1 });
+        Values<float> outputs = outputLayouts.CreateBuffers<float>({ tokens.size() + 1 });
+        for (size_t i = 0; i < inputLayouts.size(); i++)
+        {
+            if (inputLayouts[i].m_name == L"s")
+                inputs[i].m_buffer = source;
+            else
+            {
+                inputs[i].m_buffer.assign((tokens.size() + 1) * numTokens, 0);
+                inputs[i].m_buffer[startSymbol] = 1;
+                for (size_t k = 0; k < tokens.size(); k++)
+                    inputs[i].m_buffer[(k + 1) * numTokens + tokens[k]] = 1;
+            }
+        }
+        eval->ForwardPass(inputs, outputs);
+
+        auto lastFrame = outputs[0].m_buffer.end() - numTokens;
+        double maxScore = *std::max_element(lastFrame, outputs[0].m_buffer.end());
+        double sum = 0;
+        for (size_t v = 0; v < numTokens; v++)
+            sum += exp(lastFrame[v] - maxScore);
+        std::vector<double> logProbabilities(numTokens);
+        for (size_t v = 0; v < numTokens; v++)
+            logProbabilities[v] = lastFrame[v] - maxScore - log(sum);
+        return logProbabilities;
+    }
+
+    // log probability of a hypothesis, including the end symbol unless it has the maximum length
+    double Score(const std::vector<float>& source, const std::vector<size_t>& tokens, size_t maxLength)
+    {
+        double score = 0;
+        for (size_t k = 0; k < tokens.size(); k++)
+            score += NextLogProbabilities(source, std::vector<size_t>(tokens.begin(), tokens.begin() + k))[tokens[k]];
+        if (tokens.size() < maxLength)
+            score += NextLogProbabilities(source, tokens)[endSymbol];
+        return score;
+    }
+
+    // the hypothesis found by choosing the most probable token in each step
+    std::vector<size_t> DecodeGreedy(const std::vector<float>& source, size_t maxLength)
+    {
+        std::vector<size_t> tokens;
+        while (tokens.size() < maxLength)
+        {
+            auto logProbabilities = NextLogProbabilities(source, tokens);
+            size_t best = std::max_element(logProbabilities.begin(), logProbabilities.end()) - logProbabilities.begin();
+            if (best == endSymbol)
+                break;
+            tokens.push_back(best);
+        }
+        return tokens;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(EvalBeamSearchRecurrentDecoderTest)
+{
+    const size_t maxLength = 4;
+    RecurrentDecoderReference reference;
+
+    IEvaluateModelExtended<float>* greedy;
+    GetEvalExtendedF(&greedy);
+    greedy->CreateNetwork(recurrentDecoderModel);
+    greedy->StartBeamSearch(L"t", L"z", reference.startSymbol, reference.endSymbol, /*beamWidth=*/1, maxLength, /*lengthNormalization=*/0);
+
+    IEvaluateModelExtended<float>* beam;
+    GetEvalExtendedF(&beam);
+    beam->CreateNetwork(recurrentDecoderModel);
+    beam->StartBeamSearch(L"t", L"z", reference.startSymbol, reference.endSymbol, /*beamWidth=*/2, maxLength, /*lengthNormalization=*/0);
+
+    // The encoded sources are 1 and -1. For the first one, greedy decoding yields 'b b b b', while the beam finds 'b a',
+    // which has to continue the recurrent state of the second hypothesis of the previous step. The sources alternate,
+    // so that the encoder, which is evaluated in the first step only, has to be recomputed for each decoding.
+    std::vector<std::vector<float>> sources{ { 1.5f, -1 }, { -0.5f, -0.5f, -0.5f } };
+    std::vector<std::vector<size_t>> expectedBest{ { 2, 1 }, { 1 } };
+    for (size_t i = 0; i < 2 * sources.size(); i++)
+    {
+        const auto& source = sources[i % sources.size()];
+        Values<float> sourceBuffer(1);
+        sourceBuffer[0].m_buffer = source;
+        std::vector<std::vector<size_t>> hypotheses;
+        std::vector<double> scores;
+
+        // a beam of one yields the greedy hypothesis
+        greedy->BeamSearch(sourceBuffer, 1, hypotheses, scores);
+        auto expectedGreedy = reference.DecodeGreedy(source, maxLength);
+        double greedyScore = reference.Score(source, expectedGreedy, maxLength);
+        BOOST_REQUIRE_EQUAL(hypotheses.size(), 1);
+        BOOST_CHECK_EQUAL_COLLECTIONS(hypotheses[0].begin(), hypotheses[0].end(), expectedGreedy.begin(), expectedGreedy.end());
+        BOOST_CHECK_CLOSE(scores[0], greedyScore, 0.01);
+
+        // the scores of a beam of two are those of a full evaluation of the hypotheses
+        beam->BeamSearch(sourceBuffer, 2, hypotheses, scores);
+        const auto& expected = expectedBest[i % sources.size()];
+        BOOST_REQUIRE_EQUAL(hypotheses.size(), 2);
+        BOOST_CHECK_EQUAL_COLLECTIONS(hypotheses[0].begin(), hypotheses[0].end(), expected.begin(), expected.end());
+        BOOST_CHECK_CLOSE(scores[0], reference.Score(source, hypotheses[0], maxLength), 0.01);
+        BOOST_CHECK_CLOSE(scores[1], reference.Score(source, hypotheses[1], maxLength), 0.01);
+
+        // the beam improves on greedy decoding for the first source, and finds the same hypothesis for the second
+        BOOST_CHECK_EQUAL(hypotheses[0] == expectedGreedy, i % sources.size() == 1);
+        BOOST_CHECK_GT(scores[0], greedyScore - 1e-4);
+    }
+
+    greedy->Destroy();
+    beam->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBeamSearchWholeSequenceOperationTest)
+{
+    // the decoder cannot broadcast the source to all steps of the token sequence, since it sees one step at a time
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "BrainScriptNetworkBuilder = [ \n"
+        "    sourceAxis = DynamicAxis() \n"
+        "    s = Input(1, dynamicAxis = sourceAxis) \n"
+        "    t = Input(4) \n"
+        "    z = t + BS.Sequences.BroadcastSequenceAs(t, BS.Sequences.Last(s)) \n"
+        "    featureNodes = (s : t) \n"
+        "    outputNodes = (z) \n"
+        "] \n";
+
+    IEvaluateModelExtended<float>* eval;
+    GetEvalExtendedF(&eval);
+    eval->CreateNetwork(modelDefinition);
+    BOOST_CHECK_THROW(eval->StartBeamSearch(L"t", L"z", 0, 3, /*beamWidth=*/2, /*maxLength=*/4, /*lengthNormalization=*/0), std::invalid_argument);
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
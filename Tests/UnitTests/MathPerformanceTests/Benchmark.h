@@ -0,0 +1,155 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Benchmark.h -- minimal harness for timing kernels with warm-up and repeated samples
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmark {
+
+// A benchmark is a named, parameterized kernel. Setup() allocates and initializes the operands and returns the
+// function to time, so that allocation is not measured. 'work' is the amount of work per call in 'workUnit'
+// (e.g. flops for GEMM, bytes for memory-bound ops) and is used to report a rate.
+struct Case
+{
+    std::string m_name;      // e.g. "gemm"
+    std::string m_params;    // e.g. "m=1024,k=1024,n=1024"
+    std::string m_elemType;  // "float" or "double"
+    double m_work;
+    std::string m_workUnit;  // "flop" or "byte"
+    std::function<std::function<void()>()> m_setup;
+};
+
+struct Options
+{
+    size_t m_warmupSamples = 2;       // samples that are run but not recorded
+    size_t m_samples = 10;            // recorded samples
+    double m_minSampleSeconds = 0.05; // each sample repeats the kernel until this much time has passed
+    std::string m_filter;             // only run cases whose name or parameters contain this
+};
+
+struct Result
+{
+    const Case* m_case;
+    int m_numThreads;
+    size_t m_iterationsPerSample;
+    std::vector<double> m_seconds; // [sample] seconds per call
+    double m_min, m_median, m_mean, m_stddev;
+
+    // work per second, based on the median
+    double Rate() const { return m_median > 0 ? m_case->m_work / m_median : 0; }
+};
+
+inline bool Matches(const Case& c, const std::string& filter)
+{
+    return filter.empty() || (c.m_name + " " + c.m_params + " " + c.m_elemType).find(filter) != std::string::npos;
+}
+
+inline Result Run(const Case& c, int numThreads, const Options& options)
+{
+    typedef std::chrono::steady_clock Clock;
+    auto kernel = c.m_setup();
+
+    // calibrate: time one call, and derive how many calls make up a sample
+    auto start = Clock::now();
+    kernel();
+    double once = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t iterations = once > 0 ? (size_t) std::ceil(options.m_minSampleSeconds / once) : 1;
+    iterations = std::max<size_t>(1, std::min<size_t>(iterations, 1000000));
+
+    Result result;
+    result.m_case = &c;
+    result.m_numThreads = numThreads;
+    result.m_iterationsPerSample = iterations;
+    for (size_t sample = 0; sample < options.m_warmupSamples + options.m_samples; sample++)
+    {
+        start = Clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            kernel();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count() / iterations;
+        if (sample >= options.m_warmupSamples)
+            result.m_seconds.push_back(seconds);
+    }
+
+    // statistics over the recorded samples
+    auto sorted = result.m_seconds;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    result.m_min = n > 0 ? sorted.front() : 0;
+    result.m_median = n == 0 ? 0 : n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    double sum = 0, sumSq = 0;
+    for (auto s : sorted)
+    {
+        sum += s;
+        sumSq += s * s;
+    }
+    result.m_mean = n > 0 ? sum / n : 0;
+    result.m_stddev = n > 1 ? std::sqrt(std::max(0.0, (sumSq - sum * sum / n) / (n - 1))) : 0;
+    return result;
+}
+
+// -----------------------------------------------------------------------
+// reporting
+// -----------------------------------------------------------------------
+
+enum class Format
+{
+    text, // human-readable table
+    csv,  // one line per result, with a header line
+    json  // an array of objects
+};
+
+inline void WriteHeader(FILE* f, Format format)
+{
+    if (format == Format::text)
+        fprintf(f, "%-24s %-40s %-6s %7s %12s %12s %8s %14s\n", "benchmark", "parameters", "type", "threads", "median [us]", "min [us]", "stddev%", "rate");
+    else if (format == Format::csv)
+        fprintf(f, "benchmark,parameters,type,threads,iterations,samples,median_s,min_s,mean_s,stddev_s,work,work_unit,rate_per_s\n");
+    else
+        fprintf(f, "[");
+}
+
+inline void WriteResult(FILE* f, Format format, const Result& r, bool first)
+{
+    const Case& c = *r.m_case;
+    if (format == Format::text)
+    {
+        double rate = r.Rate();
+        const char* scale = c.m_workUnit == "flop" ? "GFlop/s" : "GB/s";
+        fprintf(f, "%-24s %-40s %-6s %7d %12.2f %12.2f %8.2f %9.2f %s\n", c.m_name.c_str(), c.m_params.c_str(), c.m_elemType.c_str(), r.m_numThreads,
+                r.m_median * 1e6, r.m_min * 1e6, r.m_mean > 0 ? 100 * r.m_stddev / r.m_mean : 0, rate * 1e-9, scale);
+    }
+    else if (format == Format::csv)
+    {
+        fprintf(f, "%s,\"%s\",%s,%d,%d,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%s,%.9g\n", c.m_name.c_str(), c.m_params.c_str(), c.m_elemType.c_str(), r.m_numThreads,
+                (int) r.m_iterationsPerSample, (int) r.m_seconds.size(), r.m_median, r.m_min, r.m_mean, r.m_stddev, c.m_work, c.m_workUnit.c_str(), r.Rate());
+    }
+    else
+    {
+        fprintf(f, "%s\n  {\"benchmark\": \"%s\", \"parameters\": \"%s\", \"type\": \"%s\", \"threads\": %d, \"iterations\": %d, \"samples\": [",
+                first ? "" : ",", c.m_name.c_str(), c.m_params.c_str(), c.m_elemType.c_str(), r.m_numThreads, (int) r.m_iterationsPerSample);
+        for (size_t i = 0; i < r.m_seconds.size(); i++)
+            fprintf(f, "%s%.9g", i > 0 ? ", " : "", r.m_seconds[i]);
+        fprintf(f, "], \"median\": %.9g, \"min\": %.9g, \"mean\": %.9g, \"stddev\": %.9g, \"work\": %.9g, \"workUnit\": \"%s\", \"rate\": %.9g}",
+                r.m_median, r.m_min, r.m_mean, r.m_stddev, c.m_work, c.m_workUnit.c_str(), r.Rate());
+    }
+    fflush(f);
+}
+
+inline void WriteFooter(FILE* f, Format format)
+{
+    if (format == Format::json)
+        fprintf(f, "\n]\n");
+}
+
+}}}}
@@ -2,358 +2,499 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// MathPerformanceTests.cpp : Defines the entry point for the console application.
+// MathPerformanceTests.cpp : micro-benchmarks for the CPU math kernels
+//
+// Usage: mathperformancetests [filter=<substring>] [threads=1,8] [types=float,double]
+//                             [warmup=2] [samples=10] [minSampleTime=0.05] [format=text|csv|json] [output=<file>]
+//
+// Every benchmark is run for every combination of thread count and element type. Each sample repeats the kernel
+// until minSampleTime seconds have passed, and the reported time is per call. Use format=csv or format=json to
+// get results that can be compared between builds.
 //
 #include "stdafx.h"
-//#define NOMINMAX
-//#include "Windows.h"
 #include "Matrix.h"
 #include "CPUMatrix.h"
+#include "CPUSparseMatrix.h"
 #include "TensorView.h"
-#include "Sequences.h"
-#include <chrono>
+#include "ConvolutionEngine.h"
+#include "Benchmark.h"
 #include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <algorithm>
 
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
 
+namespace Bench = Microsoft::MSR::CNTK::Benchmark;
+
 template <class ElemType>
-void randomInitializeCPUMatrix(CPUMatrix<ElemType>& M, float min = -10, float max = 10)
-{
-    foreach_coord (i, j, M)
-    {
-        M(i, j) = (1.0 * rand() / RAND_MAX) * max + min;
-    }
-}
+const char* ElemTypeName();
+template <>
+const char* ElemTypeName<float>() { return "float"; }
+template <>
+const char* ElemTypeName<double>() { return "double"; }
 
 template <class ElemType>
-void randomInitializeMatrix(Matrix<ElemType>& M, float min = -10, float max = 10)
+vector<ElemType> RandomVector(size_t n, int seed)
 {
-    foreach_coord (i, j, M)
-    {
-        M(i, j) = (1.0 * rand() / RAND_MAX) * max + min;
-    }
+    mt19937 rng(seed);
+    uniform_real_distribution<float> nd(-1, 1);
+    vector<ElemType> v(n);
+    generate(begin(v), end(v), [&] { return (ElemType) nd(rng); });
+    return v;
 }
 
 template <class ElemType>
-void MultiplyAndWeightedAddTest(int n, int k, int m)
+shared_ptr<CPUMatrix<ElemType>> RandomCPUMatrix(size_t rows, size_t cols, int seed)
 {
-    cout << "Testing CPUMatrix" << endl;
-    cout << "A(" << n << "x" << k << ") and B(" << k << "," << m << ")" << endl;
-    CPUMatrix<ElemType> A(n, k);
-    randomInitializeCPUMatrix<ElemType>(A);
-    CPUMatrix<ElemType> B(k, m);
-    randomInitializeCPUMatrix<ElemType>(B);
-    CPUMatrix<ElemType> C(n, m);
-    auto t_start = clock();
-    CPUMatrix<ElemType>::MultiplyAndWeightedAdd(0.324, A, false, B, false, 0.632, C);
-    auto t_end = clock();
-    std::cout << "CPU Matrix in: " << 1.0 * (t_end - t_start) / CLOCKS_PER_SEC << " seconds" << endl;
-    std::cout << n << " " << k << " " << m << endl;
-
-    cout << "Testing Matrix" << endl;
-    Matrix<ElemType> AG((size_t) n, (size_t) k);
-    randomInitializeMatrix<ElemType>(AG);
-    Matrix<ElemType> BG((size_t) k, (size_t) m);
-    randomInitializeMatrix<ElemType>(BG);
-    Matrix<ElemType> CG((size_t) n, (size_t) m);
-    auto t_startG = clock();
-    Matrix<ElemType>::MultiplyAndWeightedAdd(0.324, AG, false, BG, false, 0.632, CG);
-    auto t_endG = clock();
-    std::cout << "Matrix in: " << 1.0 * (t_endG - t_startG) / CLOCKS_PER_SEC << " seconds" << endl;
+    auto init = RandomVector<ElemType>(rows * cols, seed);
+    return make_shared<CPUMatrix<ElemType>>(rows, cols, init.data(), matrixFlagNormal);
 }
 
 template <class ElemType>
-void AddMultiplyAndInplaceSigmoidTest(int n, int k, int m)
+TensorView<ElemType> RandomTensor(const TensorShape& shape, int seed)
 {
-    cout << "Testing CPUMatrix" << endl;
-    cout << "A(" << n << "x" << k << ") and B(" << k << "," << m << ")" << endl;
-    CPUMatrix<ElemType> A(n, k);
-    randomInitializeCPUMatrix<ElemType>(A);
-    CPUMatrix<ElemType> B(k, m);
-    randomInitializeCPUMatrix<ElemType>(B);
-    CPUMatrix<ElemType> D(n, m);
-    randomInitializeCPUMatrix<ElemType>(D);
-    CPUMatrix<ElemType> C(n, m);
-    auto t_start = clock();
-    C = A * B + D;
-    // C.InplaceSigmoid();
-    auto t_end = clock();
-    std::cout << "CPU Matrix in: " << 1.0 * (t_end - t_start) / CLOCKS_PER_SEC << " seconds" << endl;
-    std::cout << n << " " << k << " " << m << endl;
-
-    cout << "Testing Matrix" << endl;
-    Matrix<ElemType> AG((size_t) n, (size_t) k);
-    randomInitializeMatrix<ElemType>(AG);
-    Matrix<ElemType> BG((size_t) k, (size_t) m);
-    randomInitializeMatrix<ElemType>(BG);
-    Matrix<ElemType> DG((size_t) n, (size_t) m);
-    randomInitializeMatrix<ElemType>(DG);
-    Matrix<ElemType> CG((size_t) n, (size_t) m);
-    auto t_startG = clock();
-    CG = AG * BG + DG;
-    // CG.InplaceSigmoid();
-    auto t_endG = clock();
-    std::cout << "Matrix in: " << 1.0 * (t_endG - t_startG) / CLOCKS_PER_SEC << " seconds" << endl;
+    let numElements = shape.GetNumElements();
+    auto init = RandomVector<ElemType>(numElements, seed);
+    let sob = make_shared<Matrix<ElemType>>(numElements /*rows*/, 1 /*cols*/, init.data(), CPUDEVICE);
+    return TensorView<ElemType>(sob, shape);
 }
 
+// random sparse matrix in CSC format with the given fraction of non-zeroes per column
 template <class ElemType>
-void SquareMultiplyAndAdd10TimesAvgTest(int n, int count)
+shared_ptr<CPUSparseMatrix<ElemType>> RandomCSCMatrix(size_t rows, size_t cols, double density, int seed)
 {
-    cout << "Testing CPUMatrix" << endl;
-    cout << "A(" << n << "x" << n << ") and B(" << n << "," << n << ")" << endl;
-
-    double cpu_avg = 0;
-    for (int i = 0; i < count; ++i)
+    mt19937 rng(seed);
+    uniform_real_distribution<float> nd(-1, 1);
+    size_t nzPerCol = max((size_t) 1, (size_t) (rows * density));
+    vector<CPUSPARSE_INDEX_TYPE> colStarts(cols + 1), rowIndices;
+    vector<ElemType> values;
+    vector<CPUSPARSE_INDEX_TYPE> allRows(rows);
+    for (size_t i = 0; i < rows; i++)
+        allRows[i] = (CPUSPARSE_INDEX_TYPE) i;
+    for (size_t j = 0; j < cols; j++)
     {
-        CPUMatrix<ElemType> A(n, n);
-        randomInitializeCPUMatrix<ElemType>(A);
-        CPUMatrix<ElemType> B(n, n);
-        randomInitializeCPUMatrix<ElemType>(B);
-        CPUMatrix<ElemType> C(n, n);
-        auto t_start = clock();
-        CPUMatrix<ElemType>::MultiplyAndWeightedAdd(0.324, A, false, B, false, 0.632, C);
-        auto t_end = clock();
-        double val = 1.0 * (t_end - t_start) / CLOCKS_PER_SEC;
-        if (i == 0)
-        {
-            cpu_avg = val;
-        }
-        else
+        colStarts[j] = (CPUSPARSE_INDEX_TYPE) rowIndices.size();
+        shuffle(allRows.begin(), allRows.end(), rng);
+        vector<CPUSPARSE_INDEX_TYPE> colRows(allRows.begin(), allRows.begin() + nzPerCol);
+        sort(colRows.begin(), colRows.end());
+        for (auto row : colRows)
         {
-            cpu_avg = cpu_avg * (i - 1) / i + val / i;
+            rowIndices.push_back(row);
+            values.push_back((ElemType) nd(rng));
         }
     }
+    colStarts[cols] = (CPUSPARSE_INDEX_TYPE) rowIndices.size();
+    auto m = make_shared<CPUSparseMatrix<ElemType>>(MatrixFormat::matrixFormatSparseCSC, rows, cols, values.size());
+    m->SetMatrixFromCSCFormat(colStarts.data(), rowIndices.data(), values.data(), values.size(), rows, cols);
+    return m;
+}
 
-    cout << "Testing Matrix" << endl;
-    double m_avg = 0;
-    for (int i = 0; i < count; ++i)
-    {
-        Matrix<ElemType> AG((size_t) n, (size_t) n);
-        randomInitializeMatrix<ElemType>(AG);
-        Matrix<ElemType> BG((size_t) n, (size_t) n);
-        randomInitializeMatrix<ElemType>(BG);
-        Matrix<ElemType> CG((size_t) n, (size_t) n);
-        auto t_startG = clock();
-        Matrix<ElemType>::MultiplyAndWeightedAdd(0.324, AG, false, BG, false, 0.632, CG);
-        auto t_endG = clock();
-        double val = 1.0 * (t_endG - t_startG) / CLOCKS_PER_SEC;
-        if (i == 0)
-        {
-            m_avg = val;
-        }
-        else
-        {
-            m_avg = m_avg * (i - 1) / i + val / i;
-        }
-    }
+static string Params(const vector<pair<string, string>>& params)
+{
+    ostringstream os;
+    for (size_t i = 0; i < params.size(); i++)
+        os << (i > 0 ? "," : "") << params[i].first << "=" << params[i].second;
+    return os.str();
+}
 
-    cout << "Based on " << count << " runs:" << endl;
-    cout << "Average time for CPUMatrix is: " << cpu_avg << " seconds" << endl;
-    cout << "Average time for Matrix is: " << m_avg << " seconds" << endl;
-    cout << "CPUMatrix/Matrix ratio is: " << cpu_avg / m_avg << " seconds" << endl;
+template <class T>
+static string ToString(const T& value)
+{
+    ostringstream os;
+    os << value;
+    return os.str();
 }
 
-// simple test suite for TensorView
-//  - this is meant for performance optimization
-//  - correctness is defined as same result between GPU and CPU
 template <class ElemType>
-struct TensorTest
+static Bench::Case MakeCase(const string& name, const string& params, double work, const string& workUnit, function<function<void()>()> setup)
 {
-    // helper to create a randomly initialized tensor object
-    static TensorView<ElemType> CreateTensor(TensorShape shape, int randomSeed, DEVICEID_TYPE deviceId, bool isResult = false)
-    {
-        let numElements = shape.GetNumElements();
-
-        if (isResult)
-            cout << " ->";
-        cout << " [" << string(shape) << "]";
-        if (isResult)
-            cout << " \t// " << (deviceId < 0 ? "C" : "G") << "PU\n   " << flush;
-
-        // random init
-        mt19937 rng(randomSeed);
-        uniform_real_distribution<float> nd(-1, 1);
-        vector<ElemType> init(numElements);
-        generate(begin(init), end(init), [&] { return nd(rng); });
-
-        // create storage object (one-column matrix)
-        let sob = make_shared<Matrix<ElemType>>(numElements/*rows*/, 1/*cols*/, init.data(), deviceId);
-
-        // create TensorView
-        return TensorView<ElemType>(sob, shape);
-    }
+    Bench::Case c;
+    c.m_name = name;
+    c.m_params = params;
+    c.m_elemType = ElemTypeName<ElemType>();
+    c.m_work = work;
+    c.m_workUnit = workUnit;
+    c.m_setup = setup;
+    return c;
+}
 
-    // test bias gradient (reduction)
-    static TensorView<ElemType> BiasGradientTest(TensorShape layerShape, TensorShape biasShape, DEVICEID_TYPE deviceId)
-    {
-        int randomSeed = 1;
-        let  gradient = CreateTensor(layerShape, randomSeed++, deviceId);
-        auto bias = CreateTensor(biasShape, randomSeed++, deviceId, true);
-        //gradient.GetSOB().Print("incoming gradient", 0, 9, 0, 9);
-        //bias.GetSOB().Print("bias gradient", 0, 9, 0, 9);
-        bias.DoCopyOf(1, gradient, 1);
-        //bias.GetSOB().Print("updated bias gradient", 0, 9, 0, 9);
-        return bias;
-    }
+// -----------------------------------------------------------------------
+// dense GEMM: C = alpha A B + beta C
+// -----------------------------------------------------------------------
 
-    // test broadcast summation gradient
-    static TensorView<ElemType> BroadcastingTest(TensorShape layerShape, TensorShape biasShape, DEVICEID_TYPE deviceId)
+template <class ElemType>
+void AddGemmCases(vector<Bench::Case>& cases)
+{
+    // square sizes, and shapes of typical fully-connected layers (output dim x input dim x minibatch)
+    size_t shapes[][3] = {{256, 256, 256}, {1024, 1024, 1024}, {2048, 512, 256}, {512, 2048, 64}, {4096, 1024, 32}};
+    for (auto& s : shapes)
     {
-        int randomSeed = 1;
-        let  input  = CreateTensor(layerShape, randomSeed++, deviceId);
-        auto bias   = CreateTensor(biasShape,  randomSeed++, deviceId);
-        //input.GetSOB().Print("input data", 0, 9, 0, 9);
-        //bias.GetSOB().Print("bias", 0, 9, 0, 9);
-        auto result = CreateTensor(layerShape, randomSeed++, deviceId, true);
-        result.AssignSumOf(input, bias);
-        return result;
+        size_t m = s[0], k = s[1], n = s[2];
+        for (bool transposeA : {false, true})
+        {
+            cases.push_back(MakeCase<ElemType>("gemm", Params({{"m", ToString(m)}, {"k", ToString(k)}, {"n", ToString(n)}, {"transA", transposeA ? "1" : "0"}}),
+                                               2.0 * m * k * n, "flop", [=]()
+            {
+                auto a = transposeA ? RandomCPUMatrix<ElemType>(k, m, 1) : RandomCPUMatrix<ElemType>(m, k, 1);
+                auto b = RandomCPUMatrix<ElemType>(k, n, 2);
+                auto c = RandomCPUMatrix<ElemType>(m, n, 3);
+                return [=]() { CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, *a, transposeA, *b, false, 0, *c); };
+            }));
+        }
     }
+}
 
-    // run one test for both GPU and CPU and verify they are the same
-    template<typename FN>
-    static void OneTensorTest(const char* what, double tolerance, const FN& fn)
-    {
-        cout << "===== Tensor test '" << what << "'\n   ";
-
-        // run on GPU and CPU
-        let resultGPU = fn(0);
-        let resultCPU = fn(-1);
-
-        // dump top corner of the result to get a feel for the error
-        resultGPU.GetSOB().Print("GPU result", 0, 7, 0, 9);
-        resultGPU.GetSOB().TransferToDeviceIfNotThere(-1, true, false, true);
-        resultCPU.GetSOB().Print("CPU result", 0, 7, 0, 9);
-
-        // compare
-        let isSame = resultGPU.GetSOB().IsEqualTo(resultCPU.GetSOB(), (ElemType)tolerance);
-        cout << (isSame ? " --> SUCCEEDED. =====\n" : " --> FAILED (GPU and CPU results differ). =====\n") << endl << flush;
-        if (!isSame)
-            sin(1.0);  // set breakpoint here
-    }
+// -----------------------------------------------------------------------
+// sparse x dense products, as in embeddings of one-hot/bag-of-words inputs
+// -----------------------------------------------------------------------
 
-    // main entry point (misusing the constructor)
-    /*void*/ TensorTest()
+template <class ElemType>
+void AddSparseCases(vector<Bench::Case>& cases)
+{
+    size_t m = 512, k = 16384, n = 256; // W [m x k] times sparse input [k x n]
+    for (double density : {0.0001, 0.001, 0.01})
     {
-        // --- elementwise
+        double nnz = max(1.0, (double) (size_t) (k * density)) * n;
+        string params = Params({{"m", ToString(m)}, {"k", ToString(k)}, {"n", ToString(n)}, {"density", ToString(density)}});
 
-        // elementwise sum
-        OneTensorTest("elementwise addition", 1e-8, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+        // dense * sparse -> dense (forward of an embedding)
+        cases.push_back(MakeCase<ElemType>("dense_x_sparse", params, 2.0 * m * nnz, "flop", [=]()
         {
-            return BroadcastingTest(TensorShape{ 512, 256 }, TensorShape({ 512, 256 }), deviceId);
-        });
+            auto w = RandomCPUMatrix<ElemType>(m, k, 1);
+            auto x = RandomCSCMatrix<ElemType>(k, n, density, 2);
+            auto c = RandomCPUMatrix<ElemType>(m, n, 3);
+            return [=]() { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, *w, false, *x, false, 0, *c); };
+        }));
+
+        // dense * sparse^T -> dense (gradient of an embedding)
+        cases.push_back(MakeCase<ElemType>("dense_x_sparseT", params, 2.0 * m * nnz, "flop", [=]()
+        {
+            auto g = RandomCPUMatrix<ElemType>(m, n, 1);
+            auto x = RandomCSCMatrix<ElemType>(k, n, density, 2);
+            auto c = RandomCPUMatrix<ElemType>(m, k, 3);
+            return [=]() { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, *g, false, *x, true, 1, *c); };
+        }));
+
+        // sparse^T * dense -> dense
+        cases.push_back(MakeCase<ElemType>("sparseT_x_dense", params, 2.0 * m * nnz, "flop", [=]()
+        {
+            auto x = RandomCSCMatrix<ElemType>(k, n, density, 2);
+            auto w = RandomCPUMatrix<ElemType>(k, m, 1);
+            auto c = RandomCPUMatrix<ElemType>(n, m, 3);
+            return [=]() { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, *x, true, *w, false, 0, *c); };
+        }));
+    }
+}
 
-        // --- broadcasting
+// -----------------------------------------------------------------------
+// elementwise and reduction tensor ops (memory-bound, reported in bytes moved)
+// -----------------------------------------------------------------------
 
-        // simple broadcasting
-        OneTensorTest("addition wth simple broadcasting", 1e-8, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+template <class ElemType>
+void AddTensorCases(vector<Bench::Case>& cases)
+{
+    const double e = sizeof(ElemType);
+    for (size_t n : {(size_t) 1 << 16, (size_t) 1 << 20, (size_t) 1 << 24})
+    {
+        TensorShape shape(n);
+        string params = Params({{"shape", string(shape)}});
+        cases.push_back(MakeCase<ElemType>("tensor_copy", params, 2 * e * n, "byte", [=]()
         {
-            return BroadcastingTest(TensorShape{ 3, 2 }, TensorShape({ 3, 1 }), deviceId);
-        });
-        // typical bias for convolutional layer
-        OneTensorTest("bias addition (broadcasting)", 1e-8, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+            auto a = RandomTensor<ElemType>(shape, 1);
+            auto c = RandomTensor<ElemType>(shape, 2);
+            return [=]() mutable { c.AssignCopyOf(a); };
+        }));
+        cases.push_back(MakeCase<ElemType>("tensor_sigmoid", params, 2 * e * n, "byte", [=]()
         {
-            return BroadcastingTest(TensorShape{ 28, 28, 128, 32 }, TensorShape({ 1, 1, 128 }), deviceId);
-        });
-        // BUGBUG: This test is strange--Print() shows different values with depth 128 instead of 64, but IsEqual() does not fail with 1e-3 tolerance.
-        //         Something fishy going on. Dimension overflow?
-        OneTensorTest("bias addition (broadcasting)", 1e-8, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+            auto a = RandomTensor<ElemType>(shape, 1);
+            auto c = RandomTensor<ElemType>(shape, 2);
+            return [=]() mutable { c.AssignSigmoidOf(a); };
+        }));
+        cases.push_back(MakeCase<ElemType>("tensor_sum", params, 3 * e * n, "byte", [=]()
         {
-            return BroadcastingTest(TensorShape{ 256, 256, 64, 32 }, TensorShape({ 1, 1, 64 }), deviceId);
-        });
-
-        // --- reduction
+            auto a = RandomTensor<ElemType>(shape, 1);
+            auto b = RandomTensor<ElemType>(shape, 2);
+            auto c = RandomTensor<ElemType>(shape, 3);
+            return [=]() mutable { c.AssignSumOf(a, b); };
+        }));
+        cases.push_back(MakeCase<ElemType>("tensor_product", params, 3 * e * n, "byte", [=]()
+        {
+            auto a = RandomTensor<ElemType>(shape, 1);
+            auto b = RandomTensor<ElemType>(shape, 2);
+            auto c = RandomTensor<ElemType>(shape, 3);
+            return [=]() mutable { c.AssignElementwiseProductOf(a, b); };
+        }));
+    }
 
-        // typical bias gradient (reduction) for FF-DNN
-        OneTensorTest("bias gradient (reduction)", 1e-4, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+    // broadcasting: bias addition for a fully-connected and a convolutional layer
+    pair<TensorShape, TensorShape> broadcasts[] = {{TensorShape(2048, 256), TensorShape(2048)}, {TensorShape(28, 28, 128, 32), TensorShape(1, 1, 128)}};
+    for (auto& bc : broadcasts)
+    {
+        auto layerShape = bc.first;
+        auto biasShape = bc.second;
+        size_t n = layerShape.GetNumElements();
+        string params = Params({{"layer", string(layerShape)}, {"bias", string(biasShape)}});
+        cases.push_back(MakeCase<ElemType>("tensor_bias_add", params, 2 * e * n, "byte", [=]()
+        {
+            auto a = RandomTensor<ElemType>(layerShape, 1);
+            auto b = RandomTensor<ElemType>(biasShape, 2);
+            auto c = RandomTensor<ElemType>(layerShape, 3);
+            return [=]() mutable { c.AssignSumOf(a, b); };
+        }));
+
+        // reductions: the corresponding bias gradient, and the maximum over all elements
+        cases.push_back(MakeCase<ElemType>("tensor_reduce_sum", params, e * n, "byte", [=]()
         {
-            return BiasGradientTest(TensorShape{ 2048, 1024 }, TensorShape(2048), deviceId);
-        });
-        // typical bias gradient (reduction) for convolutional layer
-        OneTensorTest("bias gradient (reduction)", 1e-1, [](DEVICEID_TYPE deviceId) -> TensorView<ElemType>
+            auto g = RandomTensor<ElemType>(layerShape, 1);
+            auto b = RandomTensor<ElemType>(biasShape, 2);
+            return [=]() mutable { b.AssignCopyOf(g); };
+        }));
+        cases.push_back(MakeCase<ElemType>("tensor_reduce_max", Params({{"layer", string(layerShape)}, {"result", "[1]"}}), e * n, "byte", [=]()
         {
-            return BiasGradientTest(TensorShape{ 256, 256, 64, 32 }, TensorShape({ 1, 1, 64 }), deviceId);
-        });
+            auto g = RandomTensor<ElemType>(layerShape, 1);
+            auto r = RandomTensor<ElemType>(TensorShape(1), 2);
+            return [=]() mutable { r.DoUnaryOpOf(0, g, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opMax); };
+        }));
     }
+}
+
+// -----------------------------------------------------------------------
+// convolution and pooling through ConvolutionEngine
+// -----------------------------------------------------------------------
+
+struct ConvConfig
+{
+    size_t w, h, c;    // input
+    size_t kw, kh;     // kernel
+    size_t maps;       // output maps
+    size_t stride;
 };
 
 template <class ElemType>
-void MandSTest(int count, int devId)
+void AddConvolutionCases(vector<Bench::Case>& cases)
 {
-    ElemType* arr = new ElemType[count];
-    for (int i = 0; i < count; ++i)
-        arr[i] = (1.0 * rand()) / RAND_MAX + 1;
-
-    ElemType* data1 = new ElemType[1024 * 4096];
-    for (int i = 0; i < 1024 * 4096; ++i)
-        data1[i] = (1.0 * rand()) / RAND_MAX + 1;
-
-    ElemType* data2 = new ElemType[1024 * 4096];
-    for (int i = 0; i < 1024 * 4096; ++i)
-        data2[i] = (1.0 * rand()) / RAND_MAX + 1;
-
-    ElemType* data3 = new ElemType[1024];
-    for (int i = 0; i < 1024; ++i)
-        data3[i] = (1.0 * rand()) / RAND_MAX + 1;
-
-    cout << "Testing Matrix" << endl;
-    Matrix<ElemType> A(1024, 4096, data1, true, devId);
-    Matrix<ElemType> B(4096, 1024, data2, true, devId);
-    Matrix<ElemType> V(1024, 1, data3, true, devId);
-    Matrix<ElemType> C(1024, 1024, devId);
-
-    auto t_startG = clock();
-    for (int i = 0; i < count; ++i)
+    typedef Matrix<ElemType> Mat;
+    const size_t n = 16; // minibatch size
+    // Bounds the unrolled workspace of the GEMM engine; without it, BackwardData of the 7x7 input layer needs ~10 GB.
+    const size_t maxTempMemSizeInSamples = 4;
+    ConvConfig convs[] = {{56, 56, 64, 3, 3, 64, 1}, {28, 28, 128, 3, 3, 128, 1}, {28, 28, 256, 1, 1, 128, 1}, {224, 224, 3, 7, 7, 64, 2}};
+    for (auto& cc : convs)
     {
-        // Matrix<ElemType>::MultiplyAndWeightedAdd(arr[i],A,false,B,false,3.2*arr[i],C);
-        C += (A * arr[i]) * (B * (arr[i] * 2.3));
+        auto g = make_shared<ConvolveGeometry>(TensorShape(cc.w, cc.h, cc.c), TensorShape(cc.kw, cc.kh, cc.c), TensorShape(cc.maps),
+                                               TensorShape(cc.stride, cc.stride, cc.c), ConvolveGeometry::BoolVec{true},
+                                               ConvolveGeometry::BoolVec{true, true, false}, TensorShape(0), TensorShape(0));
+        size_t inElems = g->InputShape().GetNumElements();
+        size_t outElems = g->OutputShape().GetNumElements();
+        size_t kernelElems = g->KernelShape().GetNumElements();
+        double flops = 2.0 * outElems * kernelElems * n;
+        bool winogradCandidate = cc.kw == 3 && cc.kh == 3 && cc.stride == 1;
+        vector<pair<string, ConvolutionEngineKind>> engines = {{"gemm", ConvolutionEngineKind::Gemm}};
+        if (winogradCandidate)
+            engines.push_back({"winograd", ConvolutionEngineKind::Winograd});
+        for (auto& engine : engines)
+        {
+            string params = Params({{"input", string(g->InputShape())}, {"kernel", string(g->KernelShape())}, {"maps", ToString(cc.maps)},
+                                    {"stride", ToString(cc.stride)}, {"n", ToString(n)}, {"engine", engine.first}});
+            auto kind = engine.second;
+            cases.push_back(MakeCase<ElemType>("convolution_fwd", params, flops, "flop", [=]()
+            {
+                auto eng = shared_ptr<ConvolutionEngine<ElemType>>(ConvolutionEngine<ElemType>::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMemSizeInSamples, PoolKind::None, kind));
+                auto in = make_shared<Mat>(inElems, n, RandomVector<ElemType>(inElems * n, 1).data(), CPUDEVICE);
+                auto kernel = make_shared<Mat>(cc.maps, kernelElems, RandomVector<ElemType>(cc.maps * kernelElems, 2).data(), CPUDEVICE);
+                auto out = make_shared<Mat>(outElems, n, CPUDEVICE);
+                auto workspace = make_shared<Mat>(CPUDEVICE);
+                return [=]() { eng->Forward(*in, *kernel, *out, *workspace); };
+            }));
+            cases.push_back(MakeCase<ElemType>("convolution_bwd_data", params, flops, "flop", [=]()
+            {
+                auto eng = shared_ptr<ConvolutionEngine<ElemType>>(ConvolutionEngine<ElemType>::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMemSizeInSamples, PoolKind::None, kind));
+                auto srcGrad = make_shared<Mat>(outElems, n, RandomVector<ElemType>(outElems * n, 1).data(), CPUDEVICE);
+                auto kernel = make_shared<Mat>(cc.maps, kernelElems, RandomVector<ElemType>(cc.maps * kernelElems, 2).data(), CPUDEVICE);
+                auto grad = make_shared<Mat>(inElems, n, CPUDEVICE);
+                auto workspace = make_shared<Mat>(CPUDEVICE);
+                return [=]() { eng->BackwardData(*srcGrad, *kernel, *grad, /*accumulateGradient=*/false, *workspace); };
+            }));
+            cases.push_back(MakeCase<ElemType>("convolution_bwd_kernel", params, flops, "flop", [=]()
+            {
+                auto eng = shared_ptr<ConvolutionEngine<ElemType>>(ConvolutionEngine<ElemType>::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMemSizeInSamples, PoolKind::None, kind));
+                auto srcGrad = make_shared<Mat>(outElems, n, RandomVector<ElemType>(outElems * n, 1).data(), CPUDEVICE);
+                auto in = make_shared<Mat>(inElems, n, RandomVector<ElemType>(inElems * n, 2).data(), CPUDEVICE);
+                auto kernelGrad = make_shared<Mat>(cc.maps, kernelElems, CPUDEVICE);
+                auto workspace = make_shared<Mat>(CPUDEVICE);
+                return [=]() { eng->BackwardKernel(*srcGrad, *in, *kernelGrad, /*accumulateGradient=*/false, /*allowReuse=*/false, *workspace); };
+            }));
+        }
     }
-    auto t_endG = clock();
-    double valM = 1.0 * (t_endG - t_startG) / (CLOCKS_PER_SEC * count);
-    cout << "Matrix C+=alpha*A*beta*B in: " << valM << " seconds" << endl;
-
-    cout << "Testing CPUMatrix" << endl;
-    CPUMatrix<ElemType> AC(1024, 4096, data1, true);
-    CPUMatrix<ElemType> BC(4096, 1024, data2, true);
-    CPUMatrix<ElemType> VC(1024, 1, data3, true);
-    CPUMatrix<ElemType> CC(1024, 1024);
-
-    auto t_startC = clock();
-    for (int i = 0; i < count; ++i)
+
+    // 2x2 and 3x3 pooling with stride 2
+    ConvConfig pools[] = {{56, 56, 64, 2, 2, 1, 2}, {112, 112, 64, 3, 3, 1, 2}};
+    for (auto& pc : pools)
     {
-        CPUMatrix<ElemType>::MultiplyAndWeightedAdd(arr[i], AC, false, BC, false, 3.2 * arr[i], CC);
-        // CC+=(arr[i]*AC)*((arr[i]*2.3)*BC);
+        auto g = make_shared<ConvolveGeometry>(TensorShape(pc.w, pc.h, pc.c), TensorShape(pc.kw, pc.kh, 1), TensorShape(1),
+                                               TensorShape(pc.stride, pc.stride, 1), ConvolveGeometry::BoolVec{true},
+                                               ConvolveGeometry::BoolVec{pc.kw > pc.stride, pc.kh > pc.stride, false}, TensorShape(0), TensorShape(0));
+        size_t inElems = g->InputShape().GetNumElements();
+        size_t outElems = g->OutputShape().GetNumElements();
+        for (auto poolKind : {PoolKind::Max, PoolKind::Average})
+        {
+            string params = Params({{"input", string(g->InputShape())}, {"window", string(g->KernelShape())}, {"stride", ToString(pc.stride)},
+                                    {"n", ToString(n)}, {"kind", poolKind == PoolKind::Max ? "max" : "average"}});
+            cases.push_back(MakeCase<ElemType>("pooling_fwd", params, (double) sizeof(ElemType) * (inElems + outElems) * n, "byte", [=]()
+            {
+                auto eng = shared_ptr<ConvolutionEngine<ElemType>>(ConvolutionEngine<ElemType>::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, poolKind));
+                auto in = make_shared<Mat>(inElems, n, RandomVector<ElemType>(inElems * n, 1).data(), CPUDEVICE);
+                auto out = make_shared<Mat>(outElems, n, CPUDEVICE);
+                return [=]() { eng->ForwardPooling(*in, *out); };
+            }));
+            cases.push_back(MakeCase<ElemType>("pooling_bwd", params, (double) sizeof(ElemType) * (2 * inElems + 2 * outElems) * n, "byte", [=]()
+            {
+                auto eng = shared_ptr<ConvolutionEngine<ElemType>>(ConvolutionEngine<ElemType>::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, poolKind));
+                auto in = make_shared<Mat>(inElems, n, RandomVector<ElemType>(inElems * n, 1).data(), CPUDEVICE);
+                auto out = make_shared<Mat>(outElems, n, CPUDEVICE);
+                eng->ForwardPooling(*in, *out);
+                auto srcGrad = make_shared<Mat>(outElems, n, RandomVector<ElemType>(outElems * n, 2).data(), CPUDEVICE);
+                auto grad = make_shared<Mat>(inElems, n, CPUDEVICE);
+                return [=]() { grad->SetValue(0); eng->BackwardPooling(*out, *srcGrad, *in, *grad); };
+            }));
+        }
     }
-    auto t_endC = clock();
-    double valMC = 1.0 * (t_endC - t_startC) / (CLOCKS_PER_SEC * count);
-    cout << "CPUMatrix C+=alpha*A*beta*B in: " << valMC << " seconds" << endl;
-
-    delete[] arr;
-    delete[] data1;
-    delete[] data2;
-    delete[] data3;
 }
 
-int wmain()
+template <class ElemType>
+vector<Bench::Case> GetCases()
 {
-    // MandSTest<float>(100, 2);
+    vector<Bench::Case> cases;
+    AddGemmCases<ElemType>(cases);
+    AddSparseCases<ElemType>(cases);
+    AddTensorCases<ElemType>(cases);
+    AddConvolutionCases<ElemType>(cases);
+    return cases;
+}
 
-    /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
-    SquareMultiplyAndAdd10TimesAvgTest<float>(4096,10);
+// -----------------------------------------------------------------------
+// command line
+// -----------------------------------------------------------------------
 
-    cout<<endl<<"********************Matrix AddMultiplyAndInplaceSigmoid TEST********************"<<endl;    
-    AddMultiplyAndInplaceSigmoidTest<float>(11,10,12);    
-    AddMultiplyAndInplaceSigmoidTest<float>(110,100,120);    
-    AddMultiplyAndInplaceSigmoidTest<float>(1100,1000,1200);    
-    AddMultiplyAndInplaceSigmoidTest<float>(11000,10000,1200);
+static vector<string> SplitList(const string& s)
+{
+    vector<string> result;
+    istringstream is(s);
+    string item;
+    while (getline(is, item, ','))
+    {
+        if (!item.empty())
+            result.push_back(item);
+    }
+    return result;
+}
 
-    cout<<endl<<"********************Matrix MultiplyAndWeightedAdd TEST********************"<<endl;    
-    MultiplyAndWeightedAddTest<float>(11,10,12);    
-    MultiplyAndWeightedAddTest<float>(110,100,120);    
-    MultiplyAndWeightedAddTest<float>(1100,1000,1200);    
-    MultiplyAndWeightedAddTest<float>(11000,10000,12000);*/
+int main(int argc, char* argv[])
+{
+    Bench::Options options;
+    vector<int> threads = {1, (int) max(1u, thread::hardware_concurrency())};
+    vector<string> types = {"float", "double"};
+    Bench::Format format = Bench::Format::text;
+    string outputPath;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        auto eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "filter")
+            options.m_filter = value;
+        else if (key == "threads")
+        {
+            threads.clear();
+            for (auto& t : SplitList(value))
+                threads.push_back(atoi(t.c_str()));
+        }
+        else if (key == "types")
+            types = SplitList(value);
+        else if (key == "warmup")
+            options.m_warmupSamples = (size_t) atoi(value.c_str());
+        else if (key == "samples")
+            options.m_samples = max((size_t) 1, (size_t) atoi(value.c_str()));
+        else if (key == "minSampleTime")
+            options.m_minSampleSeconds = atof(value.c_str());
+        else if (key == "format" && (value == "text" || value == "csv" || value == "json"))
+            format = value == "csv" ? Bench::Format::csv : value == "json" ? Bench::Format::json : Bench::Format::text;
+        else if (key == "output")
+            outputPath = value;
+        else if (key == "list")
+            list = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [filter=<substring>] [threads=1,8] [types=float,double] [warmup=2] [samples=10] [minSampleTime=0.05]\n"
+                            "          [format=text|csv|json] [output=<file>] [list]\n", argv[0]);
+            return 1;
+        }
+    }
 
-    return 0;
+    // all cases are constructed up front (cheap, operands are allocated by Setup() only), so that 'list' can show them
+    vector<Bench::Case> cases;
+    for (auto& type : types)
+    {
+        auto typeCases = type == "double" ? GetCases<double>() : type == "float" ? GetCases<float>() : vector<Bench::Case>();
+        if (typeCases.empty())
+        {
+            fprintf(stderr, "Unknown element type '%s'.\n", type.c_str());
+            return 1;
+        }
+        for (auto& c : typeCases)
+        {
+            if (Bench::Matches(c, options.m_filter))
+                cases.push_back(c);
+        }
+    }
+    if (list)
+    {
+        for (auto& c : cases)
+            printf("%s %s %s\n", c.m_name.c_str(), c.m_params.c_str(), c.m_elemType.c_str());
+        return 0;
+    }
+
+    FILE* out = stdout;
+    if (!outputPath.empty())
+    {
+        out = fopen(outputPath.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot open '%s' for writing.\n", outputPath.c_str());
+            return 1;
+        }
+    }
+
+    int exitCode = 0;
+    bool first = true;
+    Bench::WriteHeader(out, format);
+    for (auto numThreads : threads)
+    {
+        int actualThreads = CPUMatrix<float>::SetNumThreads(numThreads);
+        for (auto& c : cases)
+        {
+            try
+            {
+                auto result = Bench::Run(c, actualThreads, options);
+                Bench::WriteResult(out, format, result, first);
+                first = false;
+            }
+            catch (const exception& e)
+            {
+                fprintf(stderr, "%s %s %s: failed: %s\n", c.m_name.c_str(), c.m_params.c_str(), c.m_elemType.c_str(), e.what());
+                exitCode = 1;
+            }
+        }
+    }
+    Bench::WriteFooter(out, format);
+    if (out != stdout)
+        fclose(out);
+    return exitCode;
 }
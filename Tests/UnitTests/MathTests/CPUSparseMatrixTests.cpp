@@ -116,6 +116,75 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixEmbeddingGradient, RandomSeedFixture)
+{
+    // gradient of an embedding with one-hot input: one block per distinct id, block ids sorted
+    const size_t m = 40;
+    const size_t n = 300;
+    const size_t t = 64;
+
+    DenseMatrix dm0(m, t);
+    dm0.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    DenseMatrix dmGrad(m, n);
+    dmGrad.SetValue(0);
+    SparseMatrix smGrad(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        DenseMatrix dm1(n, t);
+        dm1.SetValue(0);
+        SparseMatrix sm1(MatrixFormat::matrixFormatSparseCSC, n, t, 0);
+        for (size_t col = 0; col < t; col++)
+        {
+            size_t id = ((col * 37 + 11 + pass * 23) % 60) * 5;
+            dm1(id, col) = 1;
+            sm1.SetValue(id, col, 1);
+        }
+
+        DenseMatrix::MultiplyAndAdd(dm0, false, dm1, true, dmGrad);
+        SparseMatrix::MultiplyAndAdd(1, dm0, false, sm1, true, smGrad);
+    }
+
+    const size_t* blockIds = smGrad.BlockIdsLocation();
+    for (size_t j = 1; j < smGrad.GetBlockSize(); j++)
+        BOOST_CHECK(blockIds[j - 1] < blockIds[j]);
+
+    foreach_coord(row, col, dmGrad)
+    {
+        BOOST_CHECK(abs(smGrad(row, col) - dmGrad(row, col)) < c_epsilonFloatE4);
+    }
+
+    // NormalGrad and Adagrad only touch the columns present in the gradient
+    DenseMatrix dmSmoothed(m, n);
+    dmSmoothed.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix dmSmoothedExpected(dmSmoothed);
+    const double momentum = 0.9;
+    foreach_coord(row, col, dmGrad)
+    {
+        if (dmGrad(row, col) != 0)
+            dmSmoothedExpected(row, col) = (1 - momentum) * dmGrad(row, col) + momentum * dmSmoothed(row, col);
+    }
+
+    SparseMatrix smNormal(smGrad);
+    smNormal.NormalGrad(dmSmoothed, momentum, true);
+    foreach_coord(row, col, dmSmoothed)
+    {
+        BOOST_CHECK(abs(dmSmoothed(row, col) - dmSmoothedExpected(row, col)) < c_epsilonFloatE4);
+    }
+
+    DenseMatrix dmAccumulated(m, n);
+    dmAccumulated.SetValue(1);
+    SparseMatrix smAdagrad(smGrad);
+    smAdagrad.Adagrad(dmAccumulated, false);
+    foreach_coord(row, col, dmGrad)
+    {
+        const double g = dmGrad(row, col);
+        BOOST_CHECK(abs(dmAccumulated(row, col) - (1 + g * g)) < c_epsilonFloatE4);
+        BOOST_CHECK(abs(smAdagrad(row, col) - g / sqrt(1 + g * g)) < c_epsilonFloatE4);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
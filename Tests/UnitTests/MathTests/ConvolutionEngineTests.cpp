@@ -15,6 +15,7 @@
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/ConvolutionEngine.h"
 #include "../../../Source/Math/CuDnnFactories.h"
+#include "../../../Source/Math/Int8QuantizedOperations.h"
 #include "common.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -62,6 +63,11 @@ std::vector<std::tuple<ConvolutionEngineKind, DEVICEID_TYPE, size_t>> GetTestEng
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 0));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 1));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 3));
+
+    // Winograd engine. Implemented only for CPU, handles 3x3 stride 1 convolutions and uses Gemm engine for others.
+    auto winogradKind = (ConvolutionEngineKind)((int)ConvolutionEngineKind::Winograd | (int)ConvolutionEngineKind::Gemm);
+    res.push_back(std::make_tuple(winogradKind, -1, 0));
+    res.push_back(std::make_tuple(winogradKind, -1, 2));
     return res;
 }
 
@@ -116,6 +122,15 @@ std::vector<ConvolveGeometryPtr> GenerateConvTestConfigs()
         ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
         TensorShape(0), TensorShape(0)));
 
+    // 3x3 convolutions with more than one output tile per dimension, including partially covered ones (Winograd engine).
+    for (bool pad : {false, true})
+    {
+        res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(17, 12, 4),
+            TensorShape(3, 3, 4), TensorShape(6), TensorShape(1, 1, 4),
+            ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{pad, pad, false},
+            TensorShape(0), TensorShape(0)));
+    }
+
     // 1x1 convolution (shortcuts in ResNet).
     res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(16, 16, 2),
         TensorShape(1, 1, 2), TensorShape(1), TensorShape(2, 2, 1),
@@ -160,6 +175,17 @@ std::vector<ConvolveGeometryPtr> GeneratePoolTestConfigs()
         TensorShape(3, 3, 1), TensorShape(1), TensorShape(2, 2, 1),
         ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
         TensorShape(0), TensorShape(0)));
+    // Wider planes, so that specialized CPU pooling processes several output columns at once.
+    for (size_t k : {2, 3})
+    {
+        for (size_t stride : {1, 2})
+        {
+            res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(19, 14, 3),
+                TensorShape(k, k, 1), TensorShape(1), TensorShape(stride, stride, 1),
+                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+                TensorShape(0), TensorShape(0)));
+        }
+    }
     return res;
 }
 
@@ -222,17 +248,134 @@ BOOST_AUTO_TEST_CASE(ConvolutionForward)
             std::string msgNan = " has NaNs, " + tmsg.str();
             std::string msgNotNan = " has buffer overflow/underflow, " + tmsg.str();
 
-            float relErr = Err<float>::Rel;
-            float absErr = Err<float>::Abs;
+            float relErr = Err<float>::Rel * 4;
+            float absErr = Err<float>::Abs * 14;
+            // The rounding error of an output is proportional to eps * sum |w * x| over its receptive field, so it grows with
+            // the filter size and the magnitude of the inputs. Winograd transforms amplify it by a constant factor that depends
+            // on the tile size (up to about 15 was measured for F(4x4,3x3), about 2 for F(2x2,3x3)). Hence the tolerance for
+            // Winograd is derived from the largest such sum, computed by convolving the absolute values, with a factor of 32.
+            if (((int)engKind & (int)ConvolutionEngineKind::Winograd) != 0)
+            {
+                SingleMatrix absIn(baseDeviceId), absKernel(baseDeviceId);
+                absIn.AssignAbsOf(inB);
+                absKernel.AssignAbsOf(kernelB);
+                SingleMatrix magnitude(crowOut, n, baseDeviceId);
+                baseEng->Forward(absIn, absKernel, magnitude, workspaceB);
+                absErr = std::max(absErr, 32 * Err<float>::Abs * magnitude.MatrixNormInf());
+            }
             std::string emsg;
 
             BOOST_REQUIRE_MESSAGE(!out.HasNan("out"), "out" << msgNan);
-            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr * 4, absErr * 14), "out" << msg << ". " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr, absErr), "out" << msg << ". " << emsg);
             BOOST_REQUIRE_MESSAGE(CountNans(outBuf) == crowOut * 2 * n, "out" << msgNotNan);
         }
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionForwardBiasActivation)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    // Compare fused convolution + bias (+ ReLU) against plain convolution followed by the same operations.
+    auto g = std::make_shared<ConvolveGeometry>(TensorShape(9, 7, 3), TensorShape(3, 3, 3), TensorShape(5), TensorShape(1, 1, 3),
+                                                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+                                                TensorShape(0), TensorShape(0));
+    size_t mapCount = 5;
+    size_t n = 4;
+    size_t crowOut = g->OutputShape().GetNumElements();
+    size_t mapSize = crowOut / mapCount;
+    for (auto engKind : {ConvolutionEngineKind::Reference, ConvolutionEngineKind::Gemm})
+    {
+        auto eng = ConvEng::Create(g, -1, ImageLayoutKind::CHW, 0, PoolKind::None, engKind);
+
+        vec buf(g->InputShape().GetNumElements() * n);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), -1, matrixFlagNormal);
+        buf.resize(g->KernelShape().GetNumElements() * mapCount);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), -1, matrixFlagNormal);
+        buf.resize(mapCount);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        SingleMatrix bias(mapCount, 1, buf.data(), -1, matrixFlagNormal);
+        SingleMatrix empty(-1);
+
+        SingleMatrix expected(crowOut, n, -1);
+        SingleMatrix workspace(-1);
+        eng->Forward(in, kernel, expected, workspace);
+
+        for (bool applyReLU : {false, true})
+        {
+            for (bool useBias : {false, true})
+            {
+                SingleMatrix out(crowOut, n, -1);
+                out.SetValue(std::numeric_limits<float>::quiet_NaN());
+                eng->ForwardBiasActivation(in, kernel, useBias ? bias : empty, applyReLU, out, workspace);
+                foreach_coord (i, j, out)
+                {
+                    float v = expected(i, j) + (useBias ? bias(i / mapSize, 0) : 0);
+                    if (applyReLU)
+                        v = std::max(v, 0.0f);
+                    BOOST_REQUIRE_MESSAGE(AreEqual(out(i, j), v, Err<float>::Rel * 4, Err<float>::Abs * 14),
+                                          "ForwardBiasActivation mismatch at (" << i << ", " << j << "), bias: " << useBias << ", ReLU: " << applyReLU);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionForwardInt8)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    // Compare int8 GEMM convolution against the float one, with and without sub-batching.
+    auto g = std::make_shared<ConvolveGeometry>(TensorShape(9, 7, 8), TensorShape(3, 3, 8), TensorShape(6), TensorShape(2, 1, 8),
+                                                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+                                                TensorShape(0), TensorShape(0));
+    size_t mapCount = 6;
+    size_t crowOut = g->OutputShape().GetNumElements();
+    for (size_t maxTempMem : {0, 1, 3})
+    {
+        for (size_t n : {1, 5})
+        {
+            auto eng = ConvEng::Create(g, -1, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Gemm);
+
+            vec buf(g->InputShape().GetNumElements() * n);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix in(g->InputShape().GetNumElements(), n, buf.data(), -1, matrixFlagNormal);
+            buf.resize(g->KernelShape().GetNumElements() * mapCount);
+            std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+            SingleMatrix kernel(mapCount, g->KernelShape().GetNumElements(), buf.data(), -1, matrixFlagNormal);
+
+            SingleMatrix expected(crowOut, n, -1);
+            SingleMatrix workspace(-1);
+            eng->Forward(in, kernel, expected, workspace);
+
+            BOOST_REQUIRE(eng->SetInt8Multiplier(std::make_shared<Int8QuantizedMultiplier<float>>(/*isAConstant=*/true)));
+            SingleMatrix out(crowOut, n, -1);
+            out.SetValue(std::numeric_limits<float>::quiet_NaN());
+            eng->Forward(in, kernel, out, workspace);
+
+            // int8 error is relative to the range of the output, not to each value
+            float maxAbsError = expected.MatrixNormInf() * 0.03f;
+            foreach_coord (i, j, out)
+            {
+                BOOST_REQUIRE_MESSAGE(AreEqual(out(i, j), expected(i, j), 0, maxAbsError),
+                                      "Int8 convolution mismatch at (" << i << ", " << j << "), batch: " << n << ", maxTempMem: " << maxTempMem);
+            }
+        }
+    }
+
+    // Winograd engine does not support int8.
+    auto gw = std::make_shared<ConvolveGeometry>(TensorShape(8, 8, 2), TensorShape(3, 3, 2), TensorShape(4), TensorShape(1, 1, 2),
+                                                 ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+                                                 TensorShape(0), TensorShape(0));
+    auto winogradKind = (ConvolutionEngineKind)((int)ConvolutionEngineKind::Winograd | (int)ConvolutionEngineKind::Gemm);
+    auto engW = ConvEng::Create(gw, -1, ImageLayoutKind::CHW, 0, PoolKind::None, winogradKind);
+    BOOST_REQUIRE(!engW->SetInt8Multiplier(std::make_shared<Int8QuantizedMultiplier<float>>(/*isAConstant=*/true)));
+}
+
 BOOST_AUTO_TEST_CASE(ConvolutionBackwardData)
 {
     std::mt19937 rng(0);
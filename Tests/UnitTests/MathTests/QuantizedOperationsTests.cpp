@@ -3,7 +3,10 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 #include "stdafx.h"
+#include <algorithm>
+#include <random>
 #include "../../../Source/Math/QuantizedOperations.h"
+#include "../../../Source/Math/Int8QuantizedOperations.h"
 #include "../../../Source/Math/Helpers.h"
 
 using namespace Microsoft::MSR::CNTK;
@@ -50,6 +53,111 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
         BOOST_CHECK_EQUAL(round(C_upd[i]), C_expected_upd[i]);
 }
 
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8Exact, RandomSeedFixture)
+{
+    // A is quantized to 7 bit and B to 8 bit: integers in [-63, 63] with an absolute max of 63 in every row of A and
+    // integers in [-127, 127] with an absolute max of 127 in B are quantized without loss, so the product must be exact.
+    // m and k are not multiples of the block sizes.
+    int m = 9, n = 4, k = 45;
+    std::vector<float> A(m * k), B(k * n), C(m * n);
+    for (int i = 0; i < m * k; i++)
+        A[i] = (float)((i * 37) % 127 - 63);
+    for (int i = 0; i < k * n; i++)
+        B[i] = (float)((i * 11) % 255 - 127);
+    for (int i = 0; i < m; i++)
+        A[i] = 63;
+    B[0] = 127;
+
+    Int8QuantizedMultiplier<float> mult(/*isAConstant=*/true);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                float expected = 0;
+                for (int l = 0; l < k; l++)
+                    expected += A[i + l * m] * B[l + j * k];
+                BOOST_CHECK_EQUAL(C[i + j * m], expected);
+            }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8NoSaturation, RandomSeedFixture)
+{
+    // The extreme values must not saturate the 16-bit intermediate sums of the kernel.
+    int m = 5, n = 2, k = 64;
+    std::vector<float> A(m * k), B(k * n), C(m * n);
+    for (int i = 0; i < m * k; i++)
+        A[i] = (i % m) % 2 ? -63.0f : 63.0f;
+    for (int l = 0; l < k; l++)
+    {
+        B[l] = 127;
+        B[l + k] = -127;
+    }
+
+    Int8QuantizedMultiplier<float> mult(/*isAConstant=*/true);
+    mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+    for (int i = 0; i < m; i++)
+    {
+        float expected = (i % 2 ? -63.0f : 63.0f) * 127 * k;
+        BOOST_CHECK_EQUAL(C[i], expected);
+        BOOST_CHECK_EQUAL(C[i + m], -expected);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8Layouts, RandomSeedFixture)
+{
+    // Compare against the float product; A transposed and C written transposed must give the same values.
+    int m = 13, n = 7, k = 70;
+    std::mt19937 rng(0);
+    std::normal_distribution<float> nd;
+    std::vector<float> A(m * k), AT(m * k), B(k * n), C(m * n), CT(m * n), expected(m * n, 0);
+    std::generate(A.begin(), A.end(), [&] { return nd(rng); });
+    std::generate(B.begin(), B.end(), [&] { return nd(rng); });
+    for (int i = 0; i < m; i++)
+        for (int l = 0; l < k; l++)
+            AT[l + i * k] = A[i + l * m];
+    float maxAbs = 0;
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+        {
+            for (int l = 0; l < k; l++)
+                expected[i + j * m] += A[i + l * m] * B[l + j * k];
+            maxAbs = std::max(maxAbs, std::abs(expected[i + j * m]));
+        }
+
+    Int8QuantizedMultiplier<float> mult(/*isAConstant=*/true);
+    mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+    Int8QuantizedMultiplier<float> multT(/*isAConstant=*/true);
+    multT.Multiply(m, n, k, AT.data(), /*isATransposed=*/true, B.data(), CT.data(), /*rowStride=*/n, /*colStride=*/1);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+        {
+            BOOST_CHECK_SMALL(C[i + j * m] - expected[i + j * m], maxAbs * 0.03f);
+            BOOST_CHECK_EQUAL(CT[i * n + j], C[i + j * m]);
+        }
+}
+
+BOOST_FIXTURE_TEST_CASE(MultiplyInt8Calibration, RandomSeedFixture)
+{
+    // After two calibration calls the range of B is fixed to the larger of the two, and larger values are clipped.
+    int m = 1, n = 1, k = 2;
+    std::vector<float> A = { 1, 1 };
+    std::vector<float> B1 = { 1, 0 }, B2 = { 2, 0 }, B3 = { 4, 1 };
+    float C = 0;
+
+    Int8QuantizedMultiplier<float> mult(/*isAConstant=*/true, /*calibrationCount=*/2);
+    mult.Multiply(m, n, k, A.data(), B1.data(), &C);
+    BOOST_CHECK_CLOSE(C, 1, 1e-3);
+    BOOST_CHECK(!mult.IsCalibrated());
+    mult.Multiply(m, n, k, A.data(), B2.data(), &C);
+    BOOST_CHECK_CLOSE(C, 2, 1e-3);
+    BOOST_CHECK(mult.IsCalibrated());
+    BOOST_CHECK_EQUAL(mult.CalibratedRange(), 2);
+    mult.Multiply(m, n, k, A.data(), B3.data(), &C);
+    BOOST_CHECK_CLOSE(C, 3, 1); // 2 (clipped) + 1
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
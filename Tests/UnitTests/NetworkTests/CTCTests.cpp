@@ -0,0 +1,96 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "SpecialPurposeNodes.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(CTCTests)
+
+// log P(labels) and its gradient, by summing over all paths that collapse to the labels
+static double BruteForceCTC(const std::vector<double>& logits, size_t numClasses, size_t numFrames, const std::vector<size_t>& labels, size_t blank)
+{
+    std::vector<double> logProbs(logits.size());
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        double sum = 0;
+        for (size_t k = 0; k < numClasses; k++)
+            sum += exp(logits[t * numClasses + k]);
+        for (size_t k = 0; k < numClasses; k++)
+            logProbs[t * numClasses + k] = logits[t * numClasses + k] - log(sum);
+    }
+
+    size_t numPaths = 1;
+    for (size_t t = 0; t < numFrames; t++)
+        numPaths *= numClasses;
+
+    double p = 0;
+    for (size_t index = 0; index < numPaths; index++)
+    {
+        std::vector<size_t> collapsed;
+        double logP = 0;
+        size_t prev = SIZE_MAX;
+        for (size_t t = 0, rest = index; t < numFrames; t++, rest /= numClasses)
+        {
+            size_t k = rest % numClasses;
+            if (k != prev && k != blank)
+                collapsed.push_back(k);
+            prev = k;
+            logP += logProbs[t * numClasses + k];
+        }
+        if (collapsed == labels)
+            p += exp(logP);
+    }
+    return log(p);
+}
+
+BOOST_AUTO_TEST_CASE(CTCForwardBackwardTest)
+{
+    const size_t numClasses = 4, numFrames = 5, blank = 3;
+    const std::vector<size_t> labels = { 0, 1, 1 };
+
+    std::vector<double> logits(numClasses * numFrames);
+    for (size_t i = 0; i < logits.size(); i++)
+        logits[i] = sin(i * 1.7) * 2; // arbitrary
+
+    // frames are interleaved with another sequence, as in a minibatch with two parallel sequences
+    const size_t stride = 2 * numClasses;
+    std::vector<double> logProbs(stride * numFrames), derivative(stride * numFrames);
+    double expected = BruteForceCTC(logits, numClasses, numFrames, labels, blank);
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        double sum = 0;
+        for (size_t k = 0; k < numClasses; k++)
+            sum += exp(logits[t * numClasses + k]);
+        for (size_t k = 0; k < numClasses; k++)
+            logProbs[t * stride + k] = logits[t * numClasses + k] - log(sum);
+    }
+
+    double logLikelihood = CTCWithSoftmaxNode<double>::ForwardBackward(logProbs.data(), numClasses, numFrames, stride, labels, blank, derivative.data());
+    BOOST_CHECK_CLOSE(logLikelihood, expected, 1e-6);
+
+    // the derivative of -log P(labels) w.r.t. the logits, against finite differences
+    const double epsilon = 1e-5;
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        for (size_t k = 0; k < numClasses; k++)
+        {
+            auto plus = logits, minus = logits;
+            plus[t * numClasses + k] += epsilon;
+            minus[t * numClasses + k] -= epsilon;
+            double numerical = -(BruteForceCTC(plus, numClasses, numFrames, labels, blank) - BruteForceCTC(minus, numClasses, numFrames, labels, blank)) / (2 * epsilon);
+            BOOST_CHECK_SMALL(derivative[t * stride + k] - numerical, 1e-6);
+        }
+    }
+
+    // repeated labels need a blank in between, so that { 0, 0, 0 } does not fit into 4 frames
+    double impossible = CTCWithSoftmaxNode<double>::ForwardBackward(logProbs.data(), numClasses, 4, stride, { 0, 0, 0 }, blank, derivative.data());
+    BOOST_CHECK(impossible == -std::numeric_limits<double>::infinity());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,189 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "WorkStealingThreadPool.h"
+#include "Globals.h"
+#include <atomic>
+#include <thread>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ConcurrentExecutionTests)
+
+BOOST_AUTO_TEST_CASE(WorkStealingThreadPoolDependencyTest)
+{
+    // a layered graph: every task of a layer depends on two tasks of the previous layer
+    const size_t numLayers = 20, width = 8, numTasks = numLayers * width;
+    std::vector<size_t> numPredecessors(numTasks, 0);
+    std::vector<std::vector<size_t>> successors(numTasks);
+    for (size_t layer = 1; layer < numLayers; layer++)
+    {
+        for (size_t k = 0; k < width; k++)
+        {
+            size_t task = layer * width + k;
+            for (size_t predecessor : { (layer - 1) * width + k, (layer - 1) * width + (k + 1) % width })
+            {
+                successors[predecessor].push_back(task);
+                numPredecessors[task]++;
+            }
+        }
+    }
+
+    WorkStealingThreadPool pool(4);
+    for (int run = 0; run < 10; run++) // the pool is reused
+    {
+        std::atomic<size_t> counter(0);
+        std::vector<size_t> finished(numTasks, SIZE_MAX);
+        std::vector<size_t> started(numTasks, SIZE_MAX);
+        pool.Run(numPredecessors, successors, [&](size_t task)
+        {
+            started[task] = counter++;
+            finished[task] = counter++;
+        });
+
+        for (size_t task = 0; task < numTasks; task++)
+        {
+            BOOST_REQUIRE(started[task] != SIZE_MAX);
+            for (size_t successor : successors[task])
+                BOOST_REQUIRE(finished[task] < started[successor]);
+        }
+    }
+
+    // an exception ends the run and is rethrown
+    BOOST_CHECK_THROW(pool.Run(numPredecessors, successors, [](size_t task)
+    {
+        if (task == 3 * width)
+            RuntimeError("task failed");
+    }), std::runtime_error);
+}
+
+// ConstOnes() is called by nodes that may be executed concurrently
+template <class ElemType>
+class ConstOnesTest : public ComputationNode<ElemType>
+{
+public:
+    using ComputationNode<ElemType>::ConstOnes;
+};
+
+BOOST_AUTO_TEST_CASE(ConstOnesConcurrencyTest)
+{
+    std::vector<std::thread> threads;
+    std::atomic<int> numErrors(0);
+    for (size_t t = 0; t < 8; t++)
+    {
+        threads.push_back(std::thread([t, &numErrors]()
+        {
+            for (size_t i = 0; i < 200; i++)
+            {
+                size_t rows = 1 + (i + t) % 13, cols = 1 + i % 7;
+                const auto& ones = ConstOnesTest<float>::ConstOnes(rows, cols, CPUDEVICE);
+                if (ones.GetNumRows() != rows || ones.GetNumCols() != cols || ones.SumOfElements() != rows * cols)
+                    numErrors++;
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(numErrors, 0);
+}
+
+// forward and backward propagation of a network with independent branches, which are executed concurrently with nodeExecutionThreads > 1
+struct BranchedNetwork
+{
+    static const size_t inputDim = 8, hiddenDim = 16, outputDim = 4, numBranches = 4, numSamples = 32;
+
+    ComputationNetworkPtr net;
+    ComputationNodeBasePtr criterion;
+    std::vector<ComputationNodeBasePtr> inputs, outputs;
+
+    BranchedNetwork()
+    {
+        net = make_shared<ComputationNetwork>(CPUDEVICE);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto features = builder.CreateInputNode(L"features", inputDim);
+        auto labels = builder.CreateInputNode(L"labels", outputDim);
+        shared_ptr<ComputationNode<float>> sum;
+        for (size_t i = 0; i < numBranches; i++)
+        {
+            auto W = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"W%d", (int)i), hiddenDim, inputDim);
+            auto V = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"V%d", (int)i), outputDim, hiddenDim);
+            net->InitLearnableParameters(W, L"uniform", 1, (unsigned long)(2 * i + 1));
+            net->InitLearnableParameters(V, L"uniform", 1, (unsigned long)(2 * i + 2));
+            auto hidden = i % 2 ? builder.Sigmoid(builder.Times(W, features)) : builder.Tanh(builder.Times(W, features));
+            auto branch = builder.Times(V, hidden);
+            sum = sum ? builder.Plus(sum, branch) : branch;
+        }
+        auto ce = builder.CrossEntropyWithSoftmax(labels, sum, L"ce");
+        net->AddToNodeGroup(L"feature", features);
+        net->AddToNodeGroup(L"label", labels);
+        net->AddToNodeGroup(L"criterion", ce);
+        net->CompileNetwork();
+        net->AllocateAllMatrices({}, {}, ce);
+        criterion = ce;
+        inputs = { features, labels };
+        outputs = { ce, sum };
+
+        // the same minibatch for every run
+        std::vector<float> featureValues(inputDim * numSamples), labelValues(outputDim * numSamples, 0);
+        for (size_t i = 0; i < featureValues.size(); i++)
+            featureValues[i] = (float)sin(0.37 * i);
+        for (size_t j = 0; j < numSamples; j++)
+            labelValues[j * outputDim + j % outputDim] = 1;
+        net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numSamples);
+        dynamic_pointer_cast<ComputationNode<float>>(features)->Value().SetValue(inputDim, numSamples, CPUDEVICE, featureValues.data());
+        dynamic_pointer_cast<ComputationNode<float>>(labels)->Value().SetValue(outputDim, numSamples, CPUDEVICE, labelValues.data());
+    }
+
+    // returns the criterion, the network output and the gradients of all parameters
+    std::vector<std::vector<float>> Run()
+    {
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+        net->StartEvaluateMinibatchLoop(criterion);
+        ComputationNetwork::BumpEvalTimeStamp(inputs);
+        net->ForwardProp(criterion);
+        net->Backprop(criterion);
+
+        std::vector<std::vector<float>> results;
+        auto copy = [&results](const Matrix<float>& matrix)
+        {
+            std::unique_ptr<float[]> data(matrix.CopyToArray());
+            results.push_back(std::vector<float>(data.get(), data.get() + matrix.GetNumElements()));
+        };
+        for (const auto& output : outputs)
+            copy(dynamic_pointer_cast<ComputationNode<float>>(output)->Value());
+        for (const auto& parameter : net->LearnableParameterNodes(criterion))
+            copy(dynamic_pointer_cast<ComputationNode<float>>(parameter)->Gradient());
+        return results;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(ConcurrentNodeExecutionMatchesSequentialTest)
+{
+    BranchedNetwork network;
+
+    Globals::SetNodeExecutionThreads(1);
+    auto expected = network.Run();
+
+    Globals::SetNodeExecutionThreads(4);
+    for (int run = 0; run < 5; run++)
+    {
+        auto actual = network.Run();
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            BOOST_REQUIRE_EQUAL(actual[i].size(), expected[i].size());
+            for (size_t k = 0; k < expected[i].size(); k++)
+                BOOST_REQUIRE_SMALL(actual[i][k] - expected[i][k], 1e-5f);
+        }
+    }
+    Globals::SetNodeExecutionThreads(1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,145 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NetworkTestHelper.h"
+#include "ComputationNetworkBuilder.h"
+#include "DataWriter.h"
+#include "SimpleOutputWriter.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+struct DistributedOutputFixture : DataFixture
+{
+    DistributedOutputFixture()
+        : DataFixture("/Data")
+    {
+    }
+};
+
+// reads the partition of the data of one out of several workers, like the 'write' command does with MPI
+class WorkerDataReader : public IDataReader
+{
+    DataReader& m_reader;
+    size_t m_rank;
+    size_t m_numWorkers;
+
+public:
+    WorkerDataReader(DataReader& reader, size_t rank, size_t numWorkers)
+        : m_reader(reader), m_rank(rank), m_numWorkers(numWorkers)
+    {
+    }
+
+    virtual void Init(const ConfigParameters&) override { NOT_IMPLEMENTED; }
+    virtual void Init(const ScriptableObjects::IConfigRecord&) override { NOT_IMPLEMENTED; }
+    virtual void Destroy() override { }
+
+    virtual void StartMinibatchLoop(size_t mbSize, size_t epoch, size_t requestedEpochSamples = requestDataSize) override
+    {
+        m_reader.StartDistributedMinibatchLoop(mbSize, epoch, m_rank, m_numWorkers, requestedEpochSamples);
+    }
+    virtual void StartMinibatchLoop(size_t mbSize, size_t epoch, const std::unordered_set<InputStreamDescription>& streamDescriptions, size_t requestedEpochSamples = requestDataSize) override
+    {
+        m_reader.StartDistributedMinibatchLoop(mbSize, epoch, m_rank, m_numWorkers, streamDescriptions, requestedEpochSamples);
+    }
+    virtual bool SupportsDistributedMBRead() const override { return m_reader.SupportsDistributedMBRead(); }
+    virtual bool IsLegacyReader() const override { return m_reader.IsLegacyReader(); }
+    // A worker receives no data for a minibatch if all of its sequences went to the other workers. The 'write' command then goes on
+    // reading until no worker has read anything; here we skip such minibatches until the sample position stops advancing.
+    virtual bool GetMinibatch(StreamMinibatchInputs& matrices) override
+    {
+        for (;;)
+        {
+            size_t samplePosition = m_reader.GetCurrentSamplePosition();
+            if (m_reader.GetMinibatch(matrices))
+                return true;
+            if (m_reader.GetCurrentSamplePosition() == samplePosition) // end of the epoch
+                return false;
+        }
+    }
+    virtual size_t GetNumParallelSequencesForFixingBPTTMode() override { return m_reader.GetNumParallelSequencesForFixingBPTTMode(); }
+    virtual bool DataEnd() override { return m_reader.DataEnd(); }
+    virtual void CopyMBLayoutTo(MBLayoutPtr pMBLayout) override { m_reader.CopyMBLayoutTo(pMBLayout); }
+};
+
+static ComputationNetworkPtr CreateNetwork()
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", 2);
+    auto W = builder.CreateLearnableParameter(L"W", 3, 2);
+    net->InitLearnableParameters(W, L"uniform", 1, 1);
+    auto out = builder.Tanh(builder.Times(W, features), L"out");
+    net->AddToNodeGroup(L"feature", features);
+    net->AddToNodeGroup(L"output", out);
+    net->CompileNetwork();
+    return net;
+}
+
+static std::string ReadFile(const std::wstring& path)
+{
+    std::ifstream stream(msra::strfun::utf8(path), std::ios::binary);
+    BOOST_REQUIRE(stream.good());
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+// returns the header and the "<first sample> <number of samples>" of all sequences (the seqIds depend on the minibatches)
+static std::vector<std::string> ReadIndexFile(const std::wstring& path)
+{
+    std::istringstream stream(ReadFile(path));
+    std::vector<std::string> entries;
+    std::string line;
+    for (bool isHeader = true; std::getline(stream, line); isHeader = false)
+        entries.push_back(isHeader ? line : line.substr(line.find(' ') + 1));
+    return entries;
+}
+
+BOOST_FIXTURE_TEST_SUITE(DistributedOutputTestSuite, DistributedOutputFixture)
+
+BOOST_AUTO_TEST_CASE(MergedDistributedOutputMatchesSingleWorker)
+{
+    const size_t mbSize = 4, numWorkers = 3;
+
+    ConfigParameters config;
+    config.LoadConfigFile(L"../Config/Network_Distributed_Output.cntk");
+    const ConfigParameters readerConfig(config(L"reader"));
+
+    WriteFormattingOptions formattingOptions;
+    formattingOptions.isBinary = true;
+
+    auto net = CreateNetwork();
+    SimpleOutputWriter<float> writer(net);
+
+    const std::wstring singlePath = L"../Output/distributed.single";
+    {
+        DataReader reader(readerConfig);
+        writer.WriteOutput(reader, mbSize, singlePath, { L"out" }, formattingOptions);
+    }
+
+    std::vector<std::wstring> shardPaths;
+    for (size_t rank = 0; rank < numWorkers; rank++)
+    {
+        std::wstring shardPath = msra::strfun::wstrprintf(L"../Output/distributed.rank%d", (int)rank);
+        DataReader reader(readerConfig);
+        WorkerDataReader workerReader(reader, rank, numWorkers);
+        writer.WriteOutput(workerReader, mbSize, shardPath, { L"out" }, formattingOptions);
+        shardPaths.push_back(shardPath + L".out");
+    }
+    const std::wstring mergedPath = L"../Output/distributed.merged.out";
+    SimpleOutputWriter<float>::MergeBinaryShards(mergedPath, shardPaths);
+
+    // the workers have read different data, and merging them restores the order of the data
+    BOOST_CHECK(ReadFile(shardPaths[0]) != ReadFile(singlePath + L".out"));
+    BOOST_CHECK(ReadFile(mergedPath) == ReadFile(singlePath + L".out"));
+    auto expectedIndex = ReadIndexFile(singlePath + L".out.idx");
+    auto mergedIndex = ReadIndexFile(mergedPath + L".idx");
+    BOOST_CHECK_EQUAL(expectedIndex.size(), 1 + 11); // header and all sequences of the data
+    BOOST_CHECK_EQUAL_COLLECTIONS(mergedIndex.begin(), mergedIndex.end(), expectedIndex.begin(), expectedIndex.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,97 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// a small convolutional classifier: convolution, ReLU and a fully-connected layer, all with learnable weights
+struct ConvolutionalClassifier
+{
+    static const size_t imageSize = 10, inputChannels = 3, kernelSize = 3, mapCount = 16, outputDim = 10, numSamples = 200;
+    static const size_t convSize = imageSize - kernelSize + 1;
+
+    ComputationNetworkPtr net;
+    ComputationNodeBasePtr output;
+    std::vector<ComputationNodeBasePtr> inputs;
+
+    ConvolutionalClassifier()
+    {
+        net = make_shared<ComputationNetwork>(CPUDEVICE);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto features = builder.CreateInputNode(L"features", TensorShape(imageSize, imageSize, inputChannels));
+        auto kernel = builder.CreateLearnableParameter(L"kernel", mapCount, kernelSize * kernelSize * inputChannels);
+        auto W = builder.CreateLearnableParameter(L"W", TensorShape(outputDim, convSize, convSize, mapCount));
+        net->InitLearnableParameters(kernel, L"uniform", 1, 1);
+        net->InitLearnableParameters(W, L"uniform", 1, 2);
+        auto conv = builder.Convolution(kernel, features, TensorShape(kernelSize, kernelSize, inputChannels), TensorShape(mapCount), TensorShape(1, 1, inputChannels),
+                                        { true }, { false }, TensorShape(0), TensorShape(0), /*transpose=*/false, ImageLayoutKind::CHW, /*maxTempMemSizeInSamples=*/0);
+        output = builder.Times(W, builder.RectifiedLinear(conv), 1, L"out");
+        net->AddToNodeGroup(L"feature", features);
+        net->AddToNodeGroup(L"output", output);
+        net->CompileNetwork();
+        net->AllocateAllMatrices({ output }, {}, nullptr);
+        inputs = { features };
+
+        std::vector<float> featureValues(imageSize * imageSize * inputChannels * numSamples);
+        for (size_t i = 0; i < featureValues.size(); i++)
+            featureValues[i] = (float)sin(0.37 * i + 0.01 * i * i);
+        net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numSamples);
+        dynamic_pointer_cast<ComputationNode<float>>(features)->Value().SetValue(imageSize * imageSize * inputChannels, numSamples, CPUDEVICE, featureValues.data());
+    }
+
+    // returns the output, column by column
+    std::vector<float> Evaluate()
+    {
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+        net->StartEvaluateMinibatchLoop(output);
+        ComputationNetwork::BumpEvalTimeStamp(inputs);
+        net->ForwardProp(output);
+        const auto& value = dynamic_pointer_cast<ComputationNode<float>>(output)->Value();
+        std::unique_ptr<float[]> data(value.CopyToArray());
+        return std::vector<float>(data.get(), data.get() + value.GetNumElements());
+    }
+};
+
+static size_t ArgMax(const std::vector<float>& values, size_t column, size_t numRows)
+{
+    auto begin = values.begin() + column * numRows;
+    return std::max_element(begin, begin + numRows) - begin;
+}
+
+BOOST_AUTO_TEST_SUITE(Int8InferenceTests)
+
+BOOST_AUTO_TEST_CASE(Int8InferenceMatchesFloatNetwork)
+{
+    ConvolutionalClassifier network;
+    const size_t outputDim = ConvolutionalClassifier::outputDim, numSamples = ConvolutionalClassifier::numSamples;
+    auto expected = network.Evaluate();
+
+    BOOST_REQUIRE_EQUAL(network.net->EnableInt8Inference<float>(/*calibrationCount=*/0), 2); // the convolution and the product
+    auto actual = network.Evaluate();
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+
+    // the error of the outputs relative to their magnitude, and how often the int8 network predicts the same class
+    double sumSquaredError = 0, sumSquares = 0;
+    size_t numAgreements = 0;
+    for (size_t j = 0; j < numSamples; j++)
+    {
+        for (size_t i = j * outputDim; i < (j + 1) * outputDim; i++)
+        {
+            sumSquaredError += (actual[i] - expected[i]) * (actual[i] - expected[i]);
+            sumSquares += expected[i] * expected[i];
+        }
+        numAgreements += ArgMax(actual, j, outputDim) == ArgMax(expected, j, outputDim);
+    }
+    BOOST_CHECK_LT(sqrt(sumSquaredError / sumSquares), 0.03);
+    BOOST_CHECK_GE(numAgreements, numSamples * 95 / 100);
+    BOOST_CHECK(actual != expected); // the int8 products are actually used
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
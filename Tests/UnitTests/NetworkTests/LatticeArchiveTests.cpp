@@ -0,0 +1,271 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "latticearchive.h"
+#include <boost/filesystem.hpp>
+
+using namespace msra::lattices;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// units as numbered in the lattice archives (see the .symlist files), and the permuted numbering of the model
+static const char* const archiveUnits[] = { "sil", "a", "b", "sp" };
+static const size_t archiveSpUnit = 3;
+
+// one edge of a handcrafted lattice: start and end node, scores, and alignment (unit in archive numbering, frames)
+struct TestEdge
+{
+    size_t S, E;
+    float a, l;
+    std::vector<std::pair<size_t, size_t>> align;
+};
+
+// nodes at frames 0, 3, 5 and 8; edges sorted by end node, then by start node, like in lattices from HTK
+static std::vector<TestEdge> TestEdges(float lmScoreOffset)
+{
+    return {
+        { 0, 1, -10.0f, 0.0f, { { 0, 3 } } },
+        { 1, 2, -20.0f, -1.5f + lmScoreOffset, { { 1, 1 }, { 3, 1 } } },
+        { 1, 2, -21.0f, -2.0f + lmScoreOffset, { { 2, 2 } } },
+        { 0, 3, -50.0f, -3.0f + lmScoreOffset, { { 1, 4 }, { 2, 3 }, { 3, 1 } } },
+        { 2, 3, -10.0f, 0.0f, { { 0, 3 } } },
+    };
+}
+static const size_t testNodeTimes[] = { 0, 3, 5, 8 };
+
+// writes a lattice in the V1 format, which is what fread() expects to get from older archives
+static void WriteV1Lattice(FILE* f, const std::vector<TestEdge>& testEdges)
+{
+    struct // same layout as lattice::header_v1_v2
+    {
+        size_t numnodes : 32;
+        size_t numedges : 32;
+        float lmf;
+        float wp;
+        double frameduration;
+        size_t numframes : 32;
+        size_t impliedspunitid : 31;
+        size_t hasacscores : 1;
+    } header;
+    static_assert(sizeof(header) == 32, "unexpected size of lattice header");
+
+    std::vector<nodeinfo> nodes;
+    for (size_t t : testNodeTimes)
+        nodes.push_back(nodeinfo(t));
+    std::vector<edgeinfowithscores> edges;
+    std::vector<aligninfo> align;
+    for (const auto& edge : testEdges)
+    {
+        edges.push_back(edgeinfowithscores(edge.S, edge.E, edge.a, edge.l, align.size()));
+        for (const auto& unit : edge.align)
+            align.push_back(aligninfo(unit.first, unit.second));
+    }
+
+    header.numnodes = nodes.size();
+    header.numedges = edges.size();
+    header.lmf = 14.0f;
+    header.wp = 0.0f;
+    header.frameduration = 0.01;
+    header.numframes = nodes.back().t;
+    header.impliedspunitid = INT_MAX;
+    header.hasacscores = 1;
+
+    fputTag(f, "LAT ");
+    fputint(f, 1);
+    fwriteOrDie(&header, sizeof(header), 1, f);
+    fputTag(f, "NODE");
+    fputint(f, (int) nodes.size());
+    fwriteOrDie(nodes, f);
+    fputTag(f, "EDGE");
+    fputint(f, (int) edges.size());
+    fwriteOrDie(edges, f);
+    fputTag(f, "ALIG");
+    fputint(f, (int) align.size());
+    fwriteOrDie(align, f);
+    fputTag(f, "END ");
+}
+
+static std::string ReadTempFile(FILE* f)
+{
+    std::string bytes((size_t) fgetpos(f), '\0');
+    rewind(f);
+    freadOrDie(&bytes[0], 1, bytes.size(), f);
+    fclose(f);
+    return bytes;
+}
+
+// returns the lattice as it would be written in the V3 format
+static std::string MappableBytes(lattice& L)
+{
+    FILE* f = tmpfile();
+    BOOST_REQUIRE(f != nullptr);
+    L.fwritemappable(f);
+    return ReadTempFile(f);
+}
+
+struct LatticeArchiveFixture
+{
+    boost::filesystem::path m_dir;
+    std::unordered_map<std::string, size_t> m_modelSymMap;
+    std::vector<const char*> m_modelUnits; // [model unit] -> name
+    std::vector<unsigned int> m_idMap;     // [archive unit] -> model unit, with /sp/ appended like archive::getcachedidmap() does
+    std::vector<std::wstring> m_keys;
+
+    LatticeArchiveFixture()
+        : m_dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("latticearchive-%%%%-%%%%")),
+          m_modelSymMap({ { "a", 0 }, { "sp", 1 }, { "sil", 2 }, { "b", 3 } }),
+          m_keys({ L"utt1", L"utt2" })
+    {
+        boost::filesystem::create_directories(m_dir);
+        m_modelUnits.resize(m_modelSymMap.size());
+        for (const auto& unit : m_modelSymMap)
+            m_modelUnits[unit.second] = unit.first.c_str();
+        for (const char* unit : archiveUnits)
+            m_idMap.push_back((unsigned int) m_modelSymMap[unit]);
+        m_idMap.push_back((unsigned int) m_modelSymMap["sp"]);
+
+        // the handcrafted lattices, in the V1 format
+        for (size_t i = 0; i < m_keys.size(); i++)
+        {
+            auto_file_ptr f(fopenOrDie(V1Path(i), L"wb"));
+            WriteV1Lattice(f, TestEdges(-0.5f * i));
+        }
+    }
+    ~LatticeArchiveFixture()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(m_dir, ec);
+    }
+
+    std::wstring Path(const std::string& name) const { return (m_dir / name).wstring(); }
+    std::wstring V1Path(size_t i) const { return Path(msra::strfun::utf8(m_keys[i]) + ".lat"); }
+
+    // reads a handcrafted lattice with the given unit mapping
+    lattice ReadV1Lattice(size_t i, const std::vector<unsigned int>& idmap) const
+    {
+        auto_file_ptr f(fopenOrDie(V1Path(i), L"rb"));
+        lattice L;
+        L.fread(f, idmap, idmap.back());
+        return L;
+    }
+
+    // returns the lattice in an HTK-like text format, with the names of the model's units
+    std::string Dump(const lattice& L) const
+    {
+        FILE* f = tmpfile();
+        BOOST_REQUIRE(f != nullptr);
+        L.dump(f, [this](size_t unit) { return m_modelUnits[unit]; });
+        return ReadTempFile(f);
+    }
+
+    // checks a lattice read from the archives against the handcrafted one, read with the units mapped to the model
+    void CheckLattice(const lattice& L, size_t i) const
+    {
+        BOOST_CHECK_EQUAL(L.getnumnodes(), _countof(testNodeTimes));
+        BOOST_CHECK_EQUAL(L.getnumframes(), testNodeTimes[_countof(testNodeTimes) - 1]);
+        BOOST_CHECK_EQUAL(Dump(L), Dump(ReadV1Lattice(i, m_idMap)));
+        BOOST_CHECK(Dump(L).find("d=:a,0.01:sp,0.01:\n") != std::string::npos);
+    }
+
+    // writes an archive in the V2 format and one in the V3 format (the same way as archive::convert() does) with the same lattices
+    // Lattices are written with the archive's own unit numbering, so reading them maps the units to the model.
+    // Returns the offsets of the lattices in the V3 archive.
+    std::vector<uint64_t> WriteArchives()
+    {
+        std::vector<unsigned int> identity;
+        for (size_t k = 0; k < _countof(archiveUnits); k++)
+            identity.push_back((unsigned int) k);
+        identity.push_back((unsigned int) archiveSpUnit);
+
+        std::vector<uint64_t> mappableOffsets;
+        for (const std::string version : { "v2", "v3" })
+        {
+            const std::wstring archivePath = Path("lats." + version);
+            auto_file_ptr f(fopenOrDie(archivePath, L"wb"));
+            auto_file_ptr ftoc(fopenOrDie(archivePath + L".toc", L"wb"));
+            for (size_t i = 0; i < m_keys.size(); i++)
+            {
+                lattice L = ReadV1Lattice(i, identity);
+                L.builduniquealignments(archiveSpUnit);
+
+                if (version == "v3")
+                {
+                    L.rebuildedges(false);
+                    lattice::fwritepadding(f, (size_t) fgetpos(f));
+                }
+                const uint64_t offset = fgetpos(f);
+                if (version == "v3")
+                {
+                    L.fwritemappable(f);
+                    mappableOffsets.push_back(offset);
+                }
+                else
+                    L.fwrite(f);
+                fprintfOrDie(ftoc, "%s=%s[%llu]\n", msra::strfun::utf8(m_keys[i]).c_str(), i == 0 ? msra::strfun::utf8(archivePath).c_str() : "", (unsigned long long) offset);
+            }
+            auto_file_ptr fsymlist(fopenOrDie(archivePath + L".symlist", L"wb"));
+            for (const char* unit : archiveUnits)
+                fprintfOrDie(fsymlist, "%s\n", unit);
+        }
+        return mappableOffsets;
+    }
+
+};
+
+BOOST_FIXTURE_TEST_SUITE(LatticeArchiveTestSuite, LatticeArchiveFixture)
+
+BOOST_AUTO_TEST_CASE(MappableArchiveMatchesUnpackedArchive)
+{
+    WriteArchives();
+
+    // the V3 archive is memory-mapped and its lattices are used in place
+    msra::lattices::archive unpackedArchive(std::vector<std::wstring>(1, Path("lats.v2.toc")), m_modelSymMap);
+    msra::lattices::archive mappedArchive(std::vector<std::wstring>(1, Path("lats.v3.toc")), m_modelSymMap);
+    for (size_t i = 0; i < m_keys.size(); i++)
+    {
+        lattice unpacked, mapped;
+        unpackedArchive.getlattice(m_keys[i], unpacked);
+        mappedArchive.getlattice(m_keys[i], mapped, testNodeTimes[_countof(testNodeTimes) - 1]);
+        CheckLattice(unpacked, i);
+        CheckLattice(mapped, i);
+        BOOST_CHECK(MappableBytes(mapped) == MappableBytes(unpacked)); // including the scores and the header
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MappedViewMatchesFread)
+{
+    const auto offsets = WriteArchives();
+
+    // the archive file in 8-byte aligned memory, like a memory mapping
+    const std::wstring archivePath = Path("lats.v3");
+    auto_file_ptr f(fopenOrDie(archivePath, L"rb"));
+    const size_t size = filesize(f);
+    std::vector<uint64_t> buffer((size + 7) / 8);
+    freadOrDie(buffer.data(), 1, size, f);
+    const char* data = (const char*) buffer.data();
+    const std::string original(data, size);
+
+    for (size_t i = 0; i < m_keys.size(); i++)
+    {
+        BOOST_REQUIRE_EQUAL(offsets[i] % 8, 0);
+        lattice mapped, read;
+        mapped.frommappedview(data + offsets[i], size - offsets[i], m_idMap, m_idMap.back());
+        fsetpos(f, offsets[i]);
+        read.fread(f, m_idMap, m_idMap.back());
+        CheckLattice(mapped, i);
+        CheckLattice(read, i);
+        BOOST_CHECK(MappableBytes(mapped) == MappableBytes(read));
+
+        // lattices must start 8-byte aligned in the archive
+        lattice misaligned;
+        BOOST_CHECK_THROW(misaligned.frommappedview(data + offsets[i] + 4, size - offsets[i] - 4, m_idMap, m_idMap.back()), std::runtime_error);
+    }
+    // mapping the units copied them rather than modifying the mapped memory
+    BOOST_CHECK(std::string(data, size) == original);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,100 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NetworkTestHelper.h"
+#include "ComputationNetwork.h"
+#include <fstream>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// creates the network cache in a directory of its own
+struct NetworkCacheFixture
+{
+    boost::filesystem::path m_dir;
+
+    NetworkCacheFixture()
+        : m_dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("networkcache-%%%%-%%%%"))
+    {
+        boost::filesystem::create_directories(m_dir);
+    }
+    ~NetworkCacheFixture()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(m_dir, ec);
+    }
+
+    std::string Path(const std::string& name) const { return (m_dir / name).generic_string(); }
+
+    void WriteFile(const std::string& name, const std::string& content) const
+    {
+        std::ofstream stream(Path(name));
+        stream << content;
+    }
+
+    size_t NumCachedNetworks() const
+    {
+        size_t num = 0;
+        for (boost::filesystem::directory_iterator it(m_dir / "cache"), end; it != end; ++it)
+            num += it->path().extension() == ".dnn";
+        return num;
+    }
+
+    // builds the network through the factory of the 'train' and 'write' actions
+    ComputationNetworkPtr BuildNetwork(const std::string& sourceOfNetwork) const
+    {
+        ConfigParameters config;
+        config.Parse("deviceId = -1\n"
+                     "networkCacheDir = " + Path("cache") + "\n"
+                     "BrainScriptNetworkBuilder = [\n" + sourceOfNetwork + "\n]\n");
+        return GetNetworkFactory<ConfigParameters, float>(config)(CPUDEVICE);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(NetworkCacheTestSuite, NetworkCacheFixture)
+
+BOOST_AUTO_TEST_CASE(ChangedIncludeInvalidatesNetworkCache)
+{
+    const std::string sourceOfNetwork =
+        "include '" + Path("dims.bs") + "'\n"
+        "features = Input {2}\n"
+        "W = ParameterTensor {(hiddenDim:2)}\n"
+        "z = W * features\n"
+        "featureNodes = (features)\n"
+        "outputNodes = (z)";
+
+    WriteFile("dims.bs", "hiddenDim = 3\n");
+    BOOST_CHECK_EQUAL(BuildNetwork(sourceOfNetwork)->GetNodeFromName(L"W")->GetAsMatrixNumRows(), 3);
+    BOOST_CHECK_EQUAL(NumCachedNetworks(), 1);
+
+    // the same sources hit the cache
+    BOOST_CHECK_EQUAL(BuildNetwork(sourceOfNetwork)->GetNodeFromName(L"W")->GetAsMatrixNumRows(), 3);
+    BOOST_CHECK_EQUAL(NumCachedNetworks(), 1);
+
+    // the network description has not changed, but the file it includes has
+    WriteFile("dims.bs", "hiddenDim = 4\n");
+    BOOST_CHECK_EQUAL(BuildNetwork(sourceOfNetwork)->GetNodeFromName(L"W")->GetAsMatrixNumRows(), 4);
+    BOOST_CHECK_EQUAL(NumCachedNetworks(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(NetworkReadingFilesIsNotCached)
+{
+    WriteFile("W.txt", "1 2\n3 4\n5 6\n");
+    const std::string sourceOfNetwork =
+        "features = Input {2}\n"
+        "W = ParameterTensor {(3:2), init = 'fromFile', initFromFilePath = '" + Path("W.txt") + "'}\n"
+        "z = W * features\n"
+        "featureNodes = (features)\n"
+        "outputNodes = (z)";
+
+    auto net = BuildNetwork(sourceOfNetwork);
+    BOOST_CHECK_EQUAL(net->GetNodeFromName(L"W")->GetAsMatrixNumRows(), 3);
+    BOOST_CHECK(!boost::filesystem::exists(m_dir / "cache") || NumCachedNetworks() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,332 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ReaderPerformanceTests.cpp : end-to-end throughput benchmark for the readers, without a network
+//
+// Usage: readerperformancetests dataset=ctf|cbf|htk|image [dataDir=<dir>] [numSequences=4096] [sequenceLength=0]
+//                               [featureDim=256] [labelDim=1000] [chunkSize=1048576] [imageSize=64]
+//                               [randomize=true] [frameMode=true] [truncationLength=0] [options]
+//        readerperformancetests configFile=<file> inputs=features,labels:sparse [section=Benchmark] [readerSection=reader] [options]
+//
+// options: [type=float|double] [mbSize=256] [epochs=2] [epochSize=0] [warmupMinibatches=10]
+//          [profilerDir=<dir>] [format=text|json] [output=<file>]
+//
+// The first form generates a synthetic dataset in dataDir together with a reader configuration, the second form
+// drives any existing reader configuration, with the named inputs (':sparse' requests a sparse input matrix).
+// The reader is then run for the given number of epochs like during training, and the tool reports samples and
+// bytes per second, chunk-load latency percentiles and the time spent in each stage of the reader pipelines
+// (randomizer, deserializer, transforms, packer, copy into the input matrices), taken from the profiler events.
+// Prefetching and chunk loading run on background threads, so their times overlap with the main thread.
+// Note that a dataset that was just generated is usually in the OS page cache; to measure cold reads, drop the
+// cache between generating and reading. Also, if the randomization window covers the whole dataset, all chunks are
+// loaded during the warm-up; use randomize=false or a larger dataset to measure chunk loads.
+//
+#include "stdafx.h"
+#include "Basics.h"
+#include "Config.h"
+#include "DataReader.h"
+#include "Matrix.h"
+#include "Sequences.h"
+#include "fileutil.h"
+#include "PerformanceProfiler.h"
+#include "SyntheticData.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace Microsoft::MSR::CNTK::ReaderBenchmark;
+using namespace std;
+
+struct BenchmarkOptions
+{
+    string m_elemType = "float";
+    size_t m_mbSize = 256;
+    size_t m_epochs = 2;
+    size_t m_epochSize = 0; // 0 = the entire dataset
+    size_t m_warmupMinibatches = 10;
+};
+
+struct BenchmarkResult
+{
+    size_t m_minibatches = 0;
+    size_t m_samples = 0;
+    double m_seconds = 0;
+};
+
+// the profiler events that make up the reader pipeline, in pipeline order
+static const struct
+{
+    int m_eventId;
+    const char* m_name;
+} c_stages[] = {
+    {profilerEvtMainGetMinibatch, "GetMinibatch (main thread)"},
+    {profilerEvtPrefetchMinibatch, "Prefetch minibatch"},
+    {profilerEvtReaderGetSequences, "  Get sequences"},
+    {profilerEvtReaderLoadChunk, "    Load chunk"},
+    {profilerEvtReaderTransform, "    Transform sequences"},
+    {profilerEvtReaderPack, "  Pack minibatch"},
+    {profilerEvtReaderCopyToMatrices, "  Copy to matrices"},
+};
+
+static vector<string> SplitList(const string& s)
+{
+    vector<string> result;
+    size_t start = 0;
+    while (start <= s.size())
+    {
+        size_t end = s.find(',', start);
+        if (end == string::npos)
+            end = s.size();
+        if (end > start)
+            result.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+static shared_ptr<DataReader> CreateDataReader(const string& configFile, const string& section, const string& readerSection, const string& elemType)
+{
+    wstring configFileArg = L"configFile=" + msra::strfun::utf16(configFile);
+    wstring precisionArg = L"precision=" + msra::strfun::utf16(elemType);
+    wstring cntk = L"CNTK";
+    vector<wchar_t*> args{&cntk[0], &configFileArg[0], &precisionArg[0]};
+
+    ConfigParameters config;
+    const string rawConfigString = ConfigParameters::ParseCommandLine((int) args.size(), &args[0], config);
+    config.ResolveVariables(rawConfigString);
+    const ConfigParameters sectionConfig = config(section);
+    const ConfigParameters readerConfig = sectionConfig(readerSection);
+    return make_shared<DataReader>(readerConfig);
+}
+
+template <class ElemType>
+BenchmarkResult RunReader(DataReader& reader, const vector<pair<wstring, bool>>& inputNames, const BenchmarkOptions& options)
+{
+    StreamMinibatchInputs inputs;
+    vector<MBLayoutPtr> layouts;
+    for (auto& input : inputNames)
+    {
+        auto matrix = make_shared<Matrix<ElemType>>(CPUDEVICE);
+        if (input.second)
+            matrix->SwitchToMatrixType(MatrixType::SPARSE, MatrixFormat::matrixFormatSparseCSC, false);
+        layouts.push_back(make_shared<MBLayout>(1, 0, input.first));
+        inputs.insert(make_pair(input.first, StreamMinibatchInputs::Input(matrix, layouts.back(), TensorShape())));
+    }
+
+    typedef chrono::steady_clock Clock;
+    BenchmarkResult result;
+    size_t minibatches = 0;
+    Clock::time_point start;
+    for (size_t epoch = 0; epoch < options.m_epochs; epoch++)
+    {
+        reader.StartMinibatchLoop(options.m_mbSize, epoch, inputs.GetStreamDescriptions(), options.m_epochSize > 0 ? options.m_epochSize : requestDataSize);
+        for (;;)
+        {
+            // measurement starts after the warm-up minibatches, which include opening files and filling the prefetch queues
+            if (minibatches == options.m_warmupMinibatches)
+            {
+                ProfilerEnable(true);
+                start = Clock::now();
+            }
+
+            auto profGetMinibatch = ProfilerTimeBegin();
+            bool more = reader.GetMinibatch(inputs);
+            ProfilerTimeEnd(profGetMinibatch, profilerEvtMainGetMinibatch);
+            if (!more)
+                break;
+
+            if (minibatches >= options.m_warmupMinibatches)
+            {
+                result.m_minibatches++;
+                result.m_samples += layouts[0]->GetActualNumSamples();
+            }
+            minibatches++;
+        }
+    }
+    if (minibatches > options.m_warmupMinibatches)
+        result.m_seconds = chrono::duration<double>(Clock::now() - start).count();
+    ProfilerEnable(false);
+    return result;
+}
+
+static void WriteReport(FILE* f, bool json, const string& source, const BenchmarkResult& result, size_t bytesOnDisk)
+{
+    ProfilerEventStats chunkLoads = {}, throughput = {};
+    ProfilerGetEventStats(profilerEvtReaderLoadChunk, chunkLoads);
+    ProfilerGetEventStats(profilerEvtReaderThroughput, throughput);
+    double seconds = result.m_seconds > 0 ? result.m_seconds : 1;
+
+    if (!json)
+    {
+        fprintf(f, "source:               %s\n", source.c_str());
+        if (bytesOnDisk > 0)
+            fprintf(f, "dataset size:         %.1f MB\n", bytesOnDisk / 1e6);
+        fprintf(f, "minibatches:          %d\n", (int) result.m_minibatches);
+        fprintf(f, "samples:              %d\n", (int) result.m_samples);
+        fprintf(f, "time:                 %.3f s\n", result.m_seconds);
+        fprintf(f, "samples/s:            %.1f\n", result.m_samples / seconds);
+        fprintf(f, "minibatch data:       %.2f MB/s\n", throughput.total / seconds / 1e6);
+        fprintf(f, "chunk loads:          %d, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                chunkLoads.count, chunkLoads.p50 * 1e3, chunkLoads.p90 * 1e3, chunkLoads.p99 * 1e3, chunkLoads.max * 1e3);
+        fprintf(f, "\n%-30s %8s %12s %12s %12s %10s\n", "stage", "count", "total [s]", "mean [ms]", "p99 [ms]", "% of time");
+        for (auto& stage : c_stages)
+        {
+            ProfilerEventStats stats = {};
+            if (!ProfilerGetEventStats(stage.m_eventId, stats))
+                continue;
+            fprintf(f, "%-30s %8d %12.3f %12.3f %12.3f %10.1f\n", stage.m_name, stats.count, stats.total, stats.mean * 1e3, stats.p99 * 1e3, 100 * stats.total / seconds);
+        }
+    }
+    else
+    {
+        fprintf(f, "{\n  \"source\": \"%s\", \"bytesOnDisk\": %.0f, \"minibatches\": %d, \"samples\": %d, \"seconds\": %.6f,\n"
+                   "  \"samplesPerSecond\": %.3f, \"bytesPerSecond\": %.3f,\n"
+                   "  \"chunkLoads\": {\"count\": %d, \"p50\": %.9g, \"p90\": %.9g, \"p99\": %.9g, \"max\": %.9g},\n  \"stages\": [",
+                source.c_str(), (double) bytesOnDisk, (int) result.m_minibatches, (int) result.m_samples, result.m_seconds,
+                result.m_samples / seconds, throughput.total / seconds, chunkLoads.count, chunkLoads.p50, chunkLoads.p90, chunkLoads.p99, chunkLoads.max);
+        bool first = true;
+        for (auto& stage : c_stages)
+        {
+            ProfilerEventStats stats = {};
+            if (!ProfilerGetEventStats(stage.m_eventId, stats))
+                continue;
+            string name = stage.m_name;
+            name.erase(0, name.find_first_not_of(' '));
+            fprintf(f, "%s\n    {\"stage\": \"%s\", \"count\": %d, \"total\": %.9g, \"mean\": %.9g, \"p50\": %.9g, \"p90\": %.9g, \"p99\": %.9g, \"max\": %.9g}",
+                    first ? "" : ",", name.c_str(), stats.count, stats.total, stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+            first = false;
+        }
+        fprintf(f, "\n  ]\n}\n");
+    }
+    fflush(f);
+}
+
+static int Usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s dataset=ctf|cbf|htk|image [dataDir=<dir>] [numSequences=4096] [sequenceLength=0] [featureDim=256] [labelDim=1000]\n"
+                    "          [chunkSize=1048576] [imageSize=64] [randomize=true] [frameMode=true] [truncationLength=0] [options]\n"
+                    "       %s configFile=<file> inputs=features,labels:sparse [section=Benchmark] [readerSection=reader] [options]\n"
+                    "options: [type=float|double] [mbSize=256] [epochs=2] [epochSize=0] [warmupMinibatches=10] [profilerDir=<dir>]\n"
+                    "         [format=text|json] [output=<file>]\n", program, program);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    SyntheticDataOptions dataOptions;
+    string datasetFormat, dataDir, configFile, section = "Benchmark", readerSection = "reader", profilerDir, outputPath;
+    vector<pair<wstring, bool>> inputNames;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        auto eq = arg.find('=');
+        if (eq == string::npos)
+            return Usage(argv[0]);
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+        size_t number = (size_t) atoll(value.c_str());
+        bool flag = value == "true" || value == "1";
+        if (key == "dataset")
+            datasetFormat = value;
+        else if (key == "dataDir")
+            dataDir = value;
+        else if (key == "numSequences")
+            dataOptions.m_numSequences = number;
+        else if (key == "sequenceLength")
+            dataOptions.m_sequenceLength = number;
+        else if (key == "featureDim")
+            dataOptions.m_featureDim = number;
+        else if (key == "labelDim")
+            dataOptions.m_labelDim = number;
+        else if (key == "chunkSize")
+            dataOptions.m_chunkSizeInBytes = number;
+        else if (key == "imageSize")
+            dataOptions.m_imageSize = number;
+        else if (key == "randomize")
+            dataOptions.m_randomize = flag;
+        else if (key == "frameMode")
+            dataOptions.m_frameMode = flag;
+        else if (key == "truncationLength")
+            dataOptions.m_truncationLength = number;
+        else if (key == "configFile")
+            configFile = value;
+        else if (key == "section")
+            section = value;
+        else if (key == "readerSection")
+            readerSection = value;
+        else if (key == "inputs")
+        {
+            for (auto& input : SplitList(value))
+            {
+                auto colon = input.find(':');
+                inputNames.push_back(make_pair(msra::strfun::utf16(input.substr(0, colon)), colon != string::npos && input.substr(colon + 1) == "sparse"));
+            }
+        }
+        else if (key == "type" && (value == "float" || value == "double"))
+            options.m_elemType = value;
+        else if (key == "mbSize")
+            options.m_mbSize = max((size_t) 1, number);
+        else if (key == "epochs")
+            options.m_epochs = max((size_t) 1, number);
+        else if (key == "epochSize")
+            options.m_epochSize = number;
+        else if (key == "warmupMinibatches")
+            options.m_warmupMinibatches = number;
+        else if (key == "profilerDir")
+            profilerDir = value;
+        else if (key == "format" && (value == "text" || value == "json"))
+            json = value == "json";
+        else if (key == "output")
+            outputPath = value;
+        else
+            return Usage(argv[0]);
+    }
+    if (datasetFormat.empty() == configFile.empty() || (!configFile.empty() && inputNames.empty()))
+        return Usage(argv[0]);
+
+    try
+    {
+        size_t bytesOnDisk = 0;
+        string source = configFile;
+        if (!datasetFormat.empty())
+        {
+            if (dataDir.empty())
+                dataDir = "ReaderBenchmarkData/" + datasetFormat;
+            fprintf(stderr, "Generating %s dataset in %s...\n", datasetFormat.c_str(), dataDir.c_str());
+            auto dataset = GenerateSyntheticDataset(datasetFormat, dataDir, dataOptions);
+            configFile = dataset.m_configFile;
+            inputNames = dataset.m_inputs;
+            bytesOnDisk = dataset.m_bytesOnDisk;
+            source = datasetFormat + " (" + dataDir + ")";
+        }
+        if (profilerDir.empty())
+            profilerDir = (dataDir.empty() ? string(".") : dataDir) + "/profiler";
+        msra::files::make_intermediate_dirs(msra::strfun::utf16(profilerDir)); // (ProfilerInit() creates the last level)
+
+        // the profiler is initialized disabled, and only enabled after the warm-up minibatches
+        ProfilerInit(msra::strfun::utf16(profilerDir), 32 * 1024 * 1024, L"", /*syncGpu=*/false);
+        auto reader = CreateDataReader(configFile, section, readerSection, options.m_elemType);
+        auto result = options.m_elemType == "double" ? RunReader<double>(*reader, inputNames, options) : RunReader<float>(*reader, inputNames, options);
+        if (result.m_minibatches == 0)
+            fprintf(stderr, "Warning: The reader returned no minibatches after the %d warm-up minibatches.\n", (int) options.m_warmupMinibatches);
+
+        FILE* out = outputPath.empty() ? stdout : fopenOrDie(outputPath, "w");
+        WriteReport(out, json, source, result, bytesOnDisk);
+        if (out != stdout)
+            fcloseOrDie(out);
+        reader.reset();
+        ProfilerClose(); // (also writes the profiler summary and detail logs into profilerDir)
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "Reader benchmark failed: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// SyntheticData.cpp -- generates random datasets and matching reader configurations for the reader benchmarks
+//
+
+#include "stdafx.h"
+#include "SyntheticData.h"
+#include "Basics.h"
+#include "fileutil.h"
+#include <algorithm>
+#include <random>
+#include <stdint.h>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace ReaderBenchmark {
+
+static FILE* OpenForWriting(const string& path)
+{
+    msra::files::make_intermediate_dirs(msra::strfun::utf16(path));
+    return fopenOrDie(path, "wb");
+}
+
+// file size, for reporting
+static size_t CloseFile(FILE* f)
+{
+    size_t size = (size_t) ftell(f);
+    fcloseOrDie(f);
+    return size;
+}
+
+// Samples are dense random vectors, and labels are uniformly drawn classes. The generator is seeded, so that
+// repeated runs with the same options read identical data.
+class SampleGenerator
+{
+public:
+    SampleGenerator(const SyntheticDataOptions& options)
+        : m_rng(options.m_seed), m_values(-1, 1), m_labels(0, (int) options.m_labelDim - 1)
+    {
+    }
+
+    void NextSample(vector<float>& sample)
+    {
+        for (auto& v : sample)
+            v = m_values(m_rng);
+    }
+
+    int NextLabel() { return m_labels(m_rng); }
+
+    mt19937& Rng() { return m_rng; }
+
+private:
+    mt19937 m_rng;
+    uniform_real_distribution<float> m_values;
+    uniform_int_distribution<int> m_labels;
+};
+
+// -----------------------------------------------------------------------
+// CNTK text format: one line per sample, dense features and one-hot sparse labels
+// -----------------------------------------------------------------------
+
+static SyntheticDataset GenerateCTF(const string& dir, const SyntheticDataOptions& options)
+{
+    SampleGenerator gen(options);
+    vector<float> sample(options.m_featureDim);
+    string dataFile = dir + "/data.ctf";
+    FILE* f = OpenForWriting(dataFile);
+    for (size_t s = 0; s < options.m_numSequences; s++)
+    {
+        for (size_t t = 0; t < options.m_sequenceLength; t++)
+        {
+            gen.NextSample(sample);
+            fprintfOrDie(f, "%d |features", (int) s);
+            for (auto v : sample)
+                fprintfOrDie(f, " %.4f", v);
+            // (one label per sequence, on its first sample)
+            if (t == 0)
+                fprintfOrDie(f, " |labels %d:1", gen.NextLabel());
+            fprintfOrDie(f, "\n");
+        }
+    }
+
+    SyntheticDataset dataset;
+    dataset.m_bytesOnDisk = CloseFile(f);
+    dataset.m_inputs = {{L"features", false}, {L"labels", true}};
+    dataset.m_configFile = dir + "/reader.cntk";
+    f = OpenForWriting(dataset.m_configFile);
+    fprintfOrDie(f, "Benchmark = [\n    reader = [\n        readerType = \"CNTKTextFormatReader\"\n        file = \"%s\"\n"
+                    "        randomize = %s\n        chunkSizeInBytes = %d\n        frameMode = %s\n        traceLevel = 0\n"
+                    "        input = [\n            features = [ dim = %d ; format = \"dense\" ]\n            labels = [ dim = %d ; format = \"sparse\" ]\n        ]\n    ]\n]\n",
+                 dataFile.c_str(), options.m_randomize ? "true" : "false", (int) options.m_chunkSizeInBytes,
+                 options.m_frameMode && options.m_sequenceLength == 1 ? "true" : "false", (int) options.m_featureDim, (int) options.m_labelDim);
+    CloseFile(f);
+    return dataset;
+}
+
+// -----------------------------------------------------------------------
+// CNTK binary format (version 1): dense features and sparse CSC labels, one sample per sequence
+// -----------------------------------------------------------------------
+
+#pragma pack(push, 1)
+struct CBFOffsetsEntry
+{
+    int64_t offset; // relative to the end of the offsets table
+    int32_t numSequences;
+    int32_t numSamples;
+};
+#pragma pack(pop)
+
+static void WriteCBFInputHeader(FILE* f, const char* name, bool sparse, size_t dim)
+{
+    int32_t nameLength = (int32_t) strlen(name);
+    fwriteOrDie(&nameLength, sizeof(nameLength), 1, f);
+    fwriteOrDie(name, 1, nameLength, f);
+    int32_t header[5] = {sparse ? 1 : 0, 0 /*sparse CSC / float*/, 0 /*float / not a sequence*/, 0, 0};
+    int32_t numCols = (int32_t) dim;
+    if (sparse) // deserializer type, storage type, element type, isSequence, numCols
+    {
+        header[4] = numCols;
+        fwriteOrDie(header, sizeof(int32_t), 5, f);
+    }
+    else // deserializer type, element type, numCols
+    {
+        header[2] = numCols;
+        fwriteOrDie(header, sizeof(int32_t), 3, f);
+    }
+}
+
+static SyntheticDataset GenerateCBF(const string& dir, const SyntheticDataOptions& options)
+{
+    if (options.m_sequenceLength != 1)
+        InvalidArgument("GenerateSyntheticDataset: The cbf format is generated with one sample per sequence only.");
+
+    // chunk layout, in order: features (numSequences x dim floats); labels (nnz, values[nnz], rowIndices[nnz], colOffsets[numSequences + 1])
+    size_t bytesPerSequence = options.m_featureDim * sizeof(float) + sizeof(float) + 2 * sizeof(int32_t);
+    size_t sequencesPerChunk = max((size_t) 1, options.m_chunkSizeInBytes / bytesPerSequence);
+    size_t numChunks = (options.m_numSequences + sequencesPerChunk - 1) / sequencesPerChunk;
+
+    string dataFile = dir + "/data.cbf";
+    FILE* f = OpenForWriting(dataFile);
+    int64_t version = 1, numChunks64 = (int64_t) numChunks;
+    int32_t numInputs = 2;
+    fwriteOrDie(&version, sizeof(version), 1, f);
+    fwriteOrDie(&numChunks64, sizeof(numChunks64), 1, f);
+    fwriteOrDie(&numInputs, sizeof(numInputs), 1, f);
+    WriteCBFInputHeader(f, "features", false, options.m_featureDim);
+    WriteCBFInputHeader(f, "labels", true, options.m_labelDim);
+
+    vector<CBFOffsetsEntry> offsets(numChunks);
+    int64_t offset = 0;
+    for (size_t c = 0; c < numChunks; c++)
+    {
+        size_t numSequences = min(sequencesPerChunk, options.m_numSequences - c * sequencesPerChunk);
+        offsets[c].offset = offset;
+        offsets[c].numSequences = (int32_t) numSequences;
+        offsets[c].numSamples = (int32_t) numSequences;
+        offset += numSequences * bytesPerSequence + 2 * sizeof(int32_t);
+    }
+    fwriteOrDie(offsets, f);
+
+    SampleGenerator gen(options);
+    vector<float> features, sample(options.m_featureDim), labelValues;
+    vector<int32_t> rowIndices, colOffsets;
+    for (size_t c = 0; c < numChunks; c++)
+    {
+        size_t numSequences = offsets[c].numSequences;
+        features.clear();
+        rowIndices.clear();
+        colOffsets.assign(1, 0);
+        for (size_t s = 0; s < numSequences; s++)
+        {
+            gen.NextSample(sample);
+            features.insert(features.end(), sample.begin(), sample.end());
+            rowIndices.push_back(gen.NextLabel()); // (sample index 0 within the sequence)
+            colOffsets.push_back((int32_t) rowIndices.size());
+        }
+        labelValues.assign(rowIndices.size(), 1.0f);
+        int32_t nnz = (int32_t) rowIndices.size();
+        fwriteOrDie(features, f);
+        fwriteOrDie(&nnz, sizeof(nnz), 1, f);
+        fwriteOrDie(labelValues, f);
+        fwriteOrDie(rowIndices, f);
+        fwriteOrDie(colOffsets, f);
+    }
+
+    SyntheticDataset dataset;
+    dataset.m_bytesOnDisk = CloseFile(f);
+    dataset.m_inputs = {{L"features", false}, {L"labels", true}};
+    dataset.m_configFile = dir + "/reader.cntk";
+    f = OpenForWriting(dataset.m_configFile);
+    fprintfOrDie(f, "Benchmark = [\n    reader = [\n        readerType = \"CNTKBinaryReader\"\n        file = \"%s\"\n"
+                    "        randomize = \"%s\"\n        traceLevel = 0\n    ]\n]\n",
+                 dataFile.c_str(), options.m_randomize ? "true" : "false");
+    CloseFile(f);
+    return dataset;
+}
+
+// -----------------------------------------------------------------------
+// HTK: features in archives of big-endian USER parameter files, frame labels in an MLF
+// -----------------------------------------------------------------------
+
+static void WriteBigEndian(FILE* f, const void* data, size_t size, size_t count)
+{
+    vector<char> buffer((const char*) data, (const char*) data + size * count);
+    for (size_t i = 0; i < count; i++)
+        reverse(buffer.begin() + i * size, buffer.begin() + (i + 1) * size);
+    fwriteOrDie(buffer, f);
+}
+
+static SyntheticDataset GenerateHTK(const string& dir, const SyntheticDataOptions& options)
+{
+    const int32_t samplePeriod = 100000; // 10 ms in 100 ns units, also the MLF time unit per frame
+    const size_t labelSegmentLength = 10;
+    size_t bytesPerUtterance = options.m_sequenceLength * options.m_featureDim * sizeof(float);
+    size_t utterancesPerArchive = max((size_t) 1, options.m_chunkSizeInBytes / bytesPerUtterance);
+
+    SampleGenerator gen(options);
+    vector<float> sample(options.m_featureDim);
+    FILE* scp = OpenForWriting(dir + "/features.scp");
+    FILE* mlf = OpenForWriting(dir + "/labels.mlf");
+    fprintfOrDie(mlf, "#!MLF!#\n");
+
+    SyntheticDataset dataset;
+    dataset.m_bytesOnDisk = 0;
+    for (size_t first = 0; first < options.m_numSequences; first += utterancesPerArchive)
+    {
+        size_t numUtterances = min(utterancesPerArchive, options.m_numSequences - first);
+        string archiveName = "features" + to_string(first / utterancesPerArchive) + ".chunk";
+        FILE* archive = OpenForWriting(dir + "/" + archiveName);
+        int32_t numFrames = (int32_t) (numUtterances * options.m_sequenceLength);
+        int16_t sampleSize = (int16_t) (options.m_featureDim * sizeof(float)), parameterKind = 9 /*USER*/;
+        WriteBigEndian(archive, &numFrames, sizeof(numFrames), 1);
+        WriteBigEndian(archive, &samplePeriod, sizeof(samplePeriod), 1);
+        WriteBigEndian(archive, &sampleSize, sizeof(sampleSize), 1);
+        WriteBigEndian(archive, &parameterKind, sizeof(parameterKind), 1);
+        for (size_t u = 0; u < numUtterances; u++)
+        {
+            size_t firstFrame = u * options.m_sequenceLength;
+            // ("..." is expanded to the directory of the SCP file)
+            fprintfOrDie(scp, "utt%07d.mfc=.../%s[%d,%d]\n", (int) (first + u), archiveName.c_str(), (int) firstFrame, (int) (firstFrame + options.m_sequenceLength - 1));
+            fprintfOrDie(mlf, "\"utt%07d.lab\"\n", (int) (first + u));
+            for (size_t t = 0; t < options.m_sequenceLength; t++)
+            {
+                gen.NextSample(sample);
+                WriteBigEndian(archive, sample.data(), sizeof(float), sample.size());
+                if (t % labelSegmentLength == 0)
+                {
+                    size_t end = min(t + labelSegmentLength, options.m_sequenceLength);
+                    fprintfOrDie(mlf, "%lld %lld s%d\n", (long long) t * samplePeriod, (long long) end * samplePeriod, gen.NextLabel());
+                }
+            }
+            fprintfOrDie(mlf, ".\n");
+        }
+        dataset.m_bytesOnDisk += CloseFile(archive);
+    }
+    CloseFile(scp);
+    dataset.m_bytesOnDisk += CloseFile(mlf);
+
+    FILE* stateList = OpenForWriting(dir + "/states.list");
+    for (size_t i = 0; i < options.m_labelDim; i++)
+        fprintfOrDie(stateList, "s%d\n", (int) i);
+    CloseFile(stateList);
+
+    dataset.m_inputs = {{L"features", false}, {L"labels", false}};
+    dataset.m_configFile = dir + "/reader.cntk";
+    FILE* f = OpenForWriting(dataset.m_configFile);
+    string mode = options.m_truncationLength > 0 ? "frameMode = false\n        truncated = true\n        truncationLength = " + to_string(options.m_truncationLength)
+                                                 : string("frameMode = ") + (options.m_frameMode ? "true" : "false");
+    fprintfOrDie(f, "Benchmark = [\n    reader = [\n        readerType = \"HTKDeserializers\"\n        readMethod = \"%s\"\n"
+                    "        randomize = \"%s\"\n        %s\n        verbosity = 0\n"
+                    "        features = [ dim = %d ; type = \"real\" ; scpFile = \"%s/features.scp\" ]\n"
+                    "        labels = [ mlfFile = \"%s/labels.mlf\" ; labelMappingFile = \"%s/states.list\" ; labelDim = %d ; labelType = \"category\" ]\n    ]\n]\n",
+                 options.m_randomize ? "blockRandomize" : "none", options.m_randomize ? "auto" : "none", mode.c_str(), (int) options.m_featureDim,
+                 dir.c_str(), dir.c_str(), dir.c_str(), (int) options.m_labelDim);
+    CloseFile(f);
+    return dataset;
+}
+
+// -----------------------------------------------------------------------
+// images: binary PPM files and a map file, decoded and transformed by the ImageReader
+// -----------------------------------------------------------------------
+
+static SyntheticDataset GenerateImages(const string& dir, const SyntheticDataOptions& options)
+{
+    if (options.m_sequenceLength != 1)
+        InvalidArgument("GenerateSyntheticDataset: Images are generated with one sample per sequence only.");
+
+    SampleGenerator gen(options);
+    uniform_int_distribution<int> pixel(0, 255);
+    vector<unsigned char> pixels(options.m_imageSize * options.m_imageSize * 3);
+    FILE* map = OpenForWriting(dir + "/images.map");
+
+    SyntheticDataset dataset;
+    dataset.m_bytesOnDisk = 0;
+    for (size_t i = 0; i < options.m_numSequences; i++)
+    {
+        string imageFile = dir + "/images/" + to_string(i) + ".ppm";
+        FILE* image = OpenForWriting(imageFile);
+        fprintfOrDie(image, "P6\n%d %d\n255\n", (int) options.m_imageSize, (int) options.m_imageSize);
+        for (auto& p : pixels)
+            p = (unsigned char) pixel(gen.Rng());
+        fwriteOrDie(pixels, image);
+        dataset.m_bytesOnDisk += CloseFile(image);
+        fprintfOrDie(map, "%s\t%d\n", imageFile.c_str(), gen.NextLabel());
+    }
+    CloseFile(map);
+
+    dataset.m_inputs = {{L"features", false}, {L"labels", false}};
+    dataset.m_configFile = dir + "/reader.cntk";
+    FILE* f = OpenForWriting(dataset.m_configFile);
+    // crop to 7/8 of the side and scale back, which is the usual training-time augmentation
+    size_t size = options.m_imageSize * 7 / 8;
+    fprintfOrDie(f, "Benchmark = [\n    reader = [\n        readerType = \"ImageReader\"\n        file = \"%s/images.map\"\n"
+                    "        randomize = \"%s\"\n        traceLevel = 0\n"
+                    "        features = [ width = %d ; height = %d ; channels = 3 ; cropType = \"randomside\" ; sideRatio = 0.875 ; jitterType = \"uniRatio\" ; interpolations = \"linear\" ]\n"
+                    "        labels = [ labelDim = %d ]\n    ]\n]\n",
+                 dir.c_str(), options.m_randomize ? "auto" : "none", (int) size, (int) size, (int) options.m_labelDim);
+    CloseFile(f);
+    return dataset;
+}
+
+SyntheticDataset GenerateSyntheticDataset(const string& format, const string& dir, const SyntheticDataOptions& options)
+{
+    if (options.m_numSequences == 0 || options.m_featureDim == 0 || options.m_labelDim == 0)
+        InvalidArgument("GenerateSyntheticDataset: numSequences, featureDim and labelDim must be positive.");
+
+    SyntheticDataOptions resolved = options;
+    if (resolved.m_sequenceLength == 0)
+        resolved.m_sequenceLength = format == "htk" ? 100 : 1;
+
+    if (format == "ctf")
+        return GenerateCTF(dir, resolved);
+    else if (format == "cbf")
+        return GenerateCBF(dir, resolved);
+    else if (format == "htk")
+        return GenerateHTK(dir, resolved);
+    else if (format == "image")
+        return GenerateImages(dir, resolved);
+    else
+        InvalidArgument("GenerateSyntheticDataset: Unknown format '%s', expected ctf, cbf, htk or image.", format.c_str());
+}
+
+}}}}
@@ -0,0 +1,41 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// SyntheticData.h -- generates random datasets and matching reader configurations for the reader benchmarks
+//
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace ReaderBenchmark {
+
+struct SyntheticDataOptions
+{
+    size_t m_numSequences = 4096;
+    size_t m_sequenceLength = 0;            // samples per sequence; 0 = 100 for htk, 1 otherwise (cbf and image only support 1)
+    size_t m_featureDim = 256;              // ignored for image, see m_imageSize
+    size_t m_labelDim = 1000;
+    size_t m_chunkSizeInBytes = 1024 * 1024; // approximate size of a chunk on disk
+    size_t m_imageSize = 64;                // width and height of the generated images
+    bool m_randomize = true;
+    bool m_frameMode = true;                // htk only
+    size_t m_truncationLength = 0;          // htk only; > 0 = truncated BPTT instead of frame mode
+    unsigned int m_seed = 1;
+};
+
+struct SyntheticDataset
+{
+    std::string m_configFile;                             // contains 'Benchmark = [ reader = [ ... ] ]'
+    std::vector<std::pair<std::wstring, bool>> m_inputs; // (stream name, sparse)
+    size_t m_bytesOnDisk;
+};
+
+// Writes a dataset of the given format ("ctf", "cbf", "htk" or "image") with a dense 'features' and a one-hot
+// 'labels' stream into 'dir', together with the reader configuration to read it. Existing files are overwritten.
+SyntheticDataset GenerateSyntheticDataset(const std::string& format, const std::string& dir, const SyntheticDataOptions& options);
+
+}}}}
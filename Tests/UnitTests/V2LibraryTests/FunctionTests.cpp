@@ -725,6 +725,102 @@ void TestOuputVariableName(const DeviceDescriptor& device)
         static_cast<unsigned long>(output->Output().Shape().TotalSize()));
 }
 
+// A Function compiles a network per device, set of requested outputs and backprop roots. Switching between these across
+// Forward calls must neither affect the results nor a pending backprop state, and only recently used networks are kept.
+void TestSwitchingNetworksAcrossForwardCalls(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 5, numLayers = 7;
+    auto input = InputVariable({ inputDim }, DataType::Float, L"input");
+    auto param = Parameter({ inputDim, inputDim }, DataType::Float, GlorotUniformInitializer(), device, L"W");
+    std::vector<FunctionPtr> layers;
+    Variable layerInput = input;
+    for (size_t i = 0; i < numLayers; ++i)
+    {
+        layers.push_back(Tanh(Times(param, layerInput)));
+        layerInput = layers.back();
+    }
+    auto root = layers.back();
+
+    auto sequences = GenerateSequences<float>({ 2, 3 }, { inputDim });
+    auto forward = [&sequences, inputDim](const FunctionPtr& function, const Variable& output, const DeviceDescriptor& computeDevice, const std::unordered_set<Variable>& backpropRoots, ValuePtr& outputValue)
+    {
+        std::unordered_map<Variable, ValuePtr> outputs = { { output, nullptr } };
+        auto backpropState = function->Forward({ { function->Arguments()[0], Value::Create(NDShape({ inputDim }), sequences, computeDevice, true) } }, outputs, computeDevice, backpropRoots);
+        outputValue = outputs[output]->DeepClone();
+        return backpropState;
+    };
+    auto backward = [&param](const FunctionPtr& function, const BackPropStatePtr& backpropState, const ValuePtr& rootGradientValue)
+    {
+        std::unordered_map<Variable, ValuePtr> gradients = { { param, nullptr } };
+        function->Backward(backpropState, { { function->Output(), rootGradientValue } }, gradients);
+        return gradients[param]->DeepClone();
+    };
+
+    // The expected values are computed by other Functions, each of which only ever compiles a single network
+    auto reference = root->Clone(ParameterCloningMethod::Share);
+    ValuePtr expectedRootValue, expectedLayerValue;
+    auto referenceBackpropState = forward(reference, reference->Output(), device, { reference->Output() }, expectedRootValue);
+    auto expectedGradient = backward(reference, referenceBackpropState, expectedRootValue);
+    forward(layers[0], layers[0]->Output(), device, {}, expectedLayerValue);
+
+    // Backward uses the network of the Forward call that created the state, although another network was computed with in between
+    ValuePtr rootValue, layerValue;
+    auto backpropState = forward(root, root->Output(), device, { root->Output() }, rootValue);
+    forward(root, layers[0]->Output(), device, {}, layerValue);
+    auto gradient = backward(root, backpropState, rootValue);
+    if (!Internal::AreEqual(*rootValue, *expectedRootValue, relativeTolerance, absoluteTolerance))
+        ReportFailure("Function output does not match the expected value.");
+    if (!Internal::AreEqual(*layerValue, *expectedLayerValue, relativeTolerance, absoluteTolerance))
+        ReportFailure("Output of an intermediate layer does not match the expected value.");
+    if (!Internal::AreEqual(*gradient, *expectedGradient, relativeTolerance, absoluteTolerance))
+        ReportFailure("Parameter gradient does not match the expected value after switching outputs between Forward and Backward.");
+
+    // Requesting the outputs of the other layers one at a time compiles a new network each, and the least recently used
+    // networks are discarded, including the one the backprop state was created with
+    backpropState = forward(root, root->Output(), device, { root->Output() }, rootValue);
+    for (size_t i = 0; i < numLayers - 1; ++i)
+    {
+        forward(root, layers[i]->Output(), device, {}, layerValue);
+        forward(layers[i], layers[i]->Output(), device, {}, expectedLayerValue);
+        if (!Internal::AreEqual(*layerValue, *expectedLayerValue, relativeTolerance, absoluteTolerance))
+            ReportFailure("Output of an intermediate layer does not match the expected value.");
+    }
+    VerifyException([&]() {
+        backward(root, backpropState, rootValue);
+    }, "Was able to backpropagate with the state of a network that should have been discarded.");
+
+    // Networks are rebuilt as needed
+    backpropState = forward(root, root->Output(), device, { root->Output() }, rootValue);
+    gradient = backward(root, backpropState, rootValue);
+    if (!Internal::AreEqual(*gradient, *expectedGradient, relativeTolerance, absoluteTolerance))
+        ReportFailure("Parameter gradient does not match the expected value.");
+
+    if (IsGPUAvailable())
+    {
+        auto otherDevice = (device.Type() == DeviceKind::CPU) ? DeviceDescriptor::GPUDevice(0) : DeviceDescriptor::CPUDevice();
+
+        // Parameters are shared by all networks of a Function and cannot be computed with on another device
+        VerifyException([&]() {
+            forward(root, root->Output(), otherDevice, {}, rootValue);
+        }, "Was able to compute with a Parameter on a device other than its own.");
+
+        // A Function without Parameters can switch devices back and forth
+        FunctionPtr constantRoot;
+        Variable constantLayerInput = input;
+        for (size_t i = 0; i < numLayers; ++i)
+        {
+            constantRoot = Tanh(Times(Constant(param.Value()), constantLayerInput));
+            constantLayerInput = constantRoot;
+        }
+        for (auto computeDevice : { device, otherDevice, device })
+        {
+            forward(constantRoot, constantRoot->Output(), computeDevice, {}, rootValue);
+            if (!Internal::AreEqual(*rootValue, *expectedRootValue, relativeTolerance, absoluteTolerance))
+                ReportFailure("Function output does not match the expected value after switching devices.");
+        }
+    }
+}
+
 void FunctionTests()
 {
     fprintf(stderr, "\nFunctionTests..\n");
@@ -755,5 +851,9 @@ void FunctionTests()
         TestTranspose(3, 1, 2, DeviceDescriptor::GPUDevice(0));
 
     TestOuputVariableName(DeviceDescriptor::CPUDevice());
+
+    TestSwitchingNetworksAcrossForwardCalls(DeviceDescriptor::CPUDevice());
+    if (IsGPUAvailable())
+        TestSwitchingNetworksAcrossForwardCalls(DeviceDescriptor::GPUDevice(0));
 }
 